@@ -0,0 +1,85 @@
+/*
+	Copyright 2026 VESC project
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+// Host benchmark of utils_crc32c against the previous bit-serial
+// implementation. The absolute numbers say little about the MCUs, the ratio
+// is what matters.
+//
+// Usage: crc32c_bench [SIZE [ROUNDS]]
+
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static uint32_t crc32c_bitwise(const uint8_t *data, uint32_t len) {
+	uint32_t crc = 0xFFFFFFFF;
+
+	for (uint32_t i = 0; i < len;i++) {
+		uint32_t byte = data[i];
+		crc = crc ^ byte;
+
+		for (int j = 7;j >= 0;j--) {
+			uint32_t mask = -(crc & 1);
+			crc = (crc >> 1) ^ (0x82F63B78 & mask);
+		}
+	}
+
+	return ~crc;
+}
+
+static double now_s(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv) {
+	uint32_t size = argc > 1 ? strtoul(argv[1], NULL, 10) : 512;
+	uint32_t rounds = argc > 2 ? strtoul(argv[2], NULL, 10) : 20000;
+
+	uint8_t *buffer = malloc(size);
+	for (uint32_t i = 0; i < size; i++) {
+		buffer[i] = rand();
+	}
+
+	// accumulate the results so that the calls aren't optimized out
+	volatile uint32_t sink = 0;
+
+	double start = now_s();
+	for (uint32_t i = 0; i < rounds; i++) {
+		sink += crc32c_bitwise(buffer, size);
+	}
+	double bitwise = now_s() - start;
+
+	start = now_s();
+	for (uint32_t i = 0; i < rounds; i++) {
+		sink += utils_crc32c(buffer, size);
+	}
+	double table = now_s() - start;
+
+	double mb = (double)size * rounds / 1e6;
+	printf("%u B x %u rounds\n", size, rounds);
+	printf("bit-serial:   %8.1f MB/s\n", mb / bitwise);
+	printf("utils_crc32c: %8.1f MB/s (%.1fx)\n", mb / table, bitwise / table);
+
+	free(buffer);
+	return 0;
+}
@@ -0,0 +1,107 @@
+/*
+	Copyright 2026 VESC project
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+// Conformance test of utils_crc32c and utils_crc32c_update against the
+// previous bit-serial implementation. Built once per variant, see
+// UTILS_CRC32C_SLICE_BY_4 in utils.c.
+
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_LEN 1100
+
+static int failures = 0;
+
+static void check(bool condition, const char *name) {
+	printf("%s %s\n", condition ? "✓" : "✗", name);
+	if (!condition) {
+		failures++;
+	}
+}
+
+// The bit-serial implementation utils_crc32c used to have
+static uint32_t crc32c_reference(const uint8_t *data, uint32_t len) {
+	uint32_t crc = 0xFFFFFFFF;
+
+	for (uint32_t i = 0; i < len;i++) {
+		uint32_t byte = data[i];
+		crc = crc ^ byte;
+
+		for (int j = 7;j >= 0;j--) {
+			uint32_t mask = -(crc & 1);
+			crc = (crc >> 1) ^ (0x82F63B78 & mask);
+		}
+	}
+
+	return ~crc;
+}
+
+int main(void) {
+	uint8_t check_string[] = "123456789";
+	check(utils_crc32c(check_string, 9) == 0xE3069283, "check value of \"123456789\"");
+	check(utils_crc32c(check_string, 0) == 0, "empty data");
+
+	// all lengths at all alignments, so that the word loop starts and ends at
+	// every position
+	static uint8_t buffer[MAX_LEN + 4];
+	srand(1);
+	for (int i = 0; i < MAX_LEN + 4; i++) {
+		buffer[i] = rand();
+	}
+
+	uint32_t mismatches = 0;
+	for (int offset = 0; offset < 4; offset++) {
+		for (uint32_t len = 0; len <= MAX_LEN; len++) {
+			if (utils_crc32c(buffer + offset, len) != crc32c_reference(buffer + offset, len)) {
+				mismatches++;
+			}
+		}
+	}
+	check(mismatches == 0, "matches the bit-serial implementation for all lengths and alignments");
+
+	memset(buffer, 0xFF, sizeof(buffer));
+	check(utils_crc32c(buffer, MAX_LEN) == crc32c_reference(buffer, MAX_LEN), "all ones");
+
+	for (int i = 0; i < MAX_LEN + 4; i++) {
+		buffer[i] = rand();
+	}
+
+	mismatches = 0;
+	uint32_t expected = crc32c_reference(buffer, MAX_LEN);
+	for (uint32_t split = 0; split <= MAX_LEN; split++) {
+		uint32_t crc = utils_crc32c_update(0, buffer, split);
+		crc = utils_crc32c_update(crc, buffer + split, MAX_LEN - split);
+		if (crc != expected) {
+			mismatches++;
+		}
+	}
+	check(mismatches == 0, "update over two parts equals the whole for every split");
+
+	uint32_t crc = 0;
+	for (uint32_t pos = 0, step = 1; pos < MAX_LEN; pos += step, step = step % 17 + 1) {
+		uint32_t len = pos + step > MAX_LEN ? MAX_LEN - pos : step;
+		crc = utils_crc32c_update(crc, buffer + pos, len);
+	}
+	check(crc == expected, "update over many uneven chunks equals the whole");
+
+	return failures ? 1 : 0;
+}
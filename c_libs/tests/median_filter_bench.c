@@ -0,0 +1,103 @@
+/*
+	Copyright 2026 VESC project
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+// Host benchmark of the median filters for window sizes 5 to 64: the previous
+// qsort implementation, utils_median_filter_uint16_run and the sliding window
+// filter.
+//
+// Usage: median_filter_bench [SAMPLES]
+
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_LEN 64
+
+static int uint16_cmp_func (const void *a, const void *b) {
+	return (*(uint16_t*)a - *(uint16_t*)b);
+}
+
+static uint16_t median_qsort(uint16_t *buffer,
+		unsigned int *buffer_index, unsigned int filter_len, uint16_t sample) {
+	buffer[(*buffer_index)++] = sample;
+	*buffer_index %= filter_len;
+	uint16_t buffer_sorted[filter_len];
+	memcpy(buffer_sorted, buffer, sizeof(uint16_t) * filter_len);
+	qsort(buffer_sorted, filter_len, sizeof(uint16_t), uint16_cmp_func);
+	return buffer_sorted[filter_len / 2];
+}
+
+static double now_s(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv) {
+	unsigned int samples = argc > 1 ? strtoul(argv[1], NULL, 10) : 200000;
+	static const unsigned int lens[] = {5, 9, 16, 32, 64};
+
+	uint16_t *input = malloc(samples * sizeof(uint16_t));
+	for (unsigned int i = 0; i < samples; i++) {
+		input[i] = 2000 + rand() % 200;
+	}
+
+	// accumulate the results so that the calls aren't optimized out
+	volatile uint32_t sink = 0;
+
+	printf("ns per sample\n");
+	printf("%6s %10s %10s %10s\n", "window", "qsort", "run", "sliding");
+	for (unsigned int l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+		unsigned int len = lens[l];
+		uint16_t buffer[MAX_LEN] = {0};
+		unsigned int index = 0;
+
+		double start = now_s();
+		for (unsigned int i = 0; i < samples; i++) {
+			sink += median_qsort(buffer, &index, len, input[i]);
+		}
+		double t_qsort = now_s() - start;
+
+		memset(buffer, 0, sizeof(buffer));
+		index = 0;
+		start = now_s();
+		for (unsigned int i = 0; i < samples; i++) {
+			sink += utils_median_filter_uint16_run(buffer, &index, len, input[i]);
+		}
+		double t_run = now_s() - start;
+
+		uint16_t storage[2 * MAX_LEN];
+		utils_median_filter_uint16_t filter;
+		utils_median_filter_uint16_init(&filter, storage, len);
+		start = now_s();
+		for (unsigned int i = 0; i < samples; i++) {
+			sink += utils_median_filter_uint16_add(&filter, input[i]);
+		}
+		double t_sliding = now_s() - start;
+
+		printf("%6u %10.1f %10.1f %10.1f\n", len,
+				t_qsort * 1e9 / samples, t_run * 1e9 / samples, t_sliding * 1e9 / samples);
+	}
+
+	free(input);
+	return 0;
+}
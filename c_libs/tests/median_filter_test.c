@@ -0,0 +1,119 @@
+/*
+	Copyright 2026 VESC project
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+// Checks the sliding window median filter and utils_median_filter_uint16_run
+// against the previous qsort implementation for window sizes 1 to 64.
+
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_LEN 64
+#define SAMPLES 5000
+
+static int failures = 0;
+
+static void check(bool condition, const char *name) {
+	printf("%s %s\n", condition ? "✓" : "✗", name);
+	if (!condition) {
+		failures++;
+	}
+}
+
+// The implementation utils_median_filter_uint16_run used to have
+static int uint16_cmp_func (const void *a, const void *b) {
+	return (*(uint16_t*)a - *(uint16_t*)b);
+}
+
+static uint16_t median_reference(uint16_t *buffer,
+		unsigned int *buffer_index, unsigned int filter_len, uint16_t sample) {
+	buffer[(*buffer_index)++] = sample;
+	*buffer_index %= filter_len;
+	uint16_t buffer_sorted[filter_len];
+	memcpy(buffer_sorted, buffer, sizeof(uint16_t) * filter_len);
+	qsort(buffer_sorted, filter_len, sizeof(uint16_t), uint16_cmp_func);
+	return buffer_sorted[filter_len / 2];
+}
+
+// Mostly a noisy ADC-like signal, with stretches of repeated values and
+// full-range outliers
+static uint16_t next_sample(unsigned int i, uint16_t last) {
+	if (rand() % 50 == 0) {
+		return rand() % 2 ? 0 : 0xFFFF;
+	}
+	if ((i / 200) % 3 == 1) {
+		return last;
+	}
+	if ((i / 200) % 3 == 2) {
+		return rand() % 4;
+	}
+	return 2000 + rand() % 64 - 32;
+}
+
+static unsigned int compare(unsigned int len, bool use_run) {
+	uint16_t reference_buffer[MAX_LEN] = {0};
+	unsigned int reference_index = 0;
+	uint16_t run_buffer[MAX_LEN] = {0};
+	unsigned int run_index = 0;
+	uint16_t storage[2 * MAX_LEN];
+	utils_median_filter_uint16_t filter;
+	utils_median_filter_uint16_init(&filter, storage, len);
+
+	unsigned int mismatches = 0;
+	uint16_t sample = 0;
+	for (unsigned int i = 0; i < SAMPLES; i++) {
+		sample = next_sample(i, sample);
+		uint16_t expected = median_reference(reference_buffer, &reference_index, len, sample);
+		uint16_t actual = use_run ?
+				utils_median_filter_uint16_run(run_buffer, &run_index, len, sample) :
+				utils_median_filter_uint16_add(&filter, sample);
+		if (actual != expected) {
+			mismatches++;
+		}
+	}
+
+	return mismatches;
+}
+
+int main(void) {
+	srand(1);
+
+	unsigned int mismatches = 0;
+	for (unsigned int len = 1; len <= MAX_LEN; len++) {
+		mismatches += compare(len, false);
+	}
+	check(mismatches == 0, "sliding window filter matches qsort for windows 1-64");
+
+	mismatches = 0;
+	for (unsigned int len = 1; len <= MAX_LEN; len++) {
+		mismatches += compare(len, true);
+	}
+	check(mismatches == 0, "utils_median_filter_uint16_run matches qsort for windows 1-64");
+
+	uint16_t storage[2 * 5];
+	utils_median_filter_uint16_t filter;
+	utils_median_filter_uint16_init(&filter, storage, 5);
+	utils_median_filter_uint16_add(&filter, 7);
+	bool zeros = utils_median_filter_uint16_add(&filter, 7) == 0;
+	check(zeros && utils_median_filter_uint16_add(&filter, 7) == 7, "window starts filled with zeros");
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,218 @@
+/*
+	Copyright 2026 VESC project
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+// Host test of rb_spsc_t: single-threaded checks of the index arithmetic and
+// a stress test with a producer and a consumer pthread. Each item carries a
+// sequence number in all its words, so a torn or reordered item is detected.
+//
+// Usage: rb_spsc_test [ITEMS]
+
+#include "rb_spsc.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define RING_SIZE 64
+#define MAX_SPAN 13
+
+typedef struct {
+	uint32_t seq;
+	uint32_t check[3];
+} item_t;
+
+static int failures = 0;
+
+static void check(bool condition, const char *name) {
+	printf("%s %s\n", condition ? "✓" : "✗", name);
+	if (!condition) {
+		failures++;
+	}
+}
+
+static void fill_item(item_t *item, uint32_t seq) {
+	item->seq = seq;
+	item->check[0] = ~seq;
+	item->check[1] = seq * 2654435761u;
+	item->check[2] = seq ^ 0x5a5a5a5a;
+}
+
+static bool item_valid(const item_t *item, uint32_t seq) {
+	item_t expected;
+	fill_item(&expected, seq);
+	return item->seq == expected.seq && item->check[0] == expected.check[0] &&
+		item->check[1] == expected.check[1] && item->check[2] == expected.check[2];
+}
+
+static void test_basic(void) {
+	item_t buffer[8];
+	rb_spsc_t rb;
+
+	check(!rb_spsc_init(&rb, buffer, sizeof(item_t), 6), "init rejects a count that isn't a power of two");
+	check(rb_spsc_init(&rb, buffer, sizeof(item_t), 8), "init accepts a power of two count");
+	check(rb_spsc_is_empty(&rb) && rb_spsc_get_free_space(&rb) == 8, "empty after init");
+
+	item_t item;
+	bool ok = true;
+	for (uint32_t i = 0; i < 8; i++) {
+		fill_item(&item, i);
+		ok &= rb_spsc_insert(&rb, &item);
+	}
+	fill_item(&item, 8);
+	check(ok && rb_spsc_is_full(&rb) && !rb_spsc_insert(&rb, &item), "all items usable, insert fails when full");
+
+	ok = true;
+	for (uint32_t i = 0; i < 5; i++) {
+		ok &= rb_spsc_pop(&rb, &item) && item_valid(&item, i);
+	}
+	check(ok && rb_spsc_get_item_count(&rb) == 3, "pop in order");
+
+	// head is at index 0 again, tail at 5: the reserved span ends at the tail
+	void *span;
+	unsigned int n = rb_spsc_reserve(&rb, &span, 8);
+	check(n == 5 && span == &buffer[0], "reserve is limited by the free space");
+	for (unsigned int i = 0; i < n; i++) {
+		fill_item((item_t*)span + i, 8 + i);
+	}
+	rb_spsc_commit(&rb, n);
+
+	// tail at 5: the peeked span is cut at the end of the buffer
+	const void *rspan;
+	n = rb_spsc_peek(&rb, &rspan, 8);
+	check(n == 3 && rspan == &buffer[5] && item_valid(rspan, 5), "peek is cut at the end of the buffer");
+	rb_spsc_release(&rb, n);
+
+	n = rb_spsc_peek(&rb, &rspan, 8);
+	check(n == 5 && item_valid((const item_t*)rspan + 4, 12), "peek continues from the start");
+	check(rb_spsc_pop(&rb, NULL) && rb_spsc_get_item_count(&rb) == 4, "pop with null discards an item");
+
+	rb_spsc_flush(&rb);
+	check(rb_spsc_is_empty(&rb) && rb_spsc_get_free_space(&rb) == 8, "flush empties the ring");
+}
+
+typedef struct {
+	rb_spsc_t rb;
+	uint32_t items;
+	uint32_t errors;
+	uint32_t first_error;
+} stress_t;
+
+static void *producer(void *arg) {
+	stress_t *s = arg;
+	uint32_t seq = 0;
+	unsigned int span_len = 1;
+
+	while (seq < s->items) {
+		if (seq % 3 == 0) {
+			// single inserts in between the spans
+			item_t item;
+			fill_item(&item, seq);
+			if (rb_spsc_insert(&s->rb, &item)) {
+				seq++;
+			} else {
+				sched_yield();
+			}
+			continue;
+		}
+
+		void *span;
+		unsigned int n = rb_spsc_reserve(&s->rb, &span, span_len);
+		if (n > s->items - seq) {
+			n = s->items - seq;
+		}
+		for (unsigned int i = 0; i < n; i++) {
+			fill_item((item_t*)span + i, seq + i);
+		}
+		rb_spsc_commit(&s->rb, n);
+		seq += n;
+		span_len = span_len % MAX_SPAN + 1;
+		if (n == 0) {
+			sched_yield();
+		}
+	}
+
+	return NULL;
+}
+
+static void *consumer(void *arg) {
+	stress_t *s = arg;
+	uint32_t seq = 0;
+	unsigned int span_len = 1;
+
+	while (seq < s->items) {
+		if (seq % 5 == 0) {
+			item_t item;
+			if (rb_spsc_pop(&s->rb, &item)) {
+				if (!item_valid(&item, seq) && s->errors++ == 0) {
+					s->first_error = seq;
+				}
+				seq++;
+			} else {
+				sched_yield();
+			}
+			continue;
+		}
+
+		const void *span;
+		unsigned int n = rb_spsc_peek(&s->rb, &span, span_len);
+		for (unsigned int i = 0; i < n; i++) {
+			if (!item_valid((const item_t*)span + i, seq + i) && s->errors++ == 0) {
+				s->first_error = seq + i;
+			}
+		}
+		rb_spsc_release(&s->rb, n);
+		seq += n;
+		span_len = span_len % (MAX_SPAN + 4) + 1;
+		if (n == 0) {
+			sched_yield();
+		}
+	}
+
+	return NULL;
+}
+
+static void test_stress(uint32_t items) {
+	static item_t buffer[RING_SIZE];
+	stress_t s = {.items = items};
+	rb_spsc_init(&s.rb, buffer, sizeof(item_t), RING_SIZE);
+
+	pthread_t producer_thread, consumer_thread;
+	pthread_create(&consumer_thread, NULL, consumer, &s);
+	pthread_create(&producer_thread, NULL, producer, &s);
+	pthread_join(producer_thread, NULL);
+	pthread_join(consumer_thread, NULL);
+
+	char name[96];
+	snprintf(name, sizeof(name), "stress: %u items through two threads in order and intact", items);
+	check(s.errors == 0, name);
+	if (s.errors) {
+		printf("  %u bad items, first at %u\n", s.errors, s.first_error);
+	}
+	check(rb_spsc_is_empty(&s.rb), "stress: ring empty at the end");
+}
+
+int main(int argc, char **argv) {
+	uint32_t items = argc > 1 ? strtoul(argv[1], NULL, 10) : 20000000;
+
+	test_basic();
+	test_stress(items);
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,141 @@
+/*
+	Copyright 2026 VESC project
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+#include "rb_spsc.h"
+#include <string.h>
+
+// The own index is only written by the calling side, so it can be read
+// relaxed. The other side's index is read with acquire to see its data.
+static inline unsigned int load_relaxed(const unsigned int *index) {
+	return __atomic_load_n(index, __ATOMIC_RELAXED);
+}
+
+static inline unsigned int load_acquire(const unsigned int *index) {
+	return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+}
+
+static inline void store_release(unsigned int *index, unsigned int value) {
+	__atomic_store_n(index, value, __ATOMIC_RELEASE);
+}
+
+static inline unsigned int min_u(unsigned int a, unsigned int b) {
+	return a < b ? a : b;
+}
+
+bool rb_spsc_init(rb_spsc_t *rb, void *buffer, unsigned int item_size, unsigned int item_count) {
+	if (item_count == 0 || (item_count & (item_count - 1)) != 0) {
+		return false;
+	}
+
+	rb->data = buffer;
+	rb->item_size = item_size;
+	rb->mask = item_count - 1;
+	rb->head = 0;
+	rb->tail = 0;
+	return true;
+}
+
+/*
+ * Reserves up to count contiguous items for writing and points span to them.
+ * Returns the number of reserved items, which can be less than count when
+ * the ring is almost full or the span would wrap around the end of the
+ * buffer. The items become visible to the consumer after rb_spsc_commit.
+ */
+unsigned int rb_spsc_reserve(rb_spsc_t *rb, void **span, unsigned int count) {
+	unsigned int head = load_relaxed(&rb->head);
+	unsigned int tail = load_acquire(&rb->tail);
+	unsigned int index = head & rb->mask;
+
+	unsigned int free = rb->mask + 1 - (head - tail);
+	unsigned int contiguous = rb->mask + 1 - index;
+
+	*span = (char*)rb->data + index * rb->item_size;
+	return min_u(count, min_u(free, contiguous));
+}
+
+void rb_spsc_commit(rb_spsc_t *rb, unsigned int count) {
+	store_release(&rb->head, load_relaxed(&rb->head) + count);
+}
+
+bool rb_spsc_insert(rb_spsc_t *rb, const void *data) {
+	void *item;
+	if (rb_spsc_reserve(rb, &item, 1) == 0) {
+		return false;
+	}
+
+	memcpy(item, data, rb->item_size);
+	rb_spsc_commit(rb, 1);
+	return true;
+}
+
+unsigned int rb_spsc_get_free_space(rb_spsc_t *rb) {
+	return rb->mask + 1 - (load_relaxed(&rb->head) - load_acquire(&rb->tail));
+}
+
+bool rb_spsc_is_full(rb_spsc_t *rb) {
+	return rb_spsc_get_free_space(rb) == 0;
+}
+
+/*
+ * Points span to up to count contiguous items for reading without removing
+ * them. Returns the number of available items, which can be less than count
+ * when the span would wrap around the end of the buffer. The items are
+ * removed by rb_spsc_release.
+ */
+unsigned int rb_spsc_peek(rb_spsc_t *rb, const void **span, unsigned int count) {
+	unsigned int tail = load_relaxed(&rb->tail);
+	unsigned int head = load_acquire(&rb->head);
+	unsigned int index = tail & rb->mask;
+
+	unsigned int available = head - tail;
+	unsigned int contiguous = rb->mask + 1 - index;
+
+	*span = (const char*)rb->data + index * rb->item_size;
+	return min_u(count, min_u(available, contiguous));
+}
+
+void rb_spsc_release(rb_spsc_t *rb, unsigned int count) {
+	store_release(&rb->tail, load_relaxed(&rb->tail) + count);
+}
+
+bool rb_spsc_pop(rb_spsc_t *rb, void *data) {
+	const void *item;
+	if (rb_spsc_peek(rb, &item, 1) == 0) {
+		return false;
+	}
+
+	// Null will just discard the item
+	if (data) {
+		memcpy(data, item, rb->item_size);
+	}
+	rb_spsc_release(rb, 1);
+	return true;
+}
+
+void rb_spsc_flush(rb_spsc_t *rb) {
+	store_release(&rb->tail, load_acquire(&rb->head));
+}
+
+unsigned int rb_spsc_get_item_count(rb_spsc_t *rb) {
+	return load_acquire(&rb->head) - load_relaxed(&rb->tail);
+}
+
+bool rb_spsc_is_empty(rb_spsc_t *rb) {
+	return rb_spsc_get_item_count(rb) == 0;
+}
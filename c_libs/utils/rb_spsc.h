@@ -0,0 +1,67 @@
+/*
+	Copyright 2026 VESC project
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+#ifndef RB_SPSC_H_
+#define RB_SPSC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Lock-free single-producer single-consumer ring buffer.
+ *
+ * Unlike rb_t there is no mutex: exactly one thread may call the producer
+ * functions (insert, reserve, commit, get_free_space, is_full) and exactly
+ * one thread may call the consumer functions (pop, peek, release, flush,
+ * get_item_count, is_empty). The indices are published with release stores
+ * and read with acquire loads, so an item is always completely written
+ * before the consumer can see it.
+ *
+ * The item count must be a power of two. All items can be used, the indices
+ * run freely and are masked on access.
+ */
+
+typedef struct {
+	void *data;
+	unsigned int item_size;
+	unsigned int mask;
+	// Written by the producer only
+	unsigned int head;
+	// Written by the consumer only
+	unsigned int tail;
+} rb_spsc_t;
+
+bool rb_spsc_init(rb_spsc_t *rb, void *buffer, unsigned int item_size, unsigned int item_count);
+
+// Producer
+bool rb_spsc_insert(rb_spsc_t *rb, const void *data);
+unsigned int rb_spsc_reserve(rb_spsc_t *rb, void **span, unsigned int count);
+void rb_spsc_commit(rb_spsc_t *rb, unsigned int count);
+unsigned int rb_spsc_get_free_space(rb_spsc_t *rb);
+bool rb_spsc_is_full(rb_spsc_t *rb);
+
+// Consumer
+bool rb_spsc_pop(rb_spsc_t *rb, void *data);
+unsigned int rb_spsc_peek(rb_spsc_t *rb, const void **span, unsigned int count);
+void rb_spsc_release(rb_spsc_t *rb, unsigned int count);
+void rb_spsc_flush(rb_spsc_t *rb);
+unsigned int rb_spsc_get_item_count(rb_spsc_t *rb);
+bool rb_spsc_is_empty(rb_spsc_t *rb);
+
+#endif
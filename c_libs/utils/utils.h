@@ -24,6 +24,16 @@
 #include <stdint.h>
 #include <math.h>
 
+/*
+ * Sliding window median filter state, see utils_median_filter_uint16_init.
+ */
+typedef struct {
+	uint16_t *window; // The samples in arrival order, a ring
+	uint16_t *sorted; // The same samples, sorted
+	unsigned int len;
+	unsigned int index;
+} utils_median_filter_uint16_t;
+
 float utils_map_angle(float angle, float min, float max);
 void utils_deadband(float *value, float tres, float max);
 float utils_angle_difference(float angle1, float angle2);
@@ -39,6 +49,13 @@ float utils_max_abs(float va, float vb);
 void utils_byte_to_binary(int x, char *b);
 float utils_throttle_curve(float val, float curve_acc, float curve_brake, int mode);
 uint32_t utils_crc32c(uint8_t *data, uint32_t len);
+/*
+ * Continues a CRC32C over more data. Start with crc = 0, the result of each
+ * call is the CRC32C of all the data so far, so
+ * utils_crc32c_update(utils_crc32c_update(0, a, n), b, m) equals the
+ * utils_crc32c of a and b concatenated.
+ */
+uint32_t utils_crc32c_update(uint32_t crc, const uint8_t *data, uint32_t len);
 void utils_fft32_bin0(float *real_in, float *real, float *imag);
 void utils_fft32_bin1(float *real_in, float *real, float *imag);
 void utils_fft32_bin2(float *real_in, float *real, float *imag);
@@ -51,6 +68,9 @@ void utils_fft8_bin2(float *real_in, float *real, float *imag);
 float utils_batt_liion_norm_v_to_capacity(float norm_v);
 uint16_t utils_median_filter_uint16_run(uint16_t *buffer,
 		unsigned int *buffer_index, unsigned int filter_len, uint16_t sample);
+void utils_median_filter_uint16_init(utils_median_filter_uint16_t *filter,
+		uint16_t *storage, unsigned int filter_len);
+uint16_t utils_median_filter_uint16_add(utils_median_filter_uint16_t *filter, uint16_t sample);
 void utils_rotate_vector3(float *input, float *rotation, float *output, bool reverse);
 
 // Return the sign of the argument. -1.0 if negative, 1.0 if zero or positive.
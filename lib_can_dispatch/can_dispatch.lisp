@@ -0,0 +1,5 @@
+(import "can_dispatch/can_dispatch.bin" 'can_dispatch)
+(import "can_dispatch/can_dispatch_esp32c3.bin" 'can_dispatch_esp32c3)
+(import "can_dispatch/can_dispatch_esp32c6.bin" 'can_dispatch_esp32c6)
+(import "can_dispatch/can_dispatch_esp32s3.bin" 'can_dispatch_esp32s3)
+(import "can_dispatch/can_dispatch_esp32p4.bin" 'can_dispatch_esp32p4)
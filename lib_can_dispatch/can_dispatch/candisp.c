@@ -0,0 +1,215 @@
+/*
+	Copyright 2026 VESC project
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "candisp.h"
+
+#include <string.h>
+
+void candisp_init(candisp_t *d) {
+	memset(d, 0, sizeof(candisp_t));
+}
+
+int candisp_type_size(candisp_type type) {
+	switch (type) {
+	case CANDISP_U8:
+	case CANDISP_I8:
+		return 1;
+	case CANDISP_U16:
+	case CANDISP_I16:
+	case CANDISP_U16_LE:
+	case CANDISP_I16_LE:
+		return 2;
+	default:
+		return 4;
+	}
+}
+
+bool candisp_type_is_int(candisp_type type) {
+	return type != CANDISP_F32 && type != CANDISP_F32_LE;
+}
+
+int candisp_add(candisp_t *d, uint32_t id, uint32_t mask, bool ext,
+		const candisp_field *fields, int count, candisp_notify notify, bool consume) {
+	if (d->entry_count >= CANDISP_MAX_ENTRIES ||
+			count < 0 || d->field_count + count > CANDISP_MAX_FIELDS) {
+		return -1;
+	}
+
+	for (int i = 0; i < count; i++) {
+		if (fields[i].type >= CANDISP_TYPE_COUNT ||
+				fields[i].offset + candisp_type_size(fields[i].type) > 8) {
+			return -1;
+		}
+	}
+
+	candisp_entry *e = &d->entry[d->entry_count];
+	memset(e, 0, sizeof(candisp_entry));
+	e->mask = mask & (ext ? 0x1FFFFFFF : 0x7FF);
+	e->id = id & e->mask;
+	e->ext = ext;
+	e->notify = notify;
+	e->consume = consume;
+	e->field_first = d->field_count;
+	e->field_count = count;
+
+	for (int i = 0; i < count; i++) {
+		d->field[d->field_count] = fields[i];
+		d->valid[d->field_count] = false;
+		d->field_count++;
+	}
+
+	return d->entry_count++;
+}
+
+static uint32_t get_be(const uint8_t *p, int n) {
+	uint32_t res = 0;
+	for (int i = 0; i < n; i++) {
+		res = (res << 8) | p[i];
+	}
+	return res;
+}
+
+static uint32_t get_le(const uint8_t *p, int n) {
+	uint32_t res = 0;
+	for (int i = n - 1; i >= 0; i--) {
+		res = (res << 8) | p[i];
+	}
+	return res;
+}
+
+static candisp_raw decode(const uint8_t *p, candisp_type type) {
+	candisp_raw res;
+
+	switch (type) {
+	case CANDISP_U8: res.u = p[0]; break;
+	case CANDISP_I8: res.i = (int8_t)p[0]; break;
+	case CANDISP_U16: res.u = get_be(p, 2); break;
+	case CANDISP_I16: res.i = (int16_t)get_be(p, 2); break;
+	case CANDISP_U16_LE: res.u = get_le(p, 2); break;
+	case CANDISP_I16_LE: res.i = (int16_t)get_le(p, 2); break;
+	case CANDISP_U32_LE:
+	case CANDISP_I32_LE:
+	case CANDISP_F32_LE: res.u = get_le(p, 4); break;
+	default: res.u = get_be(p, 4); break;
+	}
+
+	return res;
+}
+
+static void queue_event(candisp_t *d, int e) {
+	if (d->pending & (1u << e)) {
+		return;
+	}
+
+	d->pending |= 1u << e;
+	d->queue[(d->queue_head + d->queue_count) % CANDISP_MAX_ENTRIES] = (uint8_t)e;
+	d->queue_count++;
+	d->events++;
+}
+
+int candisp_process(candisp_t *d, uint32_t id, bool ext, const uint8_t *data,
+		uint8_t len, uint32_t time) {
+	d->frames++;
+
+	if (len > 8) {
+		len = 8;
+	}
+
+	int ind = -1;
+	for (int i = 0; i < d->entry_count; i++) {
+		candisp_entry *e = &d->entry[i];
+		if (e->ext == ext && (id & e->mask) == e->id) {
+			ind = i;
+			break;
+		}
+	}
+
+	if (ind < 0) {
+		return -1;
+	}
+
+	d->matched++;
+	candisp_entry *e = &d->entry[ind];
+
+	bool changed = e->frames == 0 || len != e->len ||
+			memcmp(data, e->data, len) != 0 || id != e->last_id;
+
+	e->last_id = id;
+	e->last_time = time;
+	e->len = len;
+	memcpy(e->data, data, len);
+	e->frames++;
+
+	for (int i = e->field_first; i < e->field_first + e->field_count; i++) {
+		candisp_field *f = &d->field[i];
+		if (f->offset + candisp_type_size(f->type) <= len) {
+			d->raw[i] = decode(data + f->offset, f->type);
+			d->valid[i] = true;
+		}
+	}
+
+	if (e->notify == CANDISP_NOTIFY_RX ||
+			(e->notify == CANDISP_NOTIFY_CHANGE && changed)) {
+		queue_event(d, ind);
+	}
+
+	return ind;
+}
+
+int candisp_pop_event(candisp_t *d) {
+	if (d->queue_count == 0) {
+		return -1;
+	}
+
+	int e = d->queue[d->queue_head];
+	d->queue_head = (d->queue_head + 1) % CANDISP_MAX_ENTRIES;
+	d->queue_count--;
+	d->pending &= ~(1u << e);
+	return e;
+}
+
+bool candisp_value(const candisp_t *d, int e, int i, float *value) {
+	const candisp_entry *entry = &d->entry[e];
+	if (i < 0 || i >= entry->field_count) {
+		return false;
+	}
+
+	int ind = entry->field_first + i;
+	if (!d->valid[ind]) {
+		return false;
+	}
+
+	const candisp_field *f = &d->field[ind];
+	candisp_raw raw = d->raw[ind];
+	float v;
+
+	switch (f->type) {
+	case CANDISP_F32:
+	case CANDISP_F32_LE: v = raw.f; break;
+	case CANDISP_I8:
+	case CANDISP_I16:
+	case CANDISP_I32:
+	case CANDISP_I16_LE:
+	case CANDISP_I32_LE: v = (float)raw.i; break;
+	default: v = (float)raw.u; break;
+	}
+
+	*value = v * f->scale;
+	return true;
+}
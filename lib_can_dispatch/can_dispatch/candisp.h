@@ -0,0 +1,147 @@
+/*
+	Copyright 2026 VESC project
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CANDISP_H_
+#define CANDISP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * CAN frame dispatch table.
+ *
+ * An entry matches the frames whose ID equals its ID in the bits of its
+ * mask, and decodes the fields of its field map from them. Each field is
+ * read at a byte offset with a type and multiplied by a scale when it is
+ * read back, so the table only stores the raw values. The first matching
+ * entry takes the frame. Entries can consume their frames, so that the
+ * caller doesn't pass them on.
+ *
+ * Entries can ask for an event when they get a frame, or only when the
+ * frame data changed. An entry has at most one event queued: more frames
+ * before the event is popped update the values but don't queue another
+ * event, so the queue can't overflow and a slow reader just sees the
+ * latest values.
+ *
+ * Nothing here is thread safe, the caller locks around all calls.
+ */
+
+#define CANDISP_MAX_ENTRIES		32
+#define CANDISP_MAX_FIELDS		128
+
+// Multi-byte types are big-endian unless they end in _LE
+typedef enum {
+	CANDISP_U8 = 0,
+	CANDISP_I8,
+	CANDISP_U16,
+	CANDISP_I16,
+	CANDISP_U32,
+	CANDISP_I32,
+	CANDISP_F32,
+	CANDISP_U16_LE,
+	CANDISP_I16_LE,
+	CANDISP_U32_LE,
+	CANDISP_I32_LE,
+	CANDISP_F32_LE,
+	CANDISP_TYPE_COUNT
+} candisp_type;
+
+typedef enum {
+	CANDISP_NOTIFY_NONE = 0,
+	CANDISP_NOTIFY_RX,
+	CANDISP_NOTIFY_CHANGE
+} candisp_notify;
+
+typedef struct {
+	uint8_t offset;
+	uint8_t type;
+	float scale;
+} candisp_field;
+
+typedef union {
+	uint32_t u;
+	int32_t i;
+	float f;
+} candisp_raw;
+
+typedef struct {
+	uint32_t id;
+	uint32_t mask;
+	bool ext;
+	uint8_t notify;
+	bool consume;
+	uint8_t field_first;
+	uint8_t field_count;
+
+	// The last frame
+	uint32_t last_id;
+	uint32_t last_time;
+	uint8_t len;
+	uint8_t data[8];
+	uint32_t frames;
+} candisp_entry;
+
+typedef struct {
+	candisp_entry entry[CANDISP_MAX_ENTRIES];
+	int entry_count;
+
+	candisp_field field[CANDISP_MAX_FIELDS];
+	candisp_raw raw[CANDISP_MAX_FIELDS];
+	bool valid[CANDISP_MAX_FIELDS];
+	int field_count;
+
+	// Bit per entry with an event in the queue
+	uint32_t pending;
+	uint8_t queue[CANDISP_MAX_ENTRIES];
+	int queue_head;
+	int queue_count;
+
+	uint32_t frames;
+	uint32_t matched;
+	uint32_t events;
+} candisp_t;
+
+void candisp_init(candisp_t *d);
+
+/*
+ * Adds an entry with count fields, which consumes its frames if consume is
+ * set. Returns the index of the entry, or -1 if the table is full or a field
+ * is invalid.
+ */
+int candisp_add(candisp_t *d, uint32_t id, uint32_t mask, bool ext,
+		const candisp_field *fields, int count, candisp_notify notify, bool consume);
+
+/*
+ * Decodes a received frame, stamped with time. Returns the index of the
+ * entry that took it, or -1 if no entry matches. Fields that don't fit in
+ * the frame keep their previous value.
+ */
+int candisp_process(candisp_t *d, uint32_t id, bool ext, const uint8_t *data,
+		uint8_t len, uint32_t time);
+
+// Returns the entry of the oldest event, or -1 if there is none
+int candisp_pop_event(candisp_t *d);
+
+int candisp_type_size(candisp_type type);
+bool candisp_type_is_int(candisp_type type);
+
+// Value of field i of entry e, scaled. Returns false if it has no value yet.
+bool candisp_value(const candisp_t *d, int e, int i, float *value);
+
+#endif
@@ -0,0 +1,502 @@
+/*
+	Copyright 2026 VESC project
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef ESP_PLATFORM
+#include "express/vesc_c_if.h"
+#define CAN_SET_SID_CB(f)	VESC_IF->can_set_sid_rx_callback(f)
+#define CAN_SET_EID_CB(f)	VESC_IF->can_set_eid_rx_callback(f)
+#else
+#include "vesc_c_if.h"
+#define CAN_SET_SID_CB(f)	VESC_IF->can_set_sid_cb(f)
+#define CAN_SET_EID_CB(f)	VESC_IF->can_set_eid_cb(f)
+#endif
+
+#include "candisp.h"
+
+HEADER
+
+#define IS_CONS(x)			VESC_IF->lbm_is_cons(x)
+#define IS_NUMBER(x)		VESC_IF->lbm_is_number(x)
+#define IS_SYMBOL(x)		VESC_IF->lbm_is_symbol(x)
+#define CAR(x)				VESC_IF->lbm_car(x)
+#define CDR(x)				VESC_IF->lbm_cdr(x)
+#define CONS(car, cdr)		VESC_IF->lbm_cons(car, cdr)
+#define DEC_F(x)			VESC_IF->lbm_dec_as_float(x)
+#define DEC_I(x)			VESC_IF->lbm_dec_as_i32(x)
+#define DEC_U(x)			VESC_IF->lbm_dec_as_u32(x)
+#define ENC_F(x)			VESC_IF->lbm_enc_float(x)
+#define ENC_I(x)			VESC_IF->lbm_enc_i(x)
+#define SYM_TRUE			VESC_IF->lbm_enc_sym_true
+#define SYM_NIL				VESC_IF->lbm_enc_sym_nil
+#define SYM_EERROR			VESC_IF->lbm_enc_sym_eerror
+#define SYM_MERROR			VESC_IF->lbm_enc_sym_merror
+#define SYM_TERROR			VESC_IF->lbm_enc_sym_terror
+
+// Symbol names of the field types, in the order of candisp_type. Fixed-size
+// arrays rather than pointers, as pointer tables don't work on the Express.
+static const char type_names[CANDISP_TYPE_COUNT][8] = {
+	"u8", "i8", "u16", "i16", "u32", "i32", "f32",
+	"u16-le", "i16-le", "u32-le", "i32-le", "f32-le"
+};
+
+typedef struct {
+	candisp_t table;
+	bool cb_registered;
+
+	lbm_uint sym_type[CANDISP_TYPE_COUNT];
+	lbm_uint sym_rx;
+	lbm_uint sym_change;
+
+	// Events for ext-can-wait-event
+	lib_mutex lock;
+	lbm_cid waiter;
+	bool waiting;
+} dispatch_state;
+
+static bool get_add_symbol(char *name, lbm_uint* id) {
+	if (!VESC_IF->lbm_get_symbol_by_name(name, id)) {
+		if (!VESC_IF->lbm_add_symbol_const(name, id)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Called from the CAN thread. Frames taken by an entry that consumes them
+// don't cause event-can-sid/eid in Lisp, all others are passed on.
+static bool process_frame(uint32_t id, bool ext, uint8_t *data, uint8_t len) {
+	dispatch_state *state = (dispatch_state*)ARG;
+	if (!state) {
+		return false;
+	}
+
+	VESC_IF->mutex_lock(state->lock);
+
+	int ind = candisp_process(&state->table, id, ext, data, len,
+			VESC_IF->system_time_ticks());
+
+	if (ind >= 0 && state->waiting) {
+		int e = candisp_pop_event(&state->table);
+		if (e >= 0) {
+			VESC_IF->lbm_unblock_ctx_unboxed(state->waiter, ENC_I(e));
+			state->waiting = false;
+		}
+	}
+
+	bool consume = ind >= 0 && state->table.entry[ind].consume;
+
+	VESC_IF->mutex_unlock(state->lock);
+
+	return consume;
+}
+
+static bool sid_cb(uint32_t id, uint8_t *data, uint8_t len) {
+	return process_frame(id, false, data, len);
+}
+
+static bool eid_cb(uint32_t id, uint8_t *data, uint8_t len) {
+	return process_frame(id, true, data, len);
+}
+
+static bool parse_type(dispatch_state *state, lbm_value v, uint8_t *type) {
+	if (!IS_SYMBOL(v)) {
+		return false;
+	}
+
+	lbm_uint sym = VESC_IF->lbm_dec_sym(v);
+	for (int i = 0; i < CANDISP_TYPE_COUNT; i++) {
+		if (sym == state->sym_type[i]) {
+			*type = (uint8_t)i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Field value as an integer when it is an integer type without scale, so that
+// e.g. 32-bit counters are exact, and as a float otherwise.
+static lbm_value field_value(dispatch_state *state, int e, int i) {
+	candisp_t *d = &state->table;
+	int ind = d->entry[e].field_first + i;
+	candisp_field *f = &d->field[ind];
+	float value;
+
+	if (!candisp_value(d, e, i, &value)) {
+		return SYM_NIL;
+	}
+
+	if (candisp_type_is_int(f->type) && f->scale == 1.0f) {
+		switch (f->type) {
+		case CANDISP_U32:
+		case CANDISP_U32_LE:
+			return VESC_IF->lbm_enc_u32(d->raw[ind].u);
+		default:
+			return VESC_IF->lbm_enc_i32(d->raw[ind].i);
+		}
+	}
+
+	return ENC_F(value);
+}
+
+static dispatch_state *get_state(void) {
+	dispatch_state *state = (dispatch_state*)ARG;
+	if (!state) {
+		VESC_IF->lbm_set_error_reason("Not initialized");
+	}
+	return state;
+}
+
+static int get_entry(dispatch_state *state, lbm_value v) {
+	if (!IS_NUMBER(v)) {
+		return -1;
+	}
+
+	int e = DEC_I(v);
+	return (e >= 0 && e < state->table.entry_count) ? e : -1;
+}
+
+// (ext-can-add ext id mask fields optNotify optConsume) -> entry
+static lbm_value ext_can_add(lbm_value *args, lbm_uint argn) {
+	if (argn < 4 || argn > 6 || !IS_NUMBER(args[1]) || !IS_NUMBER(args[2])) {
+		return SYM_TERROR;
+	}
+
+	dispatch_state *state = get_state();
+	if (!state) {
+		return SYM_EERROR;
+	}
+
+	bool ext = args[0] != SYM_NIL;
+	bool consume = argn == 6 && args[5] != SYM_NIL;
+
+	candisp_notify notify = CANDISP_NOTIFY_NONE;
+	if (argn >= 5 && args[4] != SYM_NIL) {
+		if (!IS_SYMBOL(args[4])) {
+			return SYM_TERROR;
+		}
+
+		lbm_uint sym = VESC_IF->lbm_dec_sym(args[4]);
+		if (sym == state->sym_rx) {
+			notify = CANDISP_NOTIFY_RX;
+		} else if (sym == state->sym_change) {
+			notify = CANDISP_NOTIFY_CHANGE;
+		} else {
+			return SYM_TERROR;
+		}
+	}
+
+	// A frame has at most 8 fields of a byte, larger maps make no sense
+	candisp_field fields[8];
+	int count = 0;
+
+	lbm_value curr = args[3];
+	while (IS_CONS(curr)) {
+		lbm_value f = CAR(curr);
+		if (count >= 8 || !IS_CONS(f) || !IS_NUMBER(CAR(f)) || !IS_CONS(CDR(f))) {
+			return SYM_TERROR;
+		}
+
+		fields[count].offset = (uint8_t)DEC_I(CAR(f));
+		if (!parse_type(state, CAR(CDR(f)), &fields[count].type)) {
+			return SYM_TERROR;
+		}
+
+		lbm_value scale = CDR(CDR(f));
+		if (IS_CONS(scale)) {
+			if (!IS_NUMBER(CAR(scale))) {
+				return SYM_TERROR;
+			}
+			fields[count].scale = DEC_F(CAR(scale));
+		} else {
+			fields[count].scale = 1.0f;
+		}
+
+		count++;
+		curr = CDR(curr);
+	}
+
+	VESC_IF->mutex_lock(state->lock);
+	int e = candisp_add(&state->table, DEC_U(args[1]), DEC_U(args[2]), ext,
+			fields, count, notify, consume);
+	VESC_IF->mutex_unlock(state->lock);
+
+	if (e < 0) {
+		VESC_IF->lbm_set_error_reason("Table full or field outside of frame");
+		return SYM_EERROR;
+	}
+
+	if (!state->cb_registered) {
+		CAN_SET_SID_CB(sid_cb);
+		CAN_SET_EID_CB(eid_cb);
+		state->cb_registered = true;
+	}
+
+	return ENC_I(e);
+}
+
+// (ext-can-get entry) -> list of field values, or nil before the first frame
+static lbm_value ext_can_get(lbm_value *args, lbm_uint argn) {
+	dispatch_state *state = get_state();
+	if (!state) {
+		return SYM_EERROR;
+	}
+
+	int e = argn == 1 ? get_entry(state, args[0]) : -1;
+	if (e < 0) {
+		return SYM_TERROR;
+	}
+
+	VESC_IF->mutex_lock(state->lock);
+
+	lbm_value res = SYM_NIL;
+	if (state->table.entry[e].frames > 0) {
+		for (int i = state->table.entry[e].field_count - 1; i >= 0; i--) {
+			res = CONS(field_value(state, e, i), res);
+			if (res == SYM_MERROR) {
+				break;
+			}
+		}
+	}
+
+	VESC_IF->mutex_unlock(state->lock);
+	return res;
+}
+
+// (ext-can-field entry field) -> value of one field
+static lbm_value ext_can_field(lbm_value *args, lbm_uint argn) {
+	dispatch_state *state = get_state();
+	if (!state) {
+		return SYM_EERROR;
+	}
+
+	int e = argn == 2 ? get_entry(state, args[0]) : -1;
+	if (e < 0 || !IS_NUMBER(args[1])) {
+		return SYM_TERROR;
+	}
+
+	int i = DEC_I(args[1]);
+	if (i < 0 || i >= state->table.entry[e].field_count) {
+		return SYM_TERROR;
+	}
+
+	VESC_IF->mutex_lock(state->lock);
+	lbm_value res = field_value(state, e, i);
+	VESC_IF->mutex_unlock(state->lock);
+
+	return res;
+}
+
+// (ext-can-data entry) -> the last frame as a byte array
+static lbm_value ext_can_data(lbm_value *args, lbm_uint argn) {
+	dispatch_state *state = get_state();
+	if (!state) {
+		return SYM_EERROR;
+	}
+
+	int e = argn == 1 ? get_entry(state, args[0]) : -1;
+	if (e < 0) {
+		return SYM_TERROR;
+	}
+
+	VESC_IF->mutex_lock(state->lock);
+
+	candisp_entry *entry = &state->table.entry[e];
+	lbm_value res = SYM_NIL;
+	if (entry->frames > 0) {
+		if (VESC_IF->lbm_create_byte_array(&res, entry->len)) {
+			uint8_t *data = (uint8_t*)VESC_IF->lbm_dec_str(res);
+			for (int i = 0; i < entry->len; i++) {
+				data[i] = entry->data[i];
+			}
+		} else {
+			res = SYM_MERROR;
+		}
+	}
+
+	VESC_IF->mutex_unlock(state->lock);
+	return res;
+}
+
+// (ext-can-info entry) -> (id frames age), or nil before the first frame
+static lbm_value ext_can_info(lbm_value *args, lbm_uint argn) {
+	dispatch_state *state = get_state();
+	if (!state) {
+		return SYM_EERROR;
+	}
+
+	int e = argn == 1 ? get_entry(state, args[0]) : -1;
+	if (e < 0) {
+		return SYM_TERROR;
+	}
+
+	VESC_IF->mutex_lock(state->lock);
+	candisp_entry entry = state->table.entry[e];
+	VESC_IF->mutex_unlock(state->lock);
+
+	if (entry.frames == 0) {
+		return SYM_NIL;
+	}
+
+	lbm_value res = CONS(ENC_F(VESC_IF->ts_to_age_s(entry.last_time)), SYM_NIL);
+	res = CONS(VESC_IF->lbm_enc_u32(entry.frames), res);
+	return CONS(VESC_IF->lbm_enc_u32(entry.last_id), res);
+}
+
+// (ext-can-wait-event) -> entry
+static lbm_value ext_can_wait_event(lbm_value *args, lbm_uint argn) {
+	(void)args; (void)argn;
+
+	dispatch_state *state = get_state();
+	if (!state) {
+		return SYM_EERROR;
+	}
+
+	lbm_value res = SYM_NIL;
+	VESC_IF->mutex_lock(state->lock);
+
+	bool subscribed = false;
+	for (int i = 0; i < state->table.entry_count; i++) {
+		if (state->table.entry[i].notify != CANDISP_NOTIFY_NONE) {
+			subscribed = true;
+		}
+	}
+
+	int e = candisp_pop_event(&state->table);
+	if (e >= 0) {
+		res = ENC_I(e);
+	} else if (state->waiting) {
+		VESC_IF->mutex_unlock(state->lock);
+		VESC_IF->lbm_set_error_reason("Another thread is waiting");
+		return SYM_EERROR;
+	} else if (subscribed) {
+		// Unblocked with the next event by process_frame
+		state->waiter = VESC_IF->lbm_get_current_cid();
+		state->waiting = true;
+		VESC_IF->lbm_block_ctx_from_extension();
+		res = SYM_TRUE;
+	}
+
+	VESC_IF->mutex_unlock(state->lock);
+	return res;
+}
+
+// (ext-can-clear) -> t. Removes all entries.
+static lbm_value ext_can_clear(lbm_value *args, lbm_uint argn) {
+	(void)args; (void)argn;
+
+	dispatch_state *state = get_state();
+	if (!state) {
+		return SYM_EERROR;
+	}
+
+	if (state->cb_registered) {
+		CAN_SET_SID_CB(0);
+		CAN_SET_EID_CB(0);
+		state->cb_registered = false;
+	}
+
+	VESC_IF->mutex_lock(state->lock);
+	if (state->waiting) {
+		VESC_IF->lbm_unblock_ctx_unboxed(state->waiter, SYM_NIL);
+		state->waiting = false;
+	}
+	candisp_init(&state->table);
+	VESC_IF->mutex_unlock(state->lock);
+
+	return SYM_TRUE;
+}
+
+// (ext-can-stats) -> (frames matched events)
+static lbm_value ext_can_stats(lbm_value *args, lbm_uint argn) {
+	(void)args; (void)argn;
+
+	dispatch_state *state = get_state();
+	if (!state) {
+		return SYM_EERROR;
+	}
+
+	VESC_IF->mutex_lock(state->lock);
+	uint32_t frames = state->table.frames;
+	uint32_t matched = state->table.matched;
+	uint32_t events = state->table.events;
+	VESC_IF->mutex_unlock(state->lock);
+
+	lbm_value res = CONS(VESC_IF->lbm_enc_u32(events), SYM_NIL);
+	res = CONS(VESC_IF->lbm_enc_u32(matched), res);
+	return CONS(VESC_IF->lbm_enc_u32(frames), res);
+}
+
+static void stop(void *arg) {
+	dispatch_state *state = (dispatch_state*)arg;
+	if (!state) {
+		return;
+	}
+
+	if (state->cb_registered) {
+		CAN_SET_SID_CB(0);
+		CAN_SET_EID_CB(0);
+	}
+
+	if (state->lock) {
+		VESC_IF->free(state->lock);
+	}
+	VESC_IF->free(state);
+}
+
+INIT_FUN(lib_info *info) {
+	INIT_START
+
+	dispatch_state *state = VESC_IF->malloc(sizeof(dispatch_state));
+	if (!state) {
+		return false;
+	}
+
+	candisp_init(&state->table);
+	state->cb_registered = false;
+	state->waiting = false;
+	state->lock = VESC_IF->mutex_create();
+
+	bool ok = state->lock != 0;
+	for (int i = 0; i < CANDISP_TYPE_COUNT; i++) {
+		ok = ok && get_add_symbol((char*)type_names[i], &state->sym_type[i]);
+	}
+	ok = ok && get_add_symbol("rx", &state->sym_rx);
+	ok = ok && get_add_symbol("change", &state->sym_change);
+
+	if (!ok) {
+		stop(state);
+		return false;
+	}
+
+	info->arg = state;
+	info->stop_fun = stop;
+
+	VESC_IF->lbm_add_extension("ext-can-add", ext_can_add);
+	VESC_IF->lbm_add_extension("ext-can-get", ext_can_get);
+	VESC_IF->lbm_add_extension("ext-can-field", ext_can_field);
+	VESC_IF->lbm_add_extension("ext-can-data", ext_can_data);
+	VESC_IF->lbm_add_extension("ext-can-info", ext_can_info);
+	VESC_IF->lbm_add_extension("ext-can-wait-event", ext_can_wait_event);
+	VESC_IF->lbm_add_extension("ext-can-clear", ext_can_clear);
+	VESC_IF->lbm_add_extension("ext-can-stats", ext_can_stats);
+
+	return true;
+}
@@ -0,0 +1,393 @@
+/*
+	Copyright 2026 VESC project
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+// Runs a synthetic CAN trace through the dispatch table and checks the
+// decoded values and the events against a simple reference model.
+
+#include "candisp.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_FRAMES	20000
+
+#define CAN_PACKET_STATUS	9
+
+static int failures = 0;
+
+static void check(bool condition, const char *name) {
+	printf("%s %s\n", condition ? "✓" : "✗", name);
+	if (!condition) {
+		failures++;
+	}
+}
+
+typedef struct {
+	uint32_t id;
+	bool ext;
+	uint8_t len;
+	uint8_t data[8];
+} frame_t;
+
+// The table under test, as a bridge script would set it up
+typedef struct {
+	uint32_t id;
+	uint32_t mask;
+	bool ext;
+	candisp_notify notify;
+	bool consume;
+	candisp_field fields[4];
+	int count;
+} entry_def;
+
+static const entry_def defs[] = {
+	// vdisp status frames
+	{20, 0x7FF, false, CANDISP_NOTIFY_CHANGE, false, {
+			{0, CANDISP_I16, 0.001}, {2, CANDISP_I16, 0.001},
+			{4, CANDISP_I16, 0.1}, {6, CANDISP_I16, 0.01}}, 4},
+	{22, 0x7FF, false, CANDISP_NOTIFY_NONE, false, {
+			{0, CANDISP_U16, 0.1}, {2, CANDISP_U16, 0.1},
+			{4, CANDISP_U16, 0.1}, {6, CANDISP_U16, 1.0}}, 4},
+	{24, 0x7FF, false, CANDISP_NOTIFY_RX, false, {
+			{0, CANDISP_U16, 0.1}, {2, CANDISP_U32, 0.1},
+			{6, CANDISP_U16, 0.1}}, 3},
+	// VESC status from any controller
+	{CAN_PACKET_STATUS << 8, 0x1FFFFF00, true, CANDISP_NOTIFY_RX, false, {
+			{0, CANDISP_I32, 1.0}, {4, CANDISP_I16, 0.1},
+			{6, CANDISP_I16, 0.001}}, 3},
+	// J1939 style frame with little-endian fields
+	{0x18FF3E07, 0x1FFFFFFF, true, CANDISP_NOTIFY_CHANGE, true, {
+			{0, CANDISP_U16_LE, 1.0}, {2, CANDISP_I16_LE, 0.5},
+			{4, CANDISP_F32_LE, 1.0}}, 3},
+	{0x7E0, 0x7F0, false, CANDISP_NOTIFY_NONE, false, {
+			{0, CANDISP_I8, 1.0}, {1, CANDISP_U8, 2.0},
+			{4, CANDISP_F32, 1.0}}, 3},
+};
+
+#define ENTRIES ((int)(sizeof(defs) / sizeof(defs[0])))
+
+static uint32_t rng_state = 12345;
+
+static uint32_t rng(void) {
+	rng_state = rng_state * 1103515245 + 12345;
+	return rng_state >> 8;
+}
+
+// Reference decoder, written independently of candisp.c
+static double ref_value(const uint8_t *d, const candisp_field *f) {
+	const uint8_t *p = d + f->offset;
+	uint32_t u = 0;
+	double v = 0;
+
+	switch (f->type) {
+	case CANDISP_U8: v = p[0]; break;
+	case CANDISP_I8: v = (p[0] & 0x80) ? p[0] - 256.0 : p[0]; break;
+	case CANDISP_U16: v = p[0] * 256.0 + p[1]; break;
+	case CANDISP_I16: v = p[0] * 256.0 + p[1]; if (v >= 32768) v -= 65536; break;
+	case CANDISP_U16_LE: v = p[1] * 256.0 + p[0]; break;
+	case CANDISP_I16_LE: v = p[1] * 256.0 + p[0]; if (v >= 32768) v -= 65536; break;
+	case CANDISP_U32: v = ((p[0] * 256.0 + p[1]) * 256.0 + p[2]) * 256.0 + p[3]; break;
+	case CANDISP_I32:
+		v = ((p[0] * 256.0 + p[1]) * 256.0 + p[2]) * 256.0 + p[3];
+		if (v >= 2147483648.0) v -= 4294967296.0;
+		break;
+	case CANDISP_F32:
+	case CANDISP_F32_LE: {
+		for (int i = 0; i < 4; i++) {
+			u |= (uint32_t)p[f->type == CANDISP_F32 ? 3 - i : i] << (8 * i);
+		}
+		float fl;
+		memcpy(&fl, &u, 4);
+		v = fl;
+	} break;
+	default: break;
+	}
+
+	return v * f->scale;
+}
+
+static void fill(uint8_t *d, int len) {
+	for (int i = 0; i < len; i++) {
+		d[i] = (uint8_t)rng();
+	}
+}
+
+static void put_float(uint8_t *d, float f, bool le) {
+	uint32_t u;
+	memcpy(&u, &f, 4);
+	for (int i = 0; i < 4; i++) {
+		d[le ? i : 3 - i] = (uint8_t)(u >> (8 * i));
+	}
+}
+
+// A frame for entry e, or a frame that matches no entry for e < 0
+static frame_t make_frame(int e) {
+	frame_t f;
+	memset(&f, 0, sizeof(f));
+	f.len = 8;
+
+	switch (e) {
+	case 0:
+		// Few distinct payloads, so that most frames don't change anything
+		f.id = 20;
+		memset(f.data, rng() % 3, 8);
+		break;
+	case 1:
+		f.id = 22;
+		fill(f.data, 8);
+		break;
+	case 2:
+		f.id = 24;
+		fill(f.data, 8);
+		// Short frames leave the later fields as they were
+		if (rng() % 4 == 0) {
+			f.len = 4;
+		}
+		break;
+	case 3:
+		f.ext = true;
+		f.id = (CAN_PACKET_STATUS << 8) | (rng() % 4 + 10);
+		fill(f.data, 8);
+		break;
+	case 4:
+		f.ext = true;
+		f.id = 0x18FF3E07;
+		f.data[0] = (uint8_t)(rng() % 2);
+		f.data[2] = (uint8_t)rng();
+		f.data[3] = (uint8_t)rng();
+		put_float(f.data + 4, (float)(rng() % 1000) / 7.0f, true);
+		break;
+	case 5:
+		f.id = 0x7E0 | (rng() % 16);
+		fill(f.data, 4);
+		put_float(f.data + 4, (float)(rng() % 1000) / 3.0f, false);
+		break;
+	default:
+		// The IDs of the table with the wrong frame type, and other traffic
+		switch (rng() % 4) {
+		case 0: f.ext = true; f.id = 20 + rng() % 5; break;
+		case 1: f.id = CAN_PACKET_STATUS << 8; break;
+		case 2: f.ext = true; f.id = (rng() % 100) << 8 | 10; break;
+		default: f.id = 100 + rng() % 1900; break;
+		}
+		if (f.ext && (f.id >> 8) == CAN_PACKET_STATUS) {
+			f.id += 1 << 8;
+		}
+		f.len = (uint8_t)(rng() % 9);
+		fill(f.data, f.len);
+		break;
+	}
+
+	return f;
+}
+
+static void setup(candisp_t *d) {
+	candisp_init(d);
+	for (int i = 0; i < ENTRIES; i++) {
+		candisp_add(d, defs[i].id, defs[i].mask, defs[i].ext,
+				defs[i].fields, defs[i].count, defs[i].notify, defs[i].consume);
+	}
+}
+
+static void test_trace(void) {
+	static candisp_t d;
+	setup(&d);
+
+	// Reference state
+	uint8_t data[ENTRIES][8];
+	uint8_t len[ENTRIES];
+	bool valid[ENTRIES][4];
+	double value[ENTRIES][4];
+	uint32_t frames[ENTRIES];
+	uint32_t last_id[ENTRIES];
+	int dirty[ENTRIES];
+	int dirty_order[ENTRIES];
+	int dirty_count = 0;
+	uint32_t matched = 0;
+	uint32_t events = 0;
+
+	memset(valid, 0, sizeof(valid));
+	memset(frames, 0, sizeof(frames));
+	memset(dirty, 0, sizeof(dirty));
+
+	bool ok_match = true;
+	bool ok_values = true;
+	bool ok_events = true;
+	bool ok_info = true;
+	int polls = 0;
+	int until_poll = 1;
+
+	for (int n = 0; n < TRACE_FRAMES; n++) {
+		int e = (int)(rng() % (ENTRIES + 3));
+		if (e >= ENTRIES) {
+			e = -1;
+		}
+
+		frame_t f = make_frame(e);
+		int res = candisp_process(&d, f.id, f.ext, f.data, f.len, (uint32_t)n);
+
+		if (res != e) {
+			ok_match = false;
+		}
+
+		if (e >= 0) {
+			const entry_def *def = &defs[e];
+			bool changed = frames[e] == 0 || f.len != len[e] ||
+					memcmp(f.data, data[e], f.len) != 0 || f.id != last_id[e];
+			last_id[e] = f.id;
+
+			memcpy(data[e], f.data, f.len);
+			len[e] = f.len;
+			frames[e]++;
+			matched++;
+
+			for (int i = 0; i < def->count; i++) {
+				if (def->fields[i].offset + candisp_type_size(def->fields[i].type) <= f.len) {
+					value[e][i] = ref_value(f.data, &def->fields[i]);
+					valid[e][i] = true;
+				}
+			}
+
+			if ((def->notify == CANDISP_NOTIFY_RX ||
+					(def->notify == CANDISP_NOTIFY_CHANGE && changed)) && !dirty[e]) {
+				dirty[e] = 1;
+				dirty_order[dirty_count++] = e;
+				events++;
+			}
+
+			for (int i = 0; i < def->count; i++) {
+				float v;
+				bool has = candisp_value(&d, e, i, &v);
+				if (has != valid[e][i] ||
+						(has && fabs(v - value[e][i]) > 1e-6 * fmax(1.0, fabs(value[e][i])))) {
+					ok_values = false;
+				}
+			}
+
+			if (d.entry[e].last_id != f.id || d.entry[e].frames != frames[e] ||
+					d.entry[e].last_time != (uint32_t)n) {
+				ok_info = false;
+			}
+		}
+
+		// The reader polls at an irregular rate, so events get coalesced
+		if (--until_poll == 0) {
+			until_poll = (int)(rng() % 10) + 1;
+			polls++;
+
+			for (int i = 0; i < dirty_count; i++) {
+				if (candisp_pop_event(&d) != dirty_order[i]) {
+					ok_events = false;
+				}
+				dirty[dirty_order[i]] = 0;
+			}
+			if (candisp_pop_event(&d) != -1) {
+				ok_events = false;
+			}
+			dirty_count = 0;
+		}
+	}
+
+	check(ok_match, "frames go to the matching entry only");
+	check(ok_values, "decoded values match the reference");
+	check(ok_info, "last id, time and frame count");
+	check(ok_events, "events are queued once per entry, in order");
+	check(d.frames == TRACE_FRAMES && d.matched == matched, "frame counters");
+	check(d.events == events, "event counter");
+	check(matched > TRACE_FRAMES / 2 && events < matched / 2, "trace covers the table and coalesces events");
+	check(frames[0] > 0 && frames[ENTRIES - 1] > 0 && polls > 1000, "trace reaches every entry");
+}
+
+static void test_change(void) {
+	static candisp_t d;
+	setup(&d);
+
+	uint8_t a[8] = {0, 1, 0, 2, 0, 3, 0, 4};
+	uint8_t b[8] = {0, 1, 0, 2, 0, 3, 0, 5};
+
+	candisp_process(&d, 20, false, a, 8, 0);
+	bool first = candisp_pop_event(&d) == 0;
+	candisp_process(&d, 20, false, a, 8, 1);
+	candisp_process(&d, 20, false, a, 8, 2);
+	bool same = candisp_pop_event(&d) == -1;
+	candisp_process(&d, 20, false, b, 8, 3);
+	candisp_process(&d, 20, false, a, 8, 4);
+	bool changed = candisp_pop_event(&d) == 0 && candisp_pop_event(&d) == -1;
+
+	check(first, "change: first frame is an event");
+	check(same, "change: repeated frames are not");
+	check(changed, "change: changes are coalesced into one event");
+
+	float v;
+	check(candisp_value(&d, 0, 3, &v) && fabsf(v - 0.04f) < 1e-6f, "change: values follow the last frame");
+
+	candisp_process(&d, 22, false, a, 8, 5);
+	check(candisp_pop_event(&d) == -1, "entries without notify have no events");
+}
+
+// Frames are passed on unless the entry that takes them consumes them
+static void test_consume(void) {
+	static candisp_t d;
+	setup(&d);
+
+	uint8_t data[8] = {0};
+	int e = candisp_process(&d, 0x18FF3E07, true, data, 8, 0);
+	check(e == 4 && d.entry[e].consume, "entry that consumes takes its frames");
+
+	bool passed = true;
+	for (int i = 0; i < ENTRIES; i++) {
+		passed = passed && (d.entry[i].consume == (i == 4));
+	}
+	check(passed, "other entries pass their frames on");
+}
+
+static void test_add(void) {
+	static candisp_t d;
+	candisp_init(&d);
+
+	candisp_field bad = {6, CANDISP_U32, 1.0};
+	check(candisp_add(&d, 1, 0x7FF, false, &bad, 1, CANDISP_NOTIFY_NONE, false) == -1, "field outside of the frame is rejected");
+
+	candisp_field bad_type = {0, CANDISP_TYPE_COUNT, 1.0};
+	check(candisp_add(&d, 1, 0x7FF, false, &bad_type, 1, CANDISP_NOTIFY_NONE, false) == -1, "unknown type is rejected");
+
+	// The mask is limited to the ID bits of the frame type
+	int e = candisp_add(&d, 0x123, 0xFFFFFFFF, false, NULL, 0, CANDISP_NOTIFY_NONE, false);
+	uint8_t data[8] = {0};
+	check(e == 0 && candisp_process(&d, 0x123, false, data, 8, 0) == 0 &&
+			candisp_process(&d, 0x123, true, data, 8, 0) == -1, "standard and extended IDs are separate");
+
+	candisp_field byte = {0, CANDISP_U8, 1.0};
+	bool filled = true;
+	for (int i = 1; i < CANDISP_MAX_ENTRIES; i++) {
+		filled = filled && candisp_add(&d, i, 0x7FF, false, &byte, 1, CANDISP_NOTIFY_NONE, false) == i;
+	}
+	check(filled, "table holds CANDISP_MAX_ENTRIES entries");
+	check(candisp_add(&d, 0, 0x7FF, false, &byte, 1, CANDISP_NOTIFY_NONE, false) == -1, "full table is rejected");
+}
+
+int main(void) {
+	test_trace();
+	test_change();
+	test_consume();
+	test_add();
+	return failures ? 1 : 0;
+}
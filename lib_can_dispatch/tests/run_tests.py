@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+"""
+CAN dispatch library host tests
+Builds the host tests of the platform independent parts of the library and runs them
+"""
+
+import os
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+
+TESTS_DIR = Path(__file__).resolve().parent
+LIB_DIR = TESTS_DIR.parent / "can_dispatch"
+
+CC = os.environ.get("CC", "cc")
+CFLAGS = ["-O2", "-std=gnu99", "-Wall", "-Wextra", "-Werror", "-pthread", "-I", str(LIB_DIR)]
+
+# Test counters
+test_passes = 0
+test_failures = 0
+
+
+def build(workdir, name, sources, defines=()):
+    binary = Path(workdir) / name
+    cmd = [CC] + CFLAGS + [f"-D{d}" for d in defines] + ["-o", str(binary)]
+    subprocess.run(cmd + [str(s) for s in sources] + ["-lm"], check=True)
+    return binary
+
+
+def run_test(workdir, name, sources, defines=(), args=()):
+    """Builds and runs a test program, which prints a ✓/✗ line per check"""
+    global test_passes, test_failures
+    print(f"\n{name}:")
+    binary = build(workdir, name, sources, defines)
+    result = subprocess.run([str(binary)] + list(args), capture_output=True, text=True)
+    print(result.stdout, end="")
+    test_passes += result.stdout.count("✓")
+    test_failures += result.stdout.count("✗")
+    if result.returncode != 0 and "✗" not in result.stdout:
+        test_failures += 1
+        print(f"✗ {name} exited with {result.returncode}")
+        print(result.stderr, end="")
+
+
+def main():
+    with tempfile.TemporaryDirectory() as workdir:
+        run_test(workdir, "dispatch_test", [TESTS_DIR / "dispatch_test.c", LIB_DIR / "candisp.c"])
+
+    print(f"\n{test_passes} passed, {test_failures} failed")
+    return 1 if test_failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -7,6 +7,12 @@
 
 (def code-server-mutex (mutex-create))
 
+; Outstanding requests as (req can-id thread), newest first. A request is
+; removed once its result has arrived or its thread has stopped waiting.
+(def code-server-pending nil)
+(def code-server-req 0)
+(def code-server-rx-started false)
+
 @const-start
 
 (defun code-server-worker (parent)
@@ -14,7 +20,9 @@
             (var rx (unflatten (canmsg-recv 0 -1)))
             (var id (first rx))
 
-            (send parent (list 'can-id id))
+            ; The request id is only needed for eerror, the client wraps the
+            ; code so that the result carries it
+            (send parent (list 'can-id id (if (= (length rx) 3) (ix rx 2) nil)))
 
             (if (>= id 0)
                 (canmsg-send id 1 (flatten (eval (second rx))))
@@ -28,6 +36,7 @@
 
         (spawn 150 (fn () {
                     (var last-id 0)
+                    (var last-req nil)
                     (var respawn true)
 
                     (loopwhile t {
@@ -40,29 +49,163 @@
                                 ((exit-error (? tid) (? v)) {
                                         (setq respawn true)
                                         (if (>= last-id 0)
-                                            (canmsg-send last-id 1 (flatten 'eerror))
+                                            (canmsg-send last-id 1 (flatten
+                                                    (if last-req (list 'rcode-res last-req 'eerror) 'eerror)
+                                            ))
                                         )
                                 })
 
-                                ((can-id (? id)) {
+                                ((can-id (? id) (? req)) {
                                         (setq last-id id)
+                                        (setq last-req req)
                                 })
                             )
                     })
         }))
 })
 
-(defun rcode-run (id tout code) {
-        (mutex-lock code-server-mutex)
-        (canmsg-send id 0 (flatten (list (can-local-id) code)))
-        (var res (match (canmsg-recv 1 tout)
-                (timeout timeout)
-                ((? a) (unflatten a))
-        ))
-        (mutex-unlock code-server-mutex)
+; Call with code-server-mutex locked
+(defun code-server-find (req) {
+        (var res nil)
+        (loopforeach p code-server-pending
+            (if (= (first p) req) (setq res p))
+        )
         res
 })
 
+; Call with code-server-mutex locked
+(defun code-server-remove (req) {
+        (var res nil)
+        (loopforeach p code-server-pending
+            (if (not (= (first p) req)) (setq res (cons p res)))
+        )
+        (setq code-server-pending (reverse res))
+})
+
+; Hands the results to the threads waiting for them. Results to requests that
+; have timed out are dropped. Servers running an older version of this library
+; send eerror without request id, which can only be told apart when a single
+; request is outstanding. Otherwise it is dropped and the request times out.
+(defun code-server-rx-thd ()
+    (loopwhile t {
+            (var rx (unflatten (canmsg-recv 1 -1)))
+            (var req nil)
+            (var res rx)
+
+            (if (and (eq (type-of rx) 'type-list) (eq (first rx) 'rcode-res)) {
+                    (setq req (ix rx 1))
+                    (setq res (ix rx 2))
+            })
+
+            (mutex-lock code-server-mutex)
+            (var p (cond
+                    (req (code-server-find req))
+                    ((= (length code-server-pending) 1) (first code-server-pending))
+                    (t nil)
+            ))
+            (if p {
+                    (code-server-remove (first p))
+                    (send (ix p 2) (list 'rcode-res (first p) res))
+            })
+            (mutex-unlock code-server-mutex)
+}))
+
+; Registers a request to id and returns its request id, or nil if the
+; request can't be started before the timeout runs out. The server runs one
+; request at a time, so a request waits while another one to the same id is
+; outstanding. Requests to different ids don't wait for each other.
+(defun code-server-add (id t-start tout) {
+        (var req nil)
+        (loopwhile (and (not req) (< (secs-since t-start) tout)) {
+                (mutex-lock code-server-mutex)
+
+                (if (not code-server-rx-started) {
+                        (spawn 150 code-server-rx-thd)
+                        (setq code-server-rx-started true)
+                })
+
+                (var busy false)
+                (loopforeach p code-server-pending
+                    (if (= (ix p 1) id) (setq busy true))
+                )
+
+                (if (not busy) {
+                        (setq code-server-req (mod (+ code-server-req 1) 100000))
+                        (setq req code-server-req)
+                        (setq code-server-pending (cons (list req id (self)) code-server-pending))
+                })
+
+                (mutex-unlock code-server-mutex)
+
+                (if (not req) (sleep 0.002))
+        })
+        req
+})
+
+; Waits for the results of the requests reqs, given as (req t-sent), and
+; returns them in the same order. Each request has tout from when it was sent.
+; Requests that are nil or don't finish in time give timeout.
+(defun code-server-collect (reqs tout) {
+        (var res (map (fn (x) 'timeout) reqs))
+        (var done (map (fn (x) (not (first x))) reqs))
+
+        (loopwhile t {
+                ; Requests past their deadline stop being waited for, the
+                ; wait is until the next deadline
+                (var tout-left -1)
+                (mutex-lock code-server-mutex)
+                (looprange i 0 (length reqs)
+                    (if (not (ix done i)) {
+                            (var left (- tout (secs-since (ix (ix reqs i) 1))))
+                            (cond
+                                ; A request that is no longer outstanding has
+                                ; its result on the way to us
+                                ((not (code-server-find (first (ix reqs i)))) (setq left 0))
+                                ((<= left 0) {
+                                        (code-server-remove (first (ix reqs i)))
+                                        (setix done i true)
+                                        (setq left -1)
+                                })
+                            )
+                            (if (and (>= left 0) (or (< tout-left 0) (< left tout-left))) (setq tout-left left))
+                    })
+                )
+                (mutex-unlock code-server-mutex)
+                (if (< tout-left 0) (break))
+
+                (recv-to tout-left
+                    ((rcode-res (? req) (? v))
+                        (looprange i 0 (length reqs)
+                            (if (and (not (ix done i)) (eq (first (ix reqs i)) req)) {
+                                    (setix res i v)
+                                    (setix done i true)
+                            })
+                    ))
+                    (timeout nil)
+                )
+        })
+
+        res
+})
+
+; Sends the request and returns it as (req t-sent). The code is wrapped so that
+; its result comes back with the request id also from servers running an older
+; version of this library, which don't send it back themselves.
+(defun code-server-send (id code req) {
+        (if req (canmsg-send id 0 (flatten (list (can-local-id) (list 'list (list 'quote 'rcode-res) req code) req))))
+        (list req (systime))
+})
+
+(defun rcode-run (id tout code) {
+        (var req (code-server-add id (systime) tout))
+        (first (code-server-collect (list (code-server-send id code req)) tout))
+})
+
+(defun rcode-run-all (ids tout code) {
+        (var reqs (map (fn (id) (code-server-send id code (code-server-add id (systime) tout))) ids))
+        (code-server-collect reqs tout)
+})
+
 (defun rcode-run-noret (id code) {
         (mutex-lock code-server-mutex)
         (var res (canmsg-send id 0 (flatten (list -1 code))))
@@ -0,0 +1,263 @@
+/*
+	Copyright 2026 VESC project
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Host benchmark of the segment pixel pass (pixel.h) against the previous
+// three-pass implementation: brightness scale, auto-white, then packing with
+// a per-pixel overlay scan and a per-pixel switch on the byte layout. The
+// outputs are checked to be identical first. The absolute numbers say little
+// about the ESP targets, the ratio is what matters.
+//
+// Usage: render_bench [PIXELS [ROUNDS]]
+
+#include "../esp_led_strip/pixel.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define OV_MAX 8
+
+typedef struct {
+	int type;
+	int n;
+	bool reverse;
+	bool auto_white;
+	uint8_t bri_cur;
+	uint8_t master_cur;
+	int ov_count;
+	uint16_t ov_idx[OV_MAX];
+	uint32_t ov_color;
+	uint8_t ov_bri;
+} seg_t;
+
+static uint32_t scale_ref(uint32_t c, uint32_t num) {
+	uint32_t w = (((c >> 24) & 0xFF) * num) / 255;
+	uint32_t r = (((c >> 16) & 0xFF) * num) / 255;
+	uint32_t g = (((c >> 8) & 0xFF) * num) / 255;
+	uint32_t b = ((c & 0xFF) * num) / 255;
+	return px_pack(r, g, b, w);
+}
+
+static void render_ref(const seg_t *s, uint32_t *work, uint8_t *tx) {
+	int n = s->n;
+	int colors = s->type >= TYPE_GRBW ? 4 : 3;
+	uint32_t bri = ((uint32_t)s->bri_cur * s->master_cur) / 255;
+
+	for (int i = 0; i < n; i++) {
+		uint32_t c = scale_ref(work[i], bri);
+
+		uint32_t w = (c >> 24) & 0xFF;
+		uint32_t r = (c >> 16) & 0xFF;
+		uint32_t g = (c >> 8) & 0xFF;
+		uint32_t b = c & 0xFF;
+
+		if (s->auto_white && colors == 4 && w == 0) {
+			w = r < g ? (r < b ? r : b) : (g < b ? g : b);
+			r -= w; g -= w; b -= w;
+		}
+
+		work[i] = px_pack(r, g, b, w);
+	}
+
+	int total = n + s->ov_count;
+	int src = 0;
+	for (int i = 0; i < total; i++) {
+		bool is_ov = false;
+		for (int k = 0; k < s->ov_count; k++) {
+			if (s->ov_idx[k] == i) {
+				is_ov = true;
+				break;
+			}
+		}
+
+		uint32_t c;
+		if (is_ov) {
+			c = scale_ref(s->ov_color, s->ov_bri);
+		} else if (src < n) {
+			c = work[s->reverse ? n - 1 - src : src];
+			src++;
+		} else {
+			c = 0;
+		}
+
+		uint32_t w = (c >> 24) & 0xFF;
+		uint32_t r = (c >> 16) & 0xFF;
+		uint32_t g = (c >> 8) & 0xFF;
+		uint32_t b = c & 0xFF;
+
+		uint8_t *px = tx + i * colors;
+		switch (s->type) {
+		case TYPE_RGB:  px[0] = r; px[1] = g; px[2] = b; break;
+		case TYPE_GRBW: px[0] = g; px[1] = r; px[2] = b; px[3] = w; break;
+		case TYPE_RGBW: px[0] = r; px[1] = g; px[2] = b; px[3] = w; break;
+		case TYPE_WRGB: px[0] = w; px[1] = r; px[2] = g; px[3] = b; break;
+		case TYPE_GRB:
+		default:        px[0] = g; px[1] = r; px[2] = b; break;
+		}
+	}
+}
+
+// The same as render_seg and ext-esp_led-seg-overlay-def in code.c
+static void render_new(const seg_t *s, const uint32_t *work, uint8_t *tx) {
+	uint16_t ov_pos[OV_MAX];
+	int ov_pos_count = 0;
+	for (int k = 0; k < s->ov_count; k++) {
+		uint16_t v = s->ov_idx[k];
+		bool dup = false;
+		for (int j = 0; j < ov_pos_count; j++) {
+			dup |= ov_pos[j] == v;
+		}
+		if (dup) {
+			continue;
+		}
+		int j = ov_pos_count;
+		while (j > 0 && ov_pos[j - 1] > v) {
+			ov_pos[j] = ov_pos[j - 1];
+			j--;
+		}
+		ov_pos[j] = v;
+		ov_pos_count++;
+	}
+
+	px_seg_t p = {
+		.work = work,
+		.n = s->n,
+		.total = s->n + s->ov_count,
+		.reverse = s->reverse,
+		.auto_white = s->auto_white,
+		.bri = ((uint32_t)s->bri_cur * s->master_cur) / 255,
+		.ov_color = px_scale(s->ov_color, s->ov_bri),
+		.ov_pos = ov_pos,
+		.ov_pos_count = ov_pos_count,
+	};
+	px_render(&p, tx, s->type);
+}
+
+static double now_s(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void random_work(uint32_t *work, int n) {
+	for (int i = 0; i < n; i++) {
+		// some pixels without white, for auto-white to act on
+		work[i] = (uint32_t)rand() << 16 ^ (uint32_t)rand();
+		if (rand() % 2) {
+			work[i] &= 0x00FFFFFF;
+		}
+	}
+}
+
+static void set_overlay(seg_t *s, int count) {
+	s->ov_count = count;
+	for (int k = 0; k < count; k++) {
+		s->ov_idx[k] = rand() % (s->n + count);
+	}
+	if (count > 2) {
+		s->ov_idx[count - 1] = s->ov_idx[0]; // a duplicate
+	}
+}
+
+int main(int argc, char **argv) {
+	int n = argc > 1 ? atoi(argv[1]) : 300;
+	int rounds = argc > 2 ? atoi(argv[2]) : 20000;
+
+	uint32_t *work = malloc(n * sizeof(uint32_t));
+	uint32_t *work_ref = malloc(n * sizeof(uint32_t));
+	uint8_t *tx = malloc((n + OV_MAX) * 4);
+	uint8_t *tx_ref = malloc((n + OV_MAX) * 4);
+
+	// identical output for every layout and option
+	int checks = 0;
+	for (int type = TYPE_GRB; type <= TYPE_WRGB; type++) {
+		for (int opts = 0; opts < 4; opts++) {
+			for (int ov = 0; ov <= OV_MAX; ov += 2) {
+				seg_t s = {
+					.type = type, .n = n,
+					.reverse = opts & 1, .auto_white = opts & 2,
+					.bri_cur = rand(), .master_cur = rand(),
+					.ov_color = rand(), .ov_bri = rand(),
+				};
+				set_overlay(&s, ov);
+				random_work(work, n);
+				memcpy(work_ref, work, n * sizeof(uint32_t));
+
+				int bytes = (n + ov) * (type >= TYPE_GRBW ? 4 : 3);
+				memset(tx, 0xAA, bytes);
+				memset(tx_ref, 0x55, bytes);
+				render_new(&s, work, tx);
+				render_ref(&s, work_ref, tx_ref);
+				if (memcmp(tx, tx_ref, bytes) != 0) {
+					printf("Mismatch: type %d, options %d, overlays %d\n", type, opts, ov);
+					return 1;
+				}
+				checks++;
+			}
+		}
+	}
+	printf("Output identical to the previous implementation in %d configurations\n", checks);
+
+	static const struct {
+		const char *name;
+		int type;
+		bool auto_white;
+		int ov;
+	} cases[] = {
+		{"GRB", TYPE_GRB, false, 0},
+		{"GRB, 4 overlays", TYPE_GRB, false, 4},
+		{"GRBW, auto-white", TYPE_GRBW, true, 0},
+		{"GRBW, auto-white, 8 overlays", TYPE_GRBW, true, 8},
+	};
+
+	printf("%d pixels, %d rounds:\n", n, rounds);
+	for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+		seg_t s = {
+			.type = cases[c].type, .n = n, .auto_white = cases[c].auto_white,
+			.bri_cur = 200, .master_cur = 180, .ov_color = 0xFFFFFF, .ov_bri = 255,
+		};
+		set_overlay(&s, cases[c].ov);
+		random_work(work, n);
+
+		// the previous implementation scales in place, give it fresh pixels
+		double t0 = now_s();
+		for (int r = 0; r < rounds; r++) {
+			memcpy(work_ref, work, n * sizeof(uint32_t));
+			render_ref(&s, work_ref, tx_ref);
+		}
+		double t_ref = now_s() - t0;
+
+		t0 = now_s();
+		for (int r = 0; r < rounds; r++) {
+			memcpy(work_ref, work, n * sizeof(uint32_t));
+			render_new(&s, work_ref, tx);
+		}
+		double t_new = now_s() - t0;
+
+		printf("  %-30s previous %7.0f ns, fused %7.0f ns per segment, %.1fx\n",
+			cases[c].name, t_ref / rounds * 1e9, t_new / rounds * 1e9, t_ref / t_new);
+	}
+
+	free(work);
+	free(work_ref);
+	free(tx);
+	free(tx_ref);
+	return 0;
+}
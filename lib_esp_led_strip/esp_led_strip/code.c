@@ -39,6 +39,7 @@
 // Colors are packed 0xWWRRGGBB ints, like the color-* extensions.
 
 #include "express/vesc_c_if.h"
+#include "pixel.h"
 
 #include <string.h>
 
@@ -118,15 +119,6 @@ enum {
 	TURN_HAZARD_SOLID, TURN_HAZARD_BLINK, TURN_HAZARD_SWEEP,
 };
 
-// Color byte layouts on the wire
-enum {
-	TYPE_GRB = 0,
-	TYPE_RGB,
-	TYPE_GRBW,
-	TYPE_RGBW,
-	TYPE_WRGB,  // white first (WS2814 and friends)
-};
-
 // Wire timing presets. The lib forwards the value to the firmware LED driver;
 // it is never switched on here, so this enum is documentation for lisp
 // consumers (mirrored into esp_led_defs.lisp by gen_defs.py).
@@ -166,6 +158,24 @@ static const palette_t palettes[] = {
 };
 #define PALETTE_COUNT ((int)(sizeof(palettes) / sizeof(palettes[0])))
 
+// Everything a static segment's output depends on, compared frame to frame
+// by render_thd to skip re-rendering it (see fx_animated). The manual pixels
+// of FX_CUSTOM are not part of it, their setters clear seg_t.drawn instead.
+typedef struct {
+	uint32_t color;
+	uint32_t ov_color;
+	uint32_t cpal[4];
+	uint8_t fx;
+	uint8_t pal;
+	uint8_t bri;       // combined segment and master brightness
+	uint8_t spd;
+	uint8_t fx_val;
+	uint8_t ov_bri;
+	bool on;
+	bool reverse;
+	bool auto_white;
+} seg_key_t;
+
 typedef struct {
 	bool defined;
 	bool on;
@@ -197,7 +207,11 @@ typedef struct {
 	// effect pixels flow around them. Positions are relative to the
 	// segment and extend its footprint to len + ov_count pixels.
 	uint8_t ov_count;
-	uint8_t ov_idx[esp_led_OV_MAX];
+	uint16_t ov_idx[esp_led_OV_MAX];
+	// ov_idx sorted with duplicates dropped, for the pixel pass to walk the
+	// footprint in runs (see px_render_type)
+	uint8_t ov_pos_count;
+	uint16_t ov_pos[esp_led_OV_MAX];
 	uint32_t ov_color;
 	uint8_t ov_bri;
 
@@ -211,6 +225,11 @@ typedef struct {
 	// gradient effects can be recoloured. Set via ext-esp_led-seg-palette.
 	uint32_t cpal[4];
 
+	// Static output tracking (render_thd): the inputs of the last render and
+	// a bit per group tx buffer that holds its output for them
+	seg_key_t key;
+	uint8_t drawn;
+
 	int group;         // pin group index, assigned at init
 } seg_t;
 
@@ -258,18 +277,6 @@ static esp_led_t *state(void) {
 
 // ---- Color helpers ------------------------------------------------------
 
-static uint32_t pack(uint32_t r, uint32_t g, uint32_t b, uint32_t w) {
-	return (w << 24) | (r << 16) | (g << 8) | b;
-}
-
-static uint32_t scale(uint32_t c, uint32_t num) { // num 0..255
-	uint32_t w = (((c >> 24) & 0xFF) * num) / 255;
-	uint32_t r = (((c >> 16) & 0xFF) * num) / 255;
-	uint32_t g = (((c >> 8) & 0xFF) * num) / 255;
-	uint32_t b = ((c & 0xFF) * num) / 255;
-	return pack(r, g, b, w);
-}
-
 // Interpolate a position 0..255 across 4 anchor colours (wrapping).
 static uint32_t interp4(const uint32_t *c, uint8_t pos) {
 	uint32_t a = c[pos / 64];
@@ -279,7 +286,7 @@ static uint32_t interp4(const uint32_t *c, uint8_t pos) {
 	uint32_t r = (((a >> 16) & 0xFF) * (63 - f) + ((b >> 16) & 0xFF) * f) / 63;
 	uint32_t g = (((a >> 8) & 0xFF) * (63 - f) + ((b >> 8) & 0xFF) * f) / 63;
 	uint32_t bl = ((a & 0xFF) * (63 - f) + (b & 0xFF) * f) / 63;
-	return pack(r, g, bl, 0);
+	return px_pack(r, g, bl, 0);
 }
 
 static uint32_t palette_at(uint8_t pal, uint8_t pos) {
@@ -333,7 +340,7 @@ static void fx_render(const seg_t *s, uint32_t *work) {
 	case FX_BREATHE: {
 		uint32_t b = triangle(ph / 4);
 		uint32_t c0 = s->color_cur ? s->color_cur : seg_palette_at(s,(uint8_t)(ph / 128));
-		uint32_t c = scale(c0, b);
+		uint32_t c = px_scale(c0, b);
 		for (int i = 0; i < n; i++) work[i] = c;
 	} break;
 
@@ -345,7 +352,7 @@ static void fx_render(const seg_t *s, uint32_t *work) {
 			uint32_t b = d < size ? 255 - (d * 255) / size : 0;
 			uint32_t c = s->color_cur ? s->color_cur
 				: seg_palette_at(s,(uint8_t)((i * 255) / (n ? n : 1)));
-			work[i] = scale(c, b);
+			work[i] = px_scale(c, b);
 		}
 	} break;
 
@@ -374,7 +381,7 @@ static void fx_render(const seg_t *s, uint32_t *work) {
 			if (d < 0) d += n;
 			uint32_t b = d < size ? 255 - (d * 255) / size : 0;
 			uint32_t c = s->color_cur ? s->color_cur : seg_palette_at(s,(uint8_t)(ph / 32));
-			work[i] = scale(c, b);
+			work[i] = px_scale(c, b);
 		}
 	} break;
 
@@ -391,7 +398,7 @@ static void fx_render(const seg_t *s, uint32_t *work) {
 		if (!s->color_cur && s->pal) {
 			for (int i = 0; i < n; i++) {
 				work[i] = i < lit
-					? scale(seg_palette_at(s,(uint8_t)((i * 255) / n)), b)
+					? px_scale(seg_palette_at(s,(uint8_t)((i * 255) / n)), b)
 					: 0;
 			}
 			break;
@@ -404,9 +411,9 @@ static void fx_render(const seg_t *s, uint32_t *work) {
 		} else {
 			uint32_t g = ((uint32_t)s->fx_val * 255) / 204; // fx_val/0.8
 			if (g > 255) g = 255;
-			c = pack(255 - g, g, 0, 0);
+			c = px_pack(255 - g, g, 0, 0);
 		}
-		c = scale(c, b);
+		c = px_scale(c, b);
 		for (int i = 0; i < n; i++) work[i] = i < lit ? c : 0;
 	} break;
 
@@ -426,7 +433,7 @@ static void fx_render(const seg_t *s, uint32_t *work) {
 		for (int i = 0; i < n; i++) {
 			int d = i > pos ? i - pos : pos - i;
 			uint32_t b = d < size ? 255 - (d * 255) / size : 0;
-			work[i] = scale(c, b);
+			work[i] = px_scale(c, b);
 		}
 	} break;
 
@@ -476,7 +483,7 @@ static void fx_render(const seg_t *s, uint32_t *work) {
 			uint32_t w3 = triangle(p + 85 + ph / 20);
 			uint32_t c0 = s->color_cur ? s->color_cur
 				: seg_palette_at(s,(uint8_t)((w1 + w3) / 2));
-			work[i] = scale(c0, 64 + (w2 * 191) / 255);
+			work[i] = px_scale(c0, 64 + (w2 * 191) / 255);
 		}
 	} break;
 
@@ -493,7 +500,7 @@ static void fx_render(const seg_t *s, uint32_t *work) {
 			uint32_t b1 = (h1 >> 8) & 0xFF;
 			uint32_t b2 = (h2 >> 8) & 0xFF;
 			uint32_t b = (b1 * (255 - f) + b2 * f) / 255;
-			work[i] = scale(c0, 100 + (b * 155) / 255);
+			work[i] = px_scale(c0, 100 + (b * 155) / 255);
 		}
 	} break;
 
@@ -509,7 +516,7 @@ static void fx_render(const seg_t *s, uint32_t *work) {
 		}
 		if (b < 16) b = 16; // faint glow between beats
 		uint32_t c = s->color_cur ? s->color_cur : seg_palette_at(s,(uint8_t)(ph / 128));
-		c = scale(c, b);
+		c = px_scale(c, b);
 		for (int i = 0; i < n; i++) work[i] = c;
 	} break;
 
@@ -628,77 +635,69 @@ static uint32_t ease_color(uint32_t cur, uint32_t target, uint8_t fade,
 	return out;
 }
 
+// Whether the segment's output moves with its phase. The others only change
+// when their inputs (seg_key_t) do, so render_thd renders them once into
+// each tx buffer and then leaves them alone.
+static bool fx_animated(const seg_t *s) {
+	switch (s->fx) {
+	case FX_OFF:
+	case FX_CUSTOM:
+		return false;
+	case FX_SOLID:
+		return s->color_cur == 0; // palette colour cycles
+	case FX_GAUGE:
+		return s->spd != 0;       // pulsing fill
+	case FX_TURN:
+		// Solid styles and the blank invalid modes are static
+		return s->fx_val >= TURN_LEFT_SOLID && s->fx_val <= TURN_HAZARD_SWEEP
+			&& (s->fx_val - 1) % 3 != 0;
+	default:
+		return true;
+	}
+}
+
+static void seg_key(const seg_t *s, uint8_t master_cur, seg_key_t *k) {
+	memset(k, 0, sizeof(*k)); // padding too, keys are compared with memcmp
+	k->color = s->color_cur;
+	k->ov_color = s->ov_color;
+	for (int i = 0; i < 4; i++) k->cpal[i] = s->cpal[i];
+	k->fx = s->fx;
+	k->pal = s->pal;
+	k->bri = (uint8_t)(((uint32_t)s->bri_cur * master_cur) / 255);
+	k->spd = s->spd;
+	k->fx_val = s->fx_val;
+	k->ov_bri = s->ov_bri;
+	k->on = s->on;
+	k->reverse = s->reverse;
+	k->auto_white = s->auto_white;
+}
+
 // Render one segment into its place in the pin group's chain buffer.
 // Brightness is sampled once per frame under the ease lock instead of being
 // re-read here.
 static void render_seg(esp_led_t *st, const seg_t *s, uint8_t master_cur) {
 	group_t *grp = &st->group[s->group];
-	int n = s->len;
-	uint32_t *work = st->work;
-	int colors = grp->colors;
-	uint8_t *tx = grp->txbuf[grp->cur] + (uint32_t)s->offset * colors;
-
-	fx_render(s, work);
-
-	// Combined per-segment and master brightness
-	uint32_t bri = ((uint32_t)s->bri_cur * master_cur) / 255;
-
-	for (int i = 0; i < n; i++) {
-		uint32_t c = scale(work[i], bri);
-
-		uint32_t w = (c >> 24) & 0xFF;
-		uint32_t r = (c >> 16) & 0xFF;
-		uint32_t g = (c >> 8) & 0xFF;
-		uint32_t b = c & 0xFF;
-
-		// Derive white from the common RGB part on RGBW strips
-		if (s->auto_white && colors == 4 && w == 0) {
-			w = r < g ? (r < b ? r : b) : (g < b ? g : b);
-			r -= w; g -= w; b -= w;
-		}
-
-		work[i] = pack(r, g, b, w);
-	}
-
-	// Pack the wire bytes. Overlay pixels take their footprint positions,
-	// effect pixels fill the remaining slots in order (reverse applies to
-	// the effect pixels only - overlay positions are fixed hardware).
-	int total = n + s->ov_count;
-	int src = 0;
-	for (int i = 0; i < total; i++) {
-		bool is_ov = false;
-		for (int k = 0; k < s->ov_count; k++) {
-			if (s->ov_idx[k] == i) {
-				is_ov = true;
-				break;
-			}
-		}
-
-		uint32_t c;
-		if (is_ov) {
-			c = scale(s->ov_color, s->ov_bri);
-		} else if (src < n) {
-			c = work[s->reverse ? n - 1 - src : src];
-			src++;
-		} else {
-			c = 0;
-		}
-
-		uint32_t w = (c >> 24) & 0xFF;
-		uint32_t r = (c >> 16) & 0xFF;
-		uint32_t g = (c >> 8) & 0xFF;
-		uint32_t b = c & 0xFF;
-
-		uint8_t *px = tx + i * colors;
-		switch (s->type) {
-		case TYPE_RGB:  px[0] = r; px[1] = g; px[2] = b; break;
-		case TYPE_GRBW: px[0] = g; px[1] = r; px[2] = b; px[3] = w; break;
-		case TYPE_RGBW: px[0] = r; px[1] = g; px[2] = b; px[3] = w; break;
-		case TYPE_WRGB: px[0] = w; px[1] = r; px[2] = g; px[3] = b; break;
-		case TYPE_GRB:
-		default:        px[0] = g; px[1] = r; px[2] = b; break;
-		}
-	}
+	uint8_t *tx = grp->txbuf[grp->cur] + (uint32_t)s->offset * grp->colors;
+
+	fx_render(s, st->work);
+
+	// Brightness, auto-white and the wire bytes in one pass. Overlay pixels
+	// take their footprint positions, effect pixels fill the remaining slots
+	// in order (reverse applies to the effect pixels only - overlay
+	// positions are fixed hardware).
+	px_seg_t p = {
+		.work = st->work,
+		.n = s->len,
+		.total = s->len + s->ov_count,
+		.reverse = s->reverse,
+		.auto_white = s->auto_white,
+		// Combined per-segment and master brightness
+		.bri = ((uint32_t)s->bri_cur * master_cur) / 255,
+		.ov_color = px_scale(s->ov_color, s->ov_bri),
+		.ov_pos = s->ov_pos,
+		.ov_pos_count = s->ov_pos_count,
+	};
+	px_render(&p, tx, s->type);
 }
 
 static void render_thd(void *arg) {
@@ -730,18 +729,43 @@ static void render_thd(void *arg) {
 			group_t *g = &st->group[gi];
 
 			// One lock hold per segment instead of one across the whole pass.
+			// The other buffer holds the last transmitted frame, so a segment
+			// changed the frame when its rendered span differs from there.
+			// Static segments are only rendered while their inputs change,
+			// and once more into the other buffer after the next flip.
 			bool any = false;
+			bool changed = false;
+			uint8_t bit = (uint8_t)(1 << g->cur);
 			for (int i = 0; i < st->seg_count; i++) {
 				VESC_IF->mutex_lock(st->lock);
 				seg_t *s = &st->seg[i];
 				if (s->defined && s->group == gi && s->len > 0
 					&& s->len <= st->buf_len) {
-					if (s->on) {
-						render_seg(st, s, master_cur);
-					} else {
-						memset(g->txbuf[g->cur] + (uint32_t)s->offset * g->colors,
-							0, (uint32_t)(s->len + s->ov_count) * g->colors);
+					seg_key_t key;
+					seg_key(s, master_cur, &key);
+					if ((s->on && fx_animated(s))
+						|| memcmp(&key, &s->key, sizeof(key)) != 0) {
+						s->key = key;
+						s->drawn = 0;
 					}
+
+					uint32_t off = (uint32_t)s->offset * g->colors;
+					uint32_t bytes = (uint32_t)(s->len + s->ov_count) * g->colors;
+					if (!(s->drawn & bit)) {
+						if (s->on) {
+							render_seg(st, s, master_cur);
+						} else {
+							memset(g->txbuf[g->cur] + off, 0, bytes);
+						}
+						s->drawn |= bit;
+						if (!changed && memcmp(g->txbuf[0] + off,
+								g->txbuf[1] + off, bytes) != 0) {
+							changed = true;
+						}
+					} else if (!(s->drawn & (bit ^ 3))) {
+						changed = true; // not on the wire yet
+					}
+
 					// Accumulate speed so speed changes take effect in place,
 					// without moving the animation position.
 					uint32_t spd = s->spd ? s->spd : esp_led_SPD_DEF;
@@ -757,13 +781,12 @@ static void render_thd(void *arg) {
 			int tx_bytes = g->chain_len * g->colors;
 
 			// Only transmit frames that differ from what the strip already
-			// shows (the other buffer holds the last transmitted frame),
-			// plus a periodic keepalive. The buffer only flips after a real
-			// transmission so the comparison stays against the wire state.
+			// shows, plus a periodic keepalive. The buffer only flips after a
+			// real transmission so the change tracking stays against the
+			// wire state.
 			bool send = false;
 			if (any) {
-				if (g->quiet_ms >= esp_led_REFRESH_MS
-					|| memcmp(g->txbuf[0], g->txbuf[1], (size_t)tx_bytes) != 0) {
+				if (g->quiet_ms >= esp_led_REFRESH_MS || changed) {
 					send = true;
 					g->quiet_ms = 0;
 					g->cur ^= 1;
@@ -866,6 +889,7 @@ static lbm_value ext_seg_def(lbm_value *args, lbm_uint argn) {
 	s->phase = 0;
 	s->phase_rem = 0;
 	s->ov_count = 0;
+	s->ov_pos_count = 0;
 	s->ov_color = 0;
 	s->ov_bri = 0;
 	s->cpal[0] = 0; s->cpal[1] = 0; s->cpal[2] = 0; s->cpal[3] = 0;
@@ -909,8 +933,26 @@ static lbm_value ext_seg_overlay_def(lbm_value *args, lbm_uint argn) {
 
 	VESC_IF->mutex_lock(st->lock);
 	s->ov_count = (uint8_t)count;
+	s->ov_pos_count = 0;
 	for (int k = 0; k < count; k++) {
-		s->ov_idx[k] = (uint8_t)VESC_IF->lbm_dec_as_i32(args[k + 1]);
+		uint16_t v = (uint16_t)VESC_IF->lbm_dec_as_i32(args[k + 1]);
+		s->ov_idx[k] = v;
+
+		// sorted position table, without duplicates
+		bool dup = false;
+		for (int j = 0; j < s->ov_pos_count; j++) {
+			dup |= s->ov_pos[j] == v;
+		}
+		if (dup) {
+			continue;
+		}
+		int j = s->ov_pos_count;
+		while (j > 0 && s->ov_pos[j - 1] > v) {
+			s->ov_pos[j] = s->ov_pos[j - 1];
+			j--;
+		}
+		s->ov_pos[j] = v;
+		s->ov_pos_count++;
 	}
 	VESC_IF->mutex_unlock(st->lock);
 
@@ -965,6 +1007,7 @@ static lbm_value ext_init(lbm_value *args, lbm_uint argn) {
 		uint16_t end = s->offset + s->len + s->ov_count;
 
 		s->group = -1;
+		s->drawn = 0;
 		for (int gi = 0; gi < st->group_count; gi++) {
 			if (st->group[gi].pin == s->pin) {
 				s->group = gi;
@@ -1302,6 +1345,7 @@ static bool seg_custom_ready(seg_t *s) {
 		}
 	}
 	s->fx = FX_CUSTOM;
+	s->drawn = 0; // the pixels are about to change
 	return true;
 }
 
@@ -1398,7 +1442,7 @@ static lbm_value ext_col_rgbw(lbm_value *args, lbm_uint argn) {
 	uint32_t g = VESC_IF->lbm_dec_as_u32(args[1]) & 0xFF;
 	uint32_t b = VESC_IF->lbm_dec_as_u32(args[2]) & 0xFF;
 	uint32_t w = argn == 4 ? VESC_IF->lbm_dec_as_u32(args[3]) & 0xFF : 0;
-	uint32_t c = pack(r, g, b, w);
+	uint32_t c = px_pack(r, g, b, w);
 
 	VESC_IF->mutex_lock(st->lock);
 	for (int i = 0; i < esp_led_SEG_MAX; i++) {
@@ -0,0 +1,148 @@
+/*
+	Copyright 2026 VESC project
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Pixel pipeline of a segment: brightness, auto-white and packing of the wire
+// bytes, fused into one pass over the segment footprint. Kept free of the C
+// interface so the host benchmark (bench/render_bench.c) can build it.
+
+#ifndef PIXEL_H_
+#define PIXEL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Color byte layouts on the wire
+enum {
+	TYPE_GRB = 0,
+	TYPE_RGB,
+	TYPE_GRBW,
+	TYPE_RGBW,
+	TYPE_WRGB,  // white first (WS2814 and friends)
+};
+
+static inline uint32_t px_pack(uint32_t r, uint32_t g, uint32_t b, uint32_t w) {
+	return (w << 24) | (r << 16) | (g << 8) | b;
+}
+
+// Scale all channels by num / 255 (num 0..255), rounding down like the
+// per-channel (x * num) / 255. Two channels are processed per multiply in
+// 16-bit lanes, the division uses (p + (p >> 8) + 1) >> 8, which is exact
+// for the products of two bytes and doesn't carry out of the lane.
+static inline uint32_t px_scale(uint32_t c, uint32_t num) {
+	uint32_t rb = (c & 0x00FF00FF) * num;
+	uint32_t wg = ((c >> 8) & 0x00FF00FF) * num;
+	rb = ((rb + ((rb >> 8) & 0x00FF00FF) + 0x00010001) >> 8) & 0x00FF00FF;
+	wg = (wg + ((wg >> 8) & 0x00FF00FF) + 0x00010001) & 0xFF00FF00;
+	return rb | wg;
+}
+
+// Everything the pixel pass needs from a segment, resolved once per frame.
+typedef struct {
+	const uint32_t *work;     // n effect pixels, packed 0xWWRRGGBB
+	int n;
+	int total;                // footprint, effect and overlay pixels
+	bool reverse;             // applies to the effect pixels only
+	bool auto_white;
+	uint32_t bri;             // 0..255, applied to the effect pixels
+	uint32_t ov_color;        // overlay color, brightness already applied
+	const uint16_t *ov_pos;   // overlay positions, sorted and unique
+	int ov_pos_count;
+} px_seg_t;
+
+// With a constant type, the switch folds away and the stores are direct.
+static inline __attribute__((always_inline))
+void px_put(uint8_t *px, uint32_t c, const int type) {
+	uint8_t w = (uint8_t)(c >> 24);
+	uint8_t r = (uint8_t)(c >> 16);
+	uint8_t g = (uint8_t)(c >> 8);
+	uint8_t b = (uint8_t)c;
+
+	switch (type) {
+	case TYPE_RGB:  px[0] = r; px[1] = g; px[2] = b; break;
+	case TYPE_GRBW: px[0] = g; px[1] = r; px[2] = b; px[3] = w; break;
+	case TYPE_RGBW: px[0] = r; px[1] = g; px[2] = b; px[3] = w; break;
+	case TYPE_WRGB: px[0] = w; px[1] = r; px[2] = g; px[3] = b; break;
+	case TYPE_GRB:
+	default:        px[0] = g; px[1] = r; px[2] = b; break;
+	}
+}
+
+// Brightness, then white derived from the common RGB part on RGBW strips.
+static inline __attribute__((always_inline))
+uint32_t px_effect(uint32_t c, uint32_t bri, bool auto_white) {
+	c = px_scale(c, bri);
+	if (auto_white && (c >> 24) == 0) {
+		uint32_t r = (c >> 16) & 0xFF;
+		uint32_t g = (c >> 8) & 0xFF;
+		uint32_t b = c & 0xFF;
+		uint32_t w = r < g ? (r < b ? r : b) : (g < b ? g : b);
+		c = px_pack(r - w, g - w, b - w, w);
+	}
+	return c;
+}
+
+// The footprint is walked in runs of effect pixels between the overlay
+// positions, so the inner loop has no overlay test. Slots left over once the
+// effect pixels run out (duplicate overlay positions) are black.
+static inline __attribute__((always_inline))
+void px_render_type(const px_seg_t *p, uint8_t *tx, const int type) {
+	const int colors = type >= TYPE_GRBW ? 4 : 3;
+	const bool auto_white = p->auto_white && colors == 4;
+	const int step = p->reverse ? -1 : 1;
+	int src = p->reverse ? p->n - 1 : 0;
+	int left = p->n;
+	int i = 0;
+
+	for (int k = 0; k <= p->ov_pos_count; k++) {
+		int end = k < p->ov_pos_count ? p->ov_pos[k] : p->total;
+		int run = end - i < left ? end - i : left;
+		left -= run;
+
+		uint8_t *px = tx + i * colors;
+		for (int j = 0; j < run; j++) {
+			px_put(px, px_effect(p->work[src], p->bri, auto_white), type);
+			src += step;
+			px += colors;
+		}
+		for (i += run; i < end; i++) {
+			px_put(px, 0, type);
+			px += colors;
+		}
+
+		if (k < p->ov_pos_count) {
+			px_put(px, p->ov_color, type);
+			i++;
+		}
+	}
+}
+
+// Render the footprint of a segment into its wire bytes at tx, with the
+// packer specialised for the byte layout picked once here.
+static inline void px_render(const px_seg_t *p, uint8_t *tx, int type) {
+	switch (type) {
+	case TYPE_RGB:  px_render_type(p, tx, TYPE_RGB); break;
+	case TYPE_GRBW: px_render_type(p, tx, TYPE_GRBW); break;
+	case TYPE_RGBW: px_render_type(p, tx, TYPE_RGBW); break;
+	case TYPE_WRGB: px_render_type(p, tx, TYPE_WRGB); break;
+	case TYPE_GRB:
+	default:        px_render_type(p, tx, TYPE_GRB); break;
+	}
+}
+
+#endif
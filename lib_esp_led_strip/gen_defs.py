@@ -1,13 +1,14 @@
 #!/usr/bin/env python3
-"""Generate esp_led_defs.lisp from esp_led_strip/code.c.
+"""Generate esp_led_defs.lisp from esp_led_strip/code.c and pixel.h.
 
-The C source is the single source of truth for the esp_led effect / palette /
+The C sources are the single source of truth for the esp_led effect / palette /
 type / timing / turn-mode ids. This script mirrors them into lisp so consumers
 (float_accessories, the test UI, ...) cannot drift from the firmware-facing
 enums. Run `make defs` in this directory; the package build runs it too.
 
-Sources parsed from code.c:
-  - the FX_ / TYPE_ / TIMING_ / TURN_ enums (values follow C rules)
+Sources parsed from code.c and pixel.h:
+  - the FX_ / TYPE_ / TIMING_ / TURN_ enums (values follow C rules), TYPE_
+    lives in pixel.h with the wire packer
   - the palettes[] table, one PAL_<NAME> per row (id = row position + 1, see
     parse_palettes)
 """
@@ -16,7 +17,7 @@ import re
 from pathlib import Path
 
 HERE = Path(__file__).resolve().parent
-SRC = HERE / "esp_led_strip" / "code.c"
+SRCS = [HERE / "esp_led_strip" / "code.c", HERE / "esp_led_strip" / "pixel.h"]
 OUT = HERE / "esp_led_defs.lisp"
 
 # Exported groups, in output order: (C prefix, section header).
@@ -78,14 +79,14 @@ def parse_palettes(text):
 
 
 def main():
-    text = SRC.read_text(encoding="utf-8")
+    text = "\n".join(src.read_text(encoding="utf-8") for src in SRCS)
     consts = parse_enums(text)
     consts.update(parse_palettes(text))
 
     lines = [
-        "; GENERATED by gen_defs.py from esp_led_strip/code.c - DO NOT EDIT.",
+        "; GENERATED by gen_defs.py from esp_led_strip/code.c and pixel.h - DO NOT EDIT.",
         "; Run `make defs` after changing the C enums or the palette table.",
-        "; code.c is the source of truth; these ids must match it exactly.",
+        "; The C sources are the source of truth; these ids must match them exactly.",
         "",
         "@const-start",
     ]
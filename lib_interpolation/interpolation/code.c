@@ -18,7 +18,7 @@
  */
  
 #include "vesc_c_if.h"
-#include <math.h>
+#include "interp.h"
 
 HEADER
 
@@ -34,37 +34,7 @@ HEADER
 #define SYM_TRUE			VESC_IF->lbm_enc_sym_true
 #define SYM_EERROR			VESC_IF->lbm_enc_sym_eerror
 #define SYM_MERROR			VESC_IF->lbm_enc_sym_merror
-
-// See http://paulbourke.net/miscellaneous/interpolation/
-
-static float fun_linear(float y0,float y1, float y2,float y3, float mu) {
-	(void)y0; (void)y3;
-	return (y1*(1-mu) + y2*mu);
-}
-
-static float fun_cosine(float y0,float y1, float y2,float y3, float mu) {
-	(void)y0; (void)y3;
-	float mu2 = (1.0 - cosf(mu * M_PI)) / 2.0;
-	return (y1*(1-mu2) + y2*mu2);
-}
-
-static float fun_cubic(float y0,float y1, float y2,float y3, float mu) {
-	float mu2 = mu*mu;
-	float a0 = y3 - y2 - y0 + y1;
-	float a1 = y0 - y1 - a0;
-	float a2 = y2 - y0;
-	float a3 = y1;
-	return (a0*mu*mu2 + a1*mu2+a2*mu + a3);
-}
-
-static float fun_hermite(float y0,float y1, float y2,float y3, float mu) {
-	float mu2 = mu*mu;
-	float a0 = -0.5*y0 + 1.5*y1 - 1.5*y2 + 0.5*y3;
-	float a1 = y0 - 2.5*y1 + 2*y2 - 0.5*y3;
-	float a2 = -0.5*y0 + 0.5*y2;
-	float a3 = y1;
-	return (a0*mu*mu2 + a1*mu2+a2*mu + a3);
-}
+#define SYM_NIL				VESC_IF->lbm_enc_sym_nil
 
 static lbm_value ext_interpolate(lbm_value *args, lbm_uint argn) {
 	if ((argn != 2 && argn != 3) || !IS_NUMBER(args[0]) || !IS_CONS(args[1])) {
@@ -173,57 +143,7 @@ static lbm_value ext_interpolate(lbm_value *args, lbm_uint argn) {
 
 		if (x > val) {
 			if (passed) {
-				float mu = 0.0;
-				if (x2 != x1) {
-					mu = (val - x1) / (x2 - x1);
-					if (mu > 1.0) {
-						mu = 1.0;
-					} else if (mu < 0.0) {
-						mu = 0.0;
-					}
-				}
-
-				// Linear interpolation to approximate uniform point distribution
-				if (x3 != x2) {
-					float k = (y3 - y2) / (x3 - x2);
-					y3 = y2 + k * (x2 - x1);
-				}
-				if (x1 != x0) {
-					float k = (y0 - y1) / (x1 - x0);
-					y0 = y1 + k * (x2 - x1);
-				}
-
-//				VESC_IF->printf(
-//						"Done!\n"
-//						"mu: %.2f\n"
-//						"x0: %.2f\n"
-//						"x1: %.2f\n"
-//						"x2: %.2f\n"
-//						"x3: %.2f\n"
-//						"y0: %.2f\n"
-//						"y1: %.2f\n"
-//						"y2: %.2f\n"
-//						"y3: %.2f",
-//						(double)mu,
-//						(double)x0,
-//						(double)x1,
-//						(double)x2,
-//						(double)x3,
-//						(double)y0,
-//						(double)y1,
-//						(double)y2,
-//						(double)y3
-//				);
-
-				if (method == 0) {
-					res = fun_linear(y0, y1, y2, y3, mu);
-				} else if (method == 1) {
-					res = fun_cosine(y0, y1, y2, y3, mu);
-				} else if (method == 2) {
-					res = fun_cubic(y0, y1, y2, y3, mu);
-				} else {
-					res = fun_hermite(y0, y1, y2, y3, mu);
-				}
+				res = interp_window(val, x0, x1, x2, x3, y0, y1, y2, y3, method);
 				break;
 			} else {
 				passed = true;
@@ -236,9 +156,244 @@ static lbm_value ext_interpolate(lbm_value *args, lbm_uint argn) {
 	return ENC_F(res);
 }
 
+/*
+ * Compiled tables are byte arrays holding the x-values of the points in
+ * ascending order followed by their y-values, so that no list has to be
+ * walked when evaluating.
+ */
+
+static int table_size(lbm_value table) {
+	if (!VESC_IF->lbm_is_byte_array(table)) {
+		return 0;
+	}
+
+	lbm_array_header_t *arr = (lbm_array_header_t *)VESC_IF->lbm_car(table);
+	if (arr->size == 0 || arr->size % (2 * sizeof(float)) != 0) {
+		return 0;
+	}
+
+	return arr->size / (2 * sizeof(float));
+}
+
+static lbm_value ext_interp_compile(lbm_value *args, lbm_uint argn) {
+	if (argn != 1 || !IS_CONS(args[0])) {
+		VESC_IF->lbm_set_error_reason("Format: (ext-interp-compile table)");
+		return SYM_EERROR;
+	}
+
+	int n = 0;
+	lbm_value curr = args[0];
+	while (IS_CONS(curr)) {
+		lbm_value p = CAR(curr);
+		if (!IS_CONS(p) || !IS_NUMBER(FIRST(p)) || !IS_CONS(CDR(p)) || !IS_NUMBER(SECOND(p))) {
+			VESC_IF->lbm_set_error_reason("Table entries must be (x y)");
+			return SYM_EERROR;
+		}
+		curr = CDR(curr);
+		n++;
+	}
+
+	lbm_value res;
+	if (!VESC_IF->lbm_create_byte_array(&res, n * 2 * sizeof(float))) {
+		return SYM_MERROR;
+	}
+
+	float *xs = (float*)VESC_IF->lbm_dec_str(res);
+	float *ys = xs + n;
+
+	// Insertion sort, which keeps the order of points with the same x
+	curr = args[0];
+	for (int i = 0; i < n; i++) {
+		lbm_value p = CAR(curr);
+		curr = CDR(curr);
+		float x = DEC_F(FIRST(p));
+		float y = DEC_F(SECOND(p));
+
+		int j = i;
+		while (j > 0 && xs[j - 1] > x) {
+			xs[j] = xs[j - 1];
+			ys[j] = ys[j - 1];
+			j--;
+		}
+		xs[j] = x;
+		ys[j] = y;
+	}
+
+	return res;
+}
+
+static lbm_value ext_interp_eval(lbm_value *args, lbm_uint argn) {
+	int n = argn >= 2 ? table_size(args[1]) : 0;
+	if ((argn != 2 && argn != 3) || !IS_NUMBER(args[0]) || n == 0) {
+		VESC_IF->lbm_set_error_reason("Format: (ext-interp-eval value ctable optMethod)");
+		return SYM_EERROR;
+	}
+
+	int method = 3;
+	if (argn == 3 && IS_NUMBER(args[2])) {
+		method = DEC_I(args[2]);
+	}
+
+	const float *xs = (const float*)VESC_IF->lbm_dec_str(args[1]);
+	return ENC_F(interp_table_eval(xs, xs + n, n, DEC_F(args[0]), method));
+}
+
+static lbm_value ext_interp_eval_batch(lbm_value *args, lbm_uint argn) {
+	int n = argn >= 2 ? table_size(args[1]) : 0;
+	if ((argn != 2 && argn != 3) || !(IS_CONS(args[0]) || args[0] == SYM_NIL) || n == 0) {
+		VESC_IF->lbm_set_error_reason("Format: (ext-interp-eval-batch values ctable optMethod)");
+		return SYM_EERROR;
+	}
+
+	int method = 3;
+	if (argn == 3 && IS_NUMBER(args[2])) {
+		method = DEC_I(args[2]);
+	}
+
+	const float *xs = (const float*)VESC_IF->lbm_dec_str(args[1]);
+
+	// The results are consed up in reverse and then reversed. On a memory
+	// error the evaluator collects garbage and calls this again.
+	lbm_value rev = SYM_NIL;
+	lbm_value curr = args[0];
+	while (IS_CONS(curr)) {
+		lbm_value v = CAR(curr);
+		curr = CDR(curr);
+
+		if (!IS_NUMBER(v)) {
+			VESC_IF->lbm_set_error_reason("Values must be numbers");
+			return SYM_EERROR;
+		}
+
+		lbm_value f = ENC_F(interp_table_eval(xs, xs + n, n, DEC_F(v), method));
+		if (f == SYM_MERROR) {
+			return SYM_MERROR;
+		}
+
+		rev = VESC_IF->lbm_cons(f, rev);
+		if (rev == SYM_MERROR) {
+			return SYM_MERROR;
+		}
+	}
+
+	lbm_value res = SYM_NIL;
+	while (IS_CONS(rev)) {
+		res = VESC_IF->lbm_cons(CAR(rev), res);
+		if (res == SYM_MERROR) {
+			return SYM_MERROR;
+		}
+		rev = CDR(rev);
+	}
+
+	return res;
+}
+
+static int list_len(lbm_value list) {
+	int len = 0;
+	while (IS_CONS(list)) {
+		if (!IS_NUMBER(CAR(list))) {
+			return -1;
+		}
+		len++;
+		list = CDR(list);
+	}
+	return len;
+}
+
+static void list_to_floats(lbm_value list, float *out) {
+	while (IS_CONS(list)) {
+		*out++ = DEC_F(CAR(list));
+		list = CDR(list);
+	}
+}
+
+static lbm_value ext_map_compile(lbm_value *args, lbm_uint argn) {
+	if (argn != 3) {
+		VESC_IF->lbm_set_error_reason("Format: (ext-map-compile xs ys rows)");
+		return SYM_EERROR;
+	}
+
+	int nx = list_len(args[0]);
+	int ny = list_len(args[1]);
+	if (nx < 1 || ny < 1 || nx > 0xFFFF || ny > 0xFFFF) {
+		VESC_IF->lbm_set_error_reason("The axes must be non-empty lists of numbers");
+		return SYM_EERROR;
+	}
+
+	int rows = 0;
+	lbm_value curr = args[2];
+	while (IS_CONS(curr)) {
+		if (list_len(CAR(curr)) != nx) {
+			VESC_IF->lbm_set_error_reason("Every row must have one number per x-value");
+			return SYM_EERROR;
+		}
+		rows++;
+		curr = CDR(curr);
+	}
+
+	if (rows != ny) {
+		VESC_IF->lbm_set_error_reason("There must be one row per y-value");
+		return SYM_EERROR;
+	}
+
+	lbm_value res;
+	if (!VESC_IF->lbm_create_byte_array(&res, interp_map_bytes(nx, ny))) {
+		return SYM_MERROR;
+	}
+
+	interp_map_t *map = (interp_map_t*)VESC_IF->lbm_dec_str(res);
+	map->nx = nx;
+	map->ny = ny;
+	list_to_floats(args[0], interp_map_xs(map));
+	list_to_floats(args[1], interp_map_ys(map));
+
+	float *z = interp_map_zs(map);
+	curr = args[2];
+	while (IS_CONS(curr)) {
+		list_to_floats(CAR(curr), z);
+		z += nx;
+		curr = CDR(curr);
+	}
+
+	if (!interp_map_prepare(map)) {
+		VESC_IF->lbm_set_error_reason("The axes must be strictly increasing");
+		return SYM_EERROR;
+	}
+
+	return res;
+}
+
+static lbm_value ext_map_eval(lbm_value *args, lbm_uint argn) {
+	const interp_map_t *map = 0;
+	if (argn >= 3 && VESC_IF->lbm_is_byte_array(args[2])) {
+		lbm_array_header_t *arr = (lbm_array_header_t *)VESC_IF->lbm_car(args[2]);
+		map = (const interp_map_t*)arr->data;
+		if (arr->size < sizeof(interp_map_t) || arr->size != interp_map_bytes(map->nx, map->ny)) {
+			map = 0;
+		}
+	}
+
+	if ((argn != 3 && argn != 4) || !IS_NUMBER(args[0]) || !IS_NUMBER(args[1]) || !map) {
+		VESC_IF->lbm_set_error_reason("Format: (ext-map-eval x y cmap optMethod)");
+		return SYM_EERROR;
+	}
+
+	int method = 3;
+	if (argn == 4 && IS_NUMBER(args[3])) {
+		method = DEC_I(args[3]);
+	}
+
+	return ENC_F(interp_map_eval(map, DEC_F(args[0]), DEC_F(args[1]), method));
+}
+
 INIT_FUN(lib_info *info) {
 	INIT_START
 	(void)info;
 	VESC_IF->lbm_add_extension("ext-interpolate", ext_interpolate);
+	VESC_IF->lbm_add_extension("ext-interp-compile", ext_interp_compile);
+	VESC_IF->lbm_add_extension("ext-interp-eval", ext_interp_eval);
+	VESC_IF->lbm_add_extension("ext-interp-eval-batch", ext_interp_eval_batch);
+	VESC_IF->lbm_add_extension("ext-map-compile", ext_map_compile);
+	VESC_IF->lbm_add_extension("ext-map-eval", ext_map_eval);
 	return true;
 }
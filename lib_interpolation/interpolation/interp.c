@@ -0,0 +1,265 @@
+/*
+	Copyright 2022 Benjamin Vedder	benjamin@vedder.se
+	Copyright 2026 VESC project
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "interp.h"
+#include <math.h>
+
+// See http://paulbourke.net/miscellaneous/interpolation/
+
+static float fun_linear(float y0,float y1, float y2,float y3, float mu) {
+	(void)y0; (void)y3;
+	return (y1*(1-mu) + y2*mu);
+}
+
+static float fun_cosine(float y0,float y1, float y2,float y3, float mu) {
+	(void)y0; (void)y3;
+	float mu2 = (1.0 - cosf(mu * M_PI)) / 2.0;
+	return (y1*(1-mu2) + y2*mu2);
+}
+
+static float fun_cubic(float y0,float y1, float y2,float y3, float mu) {
+	float mu2 = mu*mu;
+	float a0 = y3 - y2 - y0 + y1;
+	float a1 = y0 - y1 - a0;
+	float a2 = y2 - y0;
+	float a3 = y1;
+	return (a0*mu*mu2 + a1*mu2+a2*mu + a3);
+}
+
+static float fun_hermite(float y0,float y1, float y2,float y3, float mu) {
+	float mu2 = mu*mu;
+	float a0 = -0.5*y0 + 1.5*y1 - 1.5*y2 + 0.5*y3;
+	float a1 = y0 - 2.5*y1 + 2*y2 - 0.5*y3;
+	float a2 = -0.5*y0 + 0.5*y2;
+	float a3 = y1;
+	return (a0*mu*mu2 + a1*mu2+a2*mu + a3);
+}
+
+float interp_window(float val,
+		float x0, float x1, float x2, float x3,
+		float y0, float y1, float y2, float y3, int method) {
+	float mu = 0.0;
+	if (x2 != x1) {
+		mu = (val - x1) / (x2 - x1);
+		if (mu > 1.0) {
+			mu = 1.0;
+		} else if (mu < 0.0) {
+			mu = 0.0;
+		}
+	}
+
+	// Linear interpolation to approximate uniform point distribution
+	if (x3 != x2) {
+		float k = (y3 - y2) / (x3 - x2);
+		y3 = y2 + k * (x2 - x1);
+	}
+	if (x1 != x0) {
+		float k = (y0 - y1) / (x1 - x0);
+		y0 = y1 + k * (x2 - x1);
+	}
+
+	if (method == 0) {
+		return fun_linear(y0, y1, y2, y3, mu);
+	} else if (method == 1) {
+		return fun_cosine(y0, y1, y2, y3, mu);
+	} else if (method == 2) {
+		return fun_cubic(y0, y1, y2, y3, mu);
+	} else {
+		return fun_hermite(y0, y1, y2, y3, mu);
+	}
+}
+
+float interp_table_eval(const float *xs, const float *ys, int n, float val, int method) {
+	if (n == 1) {
+		return ys[0];
+	}
+
+	// First point after val
+	int lo = 0;
+	int hi = n;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (xs[mid] > val) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+
+	// Same points as ext-interpolate picks, including its edge cases
+	int i0, i1, i2, i3;
+	if (lo == 0) {
+		i0 = 0; i1 = 1; i2 = 0; i3 = 1;
+	} else if (lo < n - 1) {
+		i0 = lo > 1 ? lo - 2 : 0; i1 = lo - 1; i2 = lo; i3 = lo + 1;
+	} else if (n == 2) {
+		i0 = 1; i1 = 0; i2 = 1; i3 = 1;
+	} else {
+		i0 = n - 3; i1 = n - 2; i2 = n - 1; i3 = n - 1;
+	}
+
+	return interp_window(val,
+			xs[i0], xs[i1], xs[i2], xs[i3],
+			ys[i0], ys[i1], ys[i2], ys[i3], method);
+}
+
+static int axis_find(const float *axis, int n, bool uniform, float scale, float val) {
+	if (n < 2) {
+		return 0;
+	}
+
+	int i;
+	if (uniform) {
+		// The guess is at most one off, the checks below correct it
+		float pos = (val - axis[0]) * scale;
+		i = pos <= 0.0 ? 0 : (pos >= (float)(n - 2) ? n - 2 : (int)pos);
+	} else {
+		int lo = 1;
+		int hi = n - 1;
+		while (lo < hi) {
+			int mid = (lo + hi) / 2;
+			if (axis[mid] > val) {
+				hi = mid;
+			} else {
+				lo = mid + 1;
+			}
+		}
+		i = lo - 1;
+	}
+
+	// Last point of the first n - 1 at or below val
+	while (i < n - 2 && axis[i + 1] <= val) {
+		i++;
+	}
+	while (i > 0 && axis[i] > val) {
+		i--;
+	}
+
+	return i;
+}
+
+static void axis_window(int i, int n, int *ind) {
+	ind[0] = i > 0 ? i - 1 : 0;
+	ind[1] = i;
+	ind[2] = i + 1 < n ? i + 1 : n - 1;
+	ind[3] = i + 2 < n ? i + 2 : n - 1;
+}
+
+// Gathers the window points. Missing outer points at the edges are
+// extrapolated linearly, so that e.g. planes are reproduced up to the edges.
+static void window_points(const float *v, const int *ind, float *p) {
+	for (int k = 0; k < 4; k++) {
+		p[k] = v[ind[k]];
+	}
+
+	if (ind[1] != ind[2]) {
+		if (ind[0] == ind[1]) {
+			p[0] = 2.0 * p[1] - p[2];
+		}
+		if (ind[3] == ind[2]) {
+			p[3] = 2.0 * p[2] - p[1];
+		}
+	}
+}
+
+static bool axis_prepare(const float *axis, int n, bool *uniform, float *scale) {
+	for (int i = 1; i < n; i++) {
+		if (!(axis[i] > axis[i - 1])) {
+			return false;
+		}
+	}
+
+	*uniform = false;
+	*scale = 0.0;
+
+	if (n > 2) {
+		float step = (axis[n - 1] - axis[0]) / (float)(n - 1);
+		*uniform = true;
+		for (int i = 1; i < n - 1; i++) {
+			if (fabsf(axis[i] - (axis[0] + step * (float)i)) > step * 0.01) {
+				*uniform = false;
+				break;
+			}
+		}
+		*scale = 1.0 / step;
+	}
+
+	return true;
+}
+
+unsigned int interp_map_bytes(int nx, int ny) {
+	return sizeof(interp_map_t) + (nx + ny + nx * ny) * sizeof(float);
+}
+
+bool interp_map_prepare(interp_map_t *map) {
+	bool uniform_x, uniform_y;
+
+	if (!axis_prepare(interp_map_xs(map), map->nx, &uniform_x, &map->x_scale) ||
+			!axis_prepare(interp_map_ys(map), map->ny, &uniform_y, &map->y_scale)) {
+		return false;
+	}
+
+	map->flags = (uniform_x ? INTERP_MAP_UNIFORM_X : 0) | (uniform_y ? INTERP_MAP_UNIFORM_Y : 0);
+	return true;
+}
+
+float interp_map_eval(const interp_map_t *map, float x, float y, int method) {
+	const float *xs = interp_map_xs(map);
+	const float *ys = interp_map_ys(map);
+	const float *zs = interp_map_zs(map);
+	int nx = map->nx;
+	int ny = map->ny;
+
+	int xi[4], yi[4];
+	axis_window(axis_find(xs, nx, map->flags & INTERP_MAP_UNIFORM_X, map->x_scale, x), nx, xi);
+	axis_window(axis_find(ys, ny, map->flags & INTERP_MAP_UNIFORM_Y, map->y_scale, y), ny, yi);
+
+	float px[4], py[4];
+	window_points(xs, xi, px);
+	window_points(ys, yi, py);
+
+	// Interpolate along x in the rows around y, then along y. Linear
+	// interpolation doesn't use the outer rows.
+	float r[4];
+	for (int j = 0; j < 4; j++) {
+		if (method == 0 && (j == 0 || j == 3)) {
+			continue;
+		}
+
+		float pz[4];
+		window_points(zs + yi[j] * nx, xi, pz);
+		r[j] = interp_window(x, px[0], px[1], px[2], px[3], pz[0], pz[1], pz[2], pz[3], method);
+	}
+
+	if (method == 0) {
+		r[0] = r[1];
+		r[3] = r[2];
+	} else if (yi[1] != yi[2]) {
+		// The outer rows at the edges, see window_points
+		if (yi[0] == yi[1]) {
+			r[0] = 2.0 * r[1] - r[2];
+		}
+		if (yi[3] == yi[2]) {
+			r[3] = 2.0 * r[2] - r[1];
+		}
+	}
+
+	return interp_window(y, py[0], py[1], py[2], py[3], r[0], r[1], r[2], r[3], method);
+}
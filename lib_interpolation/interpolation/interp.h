@@ -0,0 +1,79 @@
+/*
+	Copyright 2026 VESC project
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INTERP_H_
+#define INTERP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Platform independent parts of the interpolation library, so that they
+ * can be tested on the host.
+ *
+ * Methods: 0 linear, 1 cosine, 2 cubic spline, 3 Catmull-Rom spline.
+ */
+
+// Interpolates val between (x1, y1) and (x2, y2) with (x0, y0) and (x3, y3) as outer points
+float interp_window(float val,
+		float x0, float x1, float x2, float x3,
+		float y0, float y1, float y2, float y3, int method);
+
+// Same result as ext-interpolate on n points sorted by x, using a binary search
+float interp_table_eval(const float *xs, const float *ys, int n, float val, int method);
+
+#define INTERP_MAP_UNIFORM_X	(1 << 0)
+#define INTERP_MAP_UNIFORM_Y	(1 << 1)
+
+/*
+ * 2-D map. The header is followed by the nx x-values, the ny y-values and
+ * ny rows of nx z-values. The axes must be strictly increasing. On uniform
+ * axes the interval is computed from the value instead of searched for.
+ */
+typedef struct {
+	uint16_t nx;
+	uint16_t ny;
+	uint16_t flags;
+	uint16_t reserved;
+	float x_scale;
+	float y_scale;
+	float data[];
+} interp_map_t;
+
+static inline float *interp_map_xs(const interp_map_t *map) {
+	return (float*)map->data;
+}
+
+static inline float *interp_map_ys(const interp_map_t *map) {
+	return (float*)map->data + map->nx;
+}
+
+static inline float *interp_map_zs(const interp_map_t *map) {
+	return (float*)map->data + map->nx + map->ny;
+}
+
+unsigned int interp_map_bytes(int nx, int ny);
+
+// Checks the axes and detects uniform ones once the data is filled in
+bool interp_map_prepare(interp_map_t *map);
+
+// Separable interpolation over the 4x4 points around (x, y), clamped to the map
+float interp_map_eval(const interp_map_t *map, float x, float y, int method);
+
+#endif
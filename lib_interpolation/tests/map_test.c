@@ -0,0 +1,311 @@
+/*
+	Copyright 2026 VESC project
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+// Checks the 2-D map interpolation against a double precision reference,
+// and the uniform axis fast path against the search.
+
+#include "interp.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_N 12
+#define QUERIES 200
+
+static int failures = 0;
+
+static void check(bool condition, const char *name) {
+	printf("%s %s\n", condition ? "✓" : "✗", name);
+	if (!condition) {
+		failures++;
+	}
+}
+
+static double rand_range(double min, double max) {
+	return min + (max - min) * rand() / (double)RAND_MAX;
+}
+
+static double ref_kernel(double y0, double y1, double y2, double y3, double mu, int method) {
+	double mu2 = mu * mu;
+	double a0, a1, a2;
+
+	switch (method) {
+	case 0:
+		return y1 * (1 - mu) + y2 * mu;
+	case 1:
+		mu2 = (1.0 - cos(mu * M_PI)) / 2.0;
+		return y1 * (1 - mu2) + y2 * mu2;
+	case 2:
+		a0 = y3 - y2 - y0 + y1;
+		a1 = y0 - y1 - a0;
+		a2 = y2 - y0;
+		return a0 * mu * mu2 + a1 * mu2 + a2 * mu + y1;
+	default:
+		a0 = -0.5 * y0 + 1.5 * y1 - 1.5 * y2 + 0.5 * y3;
+		a1 = y0 - 2.5 * y1 + 2 * y2 - 0.5 * y3;
+		a2 = -0.5 * y0 + 0.5 * y2;
+		return a0 * mu * mu2 + a1 * mu2 + a2 * mu + y1;
+	}
+}
+
+// Interpolates v on the axis a with the values z, clamped to the axis
+static double ref_1d(const double *a, const double *z, int n, double v, int method) {
+	if (n == 1) {
+		return z[0];
+	}
+
+	int i = 0;
+	while (i < n - 2 && a[i + 1] <= v) {
+		i++;
+	}
+
+	int i0 = i > 0 ? i - 1 : 0;
+	int i3 = i + 2 < n ? i + 2 : n - 1;
+	double h = a[i + 1] - a[i];
+	double mu = fmin(fmax((v - a[i]) / h, 0.0), 1.0);
+
+	// The outer points are moved along their line to the inner point to
+	// one interval from it, as for a uniform grid. At the edges they are
+	// extrapolated from the inner points.
+	double y0 = 2.0 * z[i] - z[i + 1];
+	double y3 = 2.0 * z[i + 1] - z[i];
+	if (i0 != i) {
+		y0 = z[i] + (z[i0] - z[i]) / (a[i] - a[i0]) * h;
+	}
+	if (i3 != i + 1) {
+		y3 = z[i + 1] + (z[i3] - z[i + 1]) / (a[i3] - a[i + 1]) * h;
+	}
+
+	return ref_kernel(y0, z[i], z[i + 1], y3, mu, method);
+}
+
+static double ref_2d(const double *xs, int nx, const double *ys, int ny,
+		const double *zs, double x, double y, int method) {
+	double col[MAX_N];
+	for (int j = 0; j < ny; j++) {
+		col[j] = ref_1d(xs, zs + j * nx, nx, x, method);
+	}
+	return ref_1d(ys, col, ny, y, method);
+}
+
+typedef struct {
+	int nx, ny;
+	double xs[MAX_N], ys[MAX_N], zs[MAX_N * MAX_N];
+	interp_map_t *map;
+} grid_t;
+
+static void make_axis(double *a, int n, bool uniform) {
+	a[0] = rand_range(-100.0, 100.0);
+	double step = rand_range(0.5, 20.0);
+	for (int i = 1; i < n; i++) {
+		a[i] = a[i - 1] + (uniform ? step : rand_range(2.0, 20.0));
+	}
+}
+
+static void make_grid(grid_t *g, int nx, int ny, bool uniform, bool plane) {
+	g->nx = nx;
+	g->ny = ny;
+	make_axis(g->xs, nx, uniform);
+	make_axis(g->ys, ny, uniform);
+
+	double a = rand_range(-2.0, 2.0);
+	double b = rand_range(-2.0, 2.0);
+	double c = rand_range(-50.0, 50.0);
+	for (int j = 0; j < ny; j++) {
+		for (int i = 0; i < nx; i++) {
+			g->zs[j * nx + i] = plane ? a * g->xs[i] + b * g->ys[j] + c : rand_range(-100.0, 100.0);
+		}
+	}
+
+	g->map = malloc(interp_map_bytes(nx, ny));
+	g->map->nx = nx;
+	g->map->ny = ny;
+	for (int i = 0; i < nx; i++) {
+		interp_map_xs(g->map)[i] = g->xs[i];
+	}
+	for (int j = 0; j < ny; j++) {
+		interp_map_ys(g->map)[j] = g->ys[j];
+	}
+	for (int k = 0; k < nx * ny; k++) {
+		interp_map_zs(g->map)[k] = g->zs[k];
+	}
+
+	// The reference uses the same axes as the map
+	for (int i = 0; i < nx; i++) {
+		g->xs[i] = interp_map_xs(g->map)[i];
+	}
+	for (int j = 0; j < ny; j++) {
+		g->ys[j] = interp_map_ys(g->map)[j];
+	}
+	for (int k = 0; k < nx * ny; k++) {
+		g->zs[k] = interp_map_zs(g->map)[k];
+	}
+}
+
+// Rounded to float, so that the reference sees the same point as the map
+static double query(const double *a, int n) {
+	double span = a[n - 1] - a[0] + 1.0;
+	return (float)rand_range(a[0] - 0.2 * span, a[n - 1] + 0.2 * span);
+}
+
+static void test_reference(bool uniform) {
+	double max_err[4] = {0};
+
+	for (int t = 0; t < 500; t++) {
+		grid_t g;
+		make_grid(&g, 1 + rand() % MAX_N, 1 + rand() % MAX_N, uniform, false);
+		bool prepared = interp_map_prepare(g.map);
+		if (!prepared) {
+			check(false, "map prepares");
+			free(g.map);
+			return;
+		}
+
+		for (int q = 0; q < QUERIES; q++) {
+			double x = query(g.xs, g.nx);
+			double y = query(g.ys, g.ny);
+			for (int m = 0; m < 4; m++) {
+				double ref = ref_2d(g.xs, g.nx, g.ys, g.ny, g.zs, x, y, m);
+				double err = fabs(interp_map_eval(g.map, x, y, m) - ref);
+				max_err[m] = fmax(max_err[m], err);
+			}
+		}
+
+		free(g.map);
+	}
+
+	const char *names[] = {"linear", "cosine", "cubic", "catmull-rom"};
+	for (int m = 0; m < 4; m++) {
+		char name[100];
+		snprintf(name, sizeof(name), "%s %s grid matches reference (max error %.2g)",
+				names[m], uniform ? "uniform" : "non-uniform", max_err[m]);
+		// Values are within +-100, the error is relative to that
+		check(max_err[m] < 1e-3, name);
+	}
+}
+
+static void test_nodes_and_planes(void) {
+	bool nodes_ok = true;
+	bool plane_ok = true;
+
+	for (int t = 0; t < 200; t++) {
+		grid_t g;
+		make_grid(&g, 2 + rand() % (MAX_N - 1), 2 + rand() % (MAX_N - 1), t % 2, true);
+		interp_map_prepare(g.map);
+
+		for (int j = 0; j < g.ny; j++) {
+			for (int i = 0; i < g.nx; i++) {
+				for (int m = 0; m < 4; m++) {
+					float z = interp_map_eval(g.map, g.xs[i], g.ys[j], m);
+					if (fabs(z - g.zs[j * g.nx + i]) > 1e-4) {
+						nodes_ok = false;
+					}
+				}
+			}
+		}
+
+		// Linear and Catmull-Rom reproduce planes
+		for (int q = 0; q < QUERIES; q++) {
+			double x = (float)rand_range(g.xs[0], g.xs[g.nx - 1]);
+			double y = (float)rand_range(g.ys[0], g.ys[g.ny - 1]);
+			double ref = ref_2d(g.xs, g.nx, g.ys, g.ny, g.zs, x, y, 0);
+			if (fabs(interp_map_eval(g.map, x, y, 0) - ref) > 1e-3 ||
+					fabs(interp_map_eval(g.map, x, y, 3) - ref) > 1e-3) {
+				plane_ok = false;
+			}
+		}
+
+		free(g.map);
+	}
+
+	check(nodes_ok, "all methods hit the grid points");
+	check(plane_ok, "linear and catmull-rom reproduce planes");
+}
+
+static void test_uniform(void) {
+	bool flags_ok = true;
+	bool same = true;
+
+	for (int t = 0; t < 500; t++) {
+		grid_t g;
+		bool uniform = t % 2;
+		make_grid(&g, 3 + rand() % (MAX_N - 2), 3 + rand() % (MAX_N - 2), uniform, false);
+		interp_map_prepare(g.map);
+
+		uint16_t expected = uniform ? (INTERP_MAP_UNIFORM_X | INTERP_MAP_UNIFORM_Y) : 0;
+		if (g.map->flags != expected) {
+			flags_ok = false;
+		}
+
+		unsigned int size = interp_map_bytes(g.nx, g.ny);
+		interp_map_t *searched = malloc(size);
+		memcpy(searched, g.map, size);
+		searched->flags = 0;
+
+		for (int q = 0; q < QUERIES; q++) {
+			double x = query(g.xs, g.nx);
+			double y = query(g.ys, g.ny);
+
+			// Points exactly on the grid lines are the interesting ones
+			if (q % 4 == 0) {
+				x = g.xs[rand() % g.nx];
+				y = g.ys[rand() % g.ny];
+			}
+
+			for (int m = 0; m < 4; m++) {
+				if (interp_map_eval(g.map, x, y, m) != interp_map_eval(searched, x, y, m)) {
+					same = false;
+				}
+			}
+		}
+
+		free(searched);
+		free(g.map);
+	}
+
+	check(flags_ok, "uniform axes are detected");
+	check(same, "uniform fast path matches search");
+}
+
+static void test_prepare(void) {
+	grid_t g;
+	make_grid(&g, 4, 3, false, false);
+	interp_map_xs(g.map)[2] = interp_map_xs(g.map)[1];
+	check(!interp_map_prepare(g.map), "repeated axis value is rejected");
+	free(g.map);
+
+	make_grid(&g, 1, 1, false, false);
+	bool ok = interp_map_prepare(g.map);
+	check(ok && interp_map_eval(g.map, 1e6, -1e6, 3) == (float)g.zs[0], "single point map is constant");
+	free(g.map);
+}
+
+int main(void) {
+	srand(1);
+
+	test_reference(false);
+	test_reference(true);
+	test_nodes_and_planes();
+	test_uniform();
+	test_prepare();
+
+	return failures ? 1 : 0;
+}
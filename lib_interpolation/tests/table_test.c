@@ -0,0 +1,220 @@
+/*
+	Copyright 2026 VESC project
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+// Checks that the binary search of compiled tables gives the same results as
+// the list walk of ext-interpolate, on random tables with all methods.
+
+#include "interp.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAX_N 16
+#define TABLES 2000
+#define QUERIES 50
+
+static int failures = 0;
+
+static void check(bool condition, const char *name) {
+	printf("%s %s\n", condition ? "✓" : "✗", name);
+	if (!condition) {
+		failures++;
+	}
+}
+
+static float rand_range(float min, float max) {
+	return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+// The point selection of ext-interpolate in code.c, with the list of (x y)
+// points replaced by the arrays
+static float ref_walk(const float *xs, const float *ys, int n, float val, int method) {
+	float x0 = 0.0, x1 = 0.0, x2 = 0.0, x3 = 0.0;
+	float y0 = 0.0, y1 = 0.0, y2 = 0.0, y3 = 0.0;
+
+	for (int cnt = 0; cnt < n && cnt < 4; cnt++) {
+		float x = xs[cnt];
+		float y = ys[cnt];
+
+		if (cnt == 0) {
+			x0 = x; x1 = x; x2 = x; x3 = x;
+			y0 = y; y1 = y; y2 = y; y3 = y;
+		} else if (cnt == 1) {
+			x1 = x; x2 = x; x3 = x;
+			y1 = y; y2 = y; y3 = y;
+		} else if (cnt == 2) {
+			x2 = x; x3 = x;
+			y2 = y; y3 = y;
+		} else {
+			x3 = x;
+			y3 = y;
+		}
+	}
+
+	bool passed = false;
+	for (int cnt = 0; cnt < n; cnt++) {
+		float x = xs[cnt];
+		float y = ys[cnt];
+
+		if (cnt >= 3) {
+			x0 = x1;
+			y0 = y1;
+		}
+
+		if (cnt >= 2) {
+			x1 = x2;
+			y1 = y2;
+		}
+
+		x2 = x3;
+		x3 = x;
+		y2 = y3;
+		y3 = y;
+
+		if (cnt == n - 1) {
+			if (!passed) {
+				passed = true;
+
+				x0 = x1;
+				x1 = x2;
+				x2 = x3;
+				x3 = x;
+
+				y0 = y1;
+				y1 = y2;
+				y2 = y3;
+				y3 = y;
+			}
+
+			x = val + 1;
+		}
+
+		if (x > val) {
+			if (passed) {
+				return interp_window(val, x0, x1, x2, x3, y0, y1, y2, y3, method);
+			} else {
+				passed = true;
+			}
+		}
+	}
+
+	return 0.0;
+}
+
+typedef struct {
+	int n;
+	float xs[MAX_N];
+	float ys[MAX_N];
+} table_t;
+
+// Sorted points as ext-interp-compile stores them. Tables with repeated
+// x-values are allowed there as well.
+static void make_table(table_t *t, bool repeats) {
+	t->n = 1 + rand() % MAX_N;
+	t->xs[0] = rand_range(-1000.0, 1000.0);
+	t->ys[0] = rand_range(-100.0, 100.0);
+	for (int i = 1; i < t->n; i++) {
+		t->xs[i] = t->xs[i - 1] + ((repeats && rand() % 4 == 0) ? 0.0 : rand_range(0.1, 200.0));
+		t->ys[i] = rand_range(-100.0, 100.0);
+	}
+}
+
+// The knots, the midpoints between them, values just around the ends and
+// random values in and out of the range
+static float query(const table_t *t, int q) {
+	const float *xs = t->xs;
+	int n = t->n;
+	float span = xs[n - 1] - xs[0] + 1.0;
+
+	switch (q % 6) {
+	case 0: return xs[rand() % n];
+	case 1: {
+		int i = rand() % n;
+		return i < n - 1 ? 0.5 * (xs[i] + xs[i + 1]) : xs[i];
+	}
+	case 2: return rand() % 2 ? xs[0] : xs[n - 1];
+	case 3: return rand() % 2 ? nextafterf(xs[0], -INFINITY) : nextafterf(xs[n - 1], INFINITY);
+	case 4: return rand_range(xs[0] - 2.0 * span, xs[0]);
+	default: return rand_range(xs[0] - 0.2 * span, xs[n - 1] + 2.0 * span);
+	}
+}
+
+static void test_equivalence(bool repeats) {
+	const char *names[] = {"linear", "cosine", "cubic", "catmull-rom"};
+	int mismatches[4] = {0};
+	int queries = 0;
+
+	for (int k = 0; k < TABLES; k++) {
+		table_t t;
+		make_table(&t, repeats);
+
+		for (int q = 0; q < QUERIES; q++) {
+			float val = query(&t, q);
+			queries++;
+
+			for (int m = 0; m < 4; m++) {
+				float a = interp_table_eval(t.xs, t.ys, t.n, val, m);
+				float b = ref_walk(t.xs, t.ys, t.n, val, m);
+				if (a != b && !(isnan(a) && isnan(b))) {
+					if (mismatches[m] == 0) {
+						printf("  %s, %d points, val %.9g: %.9g != %.9g\n",
+								names[m], t.n, (double)val, (double)a, (double)b);
+					}
+					mismatches[m]++;
+				}
+			}
+		}
+	}
+
+	for (int m = 0; m < 4; m++) {
+		char name[120];
+		snprintf(name, sizeof(name), "%s on %s matches the list walk (%d of %d differ)",
+				names[m], repeats ? "repeated x-values" : "random tables", mismatches[m], queries);
+		check(mismatches[m] == 0, name);
+	}
+}
+
+static void test_small_tables(void) {
+	// Every query position against every table of one to four points, where
+	// the walk has its special cases
+	bool same = true;
+	for (int n = 1; n <= 4; n++) {
+		const float xs[] = {-1.0, 0.5, 2.0, 3.0};
+		const float ys[] = {4.0, -2.0, 1.0, 7.5};
+		for (float val = -3.0; val <= 5.0; val += 0.25) {
+			for (int m = 0; m < 4; m++) {
+				if (interp_table_eval(xs, ys, n, val, m) != ref_walk(xs, ys, n, val, m)) {
+					same = false;
+				}
+			}
+		}
+	}
+	check(same, "tables of one to four points match the list walk");
+}
+
+int main(void) {
+	srand(1);
+
+	test_equivalence(false);
+	test_equivalence(true);
+	test_small_tables();
+
+	return failures ? 1 : 0;
+}
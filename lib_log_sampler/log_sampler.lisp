@@ -0,0 +1 @@
+(import "log_sampler/log_sampler.bin" 'log_sampler)
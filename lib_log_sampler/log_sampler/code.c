@@ -0,0 +1,834 @@
+/*
+	Copyright 2026 VESC project
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "vesc_c_if.h"
+#include "rb_spsc.h"
+#include "vlog.h"
+
+#include <string.h>
+
+HEADER
+
+#define IS_CONS(x)			VESC_IF->lbm_is_cons(x)
+#define IS_NUMBER(x)		VESC_IF->lbm_is_number(x)
+#define IS_SYMBOL(x)		VESC_IF->lbm_is_symbol(x)
+#define CAR(x)				VESC_IF->lbm_car(x)
+#define CDR(x)				VESC_IF->lbm_cdr(x)
+#define FIRST(x)			CAR(x)
+#define SECOND(x)			CAR(CDR(x))
+#define DEC_F(x)			VESC_IF->lbm_dec_as_float(x)
+#define DEC_I(x)			VESC_IF->lbm_dec_as_i32(x)
+#define DEC_SYM(x)			VESC_IF->lbm_dec_sym(x)
+#define ENC_F(x)			VESC_IF->lbm_enc_float(x)
+#define ENC_I(x)			VESC_IF->lbm_enc_i(x)
+#define SYM_NIL				VESC_IF->lbm_enc_sym_nil
+#define SYM_TRUE			VESC_IF->lbm_enc_sym_true
+#define SYM_TERROR			VESC_IF->lbm_enc_sym_terror
+#define SYM_EERROR			VESC_IF->lbm_enc_sym_eerror
+#define SYM_MERROR			VESC_IF->lbm_enc_sym_merror
+
+#define FIELDS_MAX			128
+#define RATE_MAX			1000
+// Default buffer length in time, the Lisp side has to drain it faster
+#define BUFFER_MS			100
+#define BUFFER_FRAMES_MIN	16
+#define BUFFER_FRAMES_MAX	1024
+#define BLOCK_BYTES_DEF		256
+#define BLOCK_BYTES_MAX		1024
+
+// Value sources, named after the LispBM extensions they replace
+#define SOURCES(X) \
+	X(SRC_VIN,				"get-vin") \
+	X(SRC_CURRENT,			"get-current") \
+	X(SRC_CURRENT_IN,		"get-current-in") \
+	X(SRC_DUTY,				"get-duty") \
+	X(SRC_RPM,				"get-rpm") \
+	X(SRC_TEMP_FET,			"get-temp-fet") \
+	X(SRC_TEMP_MOT,			"get-temp-mot") \
+	X(SRC_BATT,				"get-batt") \
+	X(SRC_SPEED,			"get-speed") \
+	X(SRC_IMU_RPY,			"get-imu-rpy") \
+	X(SRC_FAULT,			"get-fault") \
+	X(SRC_DIST,				"get-dist") \
+	X(SRC_DIST_ABS,			"get-dist-abs") \
+	X(SRC_AH,				"get-ah") \
+	X(SRC_WH,				"get-wh") \
+	X(SRC_AH_CHG,			"get-ah-chg") \
+	X(SRC_WH_CHG,			"get-wh-chg") \
+	X(SRC_ADC,				"get-adc") \
+	X(SRC_IQ,				"get-iq") \
+	X(SRC_ID,				"get-id") \
+	X(SRC_VQ,				"get-vq") \
+	X(SRC_VD,				"get-vd") \
+	X(SRC_CAN_CURRENT,		"canget-current") \
+	X(SRC_CAN_CURRENT_IN,	"canget-current-in") \
+	X(SRC_CAN_DUTY,			"canget-duty") \
+	X(SRC_CAN_RPM,			"canget-rpm") \
+	X(SRC_CAN_TEMP_FET,		"canget-temp-fet") \
+	X(SRC_CAN_TEMP_MOTOR,	"canget-temp-motor") \
+	X(SRC_CAN_ADC,			"canget-adc") \
+	X(SRC_CAN_VIN,			"canget-vin")
+
+#define X(src, name) src,
+typedef enum {
+	SOURCES(X)
+	SRC_COUNT,
+	// Value set from Lisp with ext-sampler-set
+	SRC_LISP = SRC_COUNT,
+} source_t;
+#undef X
+
+typedef struct {
+	uint8_t src;
+	uint8_t motor;
+	// CAN id of the CAN sources. The ADC channel, the rpy index or the
+	// filter flag of get-current(-in) of the others.
+	int16_t arg;
+	// ADC channel of canget-adc
+	int16_t arg2;
+	float scale;
+	volatile float value;
+} field_t;
+
+typedef struct {
+	// Symbol ids of the sources and the forms understood around them
+	lbm_uint sym[SRC_COUNT];
+	lbm_uint sym_mul;
+	lbm_uint sym_run_m2;
+	lbm_uint sym_ix;
+
+	field_t *fields;
+	int field_num;
+
+	// Binary encoding, set up by ext-sampler-binary
+	uint8_t *precision;
+	int32_t *prev;
+	uint8_t *block;
+	unsigned int block_size;
+
+	// Frames of 1 + field_num floats, the sample time first
+	rb_spsc_t rb;
+	float *buffer;
+	float period;
+
+	lib_thread thread;
+	volatile bool running;
+	volatile uint32_t sampled;
+	volatile uint32_t dropped;
+} sampler_t;
+
+static const char *source_name(int src) {
+	// A switch rather than a table, a table of string pointers would need
+	// relocations which native libs don't get
+	switch (src) {
+#define X(src, name) case src: return name;
+	SOURCES(X)
+#undef X
+	default: return "";
+	}
+}
+
+static lbm_uint symbol_id(const char *name) {
+	lbm_uint id;
+	if (!VESC_IF->lbm_get_symbol_by_name((char*)name, &id)) {
+		// Not interned, so it can't appear in any expression either
+		return (lbm_uint)-1;
+	}
+	return id;
+}
+
+static void lookup_symbols(sampler_t *s) {
+	for (int i = 0; i < SRC_COUNT; i++) {
+		s->sym[i] = symbol_id(source_name(i));
+	}
+	s->sym_mul = symbol_id("*");
+	s->sym_run_m2 = symbol_id("run-m2");
+	s->sym_ix = symbol_id("ix");
+}
+
+static bool is_nil(lbm_value v) {
+	return IS_SYMBOL(v) && VESC_IF->lbm_is_symbol_nil(DEC_SYM(v));
+}
+
+/*
+ * Compiles a value expression of the LogUI loglist format into a field. The
+ * accepted forms are the getters of SOURCES with constant arguments, possibly
+ * wrapped in (* expr k), (run-m2 expr) or, for the IMU, (ix (get-imu-rpy) i).
+ * Returns false for anything else, which is then left to Lisp.
+ */
+static bool compile(sampler_t *s, lbm_value expr, field_t *f) {
+	if (!IS_CONS(expr) || !IS_SYMBOL(CAR(expr))) {
+		return false;
+	}
+
+	lbm_uint head = DEC_SYM(CAR(expr));
+	lbm_value args = CDR(expr);
+
+	if (head == s->sym_mul) {
+		lbm_value a = FIRST(args);
+		lbm_value b = SECOND(args);
+		if (!is_nil(CDR(CDR(args)))) {
+			return false;
+		}
+		if (IS_NUMBER(a)) {
+			lbm_value t = a;
+			a = b;
+			b = t;
+		}
+		if (!IS_NUMBER(b)) {
+			return false;
+		}
+		f->scale *= DEC_F(b);
+		return compile(s, a, f);
+	}
+
+	if (head == s->sym_run_m2) {
+		f->motor = 2;
+		return compile(s, FIRST(args), f);
+	}
+
+	if (head == s->sym_ix) {
+		lbm_value inner = FIRST(args);
+		lbm_value ind = SECOND(args);
+		if (!IS_CONS(inner) || !IS_SYMBOL(CAR(inner)) ||
+				DEC_SYM(CAR(inner)) != s->sym[SRC_IMU_RPY] || !IS_NUMBER(ind)) {
+			return false;
+		}
+		int i = DEC_I(ind);
+		if (i < 0 || i > 2) {
+			return false;
+		}
+		f->src = SRC_IMU_RPY;
+		f->arg = i;
+		return true;
+	}
+
+	int src = 0;
+	while (src < SRC_COUNT && s->sym[src] != head) {
+		src++;
+	}
+	// The whole rpy list is not a value
+	if (src == SRC_COUNT || src == SRC_IMU_RPY) {
+		return false;
+	}
+
+	int argv[2] = {0, 0};
+	int argc = 0;
+	while (IS_CONS(args)) {
+		if (argc == 2 || !IS_NUMBER(CAR(args))) {
+			return false;
+		}
+		argv[argc++] = DEC_I(CAR(args));
+		args = CDR(args);
+	}
+
+	f->src = src;
+	f->arg = argv[0];
+	f->arg2 = argv[1];
+
+	if (src >= SRC_CAN_CURRENT) {
+		if (argc == 0) {
+			return false;
+		}
+		if (src == SRC_CAN_ADC && (f->arg2 < 0 || f->arg2 > 2)) {
+			return false;
+		}
+	} else if (src == SRC_ADC && (f->arg < 0 || f->arg > 1)) {
+		return false;
+	}
+
+	return true;
+}
+
+static float sample_local(const field_t *f) {
+	switch (f->src) {
+	case SRC_VIN: return VESC_IF->mc_get_input_voltage_filtered();
+	case SRC_CURRENT:
+		return f->arg ? VESC_IF->mc_get_tot_current_filtered() : VESC_IF->mc_get_tot_current();
+	case SRC_CURRENT_IN:
+		return f->arg ? VESC_IF->mc_get_tot_current_in_filtered() : VESC_IF->mc_get_tot_current_in();
+	case SRC_DUTY: return VESC_IF->mc_get_duty_cycle_now();
+	case SRC_RPM: return VESC_IF->mc_get_rpm();
+	case SRC_TEMP_FET: return VESC_IF->mc_temp_fet_filtered();
+	case SRC_TEMP_MOT: return VESC_IF->mc_temp_motor_filtered();
+	case SRC_BATT: return VESC_IF->mc_get_battery_level(0);
+	case SRC_SPEED: return VESC_IF->mc_get_speed();
+	case SRC_IMU_RPY: {
+		float rpy[3];
+		VESC_IF->imu_get_rpy(rpy);
+		return rpy[f->arg];
+	}
+	case SRC_FAULT: return (float)VESC_IF->mc_get_fault();
+	case SRC_DIST: return VESC_IF->mc_get_distance();
+	case SRC_DIST_ABS: return VESC_IF->mc_get_distance_abs();
+	case SRC_AH: return VESC_IF->mc_get_amp_hours(false);
+	case SRC_WH: return VESC_IF->mc_get_watt_hours(false);
+	case SRC_AH_CHG: return VESC_IF->mc_get_amp_hours_charged(false);
+	case SRC_WH_CHG: return VESC_IF->mc_get_watt_hours_charged(false);
+	case SRC_ADC: return VESC_IF->io_read_analog(f->arg == 0 ? VESC_PIN_ADC1 : VESC_PIN_ADC2);
+	// There are no filtered variants in the interface, the optional
+	// filter argument is ignored
+	case SRC_IQ: return VESC_IF->foc_get_iq();
+	case SRC_ID: return VESC_IF->foc_get_id();
+	case SRC_VQ: return VESC_IF->foc_get_vq();
+	case SRC_VD: return VESC_IF->foc_get_vd();
+	default: return 0.0;
+	}
+}
+
+// Values of devices that have not sent the status message read as 0
+static float sample_can(const field_t *f) {
+	switch (f->src) {
+	case SRC_CAN_CURRENT:
+	case SRC_CAN_DUTY:
+	case SRC_CAN_RPM: {
+		can_status_msg *msg = VESC_IF->can_get_status_msg_id(f->arg);
+		if (!msg) {
+			return 0.0;
+		}
+		return f->src == SRC_CAN_CURRENT ? msg->current :
+				f->src == SRC_CAN_DUTY ? msg->duty : msg->rpm;
+	}
+	case SRC_CAN_CURRENT_IN:
+	case SRC_CAN_TEMP_FET:
+	case SRC_CAN_TEMP_MOTOR: {
+		can_status_msg_4 *msg = VESC_IF->can_get_status_msg_4_id(f->arg);
+		if (!msg) {
+			return 0.0;
+		}
+		return f->src == SRC_CAN_CURRENT_IN ? msg->current_in :
+				f->src == SRC_CAN_TEMP_FET ? msg->temp_fet : msg->temp_motor;
+	}
+	case SRC_CAN_ADC: {
+		can_status_msg_6 *msg = VESC_IF->can_get_status_msg_6_id(f->arg);
+		if (!msg) {
+			return 0.0;
+		}
+		return f->arg2 == 0 ? msg->adc_1 : f->arg2 == 1 ? msg->adc_2 : msg->adc_3;
+	}
+	case SRC_CAN_VIN: {
+		can_status_msg_5 *msg = VESC_IF->can_get_status_msg_5_id(f->arg);
+		return msg ? msg->v_in : 0.0;
+	}
+	default: return 0.0;
+	}
+}
+
+static void sample(sampler_t *s, float *frame) {
+	int motor = 1;
+	for (int i = 0; i < s->field_num; i++) {
+		const field_t *f = &s->fields[i];
+		float v;
+
+		if (f->src == SRC_LISP) {
+			v = f->value;
+		} else if (f->src >= SRC_CAN_CURRENT) {
+			v = sample_can(f);
+		} else {
+			if (f->motor != motor) {
+				motor = f->motor;
+				VESC_IF->mc_select_motor_thread(motor);
+			}
+			v = sample_local(f);
+		}
+
+		frame[i] = v * f->scale;
+	}
+
+	if (motor != 1) {
+		VESC_IF->mc_select_motor_thread(1);
+	}
+}
+
+static void sampler_thd(void *arg) {
+	sampler_t *s = (sampler_t*)arg;
+
+	// Deadline schedule: sleep until the next sample is due rather than for
+	// a whole period, so the rate doesn't drift with the sampling time.
+	systime_t start = VESC_IF->system_time_ticks();
+	float next = 0.0;
+
+	while (!VESC_IF->should_terminate()) {
+		float now = VESC_IF->ts_to_age_s(start);
+		if (now < next) {
+			VESC_IF->sleep_us((uint32_t)((next - now) * 1e6));
+			continue;
+		}
+
+		float *frame;
+		if (rb_spsc_reserve(&s->rb, (void**)&frame, 1) == 1) {
+			frame[0] = now;
+			sample(s, frame + 1);
+			rb_spsc_commit(&s->rb, 1);
+			s->sampled++;
+		} else {
+			s->dropped++;
+		}
+
+		next += s->period;
+		// After a stall, realign instead of sampling a burst to catch up
+		if (now - next > s->period) {
+			next = now + s->period;
+		}
+	}
+}
+
+static void binary_free(sampler_t *s) {
+	if (s->precision) {
+		VESC_IF->free(s->precision);
+		VESC_IF->free(s->prev);
+		VESC_IF->free(s->block);
+	}
+	s->precision = 0;
+	s->prev = 0;
+	s->block = 0;
+}
+
+static void sampler_stop(sampler_t *s) {
+	if (!s->running) {
+		return;
+	}
+
+	VESC_IF->request_terminate(s->thread);
+	s->running = false;
+	VESC_IF->free(s->buffer);
+	s->buffer = 0;
+}
+
+// (ext-sampler-config exprs) - compile a list of value expressions into the
+// fields of the frame. Returns a list of the indices of the fields that
+// have to be evaluated in Lisp and set with ext-sampler-set.
+static lbm_value ext_config(lbm_value *args, lbm_uint argn) {
+	sampler_t *s = (sampler_t*)ARG;
+
+	if (argn != 1 || !(IS_CONS(args[0]) || is_nil(args[0]))) {
+		VESC_IF->lbm_set_error_reason("Format: (ext-sampler-config exprs)");
+		return SYM_TERROR;
+	}
+
+	if (s->running) {
+		VESC_IF->lbm_set_error_reason("Sampler is running");
+		return SYM_EERROR;
+	}
+
+	int num = 0;
+	for (lbm_value curr = args[0]; IS_CONS(curr); curr = CDR(curr)) {
+		num++;
+	}
+
+	if (num > FIELDS_MAX) {
+		VESC_IF->lbm_set_error_reason("Too many fields");
+		return SYM_EERROR;
+	}
+
+	// The result list is built first, so that running out of memory leaves
+	// the previous configuration in place
+	lbm_value lisp_fields = SYM_NIL;
+	field_t *fields = num > 0 ? VESC_IF->malloc(num * sizeof(field_t)) : 0;
+	if (num > 0 && !fields) {
+		return SYM_MERROR;
+	}
+
+	lookup_symbols(s);
+
+	int i = 0;
+	for (lbm_value curr = args[0]; IS_CONS(curr); curr = CDR(curr), i++) {
+		field_t *f = &fields[i];
+		f->motor = 1;
+		f->arg = 0;
+		f->arg2 = 0;
+		f->scale = 1.0;
+		f->value = 0.0;
+
+		if (!compile(s, CAR(curr), f)) {
+			f->src = SRC_LISP;
+			f->motor = 1;
+			f->scale = 1.0;
+			lisp_fields = VESC_IF->lbm_cons(ENC_I(i), lisp_fields);
+			if (lisp_fields == SYM_MERROR) {
+				VESC_IF->free(fields);
+				return SYM_MERROR;
+			}
+		}
+	}
+
+	if (s->fields) {
+		VESC_IF->free(s->fields);
+	}
+	s->fields = fields;
+	s->field_num = num;
+	// Set up for the previous fields
+	binary_free(s);
+
+	return VESC_IF->lbm_list_destructive_reverse(lisp_fields);
+}
+
+// (ext-sampler-start rate optFrames) - start sampling at rate Hz into a
+// buffer of optFrames frames.
+static lbm_value ext_start(lbm_value *args, lbm_uint argn) {
+	sampler_t *s = (sampler_t*)ARG;
+
+	if ((argn != 1 && argn != 2) || !IS_NUMBER(args[0]) ||
+			(argn == 2 && !IS_NUMBER(args[1]))) {
+		VESC_IF->lbm_set_error_reason("Format: (ext-sampler-start rate optFrames)");
+		return SYM_TERROR;
+	}
+
+	float rate = DEC_F(args[0]);
+	if (rate <= 0.0 || rate > RATE_MAX) {
+		VESC_IF->lbm_set_error_reason("Invalid rate");
+		return SYM_EERROR;
+	}
+
+	int frames = argn == 2 ? DEC_I(args[1]) : (int)(rate * BUFFER_MS / 1000);
+	if (frames < BUFFER_FRAMES_MIN) {
+		frames = BUFFER_FRAMES_MIN;
+	} else if (frames > BUFFER_FRAMES_MAX) {
+		frames = BUFFER_FRAMES_MAX;
+	}
+
+	// The ring needs a power of two
+	unsigned int count = BUFFER_FRAMES_MIN;
+	while (count < (unsigned int)frames) {
+		count *= 2;
+	}
+
+	sampler_stop(s);
+
+	unsigned int frame_size = (s->field_num + 1) * sizeof(float);
+	s->buffer = VESC_IF->malloc(count * frame_size);
+	if (!s->buffer) {
+		return SYM_MERROR;
+	}
+
+	rb_spsc_init(&s->rb, s->buffer, frame_size, count);
+	s->period = 1.0 / rate;
+	s->sampled = 0;
+	s->dropped = 0;
+
+	s->thread = VESC_IF->spawn(sampler_thd, 1024, "LogSampler", s);
+	if (!s->thread) {
+		VESC_IF->free(s->buffer);
+		s->buffer = 0;
+		return SYM_MERROR;
+	}
+
+	s->running = true;
+	return SYM_TRUE;
+}
+
+// (ext-sampler-stop)
+static lbm_value ext_stop(lbm_value *args, lbm_uint argn) {
+	(void)args; (void)argn;
+	sampler_stop((sampler_t*)ARG);
+	return SYM_TRUE;
+}
+
+// (ext-sampler-set field value) - set the value of a field evaluated in Lisp.
+static lbm_value ext_set(lbm_value *args, lbm_uint argn) {
+	sampler_t *s = (sampler_t*)ARG;
+
+	if (argn != 2 || !IS_NUMBER(args[0]) || !IS_NUMBER(args[1])) {
+		VESC_IF->lbm_set_error_reason("Format: (ext-sampler-set field value)");
+		return SYM_TERROR;
+	}
+
+	int i = DEC_I(args[0]);
+	if (i < 0 || i >= s->field_num || s->fields[i].src != SRC_LISP) {
+		VESC_IF->lbm_set_error_reason("Not a Lisp field");
+		return SYM_EERROR;
+	}
+
+	s->fields[i].value = DEC_F(args[1]);
+	return SYM_TRUE;
+}
+
+// frame as a list of floats, the sample time in seconds followed by the
+// fields
+static lbm_value frame_list(const float *frame, int field_num) {
+	lbm_value res = SYM_NIL;
+	for (int i = field_num; i >= 0; i--) {
+		lbm_value v = ENC_F(frame[i]);
+		if (v == SYM_MERROR) {
+			return SYM_MERROR;
+		}
+		res = VESC_IF->lbm_cons(v, res);
+		if (res == SYM_MERROR) {
+			return SYM_MERROR;
+		}
+	}
+	return res;
+}
+
+// (ext-sampler-pop) - the oldest frame as a list of floats, the sample time
+// in seconds followed by the fields, or nil when there is none.
+static lbm_value ext_pop(lbm_value *args, lbm_uint argn) {
+	(void)args; (void)argn;
+	sampler_t *s = (sampler_t*)ARG;
+
+	if (!s->running) {
+		return SYM_NIL;
+	}
+
+	const float *frame;
+	if (rb_spsc_peek(&s->rb, (const void**)&frame, 1) == 0) {
+		return SYM_NIL;
+	}
+
+	// The frame is only released once the list is complete. On a memory
+	// error the evaluator collects garbage and calls this again.
+	lbm_value res = frame_list(frame, s->field_num);
+	if (res == SYM_MERROR) {
+		return SYM_MERROR;
+	}
+
+	rb_spsc_release(&s->rb, 1);
+	return res;
+}
+
+// (ext-sampler-pop-frames max) - remove up to max of the oldest frames from
+// the buffer and return them as a list of frames as from ext-sampler-pop,
+// or nil when there are none.
+static lbm_value ext_pop_frames(lbm_value *args, lbm_uint argn) {
+	sampler_t *s = (sampler_t*)ARG;
+
+	if (argn != 1 || !IS_NUMBER(args[0])) {
+		VESC_IF->lbm_set_error_reason("Format: (ext-sampler-pop-frames max)");
+		return SYM_TERROR;
+	}
+
+	int max = DEC_I(args[0]);
+	if (!s->running || max <= 0) {
+		return SYM_NIL;
+	}
+
+	const float *frames;
+	unsigned int count = rb_spsc_peek(&s->rb, (const void**)&frames, (unsigned int)max);
+	if (count == 0) {
+		return SYM_NIL;
+	}
+
+	// As in ext_pop, the frames stay buffered until the list is complete
+	lbm_value res = SYM_NIL;
+	for (int i = (int)count - 1; i >= 0; i--) {
+		lbm_value frame = frame_list(frames + i * (s->field_num + 1), s->field_num);
+		if (frame == SYM_MERROR) {
+			return SYM_MERROR;
+		}
+		res = VESC_IF->lbm_cons(frame, res);
+		if (res == SYM_MERROR) {
+			return SYM_MERROR;
+		}
+	}
+
+	rb_spsc_release(&s->rb, count);
+	return res;
+}
+
+static unsigned int str_len(const char *str) {
+	unsigned int len = 0;
+	while (str[len] && len < 255) {
+		len++;
+	}
+	return len;
+}
+
+// (ext-sampler-binary meta optBlockBytes) - set up the binary encoding of
+// blocks of at most optBlockBytes bytes. meta is a list of (name unit
+// precision), one per field. Returns the log header.
+static lbm_value ext_binary(lbm_value *args, lbm_uint argn) {
+	sampler_t *s = (sampler_t*)ARG;
+
+	if ((argn != 1 && argn != 2) || !(IS_CONS(args[0]) || is_nil(args[0])) ||
+			(argn == 2 && !IS_NUMBER(args[1]))) {
+		VESC_IF->lbm_set_error_reason("Format: (ext-sampler-binary meta optBlockBytes)");
+		return SYM_TERROR;
+	}
+
+	unsigned int header_len = 8;
+	int num = 0;
+	for (lbm_value curr = args[0]; IS_CONS(curr); curr = CDR(curr), num++) {
+		lbm_value m = CAR(curr);
+		if (!IS_CONS(m) || !VESC_IF->lbm_is_byte_array(FIRST(m)) ||
+				!VESC_IF->lbm_is_byte_array(SECOND(m)) || !IS_NUMBER(CAR(CDR(CDR(m))))) {
+			VESC_IF->lbm_set_error_reason("Field meta must be (name unit precision)");
+			return SYM_TERROR;
+		}
+		header_len += 3 + str_len(VESC_IF->lbm_dec_str(FIRST(m))) +
+				str_len(VESC_IF->lbm_dec_str(SECOND(m)));
+	}
+
+	if (num != s->field_num) {
+		VESC_IF->lbm_set_error_reason("One meta entry per field is required");
+		return SYM_EERROR;
+	}
+
+	unsigned int block_min = VLOG_BLOCK_HEADER + VLOG_FRAME_MAX(num);
+	unsigned int block_size = argn == 2 ? (unsigned int)DEC_I(args[1]) : BLOCK_BYTES_DEF;
+	if (block_size > BLOCK_BYTES_MAX) {
+		block_size = BLOCK_BYTES_MAX;
+	}
+	if (block_size < block_min) {
+		block_size = block_min;
+	}
+
+	lbm_value header;
+	if (!VESC_IF->lbm_create_byte_array(&header, header_len)) {
+		return SYM_MERROR;
+	}
+
+	binary_free(s);
+	s->precision = VESC_IF->malloc(num + 1);
+	s->prev = VESC_IF->malloc((2 * num + 1) * sizeof(int32_t));
+	s->block = VESC_IF->malloc(block_size);
+	if (!s->precision || !s->prev || !s->block) {
+		if (s->precision) VESC_IF->free(s->precision);
+		if (s->prev) VESC_IF->free(s->prev);
+		if (s->block) VESC_IF->free(s->block);
+		s->precision = 0;
+		s->prev = 0;
+		s->block = 0;
+		return SYM_MERROR;
+	}
+	s->block_size = block_size;
+
+	uint8_t *buf = (uint8_t*)VESC_IF->lbm_dec_str(header);
+	unsigned int ind = 0;
+	buf[ind++] = 'V';
+	buf[ind++] = 'L';
+	buf[ind++] = 'O';
+	buf[ind++] = 'G';
+	buf[ind++] = VLOG_VERSION;
+	buf[ind++] = (uint8_t)num;
+	buf[ind++] = (uint8_t)(VLOG_TIME_US >> 8);
+	buf[ind++] = (uint8_t)VLOG_TIME_US;
+
+	int i = 0;
+	for (lbm_value curr = args[0]; IS_CONS(curr); curr = CDR(curr), i++) {
+		lbm_value m = CAR(curr);
+		int precision = DEC_I(CAR(CDR(CDR(m))));
+		if (precision < 0) {
+			precision = 0;
+		} else if (precision > VLOG_PRECISION_MAX) {
+			precision = VLOG_PRECISION_MAX;
+		}
+		s->precision[i] = (uint8_t)precision;
+		buf[ind++] = (uint8_t)precision;
+
+		for (int j = 0; j < 2; j++) {
+			const char *str = VESC_IF->lbm_dec_str(j == 0 ? FIRST(m) : SECOND(m));
+			unsigned int len = str_len(str);
+			buf[ind++] = (uint8_t)len;
+			memcpy(buf + ind, str, len);
+			ind += len;
+		}
+	}
+
+	return header;
+}
+
+// (ext-sampler-pop-block) - remove the oldest frames from the buffer and
+// return them as a binary block, or nil when there are none.
+static lbm_value ext_pop_block(lbm_value *args, lbm_uint argn) {
+	(void)args; (void)argn;
+	sampler_t *s = (sampler_t*)ARG;
+
+	if (!s->block) {
+		VESC_IF->lbm_set_error_reason("Binary encoding not set up");
+		return SYM_EERROR;
+	}
+
+	if (!s->running) {
+		return SYM_NIL;
+	}
+
+	const float *frames;
+	unsigned int available = rb_spsc_peek(&s->rb, (const void**)&frames, s->rb.mask + 1);
+	if (available == 0) {
+		return SYM_NIL;
+	}
+
+	unsigned int len;
+	unsigned int count = vlog_encode_block(s->block, s->block_size, &len,
+			frames, available, s->field_num, s->precision, s->prev);
+
+	// As in ext_pop, the frames stay buffered until the block is returned
+	lbm_value res;
+	if (!VESC_IF->lbm_create_byte_array(&res, len)) {
+		return SYM_MERROR;
+	}
+	memcpy(VESC_IF->lbm_dec_str(res), s->block, len);
+
+	rb_spsc_release(&s->rb, count);
+	return res;
+}
+
+// (ext-sampler-stats) - (sampled dropped buffered)
+static lbm_value ext_stats(lbm_value *args, lbm_uint argn) {
+	(void)args; (void)argn;
+	sampler_t *s = (sampler_t*)ARG;
+
+	int buffered = s->running ? (int)rb_spsc_get_item_count(&s->rb) : 0;
+
+	int values[3] = {s->sampled, s->dropped, buffered};
+	lbm_value res = SYM_NIL;
+	for (int i = 2; i >= 0; i--) {
+		res = VESC_IF->lbm_cons(ENC_I(values[i]), res);
+		if (res == SYM_MERROR) {
+			return SYM_MERROR;
+		}
+	}
+	return res;
+}
+
+static void stop(void *arg) {
+	sampler_t *s = (sampler_t*)arg;
+	sampler_stop(s);
+	binary_free(s);
+	if (s->fields) {
+		VESC_IF->free(s->fields);
+	}
+	VESC_IF->free(s);
+}
+
+INIT_FUN(lib_info *info) {
+	INIT_START
+
+	sampler_t *s = VESC_IF->malloc(sizeof(sampler_t));
+	if (!s) {
+		return false;
+	}
+
+	memset(s, 0, sizeof(sampler_t));
+
+	info->stop_fun = stop;
+	info->arg = s;
+
+	VESC_IF->lbm_add_extension("ext-sampler-config", ext_config);
+	VESC_IF->lbm_add_extension("ext-sampler-start", ext_start);
+	VESC_IF->lbm_add_extension("ext-sampler-stop", ext_stop);
+	VESC_IF->lbm_add_extension("ext-sampler-set", ext_set);
+	VESC_IF->lbm_add_extension("ext-sampler-pop", ext_pop);
+	VESC_IF->lbm_add_extension("ext-sampler-pop-frames", ext_pop_frames);
+	VESC_IF->lbm_add_extension("ext-sampler-binary", ext_binary);
+	VESC_IF->lbm_add_extension("ext-sampler-pop-block", ext_pop_block);
+	VESC_IF->lbm_add_extension("ext-sampler-stats", ext_stats);
+
+	return true;
+}
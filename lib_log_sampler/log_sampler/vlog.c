@@ -0,0 +1,136 @@
+/*
+	Copyright 2026 VESC project
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "vlog.h"
+
+int32_t vlog_fixed(float value, uint8_t precision) {
+	for (int i = 0; i < precision; i++) {
+		value *= 10.0;
+	}
+
+	// Saturate, which also maps NaN to 0
+	if (value >= 2147483520.0) {
+		return INT32_MAX;
+	} else if (value <= -2147483520.0) {
+		return INT32_MIN;
+	} else if (!(value == value)) {
+		return 0;
+	}
+
+	return (int32_t)(value < 0.0 ? value - 0.5 : value + 0.5);
+}
+
+static unsigned int put_varint(uint8_t *buf, uint32_t value) {
+	unsigned int ind = 0;
+	while (value >= 0x80) {
+		buf[ind++] = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+	buf[ind++] = (uint8_t)value;
+	return ind;
+}
+
+static unsigned int varint_len(uint32_t value) {
+	unsigned int len = 1;
+	while (value >= 0x80) {
+		value >>= 7;
+		len++;
+	}
+	return len;
+}
+
+static uint32_t zigzag(int32_t value) {
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static uint32_t delta(int32_t value, int32_t prev) {
+	return zigzag((int32_t)((uint32_t)value - (uint32_t)prev));
+}
+
+static uint32_t frame_time(float time) {
+	return (uint32_t)(time * (1000000.0 / VLOG_TIME_US) + 0.5);
+}
+
+unsigned int vlog_encode_block(uint8_t *buf, unsigned int size, unsigned int *len,
+		const float *frames, unsigned int frame_count, unsigned int channels,
+		const uint8_t *precision, int32_t *prev) {
+	// The values of the frame being encoded, so that it is only written
+	// once it is known to fit
+	int32_t *cur = prev + channels;
+	unsigned int bitmap_len = (channels + 7) / 8;
+	unsigned int ind = VLOG_BLOCK_HEADER;
+	unsigned int count = 0;
+	uint32_t time_prev = 0;
+
+	while (count < frame_count) {
+		const float *frame = frames + count * (channels + 1);
+		uint32_t time = frame_time(frame[0]);
+
+		unsigned int frame_len = count == 0 ? varint_len(time) :
+				varint_len(time - time_prev) + bitmap_len;
+		for (unsigned int i = 0; i < channels; i++) {
+			cur[i] = vlog_fixed(frame[i + 1], precision[i]);
+			if (count == 0) {
+				frame_len += varint_len(zigzag(cur[i]));
+			} else if (cur[i] != prev[i]) {
+				frame_len += varint_len(delta(cur[i], prev[i]));
+			}
+		}
+
+		if (ind + frame_len > size) {
+			break;
+		}
+
+		if (count == 0) {
+			ind += put_varint(buf + ind, time);
+			for (unsigned int i = 0; i < channels; i++) {
+				ind += put_varint(buf + ind, zigzag(cur[i]));
+				prev[i] = cur[i];
+			}
+		} else {
+			ind += put_varint(buf + ind, time - time_prev);
+
+			uint8_t *bitmap = buf + ind;
+			ind += bitmap_len;
+			for (unsigned int i = 0; i < bitmap_len; i++) {
+				bitmap[i] = 0;
+			}
+
+			for (unsigned int i = 0; i < channels; i++) {
+				if (cur[i] != prev[i]) {
+					bitmap[i / 8] |= 1 << (i % 8);
+					ind += put_varint(buf + ind, delta(cur[i], prev[i]));
+					prev[i] = cur[i];
+				}
+			}
+		}
+
+		time_prev = time;
+		count++;
+	}
+
+	buf[0] = VLOG_BLOCK_MARK;
+	buf[1] = (uint8_t)(ind >> 8);
+	buf[2] = (uint8_t)ind;
+	buf[3] = (uint8_t)(count >> 8);
+	buf[4] = (uint8_t)count;
+
+	*len = ind;
+	return count;
+}
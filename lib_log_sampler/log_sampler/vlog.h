@@ -0,0 +1,60 @@
+/*
+	Copyright 2026 VESC project
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VLOG_H_
+#define VLOG_H_
+
+#include <stdint.h>
+
+/*
+ * Compact binary log encoding, see the README for the format.
+ *
+ * Every channel is stored as a fixed-point integer with its own number of
+ * decimal places. A block starts with a key frame of absolute values,
+ * followed by frames that only carry the channels that changed, as
+ * varint-coded deltas, so that slow-moving channels cost a bit per frame.
+ * Blocks don't depend on each other, a lost block only loses its frames.
+ */
+
+#define VLOG_VERSION		1
+#define VLOG_PRECISION_MAX	6
+// Resolution of the frame time
+#define VLOG_TIME_US		100
+
+#define VLOG_BLOCK_MARK		'B'
+#define VLOG_BLOCK_HEADER	5
+
+// Worst case size of a channel value, a frame time and a whole frame
+#define VLOG_VALUE_MAX		5
+#define VLOG_FRAME_MAX(channels) \
+	(VLOG_VALUE_MAX + ((channels) + 7) / 8 + (channels) * VLOG_VALUE_MAX)
+
+int32_t vlog_fixed(float value, uint8_t precision);
+
+/*
+ * Encodes frames of 1 + channels floats (the time in seconds, then the
+ * values) into a block of at most size bytes, which must hold at least one
+ * frame. Returns the number of frames encoded, the block length is stored in
+ * len. prev is scratch space of 2 * channels values.
+ */
+unsigned int vlog_encode_block(uint8_t *buf, unsigned int size, unsigned int *len,
+		const float *frames, unsigned int frame_count, unsigned int channels,
+		const uint8_t *precision, int32_t *prev);
+
+#endif
@@ -0,0 +1,130 @@
+/*
+	Copyright 2026 VESC project
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+// Host benchmark of the data rate of a ride logged at 500 Hz with 40 fields:
+// the encoding time per frame and the bytes per frame of the binary log in
+// blocks of the default and the largest size, against the 4 bytes per value
+// that log-send-f32 sends.
+//
+// Usage: log_rate_bench [FIELDS [RATE]]
+
+#include "vlog.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define SECONDS			10
+#define BLOCK_BYTES_MAX	1024
+#define FIELDS_MAX		128
+
+static double now_s(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / (double)1000000000;
+}
+
+static float noise(float amplitude) {
+	return ((float)rand() / (float)RAND_MAX - 0.5f) * 2.0f * amplitude;
+}
+
+// Fields of a typical loglist, repeated for more fields: the precision of
+// the LogUI defaults and a ride of accelerations and braking with sensor
+// noise, slowly rising temperatures and counters and constant faults.
+static float field(unsigned int i, float t, uint8_t *precision) {
+	float ride = sinf(0.3f * t) + 0.3f * sinf(2.1f * t);
+	switch (i % 10) {
+	case 0: *precision = 1; return 60.0f - 2.0f * ride + noise(0.1f);			// Voltage
+	case 1: *precision = 2; return 30.0f * ride + noise(0.5f);					// Current
+	case 2: *precision = 2; return 25.0f * ride + noise(0.5f);					// Input current
+	case 3: *precision = 3; return 0.4f + 0.3f * ride + noise(0.002f);			// Duty
+	case 4: *precision = 0; return 15000.0f + 10000.0f * ride + noise(20.0f);	// ERPM
+	case 5: *precision = 1; return 40.0f + 0.5f * t;							// Temp FET
+	case 6: *precision = 1; return 45.0f + 0.8f * t;							// Temp motor
+	case 7: *precision = 3; return 0.01f * t;									// Ah
+	case 8: *precision = 2; return 5.0f * sinf(1.3f * t) + noise(0.05f);		// Pitch
+	default: *precision = 0; return 0.0f;										// Fault
+	}
+}
+
+int main(int argc, char **argv) {
+	unsigned int fields = argc > 1 ? strtoul(argv[1], NULL, 10) : 40;
+	unsigned int rate = argc > 2 ? strtoul(argv[2], NULL, 10) : 500;
+	if (fields == 0 || fields > FIELDS_MAX || rate == 0) {
+		fprintf(stderr, "Usage: %s [FIELDS [RATE]]\n", argv[0]);
+		return 1;
+	}
+
+	unsigned int frame_count = SECONDS * rate;
+	float *frames = malloc((size_t)frame_count * (fields + 1) * sizeof(float));
+	uint8_t precision[FIELDS_MAX];
+	int32_t prev[2 * FIELDS_MAX];
+	if (!frames) {
+		return 1;
+	}
+
+	srand(1);
+	for (unsigned int i = 0; i < frame_count; i++) {
+		float t = (float)i / (float)rate;
+		float *frame = frames + i * (fields + 1);
+		frame[0] = t;
+		for (unsigned int f = 0; f < fields; f++) {
+			frame[f + 1] = field(f, t, &precision[f]);
+		}
+	}
+
+	double f32_frame = 4 * (fields + 1);
+	printf("%u fields at %u Hz\n", fields, rate);
+	printf("%-10s %12s %12s %12s %12s\n", "log", "B/frame", "kB/s", "frames/block", "ns/frame");
+	printf("%-10s %12.1f %12.1f %12s %12s\n", "f32", f32_frame, f32_frame * rate / (double)1000, "-", "-");
+
+	static const unsigned int block_sizes[] = {256, BLOCK_BYTES_MAX};
+	static uint8_t block[BLOCK_BYTES_MAX];
+	for (unsigned int b = 0; b < sizeof(block_sizes) / sizeof(block_sizes[0]); b++) {
+		// Encode the ride a few times for the time, the blocks are the same
+		const int runs = 20;
+		unsigned long bytes = 0;
+		unsigned int blocks = 0;
+		double start = now_s();
+		for (int r = 0; r < runs; r++) {
+			bytes = 0;
+			blocks = 0;
+			unsigned int done = 0;
+			while (done < frame_count) {
+				unsigned int len;
+				done += vlog_encode_block(block, block_sizes[b], &len,
+						frames + done * (fields + 1), frame_count - done, fields, precision, prev);
+				bytes += len;
+				blocks++;
+			}
+		}
+		double t_encode = now_s() - start;
+
+		char name[16];
+		snprintf(name, sizeof(name), "binary %u", block_sizes[b]);
+		double bytes_frame = (double)bytes / frame_count;
+		printf("%-10s %12.1f %12.1f %12.1f %12.1f\n", name, bytes_frame,
+				bytes_frame * rate / (double)1000, (double)frame_count / blocks,
+				t_encode * (double)1000000000 / ((double)frame_count * runs));
+	}
+
+	free(frames);
+	return 0;
+}
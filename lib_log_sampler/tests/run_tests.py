@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""
+Log sampler host tests
+Encodes logs with the binary log encoder of the library and decodes them with
+tools/vlog_decode.py
+"""
+
+import os
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+
+TESTS_DIR = Path(__file__).resolve().parent
+LIB_DIR = TESTS_DIR.parent / "log_sampler"
+
+sys.dont_write_bytecode = True
+sys.path.insert(0, str(TESTS_DIR.parent / "tools"))
+import vlog_decode  # noqa: E402
+
+CC = os.environ.get("CC", "cc")
+# same float semantics as the library build
+CFLAGS = ["-O2", "-std=gnu99", "-Wall", "-Wextra", "-Werror", "-fsingle-precision-constant",
+          "-Wdouble-promotion", "-I", str(LIB_DIR)]
+
+CASES = ["constant", "small_delta", "large_delta", "nan"] + [
+    f"channels_{n}" for n in (1, 8, 9, 16, 17, 40)
+] + ["tight_blocks"]
+
+# Test counters
+test_passes = 0
+test_failures = 0
+
+
+def check(condition, test_name, details=""):
+    global test_passes, test_failures
+    if condition:
+        test_passes += 1
+        print(f"✓ {test_name}")
+    else:
+        test_failures += 1
+        print(f"✗ {test_name}")
+        if details:
+            print(f"  {details}")
+
+
+def build(workdir, name, sources):
+    binary = Path(workdir) / name
+    cmd = [CC] + CFLAGS + ["-o", str(binary)] + [str(s) for s in sources] + ["-lm"]
+    subprocess.run(cmd, check=True)
+    return binary
+
+
+def read_expected(path):
+    frames = []
+    for line in path.read_text().splitlines():
+        numbers = [int(n) for n in line.split()]
+        frames.append((numbers[0], numbers[1:]))
+    return frames
+
+
+def test_round_trip(workdir):
+    print("\nBinary log round trip:")
+    binary = build(workdir, "vlog_test", [TESTS_DIR / "vlog_test.c", LIB_DIR / "vlog.c"])
+    subprocess.run([str(binary), workdir], check=True)
+
+    for case in CASES:
+        data = (Path(workdir) / f"{case}.vlog").read_bytes()
+        expected = read_expected(Path(workdir) / f"{case}.txt")
+        header, frames = vlog_decode.decode_log(data)
+
+        mismatch = next((i for i, (a, b) in enumerate(zip(frames, expected)) if a != b), None)
+        check(
+            len(frames) == len(expected) and mismatch is None,
+            f"{case}: {len(expected[0][1])} channels decoded bit-exactly",
+            f"{len(frames)} of {len(expected)} frames, first mismatch at {mismatch}: "
+            f"{frames[mismatch] if mismatch is not None else ''} != "
+            f"{expected[mismatch] if mismatch is not None else ''}",
+        )
+
+    # blocks are filled by the size of the frames, not the worst case
+    data = (Path(workdir) / "tight_blocks.vlog").read_bytes()
+    frame_count = len(read_expected(Path(workdir) / "tight_blocks.txt"))
+    header, ind = vlog_decode.decode_header(data)
+    blocks = 0
+    while ind < len(data):
+        _, length = vlog_decode.decode_block(data[ind:], len(header.channels))
+        ind += length
+        blocks += 1
+    check(blocks * 4 < frame_count, "blocks of the smallest size hold several frames",
+          f"{blocks} blocks for {frame_count} frames")
+
+    # a block decoded with another channel count doesn't pass as valid
+    header, ind = vlog_decode.decode_header((Path(workdir) / "channels_8.vlog").read_bytes())
+    data = (Path(workdir) / "channels_8.vlog").read_bytes()[ind:]
+    for count in (7, 9):
+        try:
+            vlog_decode.decode_block(data, count)
+            check(False, f"block of 8 channels rejected as {count}")
+        except (ValueError, IndexError):
+            check(True, f"block of 8 channels rejected as {count}")
+
+    # the CSV has the values at their precision
+    data = (Path(workdir) / "small_delta.vlog").read_bytes()
+    header, frames = vlog_decode.decode_log(data)
+    csv_path = Path(workdir) / "small_delta.csv"
+    with open(csv_path, "w") as out:
+        vlog_decode.write_csv(out, header, frames[:1])
+    rows = csv_path.read_text().splitlines()
+    check(
+        rows[0].startswith("time,ch0,ch1 [V],") and rows[1].split(",")[1:4] == ["3", "20.0", "3.00"],
+        "CSV columns and precision",
+        "\n  ".join(rows),
+    )
+
+
+def main():
+    with tempfile.TemporaryDirectory() as workdir:
+        test_round_trip(workdir)
+
+        print("\nlog_rate_bench:")
+        bench = build(workdir, "log_rate_bench", [TESTS_DIR / "log_rate_bench.c", LIB_DIR / "vlog.c"])
+        subprocess.run([str(bench)], check=True)
+
+    print(f"\n{test_passes} passed, {test_failures} failed")
+    return 1 if test_failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,188 @@
+/*
+	Copyright 2026 VESC project
+
+	This file is part of the VESC firmware.
+
+	The VESC firmware is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The VESC firmware is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+    */
+
+// Encodes logs of generated frames the way the sampler does and writes them
+// to DIR/<case>.vlog, along with the expected frames in raw units (time
+// units and fixed-point values) in DIR/<case>.txt, for run_tests.py to
+// decode with vlog_decode.py and compare.
+
+#include "vlog.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHANNELS_MAX	40
+#define FRAMES			600
+
+typedef enum {
+	CASE_CONSTANT = 0,
+	CASE_SMALL_DELTA,
+	CASE_LARGE_DELTA,
+	CASE_NAN,
+} CaseKind;
+
+static float frames[FRAMES * (CHANNELS_MAX + 1)];
+static uint8_t block[4096];
+
+static float value(CaseKind kind, unsigned int frame, unsigned int channel) {
+	switch (kind) {
+	case CASE_CONSTANT:
+		return 12.5f - (float)channel;
+
+	case CASE_SMALL_DELTA:
+		// Every other channel moves, a step or two of its precision
+		if (channel % 2) {
+			return 20.0f;
+		}
+		return 3.0f + (float)((frame * (channel + 1)) % 7) * 0.01f;
+
+	case CASE_LARGE_DELTA:
+		// Jumps between the ends of the range, including saturation and
+		// differences that wrap around 32 bits
+		switch ((frame + channel) % 5) {
+		case 0: return 1e12f;
+		case 1: return -1e12f;
+		case 2: return 2147.0f;
+		case 3: return -2147.0f;
+		default: return (float)rand() / (float)RAND_MAX * 4000.0f - 2000.0f;
+		}
+
+	case CASE_NAN:
+		if ((frame + channel) % 3 == 0) {
+			return NAN;
+		}
+		return (frame + channel) % 3 == 1 ? INFINITY : -5.25f;
+	}
+
+	return 0.0f;
+}
+
+static void put_string(FILE *f, const char *str) {
+	fputc((int)strlen(str), f);
+	fputs(str, f);
+}
+
+static int write_case(const char *dir, const char *name, CaseKind kind,
+		unsigned int channels, unsigned int block_size) {
+	uint8_t precision[CHANNELS_MAX];
+	int32_t prev[2 * CHANNELS_MAX];
+
+	// Uneven frame times with gaps, starting late enough to need a
+	// multi-byte varint
+	float time = 1234.5f;
+	for (unsigned int i = 0; i < FRAMES; i++) {
+		float *frame = frames + i * (channels + 1);
+		time += (i % 50 == 49) ? 1.0f : 0.002f;
+		frame[0] = time;
+		for (unsigned int c = 0; c < channels; c++) {
+			frame[c + 1] = value(kind, i, c);
+		}
+	}
+
+	for (unsigned int c = 0; c < channels; c++) {
+		precision[c] = c % (VLOG_PRECISION_MAX + 1);
+	}
+	if (kind == CASE_LARGE_DELTA) {
+		// 2147 at precision 6 is past the 32-bit range as well
+		for (unsigned int c = 0; c < channels; c++) {
+			precision[c] = c % 2 ? 6 : 3;
+		}
+	}
+
+	char path[512];
+	snprintf(path, sizeof(path), "%s/%s.vlog", dir, name);
+	FILE *log = fopen(path, "wb");
+	snprintf(path, sizeof(path), "%s/%s.txt", dir, name);
+	FILE *expected = fopen(path, "w");
+	if (!log || !expected) {
+		fprintf(stderr, "Failed to open the output of %s\n", name);
+		return 1;
+	}
+
+	fwrite("VLOG", 1, 4, log);
+	fputc(VLOG_VERSION, log);
+	fputc((int)channels, log);
+	fputc(VLOG_TIME_US >> 8, log);
+	fputc(VLOG_TIME_US & 0xFF, log);
+	for (unsigned int c = 0; c < channels; c++) {
+		char channel_name[16];
+		snprintf(channel_name, sizeof(channel_name), "ch%u", c);
+		fputc(precision[c], log);
+		put_string(log, channel_name);
+		put_string(log, c % 2 ? "V" : "");
+	}
+
+	unsigned int done = 0;
+	while (done < FRAMES) {
+		unsigned int len;
+		unsigned int count = vlog_encode_block(block, block_size, &len,
+				frames + done * (channels + 1), FRAMES - done, channels, precision, prev);
+		if (count == 0 || len > block_size) {
+			fprintf(stderr, "%s: %u frames in a block of %u bytes\n", name, count, len);
+			return 1;
+		}
+		fwrite(block, 1, len, log);
+		done += count;
+	}
+
+	for (unsigned int i = 0; i < FRAMES; i++) {
+		const float *frame = frames + i * (channels + 1);
+		fprintf(expected, "%u", (unsigned int)(frame[0] * (1000000.0f / VLOG_TIME_US) + 0.5f));
+		for (unsigned int c = 0; c < channels; c++) {
+			fprintf(expected, " %d", (int)vlog_fixed(frame[c + 1], precision[c]));
+		}
+		fprintf(expected, "\n");
+	}
+
+	fclose(log);
+	fclose(expected);
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s DIR\n", argv[0]);
+		return 1;
+	}
+
+	srand(1);
+	const char *dir = argv[1];
+	int res = 0;
+	res |= write_case(dir, "constant", CASE_CONSTANT, 12, 256);
+	res |= write_case(dir, "small_delta", CASE_SMALL_DELTA, 12, 256);
+	res |= write_case(dir, "large_delta", CASE_LARGE_DELTA, 12, 512);
+	res |= write_case(dir, "nan", CASE_NAN, 12, 256);
+
+	// The bitmap grows by a byte every 8 channels
+	static const unsigned int channel_counts[] = {1, 8, 9, 16, 17, CHANNELS_MAX};
+	for (unsigned int i = 0; i < sizeof(channel_counts) / sizeof(channel_counts[0]); i++) {
+		char name[32];
+		snprintf(name, sizeof(name), "channels_%u", channel_counts[i]);
+		res |= write_case(dir, name, CASE_SMALL_DELTA, channel_counts[i],
+				VLOG_BLOCK_HEADER + 4 * VLOG_FRAME_MAX(channel_counts[i]));
+	}
+
+	// The smallest block the sampler allows
+	res |= write_case(dir, "tight_blocks", CASE_SMALL_DELTA, CHANNELS_MAX,
+			VLOG_BLOCK_HEADER + VLOG_FRAME_MAX(CHANNELS_MAX));
+
+	return res;
+}
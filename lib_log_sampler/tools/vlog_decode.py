@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+
+# Decoder of the binary logs of the log sampler, see the README for the
+# format.
+#
+# The input is a log file: the header returned by ext-sampler-binary
+# followed by the blocks returned by ext-sampler-pop-block, as written by
+# LogUI. Truncated or corrupt blocks at the end of the file are skipped. The
+# output is a CSV file with one row per frame, the time in seconds followed
+# by the channels.
+
+from argparse import ArgumentParser
+import struct
+import sys
+
+
+MAGIC = b"VLOG"
+VERSION = 1
+BLOCK_MARK = ord("B")
+BLOCK_HEADER = 5
+
+
+class Channel:
+    def __init__(self, name, unit, precision):
+        self.name = name
+        self.unit = unit
+        self.precision = precision
+
+
+class Header:
+    def __init__(self, channels, time_us):
+        self.channels = channels
+        self.time_us = time_us
+
+
+def read_varint(data, ind):
+    value = 0
+    shift = 0
+    while True:
+        byte = data[ind]
+        ind += 1
+        value |= (byte & 0x7f) << shift
+        shift += 7
+        if byte < 0x80:
+            return value, ind
+
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def to_int32(value):
+    value &= 0xffffffff
+    return value - 0x100000000 if value & 0x80000000 else value
+
+
+def read_string(data, ind):
+    length = data[ind]
+    return data[ind + 1:ind + 1 + length].decode(errors="replace"), ind + 1 + length
+
+
+def decode_header(data):
+    """Decodes the header, returns the Header and its length."""
+    if data[:4] != MAGIC:
+        raise ValueError("Not a binary log")
+    version, count, time_us = struct.unpack_from(">BBH", data, 4)
+    if version != VERSION:
+        raise ValueError("Unsupported version {}".format(version))
+
+    ind = 8
+    channels = []
+    for _ in range(count):
+        precision = data[ind]
+        name, ind = read_string(data, ind + 1)
+        unit, ind = read_string(data, ind)
+        channels.append(Channel(name, unit, precision))
+    return Header(channels, time_us), ind
+
+
+def decode_block(data, channel_count):
+    """
+    Decodes a single block, returns a list of frames as (time, values) in
+    raw units and the length of the block.
+    """
+    mark, length, count = struct.unpack_from(">BHH", data)
+    if mark != BLOCK_MARK:
+        raise ValueError("Invalid block mark {}".format(mark))
+
+    bitmap_len = (channel_count + 7) // 8
+    ind = BLOCK_HEADER
+    frames = []
+    time = 0
+    values = [0] * channel_count
+    for frame in range(count):
+        if frame == 0:
+            time, ind = read_varint(data, ind)
+            for i in range(channel_count):
+                zigzag, ind = read_varint(data, ind)
+                values[i] = unzigzag(zigzag)
+        else:
+            delta, ind = read_varint(data, ind)
+            time = (time + delta) & 0xffffffff
+            bitmap = data[ind:ind + bitmap_len]
+            ind += bitmap_len
+            values = list(values)
+            for i in range(channel_count):
+                if bitmap[i // 8] & (1 << (i % 8)):
+                    zigzag, ind = read_varint(data, ind)
+                    values[i] = to_int32(values[i] + unzigzag(zigzag))
+        frames.append((time, values))
+
+    if ind != length:
+        raise ValueError("Block length mismatch: {} != {}".format(ind, length))
+
+    return frames, length
+
+
+def decode_log(data):
+    """Decodes a whole log, returns the Header and a list of frames."""
+    header, ind = decode_header(data)
+    frames = []
+    while ind + BLOCK_HEADER <= len(data):
+        try:
+            block_frames, length = decode_block(data[ind:], len(header.channels))
+        except (ValueError, IndexError) as e:
+            print("Stopping at offset {}: {}".format(ind, e), file=sys.stderr)
+            break
+        frames += block_frames
+        ind += length
+    return header, frames
+
+
+def write_csv(out, header, frames):
+    columns = ["time"] + [
+        "{} [{}]".format(c.name, c.unit) if c.unit else c.name for c in header.channels
+    ]
+    out.write(",".join(columns) + "\n")
+    for time, values in frames:
+        row = ["{:.4f}".format(time * header.time_us / 1e6)]
+        for c, v in zip(header.channels, values):
+            row.append("{:.{}f}".format(v / 10 ** c.precision, c.precision))
+        out.write(",".join(row) + "\n")
+
+
+def main():
+    parser = ArgumentParser(prog='vlog_decode', description="Decode a binary log into CSV.")
+    parser.add_argument('log', help="binary log file")
+    parser.add_argument('-o', '--output', help="output CSV file (default: stdout)")
+    args = parser.parse_args()
+
+    with open(args.log, 'rb') as f:
+        header, frames = decode_log(f.read())
+
+    if args.output:
+        with open(args.output, 'w') as out:
+            write_csv(out, header, frames)
+    else:
+        write_csv(sys.stdout, header, frames)
+
+
+if __name__ == '__main__':
+    main()
@@ -18,6 +18,7 @@
  */
  
 #include "vesc_c_if.h"
+#include <math.h>
 
 // See https://github.com/abique/midi-parser
 #include "midi-parser.h"
@@ -52,9 +53,46 @@ static bool get_add_symbol(char *name, lbm_uint* id) {
 	return true;
 }
 
+#define TONE_CHANNELS		4
+#define MAX_TRACKS			16
+#define EVENT_QUEUE_LEN		8
+#define DECAY_PERIOD_US		20000
+#define MAX_SLEEP_US		10000
+
+// A midi file opened on a parser, and its timing during playback
+typedef struct {
+	const uint8_t *data;
+	int32_t size;
+	float volts;
+	float decay;
+
+	int16_t time_division;
+	float us_per_tick;
+	uint32_t tempo_tick; // Tick and time of the last tempo change
+	uint32_t tempo_us;
+} midi_source;
+
+// Playback cursor on one track. The parser only sees the track, so that the
+// tracks of a file can be merged by time.
+typedef struct {
+	struct midi_parser parser;
+	int source;
+	uint32_t tick; // Absolute tick of the event in the parser
+	bool pending;
+} midi_cursor;
+
+typedef struct {
+	int source; // -1 when free
+	uint8_t channel;
+	uint8_t note;
+	float freq;
+	float volts;
+} midi_voice;
+
 typedef struct {
 	int parsers;
 	struct midi_parser *parser;
+	midi_source *source;
 	lbm_uint sym_midi_eob;
 	lbm_uint sym_midi_error;
 	lbm_uint sym_midi_init;
@@ -63,8 +101,45 @@ typedef struct {
 	lbm_uint sym_midi_track_midi;
 	lbm_uint sym_midi_track_meta;
 	lbm_uint sym_midi_track_sysex;
+	lbm_uint sym_midi_start;
+	lbm_uint sym_midi_end;
+	lbm_uint sym_midi_stop;
+
+	// Player
+	lib_thread thread;
+	volatile bool playing;
+	systime_t start;
+	uint32_t position_period_us;
+	midi_cursor cursor[MAX_TRACKS];
+	int cursors;
+	midi_voice voice[TONE_CHANNELS];
+
+	// Events for ext-midi-wait-event
+	lib_mutex lock;
+	lbm_cid waiter;
+	bool waiting;
+	lbm_value event[EVENT_QUEUE_LEN];
+	int event_head;
+	int event_count;
 } midi_state;
 
+static void player_stop(midi_state *state);
+
+static void state_free(midi_state *state) {
+	player_stop(state);
+
+	if (state->lock) {
+		VESC_IF->free(state->lock);
+	}
+	if (state->source) {
+		VESC_IF->free(state->source);
+	}
+	if (state->parser) {
+		VESC_IF->free(state->parser);
+	}
+	VESC_IF->free(state);
+}
+
 static lbm_value ext_midi_init(lbm_value *args, lbm_uint argn) {
 	if (argn != 1 || !IS_NUMBER(args[0])) {
 		VESC_IF->lbm_set_error_reason("Invalid argument");
@@ -77,6 +152,11 @@ static lbm_value ext_midi_init(lbm_value *args, lbm_uint argn) {
 		return SYM_TERROR;
 	}
 
+	if (ARG) {
+		state_free((midi_state*)ARG);
+		ARG = 0;
+	}
+
 	midi_state *state = VESC_IF->malloc(sizeof(midi_state));
 
 	if (!state) {
@@ -85,26 +165,33 @@ static lbm_value ext_midi_init(lbm_value *args, lbm_uint argn) {
 
 	memset(state, 0, sizeof(midi_state));
 	state->parsers = parser_num;
-
 	state->parser = VESC_IF->malloc(sizeof(struct midi_parser) * parser_num);
+	state->source = VESC_IF->malloc(sizeof(midi_source) * parser_num);
+	state->lock = VESC_IF->mutex_create();
 
-	if (!state->parser) {
-		VESC_IF->free(state);
+	if (!state->parser || !state->source || !state->lock) {
+		state_free(state);
 		return SYM_MERROR;
 	}
 
 	for (int i = 0;i < parser_num;i++) {
 		memset(&state->parser[i], 0, sizeof(struct midi_parser));
+		memset(&state->source[i], 0, sizeof(midi_source));
 	}
 
+	get_add_symbol("midi-start", &state->sym_midi_start);
+	get_add_symbol("midi-end", &state->sym_midi_end);
+	get_add_symbol("midi-stop", &state->sym_midi_stop);
+
 	ARG = state;
 
 	return SYM_TRUE;
 }
 
 static lbm_value ext_midi_open(lbm_value *args, lbm_uint argn) {
-	if (argn != 2 || !IS_NUMBER(args[0]) || !VESC_IF->lbm_is_byte_array(args[1])) {
-		VESC_IF->lbm_set_error_reason("Format: (ext-midi-open parser midi-file)");
+	if (argn < 2 || argn > 4 || !IS_NUMBER(args[0]) || !VESC_IF->lbm_is_byte_array(args[1]) ||
+			(argn >= 3 && !IS_NUMBER(args[2])) || (argn == 4 && !IS_NUMBER(args[3]))) {
+		VESC_IF->lbm_set_error_reason("Format: (ext-midi-open parser midi-file optVolts optDecay)");
 		return SYM_TERROR;
 	}
 
@@ -136,6 +223,12 @@ static lbm_value ext_midi_open(lbm_value *args, lbm_uint argn) {
 	state->parser[parser_num].size = arr->size;
 	state->parser[parser_num].in = (uint8_t*)arr->data;
 
+	midi_source *src = &state->source[parser_num];
+	src->data = (uint8_t*)arr->data;
+	src->size = arr->size;
+	src->volts = argn >= 3 ? DEC_F(args[2]) : 0.5;
+	src->decay = argn == 4 ? DEC_F(args[3]) : 0.92;
+
 	ARG = state;
 
 	return SYM_TRUE;
@@ -259,12 +352,423 @@ static lbm_value ext_midi_parse(lbm_value *args, lbm_uint argn) {
 	return res;
 }
 
+// Player
+
+// Delivers an event to the context waiting in ext-midi-wait-event, or queues
+// it when there is none. Events are unboxed, so this works from any thread.
+static void player_event(midi_state *state, lbm_value event) {
+	VESC_IF->mutex_lock(state->lock);
+
+	bool delivered = false;
+	if (state->waiting) {
+		delivered = VESC_IF->lbm_unblock_ctx_unboxed(state->waiter, event);
+		state->waiting = false;
+	}
+
+	if (!delivered && state->event_count < EVENT_QUEUE_LEN) {
+		state->event[(state->event_head + state->event_count) % EVENT_QUEUE_LEN] = event;
+		state->event_count++;
+	}
+
+	VESC_IF->mutex_unlock(state->lock);
+}
+
+static uint32_t source_tick_to_us(midi_source *src, uint32_t tick) {
+	return src->tempo_us + (uint32_t)((float)(tick - src->tempo_tick) * src->us_per_tick);
+}
+
+static void source_set_tempo(midi_source *src, uint32_t tick, uint32_t us_per_quarter) {
+	src->tempo_us = source_tick_to_us(src, tick);
+	src->tempo_tick = tick;
+	src->us_per_tick = (float)us_per_quarter / (float)src->time_division;
+}
+
+// Advances the cursor to the next event of its track
+static void cursor_next(midi_cursor *c) {
+	for (;;) {
+		switch (midi_parse(&c->parser)) {
+		case MIDI_PARSER_TRACK:
+			break;
+
+		case MIDI_PARSER_TRACK_MIDI:
+		case MIDI_PARSER_TRACK_META:
+		case MIDI_PARSER_TRACK_SYSEX:
+			c->tick += (uint32_t)c->parser.vtime;
+			c->pending = true;
+			return;
+
+		default:
+			c->pending = false;
+			return;
+		}
+	}
+}
+
+// Sets up the timing of a source and a cursor for each of its tracks
+static void player_add_source(midi_state *state, int source) {
+	midi_source *src = &state->source[source];
+	if (!src->data) {
+		return;
+	}
+
+	struct midi_parser p;
+	memset(&p, 0, sizeof(p));
+	p.state = MIDI_PARSER_INIT;
+	p.in = src->data;
+	p.size = src->size;
+
+	if (midi_parse(&p) != MIDI_PARSER_HEADER) {
+		return;
+	}
+
+	src->tempo_tick = 0;
+	src->tempo_us = 0;
+
+	int16_t div = p.header.time_division;
+	if (div > 0) {
+		src->time_division = div;
+		source_set_tempo(src, 0, 500000);
+	} else {
+		// SMPTE: frames per second and ticks per frame, the tempo doesn't apply
+		int fps = -(int8_t)(div >> 8);
+		int tpf = div & 0xFF;
+		if (fps <= 0 || tpf <= 0) {
+			return;
+		}
+		src->time_division = 0;
+		src->us_per_tick = 1000000.0 / (float)(fps * tpf);
+	}
+
+	// In the header state the parser is at the start of a chunk
+	while (p.size >= 8 && state->cursors < MAX_TRACKS) {
+		int32_t len = (int32_t)(((uint32_t)p.in[4] << 24) | ((uint32_t)p.in[5] << 16) |
+				((uint32_t)p.in[6] << 8) | p.in[7]);
+		if (len < 0 || len > p.size - 8) {
+			break;
+		}
+
+		if (memcmp(p.in, "MTrk", 4) == 0) {
+			midi_cursor *c = &state->cursor[state->cursors++];
+			c->parser = p;
+			c->parser.size = 8 + len;
+			c->source = source;
+			c->tick = 0;
+			cursor_next(c);
+		}
+
+		p.in += 8 + len;
+		p.size -= 8 + len;
+	}
+}
+
+static void voice_set(int channel, midi_voice *v) {
+	if (v->source < 0) {
+		VESC_IF->foc_play_tone(channel, 500, 0);
+	} else {
+		VESC_IF->foc_play_tone(channel, v->freq, v->volts);
+	}
+}
+
+static int voice_find(midi_state *state, int source, int channel, int note) {
+	for (int i = 0;i < TONE_CHANNELS;i++) {
+		midi_voice *v = &state->voice[i];
+		if (v->source == source && v->channel == channel && v->note == note) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static void note_on(midi_state *state, int source, int channel, int note) {
+	// Retrigger the note if it is playing, otherwise take a free voice or
+	// the quietest one
+	int ind = voice_find(state, source, channel, note);
+	if (ind < 0) {
+		ind = 0;
+		for (int i = 0;i < TONE_CHANNELS;i++) {
+			midi_voice *v = &state->voice[i];
+			if (v->source < 0) {
+				ind = i;
+				break;
+			}
+			if (v->volts < state->voice[ind].volts) {
+				ind = i;
+			}
+		}
+	}
+
+	midi_voice *v = &state->voice[ind];
+	v->source = source;
+	v->channel = channel;
+	v->note = note;
+	v->freq = 440.0 * powf(2.0, ((float)note - 69.0) / 12.0);
+	v->volts = state->source[source].volts;
+	voice_set(ind, v);
+}
+
+static void note_off(midi_state *state, int source, int channel, int note) {
+	int ind = voice_find(state, source, channel, note);
+	if (ind >= 0) {
+		state->voice[ind].source = -1;
+		voice_set(ind, &state->voice[ind]);
+	}
+}
+
+static void play_event(midi_state *state, midi_cursor *c) {
+	struct midi_parser *p = &c->parser;
+	midi_source *src = &state->source[c->source];
+
+	if (p->state != MIDI_PARSER_TRACK) {
+		return;
+	}
+
+	if (p->meta.bytes) {
+		if (p->meta.type == MIDI_META_SET_TEMPO && p->meta.length == 3 && src->time_division > 0) {
+			uint32_t tempo = ((uint32_t)p->meta.bytes[0] << 16) |
+					((uint32_t)p->meta.bytes[1] << 8) | p->meta.bytes[2];
+			source_set_tempo(src, c->tick, tempo);
+		}
+		return;
+	}
+
+	if (p->midi.status == MIDI_STATUS_NOTE_ON && p->midi.param2 > 0) {
+		note_on(state, c->source, p->midi.channel, p->midi.param1);
+	} else if (p->midi.status == MIDI_STATUS_NOTE_OFF || p->midi.status == MIDI_STATUS_NOTE_ON) {
+		note_off(state, c->source, p->midi.channel, p->midi.param1);
+	}
+}
+
+static void player_silence(midi_state *state) {
+	for (int i = 0;i < TONE_CHANNELS;i++) {
+		state->voice[i].source = -1;
+		voice_set(i, &state->voice[i]);
+	}
+}
+
+static void player_thd(void *arg) {
+	midi_state *state = (midi_state*)arg;
+
+	uint32_t next_decay = DECAY_PERIOD_US;
+	uint32_t next_position = state->position_period_us;
+
+	while (!VESC_IF->should_terminate()) {
+		uint32_t now = (uint32_t)(VESC_IF->system_time_ticks() - state->start) *
+				(1000000 / SYSTEM_TICK_RATE_HZ);
+
+		// Play all events that are due in time order. The cursor with the
+		// earliest event is searched for every event, which merges the tracks.
+		uint32_t next_event = 0;
+		bool more = false;
+		for (;;) {
+			midi_cursor *first = 0;
+			uint32_t first_us = 0;
+			for (int i = 0;i < state->cursors;i++) {
+				midi_cursor *c = &state->cursor[i];
+				if (!c->pending) {
+					continue;
+				}
+
+				uint32_t us = source_tick_to_us(&state->source[c->source], c->tick);
+				if (!first || us < first_us) {
+					first = c;
+					first_us = us;
+				}
+			}
+
+			if (!first) {
+				break;
+			}
+
+			if (first_us > now) {
+				next_event = first_us;
+				more = true;
+				break;
+			}
+
+			play_event(state, first);
+			cursor_next(first);
+		}
+
+		if (!more) {
+			break;
+		}
+
+		if (now >= next_decay) {
+			for (int i = 0;i < TONE_CHANNELS;i++) {
+				midi_voice *v = &state->voice[i];
+				if (v->source >= 0) {
+					v->volts *= state->source[v->source].decay;
+					voice_set(i, v);
+				}
+			}
+			next_decay += DECAY_PERIOD_US;
+		}
+
+		if (state->position_period_us > 0 && now >= next_position) {
+			player_event(state, ENC_I(now / 1000));
+			next_position += state->position_period_us;
+		}
+
+		uint32_t wake = next_event < next_decay ? next_event : next_decay;
+		if (state->position_period_us > 0 && next_position < wake) {
+			wake = next_position;
+		}
+
+		uint32_t sleep = wake > now ? wake - now : 0;
+		if (sleep > MAX_SLEEP_US) {
+			sleep = MAX_SLEEP_US;
+		}
+
+		if (sleep > 0) {
+			VESC_IF->sleep_us(sleep);
+		}
+	}
+
+	player_silence(state);
+
+	// Stopping is reported by player_stop
+	if (state->playing && !VESC_IF->should_terminate()) {
+		state->playing = false;
+		player_event(state, ENC_SYM(state->sym_midi_end));
+	}
+}
+
+static void player_stop(midi_state *state) {
+	if (!state->thread) {
+		return;
+	}
+
+	bool was_playing = state->playing;
+	state->playing = false;
+
+	// Also joins a thread that returned at the end of the song
+	VESC_IF->request_terminate(state->thread);
+	state->thread = 0;
+
+	if (was_playing) {
+		player_event(state, ENC_SYM(state->sym_midi_stop));
+	}
+}
+
+static lbm_value ext_midi_play(lbm_value *args, lbm_uint argn) {
+	if (argn > 1 || (argn == 1 && !IS_NUMBER(args[0]))) {
+		VESC_IF->lbm_set_error_reason("Format: (ext-midi-play optPositionPeriod)");
+		return SYM_TERROR;
+	}
+
+	if (!ARG) {
+		VESC_IF->lbm_set_error_reason("Not initialized");
+		return SYM_EERROR;
+	}
+
+	if (!VESC_IF->foc_play_tone || !VESC_IF->lbm_unblock_ctx_unboxed) {
+		VESC_IF->lbm_set_error_reason("Firmware too old");
+		return SYM_EERROR;
+	}
+
+	midi_state *state = (midi_state*)ARG;
+	player_stop(state);
+
+	float period = argn == 1 ? DEC_F(args[0]) : 0.0;
+	state->position_period_us = period > 0.0 ? (uint32_t)(period * 1e6) : 0;
+
+	state->cursors = 0;
+	for (int i = 0;i < state->parsers;i++) {
+		player_add_source(state, i);
+	}
+
+	for (int i = 0;i < TONE_CHANNELS;i++) {
+		state->voice[i].source = -1;
+	}
+
+	VESC_IF->foc_stop_audio(true);
+
+	// Reported before the thread can report the end
+	state->playing = true;
+	player_event(state, ENC_SYM(state->sym_midi_start));
+
+	state->start = VESC_IF->system_time_ticks();
+	state->thread = VESC_IF->spawn(player_thd, 1024, "MidiPlayer", state);
+	if (!state->thread) {
+		state->playing = false;
+		player_event(state, ENC_SYM(state->sym_midi_stop));
+		return SYM_MERROR;
+	}
+
+	return SYM_TRUE;
+}
+
+static lbm_value ext_midi_stop(lbm_value *args, lbm_uint argn) {
+	(void)args; (void)argn;
+
+	if (ARG) {
+		player_stop((midi_state*)ARG);
+	}
+
+	return SYM_TRUE;
+}
+
+static lbm_value ext_midi_position(lbm_value *args, lbm_uint argn) {
+	(void)args; (void)argn;
+
+	midi_state *state = (midi_state*)ARG;
+	if (!state || !state->playing) {
+		return SYM_NIL;
+	}
+
+	return ENC_F(VESC_IF->ts_to_age_s(state->start));
+}
+
+static lbm_value ext_midi_wait_event(lbm_value *args, lbm_uint argn) {
+	(void)args; (void)argn;
+
+	midi_state *state = (midi_state*)ARG;
+	if (!state) {
+		return SYM_NIL;
+	}
+
+	lbm_value res = SYM_NIL;
+	VESC_IF->mutex_lock(state->lock);
+
+	if (state->event_count > 0) {
+		res = state->event[state->event_head];
+		state->event_head = (state->event_head + 1) % EVENT_QUEUE_LEN;
+		state->event_count--;
+	} else if (state->waiting) {
+		VESC_IF->mutex_unlock(state->lock);
+		VESC_IF->lbm_set_error_reason("Another thread is waiting");
+		return SYM_EERROR;
+	} else if (state->playing) {
+		// Unblocked with the next event by player_event
+		state->waiter = VESC_IF->lbm_get_current_cid();
+		state->waiting = true;
+		VESC_IF->lbm_block_ctx_from_extension();
+		res = SYM_TRUE;
+	}
+
+	VESC_IF->mutex_unlock(state->lock);
+	return res;
+}
+
+static void stop(void *arg) {
+	if (arg) {
+		midi_state *state = (midi_state*)arg;
+		state_free(state);
+	}
+}
+
 INIT_FUN(lib_info *info) {
 	INIT_START
 	info->arg = 0;
+	info->stop_fun = stop;
 
 	VESC_IF->lbm_add_extension("ext-midi-init", ext_midi_init);
 	VESC_IF->lbm_add_extension("ext-midi-open", ext_midi_open);
 	VESC_IF->lbm_add_extension("ext-midi-parse", ext_midi_parse);
+	VESC_IF->lbm_add_extension("ext-midi-play", ext_midi_play);
+	VESC_IF->lbm_add_extension("ext-midi-stop", ext_midi_stop);
+	VESC_IF->lbm_add_extension("ext-midi-position", ext_midi_position);
+	VESC_IF->lbm_add_extension("ext-midi-wait-event", ext_midi_wait_event);
 	return true;
 }
@@ -6,6 +6,25 @@
 (def vin-min 18)
 (def is-esc (eq (sysinfo 'hw-type) 'hw-esc))
 
+; The native sampler is built for the STM32 only, elsewhere the fields are
+; evaluated in Lisp
+(def use-sampler is-esc)
+
+(if use-sampler
+    (import "pkg::log_sampler@://vesc_packages/lib_log_sampler/log_sampler.vescpkg" 'log_sampler)
+)
+
+; Sampler frames are sent in batches at most this often, in seconds
+(def sampler-batch-time 0.02)
+
+; Frames taken from the sampler per call, limited by the memory of the lists
+(def sampler-batch-frames 8)
+
+; Binary logs are sent to this canmsg slot of the logger
+(def binlog-slot 2)
+; CAN id of the logger of the running binary log, -1 when there is none
+(def binlog-id -1)
+
 @const-start
 
 (defun has-dual-motors () {
@@ -186,7 +205,89 @@
             (sleep (/ 1.0 rate))
 )))
 
-(defun start-log (id append-gnss log-local log-can log-bms rate)
+; Sample time of the sampler frames, logged as the timestamp as the frames
+; are not sent when they are sampled
+(def sample-time-field '("t_sample" "s" "Sample Time" 4 nil t (sample-time)))
+
+; Sends the frames of the native sampler in batches. Fields the sampler
+; leaves to Lisp (e.g. the BMS values) are evaluated once per batch. The log
+; takes one frame per log-send-f32, but the frames are taken from the sampler
+; a block at a time.
+(defun log-thd-sampler (id rate lisp-fields) {
+        (var frames nil)
+        (loopwhile log-running {
+                (loopforeach f lisp-fields
+                    (ext-sampler-set (first f) (eval (second f)))
+                )
+                (loopwhile (setq frames (ext-sampler-pop-frames sampler-batch-frames))
+                    (loopforeach frame frames
+                        (log-send-f32 id 0 frame)
+                ))
+                (sleep (max (/ 1.0 rate) sampler-batch-time))
+        })
+})
+
+; Sends the frames of the native sampler as binary blocks to the logger,
+; see start-binlog
+(defun log-thd-binary (id rate lisp-fields) {
+        (var block nil)
+        (loopwhile log-running {
+                (loopforeach f lisp-fields
+                    (ext-sampler-set (first f) (eval (second f)))
+                )
+                (loopwhile (setq block (ext-sampler-pop-block))
+                    (canmsg-send id binlog-slot block)
+                )
+                (sleep (max (/ 1.0 rate) sampler-batch-time))
+        })
+})
+
+(defun sampler-config () {
+        (map
+            (fn (i) (list i (ix (ix loglist i) -1)))
+            (ext-sampler-config (map (fn (x) (ix x -1)) loglist))
+        )
+})
+
+; The binary log bypasses the log of the firmware: the header and blocks of
+; the sampler are sent to LogUI running on the logger, which writes them to
+; a file on its SD-card (see binlog-recv-thd). tools/vlog_decode.py of
+; lib_log_sampler converts the file to CSV.
+(defun start-binlog (id rate) {
+        (var meta ())
+        (loglist-parse 0 loglist
+            (fn (id row key name unit precision is-rel is-time)
+                (setq meta (cons (list key unit precision) meta))
+        ))
+
+        (var lisp-fields (sampler-config))
+        (canmsg-send id binlog-slot (ext-sampler-binary (reverse meta)))
+
+        (ext-sampler-start rate)
+        (def binlog-id id)
+        (def log-running true)
+        (def log-thd-id (spawn log-thd-binary id rate lisp-fields))
+})
+
+(defun start-sampler (id append-gnss rate) {
+        (log-configure id (cons sample-time-field loglist))
+
+        (var lisp-fields (sampler-config))
+
+        (log-start
+            id ; CAN id
+            (+ (length loglist) 1) ; Field num
+            rate ; Rate Hz
+            false ; Append time, the frames carry the sample time
+            append-gnss ; Append gnss
+        )
+
+        (ext-sampler-start rate)
+        (def log-running true)
+        (def log-thd-id (spawn log-thd-sampler id rate lisp-fields))
+})
+
+(defun start-log (id append-gnss log-local log-can log-bms rate binary)
     (progn
         (def last-can-id id)
         (stop-log id)
@@ -202,18 +303,27 @@
             (send-msg "Nothing to log. Make sure that everything on the CAN-bus has status messages enabled.")
 
             (progn
-                (log-configure id loglist)
-
-                (log-start
-                    id ; CAN id
-                    (length loglist) ; Field num
-                    rate ; Rate Hz
-                    true ; Append time
-                    append-gnss ; Append gnss
+                (if (and binary (not (and use-sampler (>= id 0))))
+                    (send-msg "The binary log needs a motor controller and a logger on the CAN-bus, logging normally.")
                 )
 
-                (def log-running true)
-                (def log-thd-id (spawn log-thd id rate loglist))
+                (cond
+                    ((and binary use-sampler (>= id 0)) (start-binlog id rate))
+                    (use-sampler (start-sampler id append-gnss rate))
+                    (true (progn
+                        (log-configure id loglist)
+
+                        (log-start
+                            id ; CAN id
+                            (length loglist) ; Field num
+                            rate ; Rate Hz
+                            true ; Append time
+                            append-gnss ; Append gnss
+                        )
+
+                        (def log-running true)
+                        (def log-thd-id (spawn log-thd id rate loglist))
+                )))
                 (send-data "Log Started")
         ))
 ))
@@ -223,11 +333,16 @@
         (if log-running {
                 (def log-running false)
                 (wait log-thd-id)
+                (if use-sampler (ext-sampler-stop))
+                (if (>= binlog-id 0) {
+                        (canmsg-send binlog-id binlog-slot "E")
+                        (def binlog-id -1)
+                })
                 (send-data "Log stopped")
         })
 })
 
-(defun save-config (id append-gnss log-local log-can log-bms rate at-boot) {
+(defun save-config (id append-gnss log-local log-can log-bms rate binary at-boot) {
         (write-setting 'can-id id)
         (write-setting 'log-at-boot at-boot)
         (write-setting 'log-rate rate)
@@ -235,6 +350,7 @@
         (write-setting 'log-local log-local)
         (write-setting 'log-can log-can)
         (write-setting 'log-bms log-bms)
+        (write-setting 'log-binary binary)
         (send-data "Settings Saved!")
 })
 
@@ -266,6 +382,7 @@
         (log-local   . (5 b))
         (log-can     . (6 b))
         (log-bms     . (7 b))
+        (log-binary  . (8 b))
 ))
 
 (defun print-settings ()
@@ -274,7 +391,7 @@
 ))
 
 ; Settings version
-(def settings-version 239i32)
+(def settings-version 240i32)
 
 (defun read-setting (name)
     (let (
@@ -306,6 +423,7 @@
         (write-setting 'log-local true)
         (write-setting 'log-can true)
         (write-setting 'log-bms false)
+        (write-setting 'log-binary false)
         (write-setting 'ver-code settings-version)
 })
 
@@ -319,13 +437,56 @@
             (if (read-setting 'log-local) "1 " "0 ")
             (if (read-setting 'log-can) "1 " "0 ")
             (if (read-setting 'log-bms) "1 " "0 ")
+            (if (read-setting 'log-binary) "1 " "0 ")
 )))
 
+; Writes the binary logs sent by LogUI on a motor controller to files on
+; the SD-card, log_0.vlog, log_1.vlog and so on.
+(defun binlog-file-name () {
+        (var n 0)
+        (var taken true)
+        (loopwhile taken {
+                (var f (f-open (str-from-n n "log_%d.vlog") "r"))
+                (if f {
+                        (f-close f)
+                        (setq n (+ n 1))
+                    }
+                    (setq taken false)
+                )
+        })
+        (str-from-n n "log_%d.vlog")
+})
+
+(defun binlog-recv-thd () {
+        (var fd nil)
+        (loopwhile t {
+                (var msg (canmsg-recv binlog-slot 1.0))
+                (if (eq (type-of msg) type-array)
+                    (cond
+                        ; 'V', the header, starts a new log
+                        ((= (bufget-u8 msg 0) 86) {
+                                (if fd (f-close fd))
+                                (setq fd (f-open (binlog-file-name) "w"))
+                                (if fd (f-write fd msg))
+                        })
+                        ; 'B', a block
+                        ((= (bufget-u8 msg 0) 66) (if fd (f-write fd msg)))
+                        ; 'E', the end
+                        ((= (bufget-u8 msg 0) 69) {
+                                (if fd (f-close fd))
+                                (setq fd nil)
+                        })
+                ))
+        })
+})
+
 (defun send-msg (text)
     (send-data (str-merge "msg " text))
 )
 
 (defun main () {
+        (if use-sampler (load-native-lib log_sampler))
+
         (if (has-dual-motors) {
                 (setq loglist-local (append
                         loglist-local
@@ -347,6 +508,8 @@
         (event-enable 'event-data-rx)
         (if is-esc (event-enable 'event-shutdown))
 
+        (if (not is-esc) (spawn binlog-recv-thd))
+
         ; Voltage monitor thread that stops logging if the voltage drops too low
         (loopwhile-thd 100 t {
                 (if (< (vin-hw) vin-min) {
@@ -372,6 +535,7 @@
                 (read-setting 'log-can)
                 (read-setting 'log-bms)
                 (read-setting 'log-rate)
+                (read-setting 'log-binary)
         ))
 })
 
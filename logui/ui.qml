@@ -89,12 +89,18 @@ Item {
                 id: logRate
                 Layout.fillWidth: true
                 realFrom: 1
-                realTo: 200
+                realTo: 1000
                 realValue: 10
                 decimals: 0
                 suffix: " Hz"
             }   
             
+            CheckBox {
+                Layout.columnSpan: 2
+                id: binaryLog
+                text: "Compact binary log"
+            }
+            
             CheckBox {
                 Layout.columnSpan: 2
                 id: startAtBoot
@@ -183,7 +189,8 @@ Item {
             localLog.checked + " " +
             canLog.checked + " " +
             bmsLog.checked + " " +
-            parseFloat(logRate.realValue).toFixed(2)
+            parseFloat(logRate.realValue).toFixed(2) + " " +
+            binaryLog.checked
     }
     
     function sendCode(str) {
@@ -205,6 +212,7 @@ Item {
                 localLog.checked = Number(tokens[5])
                 canLog.checked = Number(tokens[6])
                 bmsLog.checked = Number(tokens[7])
+                binaryLog.checked = Number(tokens[8])
             } else if (str.startsWith("msg ")) {
                 var msg = str.substring(4)
                 VescIf.emitMessageDialog("Logger", msg, false, false)
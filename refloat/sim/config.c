@@ -0,0 +1,123 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+// Config overrides from the command line, so that tune changes can be
+// evaluated without a config file round trip.
+
+#include "sim.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+    CFG_FLOAT,
+    CFG_U16,
+    CFG_U8,
+    CFG_INT,
+    CFG_BOOL,
+} CfgType;
+
+typedef struct {
+    const char *name;
+    size_t offset;
+    CfgType type;
+} CfgItem;
+
+#define CFG_TYPE(field)                                                                            \
+    _Generic(                                                                                      \
+        (field),                                                                                   \
+        float: CFG_FLOAT,                                                                          \
+        uint16_t: CFG_U16,                                                                         \
+        uint8_t: CFG_U8,                                                                           \
+        int: CFG_INT,                                                                              \
+        bool: CFG_BOOL                                                                             \
+    )
+
+#define CFG(name) {#name, offsetof(RefloatConfig, name), CFG_TYPE(((RefloatConfig *) 0)->name)},
+
+// clang-format off
+#define CFG_ITEMS                                                                                  \
+    CFG(kp) CFG(ki) CFG(kp2) CFG(mahony_kp) CFG(mahony_kp_roll) CFG(kp_brake) CFG(kp2_brake)       \
+    CFG(hertz) CFG(fault_pitch) CFG(fault_roll) CFG(fault_adc1) CFG(fault_adc2)                    \
+    CFG(fault_delay_pitch) CFG(fault_delay_roll) CFG(fault_delay_switch_half)                      \
+    CFG(fault_delay_switch_full) CFG(fault_adc_half_erpm) CFG(fault_is_dual_switch)                \
+    CFG(fault_moving_fault_disabled) CFG(fault_darkride_enabled) CFG(fault_reversestop_enabled)    \
+    CFG(tiltback_duty_angle) CFG(tiltback_duty_speed) CFG(tiltback_duty) CFG(tiltback_hv_angle)    \
+    CFG(tiltback_hv_speed) CFG(tiltback_hv) CFG(tiltback_lv_angle) CFG(tiltback_lv_speed)          \
+    CFG(tiltback_lv) CFG(tiltback_return_speed) CFG(tiltback_constant)                             \
+    CFG(tiltback_constant_erpm) CFG(tiltback_variable) CFG(tiltback_variable_max)                  \
+    CFG(tiltback_variable_erpm) CFG(noseangling_speed) CFG(startup_pitch_tolerance)                \
+    CFG(startup_roll_tolerance) CFG(startup_speed) CFG(startup_click_current)                      \
+    CFG(startup_simplestart_enabled) CFG(startup_pushstart_enabled) CFG(brake_current)             \
+    CFG(ki_limit) CFG(booster_angle) CFG(booster_ramp) CFG(booster_current)                        \
+    CFG(brkbooster_angle) CFG(brkbooster_ramp) CFG(brkbooster_current)                             \
+    CFG(torquetilt_start_current) CFG(torquetilt_angle_limit) CFG(torquetilt_on_speed)             \
+    CFG(torquetilt_off_speed) CFG(torquetilt_strength) CFG(torquetilt_strength_regen)              \
+    CFG(atr_strength_up) CFG(atr_strength_down) CFG(atr_threshold_up) CFG(atr_threshold_down)      \
+    CFG(atr_speed_boost) CFG(atr_angle_limit) CFG(atr_on_speed) CFG(atr_off_speed)                 \
+    CFG(atr_response_boost) CFG(atr_transition_boost) CFG(atr_filter) CFG(atr_amps_accel_ratio)    \
+    CFG(atr_amps_decel_ratio) CFG(braketilt_strength) CFG(braketilt_lingering)                     \
+    CFG(turntilt_strength) CFG(turntilt_angle_limit) CFG(turntilt_start_angle)                     \
+    CFG(turntilt_start_erpm) CFG(turntilt_speed) CFG(turntilt_erpm_boost)                          \
+    CFG(turntilt_erpm_boost_end) CFG(turntilt_yaw_aggregate) CFG(is_beeper_enabled)
+// clang-format on
+
+static const CfgItem cfg_items[] = {CFG_ITEMS};
+
+#define CFG_ITEM_COUNT (sizeof(cfg_items) / sizeof(CfgItem))
+
+bool config_override(RefloatConfig *cfg, const char *assignment) {
+    const char *eq = strchr(assignment, '=');
+    if (!eq) {
+        fprintf(stderr, "Invalid config override '%s', expected name=value\n", assignment);
+        return false;
+    }
+
+    size_t name_len = eq - assignment;
+    for (size_t i = 0; i < CFG_ITEM_COUNT; ++i) {
+        const CfgItem *item = &cfg_items[i];
+        if (strlen(item->name) != name_len || strncmp(item->name, assignment, name_len) != 0) {
+            continue;
+        }
+
+        double value = strtod(eq + 1, NULL);
+        void *field = (uint8_t *) cfg + item->offset;
+        switch (item->type) {
+        case CFG_FLOAT:
+            *(float *) field = value;
+            break;
+        case CFG_U16:
+            *(uint16_t *) field = value;
+            break;
+        case CFG_U8:
+            *(uint8_t *) field = value;
+            break;
+        case CFG_INT:
+            *(int *) field = value;
+            break;
+        case CFG_BOOL:
+            *(bool *) field = value != 0;
+            break;
+        }
+        return true;
+    }
+
+    fprintf(stderr, "Unknown config item '%.*s'\n", (int) name_len, assignment);
+    return false;
+}
@@ -0,0 +1,56 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+// The LED driver programs the timer, DMA and RCC registers directly. Instead
+// of stubbing it out, plain memory is mapped at the peripheral addresses, so
+// the real driver code runs and its register writes are simply stored.
+
+#define _GNU_SOURCE
+
+#include "sim.h"
+
+#include <sys/mman.h>
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+// APB1 (TIM3, TIM4) up to AHB1 (GPIO, RCC, DMA1)
+#define PERIPH_START 0x40000000UL
+#define PERIPH_END 0x40030000UL
+
+bool sim_peripherals_map(void) {
+    void *addr = (void *) PERIPH_START;
+    void *res = mmap(
+        addr,
+        PERIPH_END - PERIPH_START,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE,
+        -1,
+        0
+    );
+
+    if (res != addr) {
+        if (res != MAP_FAILED) {
+            munmap(res, PERIPH_END - PERIPH_START);
+        }
+        fprintf(stderr, "Failed to map peripheral memory at 0x%lx\n", PERIPH_START);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,689 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+// Host simulation of the Refloat package. Runs the unmodified package sources
+// against a simulated VESC_IF, driven by an IMU / motor trace, and writes the
+// control loop outputs into a CSV file.
+
+#include "sim.h"
+
+#include "conf/confparser.h"
+#include "utils/utils.h"
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Refloat's time.h has its own time_t, which clashes with the libc one
+#define time_t refloat_time_t
+#include "data.h"
+#undef time_t
+
+#define MAX_OVERRIDES 64
+#define MAX_RECORD_REQUESTS 16
+#define MAX_EVENTS 16
+#define COMMAND_PROFILER 44
+#define COMMAND_LOOP_TIMER 45
+#define COMMAND_DATA_RECORD_REQUEST 41
+#define COMMAND_DATA_RECORD_HEADER 42
+#define COMMAND_DATA_RECORD_DATA 43
+#define COMMAND_DATA_RECORD_FRAME 46
+#define SYNTHETIC_TRACE_RATE 1000.0f
+
+typedef struct {
+    FILE *out;
+    uint64_t last_command_count;
+} Output;
+
+static void usage(const char *name) {
+    fprintf(
+        stderr,
+        "Usage: %s [options]\n"
+        "  -t FILE        input trace CSV (default: synthetic ride)\n"
+        "  -d SECONDS     duration of the synthetic ride (default: 10)\n"
+        "  -o FILE        write control loop outputs to a CSV file\n"
+        "  -i HZ          IMU sample rate (default: 1000)\n"
+        "  -x FACTOR      charge host CPU time times FACTOR to simulated time\n"
+        "                 (default: 0, the package runs in zero time)\n"
+        "  -p NAME=VALUE  override a config item, can be repeated\n"
+        "  -P             enable the main loop profiler, print its and loop timer stats\n"
+        "  -r FILE        download the data record at the end into FILE, for\n"
+        "                 tools/data_record.py to decode\n"
+        "  -z             use the compressed data record encoding\n"
+        "  -b WINDOW      download the data record in bulk, WINDOW frames at a time\n"
+        "  -L N           drop every Nth frame of the bulk download\n"
+        "  -R SUB=VALUE   send a data record control request before the ride,\n"
+        "                 can be repeated\n"
+        "  -F SECONDS     tip the board over into a pitch fault at SECONDS\n"
+        "  -W SECONDS     spin the wheel up into a wheelslip at SECONDS\n"
+        "  -q             don't print package log messages\n",
+        name
+    );
+}
+
+static void on_yield(SimThread *thread, uint64_t cost_ns, void *data) {
+    Output *output = data;
+    Data *d = sim.arg;
+    if (!output->out || !d || thread != (SimThread *) d->main_thread) {
+        return;
+    }
+
+    // only the main loop iterations are written, one row per iteration
+    const char *command = "none";
+    if (sim.motor_command.count != output->last_command_count) {
+        static const char *const names[] = {"none", "current", "brake", "duty", "release"};
+        command = names[sim.motor_command.type];
+        output->last_command_count = sim.motor_command.count;
+    }
+
+    fprintf(
+        output->out,
+        "%.6f,%d,%.4f,%.4f,%.4f,%.4f,%s,%.4f,%.3f\n",
+        sim.now_us / 1e6,
+        d->state.state,
+        (double) d->imu.pitch,
+        (double) d->imu.balance_pitch,
+        (double) d->setpoint,
+        (double) d->balance_current,
+        command,
+        (double) sim.motor_command.value,
+        cost_ns / 1e3
+    );
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+static void print_stats(float duration) {
+    fprintf(
+        stderr,
+        "%-16s %10s %9s %9s %9s %9s %9s\n",
+        "thread",
+        "iterations",
+        "min[us]",
+        "mean[us]",
+        "p99[us]",
+        "max[us]",
+        "rate[Hz]"
+    );
+
+    for (SimThread *t = sim.threads; t; t = sim_thread_next(t)) {
+        SimThreadStats *stats = sim_thread_stats(t);
+        if (stats->iterations == 0) {
+            continue;
+        }
+
+        qsort(stats->cost_ns, stats->iterations, sizeof(uint64_t), compare_u64);
+        uint64_t sum = 0;
+        for (size_t i = 0; i < stats->iterations; ++i) {
+            sum += stats->cost_ns[i];
+        }
+
+        fprintf(
+            stderr,
+            "%-16s %10lu %9.2f %9.2f %9.2f %9.2f %9.1f\n",
+            stats->name,
+            (unsigned long) stats->iterations,
+            stats->cost_ns[0] / 1e3,
+            (double) sum / stats->iterations / 1e3,
+            stats->cost_ns[stats->iterations * 99 / 100] / 1e3,
+            stats->cost_ns[stats->iterations - 1] / 1e3,
+            (double) (stats->iterations / duration)
+        );
+    }
+}
+
+static void send_command(uint8_t command, uint8_t *data, unsigned int len) {
+    uint8_t buffer[64] = {101, command};
+    memcpy(&buffer[2], data, len);
+    sim.app_data_handler(buffer, len + 2);
+}
+
+static uint32_t get_u32(const uint8_t **buffer) {
+    const uint8_t *b = *buffer;
+    *buffer += 4;
+    return (uint32_t) b[0] << 24 | (uint32_t) b[1] << 16 | (uint32_t) b[2] << 8 | b[3];
+}
+
+static void print_profiler_stats(unsigned char *data, unsigned int len) {
+    if (len < 8 || data[0] != 101 || data[1] != COMMAND_PROFILER) {
+        return;
+    }
+
+    const uint8_t *b = &data[3];
+    double tick_us = 1e6 / get_u32(&b);
+    uint8_t stage_count = *b++;
+
+    fprintf(
+        stderr,
+        "%-16s %10s %9s %9s %9s %9s\n",
+        "stage",
+        "count",
+        "min[us]",
+        "mean[us]",
+        "p99[us]",
+        "max[us]"
+    );
+    for (uint8_t i = 0; i < stage_count; ++i) {
+        uint8_t name_len = *b++;
+        const char *name = (const char *) b;
+        b += name_len;
+        uint32_t count = get_u32(&b);
+        uint32_t min = get_u32(&b);
+        uint32_t mean = get_u32(&b);
+        uint32_t p99 = get_u32(&b);
+        uint32_t max = get_u32(&b);
+        fprintf(
+            stderr,
+            "%-16.*s %10u %9.2f %9.2f %9.2f %9.2f\n",
+            name_len,
+            name,
+            count,
+            min * tick_us,
+            mean * tick_us,
+            p99 * tick_us,
+            max * tick_us
+        );
+    }
+}
+
+static void print_loop_timer_stats(unsigned char *data, unsigned int len) {
+    if (len < 30 || data[0] != 101 || data[1] != COMMAND_LOOP_TIMER) {
+        return;
+    }
+
+    const uint8_t *b = &data[2];
+    uint32_t period = get_u32(&b);
+    uint32_t iterations = get_u32(&b);
+    uint32_t overruns = get_u32(&b);
+    uint32_t missed = get_u32(&b);
+    uint32_t lateness_mean = get_u32(&b);
+    uint32_t lateness_max = get_u32(&b);
+    uint32_t busy_max = get_u32(&b);
+    fprintf(
+        stderr,
+        "loop timer: period %uus, %u iterations, %u overruns, %u missed deadlines, "
+        "lateness mean %uus max %uus, busy max %uus\n",
+        period,
+        iterations,
+        overruns,
+        missed,
+        lateness_mean,
+        lateness_max,
+        busy_max
+    );
+}
+
+typedef struct {
+    FILE *out;
+    uint32_t size;
+    uint8_t value_count;
+    uint8_t encoding;
+    // number of items (samples or blocks) in the last data response
+    uint32_t received;
+
+    // bulk download
+    uint16_t frame_count;
+    bool *frames_received;
+    int32_t highest_received;
+    uint32_t frame_messages;
+    uint32_t drop_every;
+    uint32_t dropped;
+    uint32_t corrupted;
+} RecordDownload;
+
+static RecordDownload download;
+
+static uint16_t get_u16(const uint8_t **buffer) {
+    const uint8_t *b = *buffer;
+    *buffer += 2;
+    return b[0] << 8 | b[1];
+}
+
+// Checks a bulk download frame, returns false if it's dropped or corrupted.
+static bool store_frame(unsigned char *data, unsigned int len) {
+    if (download.drop_every > 0 && ++download.frame_messages % download.drop_every == 0) {
+        ++download.dropped;
+        return false;
+    }
+
+    if (len < 14) {
+        ++download.corrupted;
+        return false;
+    }
+
+    const uint8_t *b = &data[len - 4];
+    if (utils_crc32c(&data[2], len - 6) != get_u32(&b)) {
+        ++download.corrupted;
+        return false;
+    }
+
+    b = &data[2];
+    uint16_t seq = get_u16(&b);
+    uint16_t frame_count = get_u16(&b);
+    if (!download.frames_received) {
+        download.frame_count = frame_count;
+        download.frames_received = calloc(frame_count, sizeof(bool));
+    }
+    if (seq >= download.frame_count) {
+        ++download.corrupted;
+        return false;
+    }
+
+    download.frames_received[seq] = true;
+    if (seq > download.highest_received) {
+        download.highest_received = seq;
+    }
+    return true;
+}
+
+static void store_record_message(unsigned char *data, unsigned int len) {
+    if (len < 2 || data[0] != 101) {
+        return;
+    }
+
+    if (data[1] == COMMAND_DATA_RECORD_FRAME && !store_frame(data, len)) {
+        return;
+    }
+
+    uint8_t prefix[2] = {len >> 8, len};
+    fwrite(prefix, 1, sizeof(prefix), download.out);
+    fwrite(data, 1, len, download.out);
+
+    if (data[1] == COMMAND_DATA_RECORD_HEADER) {
+        const uint8_t *b = &data[2];
+        download.size = get_u32(&b);
+        download.value_count = *b++;
+        for (uint8_t i = 0; i < download.value_count; ++i) {
+            b += *b + 1;
+        }
+        download.encoding = b < data + len ? *b : 0;
+    } else if (data[1] == COMMAND_DATA_RECORD_DATA) {
+        download.received = 0;
+        if (download.encoding == 0) {
+            download.received = (len - 6) / (5 + 2 * download.value_count);
+            return;
+        }
+        for (unsigned int i = 6; i + 1 < len; i += data[i] << 8 | data[i + 1]) {
+            ++download.received;
+        }
+    }
+}
+
+static bool download_record(const char *path) {
+    download.out = fopen(path, "wb");
+    if (!download.out) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return false;
+    }
+
+    sim.app_data_sink = store_record_message;
+    uint8_t header[] = {2, 1};
+    send_command(COMMAND_DATA_RECORD_REQUEST, header, sizeof(header));
+
+    uint32_t offset = 0;
+    while (offset < download.size) {
+        uint8_t request[] = {2, 2, offset >> 24, offset >> 16, offset >> 8, offset};
+        download.received = 0;
+        send_command(COMMAND_DATA_RECORD_REQUEST, request, sizeof(request));
+        if (download.received == 0) {
+            break;
+        }
+        offset += download.received;
+    }
+    sim.app_data_sink = NULL;
+
+    fclose(download.out);
+    fprintf(stderr, "data record: %u %s downloaded\n", offset, download.encoding ? "blocks" : "samples");
+    return true;
+}
+
+static void send_frame_request(uint8_t sub_mode, uint16_t seq, uint8_t count) {
+    uint8_t request[] = {2, sub_mode, seq >> 8, seq, count};
+    send_command(COMMAND_DATA_RECORD_REQUEST, request, sub_mode == 5 ? 5 : 4);
+}
+
+// Downloads the record in bulk the way a client would: acknowledges the
+// received frames to get the next window and requests retransmits of the
+// frames missing before the highest received one.
+static bool download_record_bulk(const char *path, uint8_t window, uint32_t drop_every) {
+    download.out = fopen(path, "wb");
+    if (!download.out) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return false;
+    }
+
+    download.drop_every = drop_every;
+    download.highest_received = -1;
+    sim.app_data_sink = store_record_message;
+    uint8_t start[] = {2, 3, window};
+    send_command(COMMAND_DATA_RECORD_REQUEST, start, sizeof(start));
+
+    uint32_t retransmits = 0;
+    for (int i = 0; download.frames_received && i < 100000; ++i) {
+        uint16_t missing = 0;
+        while (missing < download.frame_count && download.frames_received[missing]) {
+            ++missing;
+        }
+
+        if (missing == download.frame_count) {
+            send_frame_request(4, missing, 0);
+            break;
+        }
+
+        if (missing < download.highest_received) {
+            uint16_t end = missing;
+            while (!download.frames_received[end]) {
+                ++end;
+            }
+            send_frame_request(5, missing, end - missing);
+            ++retransmits;
+        } else {
+            send_frame_request(4, missing, 0);
+        }
+    }
+    sim.app_data_sink = NULL;
+
+    fclose(download.out);
+    fprintf(
+        stderr,
+        "data record: %u frames downloaded, %u retransmits, %u dropped, %u corrupted\n",
+        download.frame_count,
+        retransmits,
+        download.dropped,
+        download.corrupted
+    );
+    free(download.frames_received);
+    return true;
+}
+
+typedef struct {
+    uint8_t sub_mode;
+    uint32_t value;
+} RecordRequest;
+
+typedef struct {
+    const char *path;
+    bool compressed;
+    uint8_t bulk_window;
+    uint32_t drop_every;
+    RecordRequest requests[MAX_RECORD_REQUESTS];
+    int request_count;
+    bool ok;
+} RecordClient;
+
+static bool parse_record_request(RecordClient *client, const char *arg) {
+    char *end;
+    unsigned long sub_mode = strtoul(arg, &end, 10);
+    if (*end != '=' || sub_mode == 0 || sub_mode > UINT8_MAX ||
+        client->request_count >= MAX_RECORD_REQUESTS) {
+        fprintf(stderr, "Invalid data record request: %s\n", arg);
+        return false;
+    }
+
+    RecordRequest *request = &client->requests[client->request_count++];
+    request->sub_mode = sub_mode;
+    request->value = strtoul(end + 1, NULL, 0);
+    return true;
+}
+
+static void send_record_request(const RecordRequest *request) {
+    // the value has the size the package expects for the sub-mode
+    uint8_t data[6] = {1, request->sub_mode};
+    unsigned int len = 2;
+    uint32_t value = request->value;
+    if (request->sub_mode == 9) {
+        data[len++] = value >> 24;
+        data[len++] = value >> 16;
+    }
+    if (request->sub_mode == 6 || request->sub_mode == 8 || request->sub_mode == 9) {
+        data[len++] = value >> 8;
+    }
+    data[len++] = value;
+    send_command(COMMAND_DATA_RECORD_REQUEST, data, len);
+}
+
+// The data record requests wait for the main loop, so they're sent from a
+// thread (see sim_run_in_thread), like the firmware handles commands
+static void send_record_requests(void *arg) {
+    RecordClient *client = arg;
+    if (client->compressed) {
+        send_record_request(&(RecordRequest){.sub_mode = 4, .value = 1});
+    }
+    for (int i = 0; i < client->request_count; ++i) {
+        send_record_request(&client->requests[i]);
+    }
+}
+
+static void stop_and_download_record(void *arg) {
+    RecordClient *client = arg;
+    uint8_t stop[] = {1, 1, 0};
+    send_command(COMMAND_DATA_RECORD_REQUEST, stop, sizeof(stop));
+    client->ok = client->bulk_window > 0
+                     ? download_record_bulk(client->path, client->bulk_window, client->drop_every)
+                     : download_record(client->path);
+}
+
+// The package reads its config from EEPROM on init. Serialize the defaults
+// with the overrides applied and store them there, the same way writing the
+// config from VESC Tool would.
+static bool store_config(const char **overrides, int override_count) {
+    RefloatConfig cfg;
+    confparser_set_defaults_refloatconfig(&cfg);
+    cfg.meta.is_default = false;
+    for (int i = 0; i < override_count; ++i) {
+        if (!config_override(&cfg, overrides[i])) {
+            return false;
+        }
+    }
+
+    uint32_t buffer[SIM_EEPROM_VARS] = {0};
+    int32_t len = confparser_serialize_refloatconfig((uint8_t *) buffer, &cfg);
+    if (len <= 0 || (size_t) len > sizeof(buffer)) {
+        fprintf(stderr, "Failed to serialize config\n");
+        return false;
+    }
+
+    // fill the whole EEPROM, the package always reads the maximum config size
+    for (int32_t i = 0; i < SIM_EEPROM_VARS; ++i) {
+        eeprom_var v = {.as_u32 = buffer[i]};
+        VESC_IF->store_eeprom_var(&v, i);
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const char *trace_path = NULL;
+    const char *out_path = NULL;
+    const char *overrides[MAX_OVERRIDES];
+    int override_count = 0;
+    float duration = 10.0f;
+    bool profile = false;
+    const char *record_path = NULL;
+    bool compressed_record = false;
+    uint8_t bulk_window = 0;
+    uint32_t drop_every = 0;
+    RecordClient record = {0};
+    float faults[MAX_EVENTS];
+    int fault_count = 0;
+    float wheelslips[MAX_EVENTS];
+    int wheelslip_count = 0;
+
+    sim.imu_rate = 1000;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:d:o:i:x:p:Pr:zb:L:R:F:W:qh")) != -1) {
+        switch (opt) {
+        case 't':
+            trace_path = optarg;
+            break;
+        case 'd':
+            duration = strtof(optarg, NULL);
+            break;
+        case 'o':
+            out_path = optarg;
+            break;
+        case 'i':
+            sim.imu_rate = strtoul(optarg, NULL, 10);
+            break;
+        case 'x':
+            sim.cost_factor = strtof(optarg, NULL);
+            break;
+        case 'p':
+            if (override_count >= MAX_OVERRIDES) {
+                fprintf(stderr, "Too many config overrides\n");
+                return 1;
+            }
+            overrides[override_count++] = optarg;
+            break;
+        case 'P':
+            profile = true;
+            break;
+        case 'r':
+            record_path = optarg;
+            break;
+        case 'z':
+            compressed_record = true;
+            break;
+        case 'b':
+            bulk_window = strtoul(optarg, NULL, 10);
+            break;
+        case 'L':
+            drop_every = strtoul(optarg, NULL, 10);
+            break;
+        case 'R':
+            if (!parse_record_request(&record, optarg)) {
+                return 1;
+            }
+            break;
+        case 'F':
+        case 'W':
+            if ((opt == 'F' ? fault_count : wheelslip_count) >= MAX_EVENTS) {
+                fprintf(stderr, "Too many events\n");
+                return 1;
+            }
+            if (opt == 'F') {
+                faults[fault_count++] = strtof(optarg, NULL);
+            } else {
+                wheelslips[wheelslip_count++] = strtof(optarg, NULL);
+            }
+            break;
+        case 'q':
+            sim.quiet = true;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    bool trace_ok = trace_path ? trace_load_csv(&sim.trace, trace_path)
+                               : trace_generate(&sim.trace, duration, SYNTHETIC_TRACE_RATE);
+    if (!trace_ok) {
+        return 1;
+    }
+    for (int i = 0; i < fault_count; ++i) {
+        trace_add_fault(&sim.trace, faults[i]);
+    }
+    for (int i = 0; i < wheelslip_count; ++i) {
+        trace_add_wheelslip(&sim.trace, wheelslips[i]);
+    }
+    sim.input = trace_sample(&sim.trace, 0);
+    duration = trace_duration(&sim.trace);
+
+    if (!sim_peripherals_map()) {
+        return 1;
+    }
+
+    sim_vesc_if_init();
+    if (!store_config(overrides, override_count)) {
+        return 1;
+    }
+
+    Output output = {0};
+    if (out_path) {
+        output.out = fopen(out_path, "w");
+        if (!output.out) {
+            fprintf(stderr, "Failed to open %s\n", out_path);
+            return 1;
+        }
+        fprintf(
+            output.out,
+            "t,state,pitch,balance_pitch,setpoint,balance_current,motor_command,motor_value,"
+            "cost_us\n"
+        );
+    }
+
+    lib_info info = {0};
+    if (!package_init(&info)) {
+        fprintf(stderr, "Package init failed\n");
+        return 1;
+    }
+    // the firmware stores the package argument for ARG after init
+    sim.arg = info.arg;
+
+    if (profile) {
+        uint8_t enable[] = {1, 1};
+        send_command(COMMAND_PROFILER, enable, sizeof(enable));
+    }
+
+    record.path = record_path;
+    record.compressed = compressed_record;
+    record.bulk_window = bulk_window;
+    record.drop_every = drop_every;
+    if (compressed_record || record.request_count > 0) {
+        sim_run_in_thread(send_record_requests, &record, on_yield, &output);
+    }
+
+    sim_run(duration * 1e6, on_yield, &output);
+
+    if (record_path) {
+        sim_run_in_thread(stop_and_download_record, &record, NULL, NULL);
+        if (!record.ok) {
+            return 1;
+        }
+    }
+
+    if (profile) {
+        uint8_t send_stats[] = {3};
+        sim.app_data_sink = print_profiler_stats;
+        send_command(COMMAND_PROFILER, send_stats, sizeof(send_stats));
+        sim.app_data_sink = print_loop_timer_stats;
+        uint8_t send_loop_stats[] = {2};
+        send_command(COMMAND_LOOP_TIMER, send_loop_stats, sizeof(send_loop_stats));
+        sim.app_data_sink = NULL;
+    }
+
+    sim_terminate_threads();
+    if (info.stop_fun) {
+        info.stop_fun(info.arg);
+    }
+    sim.arg = NULL;
+
+    print_stats(duration);
+
+    if (output.out) {
+        fclose(output.out);
+    }
+    sim_free_threads();
+    sim_vesc_if_destroy();
+    trace_free(&sim.trace);
+    return 0;
+}
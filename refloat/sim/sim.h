@@ -0,0 +1,206 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "conf/datatypes.h"
+
+#include "vesc_c_if.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Inputs of the simulated board, sampled from a trace at the current
+// simulation time. Angles are in degrees, angular rates in degrees per
+// second and accelerations in g.
+typedef struct {
+    float t;
+    float pitch, roll, yaw;
+    float gyro[3];
+    float acc[3];
+    float erpm;
+    float current;
+    float current_in;
+    float duty;
+    float voltage;
+    float adc1, adc2;
+    float remote;
+    float temp_fet, temp_motor;
+} SimInput;
+
+typedef enum {
+    MOTOR_CMD_NONE = 0,
+    MOTOR_CMD_CURRENT,
+    MOTOR_CMD_BRAKE,
+    MOTOR_CMD_DUTY,
+    MOTOR_CMD_RELEASE,
+} MotorCommandType;
+
+typedef struct {
+    MotorCommandType type;
+    float value;
+    uint32_t count;
+} MotorCommand;
+
+typedef struct {
+    SimInput *samples;
+    size_t count;
+    size_t position;
+} Trace;
+
+/**
+ * Loads a CSV trace. The first line is a header with column names, columns
+ * with unknown names are ignored and missing columns are left zeroed, except
+ * for gyro and acc, which are derived from the angles if missing.
+ */
+bool trace_load_csv(Trace *trace, const char *path);
+
+/**
+ * Generates a deterministic synthetic ride of @p duration seconds sampled at
+ * @p rate Hz: mount, a ride with pitch oscillations and a speed ramp and a
+ * dismount at the end.
+ */
+bool trace_generate(Trace *trace, float duration, float rate);
+
+/**
+ * Returns the sample valid at time @p t (zero-order hold).
+ */
+/**
+ * Tips the board over at time @p t: the pitch goes to 80 degrees in 0.1s and
+ * stays there, so that the package stops on a pitch fault.
+ */
+void trace_add_fault(Trace *trace, float t);
+
+/**
+ * Spins the wheel up at time @p t: the ERPM rises by 3000 in 0.1s at a high
+ * duty cycle and drops back, so that the package detects a wheelslip.
+ */
+void trace_add_wheelslip(Trace *trace, float t);
+
+const SimInput *trace_sample(Trace *trace, float t);
+
+float trace_duration(const Trace *trace);
+
+void trace_free(Trace *trace);
+
+// Number of 32-bit EEPROM variables of the simulated board
+#define SIM_EEPROM_VARS 256
+
+typedef struct SimThread SimThread;
+
+typedef struct {
+    // Simulated time in microseconds
+    uint64_t now_us;
+    // Simulated time charged per nanosecond of host CPU time spent in a
+    // thread, 0 means the threads run in zero simulated time
+    float cost_factor;
+
+    SimThread *threads;
+    SimThread *current;
+
+    uint32_t imu_rate;
+    void (*imu_callback)(float *acc, float *gyro, float *mag, float dt);
+
+    void (*app_data_handler)(unsigned char *data, unsigned int len);
+    void (*app_data_sink)(unsigned char *data, unsigned int len);
+
+    Trace trace;
+    const SimInput *input;
+
+    MotorCommand motor_command;
+    uint32_t tone_count;
+
+    void *arg;
+    bool quiet;
+} Sim;
+
+extern Sim sim;
+
+void sim_vesc_if_init(void);
+
+void sim_vesc_if_destroy(void);
+
+/**
+ * Maps memory at the address range of the STM32 peripherals the package
+ * accesses directly, so that the hardware register writes land in plain
+ * memory.
+ */
+bool sim_peripherals_map(void);
+
+/**
+ * Sets a config item from a "name=value" string.
+ */
+bool config_override(RefloatConfig *cfg, const char *assignment);
+
+lib_thread sim_thread_spawn(void (*fun)(void *arg), size_t stack_size, const char *name, void *arg);
+
+void sim_thread_request_terminate(lib_thread thread);
+
+bool sim_thread_should_terminate(void);
+
+void sim_thread_sleep_us(uint32_t us);
+
+/**
+ * Returns the simulated time. Called from a thread, the host CPU time it has
+ * spent since it was resumed is charged to the clock first (see cost_factor),
+ * so that the package sees the time advance while it runs.
+ */
+uint64_t sim_now_us(void);
+
+typedef struct {
+    const char *name;
+    uint64_t iterations;
+    // Host CPU time of each iteration (work done between two sleeps)
+    uint64_t *cost_ns;
+    size_t cost_capacity;
+} SimThreadStats;
+
+/**
+ * Called after a thread has yielded (went to sleep or terminated), with the
+ * host time in nanoseconds the thread has spent running.
+ */
+typedef void (*SimYieldCallback)(SimThread *thread, uint64_t cost_ns, void *data);
+
+/**
+ * Runs the simulation until @p end_us of simulated time, calling the IMU
+ * callback at imu_rate and resuming the threads according to their sleeps.
+ */
+void sim_run(uint64_t end_us, SimYieldCallback on_yield, void *data);
+
+/**
+ * Runs @p fun in a thread and the simulation along with it until it returns.
+ * For client commands which the package handles on a firmware thread and which
+ * wait for the package threads.
+ */
+void sim_run_in_thread(void (*fun)(void *arg), void *arg, SimYieldCallback on_yield, void *data);
+
+/**
+ * Requests all threads to terminate and resumes them until they finish.
+ */
+void sim_terminate_threads(void);
+
+const char *sim_thread_name(const SimThread *thread);
+
+/**
+ * Returns the thread spawned after @p thread, iterate from sim.threads.
+ */
+SimThread *sim_thread_next(const SimThread *thread);
+
+SimThreadStats *sim_thread_stats(SimThread *thread);
+
+void sim_free_threads(void);
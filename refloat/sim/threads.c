@@ -0,0 +1,289 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+// Package threads are run as coroutines on a single host thread. A thread
+// runs until it sleeps, then the scheduler advances the simulated clock to the
+// earliest pending event (a thread wakeup or an IMU sample). This makes the
+// simulation fully deterministic regardless of the host load.
+
+#include "sim.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ucontext.h>
+
+// Stack sizes requested by the package are sized for the MCU, host code
+// (libc printf in particular) needs a lot more.
+#define SIM_STACK_SIZE (256 * 1024)
+
+struct SimThread {
+    ucontext_t context;
+    void *stack;
+    void (*fun)(void *arg);
+    void *arg;
+    uint64_t wake_us;
+    bool terminate;
+    bool finished;
+    SimThreadStats stats;
+    SimThread *next;
+};
+
+static ucontext_t scheduler_context;
+
+// Host time up to which the running thread has been charged, and the
+// charged simulated time below a microsecond
+static uint64_t charged_ns;
+static uint64_t charge_remainder_ns;
+
+// Time of the next IMU sample, kept across sim_run calls so that running the
+// simulation in parts doesn't shift the samples
+static uint64_t imu_next_us;
+static bool imu_started;
+
+static uint64_t host_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void thread_trampoline(void) {
+    SimThread *thread = sim.current;
+    thread->fun(thread->arg);
+    thread->finished = true;
+    // returns to scheduler_context through uc_link
+}
+
+static void init_context(SimThread *thread) {
+    getcontext(&thread->context);
+    thread->context.uc_stack.ss_sp = thread->stack;
+    thread->context.uc_stack.ss_size = SIM_STACK_SIZE;
+    thread->context.uc_link = &scheduler_context;
+    makecontext(&thread->context, thread_trampoline, 0);
+}
+
+lib_thread sim_thread_spawn(void (*fun)(void *arg), size_t stack_size, const char *name, void *arg) {
+    (void) stack_size;
+
+    SimThread *thread = calloc(1, sizeof(SimThread));
+    if (!thread) {
+        return NULL;
+    }
+
+    thread->stack = malloc(SIM_STACK_SIZE);
+    if (!thread->stack) {
+        free(thread);
+        return NULL;
+    }
+
+    thread->fun = fun;
+    thread->arg = arg;
+    thread->wake_us = sim.now_us;
+    thread->stats.name = name;
+
+    init_context(thread);
+
+    // append to keep the spawn order, which is the tie-breaker in scheduling
+    SimThread **tail = &sim.threads;
+    while (*tail) {
+        tail = &(*tail)->next;
+    }
+    *tail = thread;
+
+    return thread;
+}
+
+static void charge_cost(uint64_t now_ns) {
+    if (sim.cost_factor > 0) {
+        charge_remainder_ns += (uint64_t) ((now_ns - charged_ns) * sim.cost_factor);
+        sim.now_us += charge_remainder_ns / 1000;
+        charge_remainder_ns %= 1000;
+    }
+    charged_ns = now_ns;
+}
+
+uint64_t sim_now_us(void) {
+    if (sim.current) {
+        charge_cost(host_now_ns());
+    }
+    return sim.now_us;
+}
+
+void sim_thread_request_terminate(lib_thread thread) {
+    ((SimThread *) thread)->terminate = true;
+}
+
+bool sim_thread_should_terminate(void) {
+    return sim.current && sim.current->terminate;
+}
+
+void sim_thread_sleep_us(uint32_t us) {
+    SimThread *thread = sim.current;
+    if (!thread) {
+        // called from the init function or an IMU callback, nothing to yield to
+        sim.now_us += us;
+        return;
+    }
+
+    thread->wake_us = sim_now_us() + us;
+    swapcontext(&thread->context, &scheduler_context);
+}
+
+static void record_cost(SimThreadStats *stats, uint64_t cost_ns) {
+    if (stats->iterations >= stats->cost_capacity) {
+        size_t capacity = stats->cost_capacity ? stats->cost_capacity * 2 : 4096;
+        uint64_t *cost_ns = realloc(stats->cost_ns, capacity * sizeof(uint64_t));
+        if (!cost_ns) {
+            return;
+        }
+        stats->cost_ns = cost_ns;
+        stats->cost_capacity = capacity;
+    }
+    stats->cost_ns[stats->iterations++] = cost_ns;
+}
+
+static void resume(SimThread *thread, SimYieldCallback on_yield, void *data) {
+    sim.current = thread;
+    uint64_t start = host_now_ns();
+    charged_ns = start;
+    swapcontext(&scheduler_context, &thread->context);
+    uint64_t end = host_now_ns();
+    uint64_t cost_ns = end - start;
+    charge_cost(end);
+    sim.current = NULL;
+
+    record_cost(&thread->stats, cost_ns);
+    if (!thread->finished && thread->wake_us < sim.now_us) {
+        thread->wake_us = sim.now_us;
+    }
+
+    if (on_yield) {
+        on_yield(thread, cost_ns, data);
+    }
+}
+
+static SimThread *next_thread(void) {
+    SimThread *next = NULL;
+    for (SimThread *t = sim.threads; t; t = t->next) {
+        if (!t->finished && (!next || t->wake_us < next->wake_us)) {
+            next = t;
+        }
+    }
+    return next;
+}
+
+void sim_run(uint64_t end_us, SimYieldCallback on_yield, void *data) {
+    const uint64_t imu_period_us = sim.imu_rate > 0 ? 1000000 / sim.imu_rate : 0;
+    if (!imu_started) {
+        imu_next_us = sim.now_us;
+        imu_started = true;
+    }
+
+    while (sim.now_us < end_us) {
+        SimThread *thread = next_thread();
+        uint64_t thread_wake_us = thread ? thread->wake_us : UINT64_MAX;
+
+        if (sim.imu_callback && imu_period_us > 0 && imu_next_us <= thread_wake_us) {
+            // IMU samples take precedence over threads waking at the same time,
+            // like the IMU interrupt would
+            if (imu_next_us >= end_us) {
+                break;
+            }
+            if (imu_next_us > sim.now_us) {
+                sim.now_us = imu_next_us;
+            }
+            sim.input = trace_sample(&sim.trace, sim.now_us * 1e-6f);
+
+            float acc[3], gyro[3], mag[3] = {0};
+            for (int i = 0; i < 3; ++i) {
+                acc[i] = sim.input->acc[i];
+                gyro[i] = sim.input->gyro[i] * (float) (M_PI / 180.0);
+            }
+            sim.imu_callback(acc, gyro, mag, imu_period_us * 1e-6f);
+            imu_next_us += imu_period_us;
+            continue;
+        }
+
+        if (!thread || thread_wake_us >= end_us) {
+            sim.now_us = end_us;
+            break;
+        }
+
+        if (thread_wake_us > sim.now_us) {
+            sim.now_us = thread_wake_us;
+        }
+        sim.input = trace_sample(&sim.trace, sim.now_us * 1e-6f);
+        resume(thread, on_yield, data);
+    }
+}
+
+void sim_terminate_threads(void) {
+    for (SimThread *t = sim.threads; t; t = t->next) {
+        t->terminate = true;
+    }
+
+    for (SimThread *t = sim.threads; t; t = t->next) {
+        while (!t->finished) {
+            resume(t, NULL, NULL);
+        }
+    }
+}
+
+void sim_run_in_thread(void (*fun)(void *arg), void *arg, SimYieldCallback on_yield, void *data) {
+    SimThread *thread = sim_thread_spawn(fun, 0, "Sim Client", arg);
+    if (!thread) {
+        return;
+    }
+
+    while (!thread->finished) {
+        sim_run(sim.now_us + 1000, on_yield, data);
+    }
+
+    // not kept in the thread stats, it isn't a package thread
+    SimThread **t = &sim.threads;
+    while (*t != thread) {
+        t = &(*t)->next;
+    }
+    *t = thread->next;
+    free(thread->stats.cost_ns);
+    free(thread->stack);
+    free(thread);
+}
+
+const char *sim_thread_name(const SimThread *thread) {
+    return thread->stats.name;
+}
+
+SimThread *sim_thread_next(const SimThread *thread) {
+    return thread->next;
+}
+
+SimThreadStats *sim_thread_stats(SimThread *thread) {
+    return &thread->stats;
+}
+
+void sim_free_threads(void) {
+    SimThread *t = sim.threads;
+    while (t) {
+        SimThread *next = t->next;
+        free(t->stats.cost_ns);
+        free(t->stack);
+        free(t);
+        t = next;
+    }
+    sim.threads = NULL;
+}
@@ -0,0 +1,274 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "sim.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEG2RAD (float) (M_PI / 180.0)
+
+typedef struct {
+    const char *name;
+    size_t offset;
+} Column;
+
+#define COLUMN(name, field) {name, offsetof(SimInput, field)}
+
+static const Column columns[] = {
+    COLUMN("t", t),
+    COLUMN("pitch", pitch),
+    COLUMN("roll", roll),
+    COLUMN("yaw", yaw),
+    COLUMN("gyro_x", gyro[0]),
+    COLUMN("gyro_y", gyro[1]),
+    COLUMN("gyro_z", gyro[2]),
+    COLUMN("acc_x", acc[0]),
+    COLUMN("acc_y", acc[1]),
+    COLUMN("acc_z", acc[2]),
+    COLUMN("erpm", erpm),
+    COLUMN("current", current),
+    COLUMN("current_in", current_in),
+    COLUMN("duty", duty),
+    COLUMN("voltage", voltage),
+    COLUMN("adc1", adc1),
+    COLUMN("adc2", adc2),
+    COLUMN("remote", remote),
+    COLUMN("temp_fet", temp_fet),
+    COLUMN("temp_motor", temp_motor),
+};
+
+#define COLUMN_COUNT (sizeof(columns) / sizeof(Column))
+#define MAX_CSV_COLUMNS 64
+
+static bool push_sample(Trace *trace, size_t *capacity, const SimInput *sample) {
+    if (trace->count >= *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : 1024;
+        SimInput *samples = realloc(trace->samples, new_capacity * sizeof(SimInput));
+        if (!samples) {
+            return false;
+        }
+        trace->samples = samples;
+        *capacity = new_capacity;
+    }
+    trace->samples[trace->count++] = *sample;
+    return true;
+}
+
+// Gravity vector in the IMU frame for the given orientation, matching the
+// convention of the balance filter.
+static void acc_from_angles(SimInput *s) {
+    float pitch = s->pitch * DEG2RAD;
+    float roll = s->roll * DEG2RAD;
+    s->acc[0] = -sinf(pitch);
+    s->acc[1] = sinf(roll) * cosf(pitch);
+    s->acc[2] = cosf(roll) * cosf(pitch);
+}
+
+static void gyro_from_angles(Trace *trace) {
+    for (size_t i = 1; i < trace->count; ++i) {
+        SimInput *prev = &trace->samples[i - 1];
+        SimInput *s = &trace->samples[i];
+        float dt = s->t - prev->t;
+        if (dt > 0) {
+            s->gyro[0] = (s->roll - prev->roll) / dt;
+            s->gyro[1] = (s->pitch - prev->pitch) / dt;
+            s->gyro[2] = (s->yaw - prev->yaw) / dt;
+        }
+    }
+}
+
+bool trace_load_csv(Trace *trace, const char *path) {
+    memset(trace, 0, sizeof(Trace));
+
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Failed to open trace %s\n", path);
+        return false;
+    }
+
+    char line[4096];
+    if (!fgets(line, sizeof(line), f)) {
+        fprintf(stderr, "Empty trace %s\n", path);
+        fclose(f);
+        return false;
+    }
+
+    // map CSV columns to SimInput fields, -1 for ignored columns
+    int map[MAX_CSV_COLUMNS];
+    size_t csv_columns = 0;
+    bool has_gyro = false;
+    bool has_acc = false;
+    for (char *tok = strtok(line, ",\r\n"); tok && csv_columns < MAX_CSV_COLUMNS;
+         tok = strtok(NULL, ",\r\n")) {
+        while (*tok == ' ') {
+            ++tok;
+        }
+        map[csv_columns] = -1;
+        for (size_t i = 0; i < COLUMN_COUNT; ++i) {
+            if (strcmp(tok, columns[i].name) == 0) {
+                map[csv_columns] = i;
+                has_gyro |= strncmp(tok, "gyro_", 5) == 0;
+                has_acc |= strncmp(tok, "acc_", 4) == 0;
+                break;
+            }
+        }
+        ++csv_columns;
+    }
+
+    size_t capacity = 0;
+    while (fgets(line, sizeof(line), f)) {
+        SimInput sample = {0};
+        char *cursor = line;
+        for (size_t c = 0; c < csv_columns; ++c) {
+            char *end;
+            float value = strtof(cursor, &end);
+            if (map[c] >= 0) {
+                *(float *) ((uint8_t *) &sample + columns[map[c]].offset) = value;
+            }
+            cursor = strchr(end, ',');
+            if (!cursor) {
+                break;
+            }
+            ++cursor;
+        }
+
+        if (!has_acc) {
+            acc_from_angles(&sample);
+        }
+        if (!push_sample(trace, &capacity, &sample)) {
+            fclose(f);
+            trace_free(trace);
+            return false;
+        }
+    }
+    fclose(f);
+
+    if (trace->count == 0) {
+        fprintf(stderr, "Trace %s has no samples\n", path);
+        return false;
+    }
+
+    if (!has_gyro) {
+        gyro_from_angles(trace);
+    }
+
+    return true;
+}
+
+static float smoothstep(float edge0, float edge1, float x) {
+    float t = (x - edge0) / (edge1 - edge0);
+    t = t < 0 ? 0 : (t > 1 ? 1 : t);
+    return t * t * (3 - 2 * t);
+}
+
+bool trace_generate(Trace *trace, float duration, float rate) {
+    memset(trace, 0, sizeof(Trace));
+
+    const float mount = 0.5f;
+    const float dismount = duration - 1.0f;
+    const float erpm_max = 6000.0f;
+
+    size_t capacity = 0;
+    size_t count = duration * rate;
+    for (size_t i = 0; i < count; ++i) {
+        float t = i / rate;
+        bool riding = t >= mount && t < dismount;
+
+        SimInput s = {0};
+        s.t = t;
+
+        // accelerate to full speed in 2s, start braking 2s before dismount
+        float speed = smoothstep(mount + 0.5f, mount + 2.5f, t) -
+            smoothstep(dismount - 2.5f, dismount - 0.5f, t);
+        s.erpm = erpm_max * speed;
+        s.duty = s.erpm / 40000.0f;
+
+        if (riding) {
+            s.pitch = 1.5f * sinf(2 * M_PI * 0.7f * t) + 0.5f * sinf(2 * M_PI * 3.1f * t);
+            s.roll = 3.0f * sinf(2 * M_PI * 0.2f * t);
+            s.yaw = 10.0f * (t - mount);
+            s.current = 15.0f * sinf(2 * M_PI * 0.7f * t) + 10.0f * speed;
+            s.adc1 = 3.0f;
+            s.adc2 = 3.0f;
+        }
+        s.current_in = s.current * s.duty;
+        s.voltage = 63.0f - 0.05f * s.current_in;
+        s.temp_fet = 35.0f;
+        s.temp_motor = 40.0f;
+
+        acc_from_angles(&s);
+        if (!push_sample(trace, &capacity, &s)) {
+            trace_free(trace);
+            return false;
+        }
+    }
+
+    gyro_from_angles(trace);
+    return trace->count > 0;
+}
+
+void trace_add_fault(Trace *trace, float t) {
+    for (size_t i = 1; i < trace->count; ++i) {
+        SimInput *prev = &trace->samples[i - 1];
+        SimInput *s = &trace->samples[i];
+        if (s->t >= t) {
+            s->pitch += (80.0f - s->pitch) * smoothstep(t, t + 0.1f, s->t);
+            acc_from_angles(s);
+            if (s->t > prev->t) {
+                s->gyro[1] = (s->pitch - prev->pitch) / (s->t - prev->t);
+            }
+        }
+    }
+}
+
+void trace_add_wheelslip(Trace *trace, float t) {
+    for (size_t i = 0; i < trace->count; ++i) {
+        SimInput *s = &trace->samples[i];
+        // the duty cycle is filtered by the package, raise it before the spin
+        if (s->t >= t - 0.05f && s->t < t + 0.15f) {
+            s->duty = 0.9f;
+        }
+        if (s->t >= t && s->t < t + 0.15f) {
+            s->erpm += 3000.0f * smoothstep(t, t + 0.1f, s->t);
+        }
+    }
+}
+
+const SimInput *trace_sample(Trace *trace, float t) {
+    // samples are mostly requested in increasing time, search from the last position
+    size_t i = trace->position;
+    if (i >= trace->count || trace->samples[i].t > t) {
+        i = 0;
+    }
+    while (i + 1 < trace->count && trace->samples[i + 1].t <= t) {
+        ++i;
+    }
+    trace->position = i;
+    return &trace->samples[i];
+}
+
+float trace_duration(const Trace *trace) {
+    return trace->count > 0 ? trace->samples[trace->count - 1].t : 0;
+}
+
+void trace_free(Trace *trace) {
+    free(trace->samples);
+    memset(trace, 0, sizeof(Trace));
+}
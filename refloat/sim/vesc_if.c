@@ -0,0 +1,659 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+// Simulated VESC_IF table. Only the functions Refloat uses are implemented,
+// the rest stay NULL, same as they would be on a firmware that doesn't
+// provide them.
+
+#include "sim.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEG2RAD (float) (M_PI / 180.0)
+#define DATA_BUFFER_SIZE (256 * 1024)
+
+Sim sim;
+
+vesc_c_if *sim_vesc_if;
+
+uint8_t sim_data_buffer_info[64] __attribute__((aligned(8)));
+
+static vesc_c_if vesc_if;
+
+static struct {
+    eeprom_var value;
+    bool stored;
+} eeprom[SIM_EEPROM_VARS];
+
+// OS
+
+static void sleep_us(uint32_t us) {
+    sim_thread_sleep_us(us);
+}
+
+static void sleep_ms(uint32_t ms) {
+    sim_thread_sleep_us(ms * 1000);
+}
+
+static void sleep_ticks(systime_t ticks) {
+    sim_thread_sleep_us(ticks * (1000000 / SYSTEM_TICK_RATE_HZ));
+}
+
+static float system_time(void) {
+    return sim_now_us() * 1e-6f;
+}
+
+static systime_t system_time_ticks(void) {
+    return sim_now_us() / (1000000 / SYSTEM_TICK_RATE_HZ);
+}
+
+static float ts_to_age_s(systime_t ts) {
+    return (system_time_ticks() - ts) * (1.0f / SYSTEM_TICK_RATE_HZ);
+}
+
+static uint32_t timer_time_now(void) {
+    return sim_now_us();
+}
+
+static float timer_seconds_elapsed_since(uint32_t time) {
+    return (uint32_t) (sim_now_us() - time) * 1e-6f;
+}
+
+static int sim_printf(const char *str, ...) {
+    if (sim.quiet) {
+        return 0;
+    }
+
+    va_list args;
+    va_start(args, str);
+    int res = vfprintf(stderr, str, args);
+    va_end(args);
+    fputc('\n', stderr);
+    return res;
+}
+
+static void **get_arg(uint32_t prog_addr) {
+    (void) prog_addr;
+    return &sim.arg;
+}
+
+static void thread_set_priority(int priority) {
+    (void) priority;
+}
+
+static lib_mutex mutex_create(void) {
+    return malloc(1);
+}
+
+static void mutex_lock(lib_mutex m) {
+    // threads only switch on sleep, there's nothing to lock against
+    (void) m;
+}
+
+static void mutex_unlock(lib_mutex m) {
+    (void) m;
+}
+
+typedef struct {
+    uint32_t count;
+} Semaphore;
+
+static lib_semaphore sem_create(void) {
+    return calloc(1, sizeof(Semaphore));
+}
+
+static bool sem_wait_to(lib_semaphore s, systime_t timeout) {
+    // threads only switch on sleep, poll once per system tick
+    Semaphore *sem = s;
+    for (systime_t t = 0; sem->count == 0; ++t) {
+        if (t >= timeout) {
+            return false;
+        }
+        sleep_ticks(1);
+    }
+
+    --sem->count;
+    return true;
+}
+
+static void sem_wait(lib_semaphore s) {
+    sem_wait_to(s, UINT32_MAX);
+}
+
+static void sem_signal(lib_semaphore s) {
+    ++((Semaphore *) s)->count;
+}
+
+static void sem_reset(lib_semaphore s) {
+    ((Semaphore *) s)->count = 0;
+}
+
+// IO
+
+static void set_pad_mode(void *gpio, uint32_t pin, uint32_t mode) {
+    (void) gpio;
+    (void) pin;
+    (void) mode;
+}
+
+static bool io_set_mode(VESC_PIN pin, VESC_PIN_MODE mode) {
+    (void) pin;
+    (void) mode;
+    return true;
+}
+
+static bool io_write(VESC_PIN pin, int state) {
+    (void) pin;
+    (void) state;
+    return true;
+}
+
+static bool io_read(VESC_PIN pin) {
+    (void) pin;
+    return false;
+}
+
+static float io_read_analog(VESC_PIN pin) {
+    switch (pin) {
+    case VESC_PIN_ADC1:
+        return sim.input->adc1;
+    case VESC_PIN_ADC2:
+        return sim.input->adc2;
+    default:
+        return -1.0f;
+    }
+}
+
+static bool app_is_output_disabled(void) {
+    return false;
+}
+
+// Motor
+
+static void record_command(MotorCommandType type, float value) {
+    sim.motor_command.type = type;
+    sim.motor_command.value = value;
+    sim.motor_command.count++;
+}
+
+static void mc_set_current(float current) {
+    record_command(MOTOR_CMD_CURRENT, current);
+}
+
+static void mc_set_brake_current(float current) {
+    record_command(MOTOR_CMD_BRAKE, current);
+}
+
+static void mc_set_duty(float duty) {
+    record_command(MOTOR_CMD_DUTY, duty);
+}
+
+static void mc_release_motor(void) {
+    record_command(MOTOR_CMD_RELEASE, 0);
+}
+
+static void mc_set_current_off_delay(float delay_sec) {
+    (void) delay_sec;
+}
+
+static void timeout_reset(void) {
+}
+
+static float mc_get_rpm(void) {
+    return sim.input->erpm;
+}
+
+static float mc_get_speed(void) {
+    // 15 pole pairs, 280mm wheel
+    return sim.input->erpm / 15.0f / 60.0f * (float) M_PI * 0.28f;
+}
+
+static float mc_get_duty_cycle_now(void) {
+    return sim.input->duty;
+}
+
+static float mc_get_tot_current(void) {
+    return sim.input->current;
+}
+
+static float mc_get_tot_current_directional(void) {
+    return sim.input->erpm < 0 ? -sim.input->current : sim.input->current;
+}
+
+static float mc_get_tot_current_in(void) {
+    return sim.input->current_in;
+}
+
+static float mc_get_input_voltage_filtered(void) {
+    return sim.input->voltage;
+}
+
+static float mc_temp_fet_filtered(void) {
+    return sim.input->temp_fet;
+}
+
+static float mc_temp_motor_filtered(void) {
+    return sim.input->temp_motor;
+}
+
+static mc_fault_code mc_get_fault(void) {
+    return FAULT_CODE_NONE;
+}
+
+static const char *mc_fault_to_string(mc_fault_code fault) {
+    (void) fault;
+    return "FAULT_CODE_NONE";
+}
+
+static float mc_get_battery_level(float *wh_left) {
+    if (wh_left) {
+        *wh_left = 500.0f;
+    }
+    return 0.8f;
+}
+
+static float mc_get_distance(void) {
+    return 0.0f;
+}
+
+static uint64_t mc_get_odometer(void) {
+    return 0;
+}
+
+static bool store_backup_data(void) {
+    return true;
+}
+
+static bool foc_play_tone(int channel, float freq, float voltage) {
+    (void) channel;
+    (void) freq;
+    (void) voltage;
+    sim.tone_count++;
+    return true;
+}
+
+static bool foc_beep(float freq, float time, float voltage) {
+    (void) time;
+    return foc_play_tone(0, freq, voltage);
+}
+
+static void foc_stop_audio(bool reset) {
+    (void) reset;
+}
+
+// IMU
+
+static bool imu_startup_done(void) {
+    return true;
+}
+
+static float imu_get_pitch(void) {
+    return sim.input->pitch * DEG2RAD;
+}
+
+static float imu_get_roll(void) {
+    return sim.input->roll * DEG2RAD;
+}
+
+static float imu_get_yaw(void) {
+    return sim.input->yaw * DEG2RAD;
+}
+
+static void imu_get_rpy(float *rpy) {
+    rpy[0] = imu_get_roll();
+    rpy[1] = imu_get_pitch();
+    rpy[2] = imu_get_yaw();
+}
+
+static void imu_get_gyro(float *gyro) {
+    memcpy(gyro, sim.input->gyro, sizeof(sim.input->gyro));
+}
+
+static void imu_get_accel(float *accel) {
+    memcpy(accel, sim.input->acc, sizeof(sim.input->acc));
+}
+
+static void imu_get_quaternions(float *q) {
+    float cr = cosf(imu_get_roll() / 2), sr = sinf(imu_get_roll() / 2);
+    float cp = cosf(imu_get_pitch() / 2), sp = sinf(imu_get_pitch() / 2);
+    float cy = cosf(imu_get_yaw() / 2), sy = sinf(imu_get_yaw() / 2);
+    q[0] = cr * cp * cy + sr * sp * sy;
+    q[1] = sr * cp * cy - cr * sp * sy;
+    q[2] = cr * sp * cy + sr * cp * sy;
+    q[3] = cr * cp * sy - sr * sp * cy;
+}
+
+static void imu_set_read_callback(void (*func)(float *acc, float *gyro, float *mag, float dt)) {
+    sim.imu_callback = func;
+}
+
+// Input devices
+
+static float get_ppm(void) {
+    return sim.input->remote;
+}
+
+static float get_ppm_age(void) {
+    return 0.0f;
+}
+
+static remote_state get_remote_state(void) {
+    remote_state state = {0};
+    state.js_y = sim.input->remote;
+    return state;
+}
+
+// Comm
+
+static void send_app_data(unsigned char *data, unsigned int len) {
+    if (sim.app_data_sink) {
+        sim.app_data_sink(data, len);
+    }
+}
+
+static bool set_app_data_handler(void (*func)(unsigned char *data, unsigned int len)) {
+    sim.app_data_handler = func;
+    return true;
+}
+
+static void terminal_register_command_callback(
+    const char *command,
+    const char *help,
+    const char *arg_names,
+    void (*cbf)(int argc, const char **argv)
+) {
+    (void) command;
+    (void) help;
+    (void) arg_names;
+    (void) cbf;
+}
+
+static void plot_init(const char *namex, const char *namey) {
+    (void) namex;
+    (void) namey;
+}
+
+static void plot_add_graph(const char *name) {
+    (void) name;
+}
+
+static void plot_set_graph(int graph) {
+    (void) graph;
+}
+
+static void plot_send_points(float x, float y) {
+    (void) x;
+    (void) y;
+}
+
+// Config
+
+static bool read_eeprom_var(eeprom_var *v, int address) {
+    if (address < 0 || address >= SIM_EEPROM_VARS || !eeprom[address].stored) {
+        return false;
+    }
+    *v = eeprom[address].value;
+    return true;
+}
+
+static bool store_eeprom_var(eeprom_var *v, int address) {
+    if (address < 0 || address >= SIM_EEPROM_VARS) {
+        return false;
+    }
+    eeprom[address].value = *v;
+    eeprom[address].stored = true;
+    return true;
+}
+
+static void conf_custom_add_config(
+    int (*get_cfg)(uint8_t *data, bool is_default),
+    bool (*set_cfg)(uint8_t *data),
+    int (*get_cfg_xml)(uint8_t **data)
+) {
+    (void) get_cfg;
+    (void) set_cfg;
+    (void) get_cfg_xml;
+}
+
+static void conf_custom_clear_configs(void) {
+}
+
+static float get_cfg_float(CFG_PARAM p) {
+    switch (p) {
+    case CFG_PARAM_l_current_max:
+        return 60.0f;
+    case CFG_PARAM_l_current_min:
+        return -60.0f;
+    case CFG_PARAM_l_in_current_max:
+        return 30.0f;
+    case CFG_PARAM_l_in_current_min:
+        return -20.0f;
+    case CFG_PARAM_l_temp_fet_start:
+        return 85.0f;
+    case CFG_PARAM_l_temp_motor_start:
+        return 100.0f;
+    case CFG_PARAM_l_max_duty:
+        return 0.95f;
+    case CFG_PARAM_l_min_vin:
+        return 40.0f;
+    case CFG_PARAM_l_max_vin:
+        return 72.0f;
+    case CFG_PARAM_l_battery_cut_start:
+        return 50.0f;
+    case CFG_PARAM_l_battery_cut_end:
+        return 48.0f;
+    case CFG_PARAM_IMU_mahony_kp:
+        return 0.4f;
+    case CFG_PARAM_IMU_accel_confidence_decay:
+        return 0.1f;
+    case CFG_PARAM_si_wheel_diameter:
+        return 0.28f;
+    case CFG_PARAM_si_gear_ratio:
+        return 1.0f;
+    default:
+        return 0.0f;
+    }
+}
+
+static int get_cfg_int(CFG_PARAM p) {
+    switch (p) {
+    case CFG_PARAM_si_battery_cells:
+        return 15;
+    case CFG_PARAM_si_motor_poles:
+        return 30;
+    case CFG_PARAM_IMU_sample_rate:
+        return sim.imu_rate;
+    default:
+        return 0;
+    }
+}
+
+static bool set_cfg_float(CFG_PARAM p, float value) {
+    (void) p;
+    (void) value;
+    return true;
+}
+
+static bool set_cfg_int(CFG_PARAM p, int value) {
+    (void) p;
+    (void) value;
+    return true;
+}
+
+// LispBM
+
+static bool lbm_add_extension(char *name, extension_fptr fptr) {
+    (void) name;
+    (void) fptr;
+    return true;
+}
+
+static int32_t lbm_dec_as_i32(lbm_value val) {
+    return (int32_t) val;
+}
+
+static float lbm_dec_as_float(lbm_value val) {
+    return (float) val;
+}
+
+typedef struct {
+    uint32_t magic;
+    uint8_t *buffer;
+    size_t length;
+} DataBufferInfo;
+
+void sim_vesc_if_init(void) {
+    vesc_if = (vesc_c_if) {
+        .lbm_add_extension = lbm_add_extension,
+        .lbm_dec_as_i32 = lbm_dec_as_i32,
+        .lbm_dec_as_float = lbm_dec_as_float,
+        .lbm_enc_sym_nil = 0,
+        .lbm_enc_sym_true = 1,
+
+        .sleep_ms = sleep_ms,
+        .sleep_us = sleep_us,
+        .system_time = system_time,
+        .ts_to_age_s = ts_to_age_s,
+        .printf = sim_printf,
+        .malloc = malloc,
+        .free = free,
+        .spawn = sim_thread_spawn,
+        .request_terminate = sim_thread_request_terminate,
+        .should_terminate = sim_thread_should_terminate,
+        .get_arg = get_arg,
+
+        .set_pad_mode = set_pad_mode,
+
+        .io_set_mode = io_set_mode,
+        .io_write = io_write,
+        .io_read = io_read,
+        .io_read_analog = io_read_analog,
+
+        .mc_fault_to_string = mc_fault_to_string,
+        .mc_get_fault = mc_get_fault,
+        .mc_set_duty = mc_set_duty,
+        .mc_set_current = mc_set_current,
+        .mc_set_brake_current = mc_set_brake_current,
+        .mc_release_motor = mc_release_motor,
+        .mc_get_duty_cycle_now = mc_get_duty_cycle_now,
+        .mc_get_rpm = mc_get_rpm,
+        .mc_get_tot_current = mc_get_tot_current,
+        .mc_get_tot_current_filtered = mc_get_tot_current,
+        .mc_get_tot_current_directional = mc_get_tot_current_directional,
+        .mc_get_tot_current_directional_filtered = mc_get_tot_current_directional,
+        .mc_get_tot_current_in = mc_get_tot_current_in,
+        .mc_get_tot_current_in_filtered = mc_get_tot_current_in,
+        .mc_get_input_voltage_filtered = mc_get_input_voltage_filtered,
+        .mc_temp_fet_filtered = mc_temp_fet_filtered,
+        .mc_temp_motor_filtered = mc_temp_motor_filtered,
+        .mc_get_battery_level = mc_get_battery_level,
+        .mc_get_speed = mc_get_speed,
+        .mc_get_distance = mc_get_distance,
+        .mc_get_distance_abs = mc_get_distance,
+        .mc_get_odometer = mc_get_odometer,
+        .mc_set_current_off_delay = mc_set_current_off_delay,
+
+        .send_app_data = send_app_data,
+        .set_app_data_handler = set_app_data_handler,
+
+        .imu_startup_done = imu_startup_done,
+        .imu_get_roll = imu_get_roll,
+        .imu_get_pitch = imu_get_pitch,
+        .imu_get_yaw = imu_get_yaw,
+        .imu_get_rpy = imu_get_rpy,
+        .imu_get_accel = imu_get_accel,
+        .imu_get_gyro = imu_get_gyro,
+        .imu_get_accel_derotated = imu_get_accel,
+        .imu_get_gyro_derotated = imu_get_gyro,
+        .imu_get_quaternions = imu_get_quaternions,
+
+        .terminal_register_command_callback = terminal_register_command_callback,
+
+        .read_eeprom_var = read_eeprom_var,
+        .store_eeprom_var = store_eeprom_var,
+
+        .timeout_reset = timeout_reset,
+
+        .plot_init = plot_init,
+        .plot_add_graph = plot_add_graph,
+        .plot_set_graph = plot_set_graph,
+        .plot_send_points = plot_send_points,
+
+        .conf_custom_add_config = conf_custom_add_config,
+        .conf_custom_clear_configs = conf_custom_clear_configs,
+
+        .get_cfg_float = get_cfg_float,
+        .get_cfg_int = get_cfg_int,
+        .set_cfg_float = set_cfg_float,
+        .set_cfg_int = set_cfg_int,
+
+        .mutex_create = mutex_create,
+        .mutex_lock = mutex_lock,
+        .mutex_unlock = mutex_unlock,
+
+        .timer_time_now = timer_time_now,
+        .timer_seconds_elapsed_since = timer_seconds_elapsed_since,
+
+        .imu_set_read_callback = imu_set_read_callback,
+
+        .store_backup_data = store_backup_data,
+
+        .get_remote_state = get_remote_state,
+        .get_ppm = get_ppm,
+        .get_ppm_age = get_ppm_age,
+        .app_is_output_disabled = app_is_output_disabled,
+
+        .system_time_ticks = system_time_ticks,
+        .sleep_ticks = sleep_ticks,
+
+        .foc_beep = foc_beep,
+        .foc_play_tone = foc_play_tone,
+        .foc_stop_audio = foc_stop_audio,
+
+        .sem_create = sem_create,
+        .sem_wait = sem_wait,
+        .sem_signal = sem_signal,
+        .sem_wait_to = sem_wait_to,
+        .sem_reset = sem_reset,
+
+        .thread_set_priority = thread_set_priority,
+    };
+    sim_vesc_if = &vesc_if;
+
+    // Data Record buffer, magic version 1.1
+    DataBufferInfo info = {
+        .magic = 0xcafe1011,
+        .buffer = malloc(DATA_BUFFER_SIZE),
+        .length = DATA_BUFFER_SIZE,
+    };
+    if (!info.buffer) {
+        info.magic = 0;
+        info.length = 0;
+    }
+    _Static_assert(sizeof(DataBufferInfo) <= sizeof(sim_data_buffer_info), "");
+    memcpy(sim_data_buffer_info, &info, sizeof(info));
+}
+
+void sim_vesc_if_destroy(void) {
+    DataBufferInfo info;
+    memcpy(&info, sim_data_buffer_info, sizeof(info));
+    free(info.buffer);
+    memset(sim_data_buffer_info, 0, sizeof(sim_data_buffer_info));
+}
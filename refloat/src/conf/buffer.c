@@ -18,6 +18,7 @@
 #include "buffer.h"
 #include <math.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wstrict-aliasing"
@@ -111,6 +111,7 @@ typedef enum {
     LED_ANIM_RAINBOW_CYCLE,
     LED_ANIM_RAINBOW_FADE,
     LED_ANIM_RAINBOW_ROLL,
+    LED_ANIM_CUSTOM,
 } LedAnimMode;
 
 typedef enum {
@@ -30,9 +30,11 @@
 #include "konami.h"
 #include "lcm.h"
 #include "leds.h"
+#include "loop_timer.h"
 #include "motor_control.h"
 #include "motor_data.h"
 #include "pid.h"
+#include "profiler.h"
 #include "remote.h"
 #include "state.h"
 #include "time.h"
@@ -77,6 +79,8 @@ typedef struct {
     BMS bms;
 
     DataRecord data_record;
+    Profiler profiler;
+    LoopTimer loop_timer;
 
     Konami flywheel_konami;
     Konami headlights_on_konami;
@@ -90,7 +94,6 @@ typedef struct {
     bool beeper_enabled;
 
     // Config values
-    uint32_t loop_time_us;
     float startup_pitch_trickmargin, startup_pitch_tolerance;
     float startup_step_size;
     float tiltback_duty_step_size, tiltback_hv_step_size, tiltback_lv_step_size,
@@ -18,22 +18,95 @@
 #pragma once
 
 #include "lib/circular_buffer.h"
+#include "lib/sample_encoder.h"
 #include "rt_data.h"
 #include "time.h"
+#include "vesc_c_if.h"
 
 #include <stdbool.h>
 #include <stdint.h>
 
+#define DATA_RECORD_CHANNEL_COUNT ITEMS_COUNT_REC(RT_DATA_ALL_ITEMS)
+
+// A sample with the values of the active channels. In the raw encoding, it's
+// stored packed, with only the active values, so the stride depends on the
+// channel mask.
 typedef struct {
     time_t time;
     uint8_t flags;
-    uint16_t values[ITEMS_COUNT_REC(RT_DATA_ALL_ITEMS)];  // values encoded as float16
+    uint16_t values[DATA_RECORD_CHANNEL_COUNT];  // values encoded as float16
 } Sample;
 
+// Sized so that two full blocks fit into a single DATA_RECORD_DATA response
+#define DATA_RECORD_BLOCK_SIZE 248
+
+typedef enum {
+    DATA_RECORD_ENCODING_RAW = 0,
+    DATA_RECORD_ENCODING_COMPRESSED = 1,
+} DataRecordEncoding;
+
+// Requests of the command thread, which the main loop carries out, as it's
+// the only writer of the buffer
+typedef enum {
+    DATA_RECORD_REQUEST_NONE = 0,
+    DATA_RECORD_REQUEST_START,
+    // stops the recording and flushes the partially filled block
+    DATA_RECORD_REQUEST_STOP,
+    // applies the requested encoding and channel mask and sets up the buffer
+    DATA_RECORD_REQUEST_SETUP,
+} DataRecordRequest;
+
+// Events that can trigger a capture, used as a bit mask
+typedef enum {
+    DATA_RECORD_EVENT_FAULT = 1 << 0,
+    DATA_RECORD_EVENT_WHEELSLIP = 1 << 1,
+    DATA_RECORD_EVENT_FW_FAULT = 1 << 2,
+} DataRecordEvent;
+
 typedef struct {
     bool enabled;
     bool recording;
     bool autostart;
     bool autostop;
+    DataRecordEncoding encoding;
+
+    // bit mask of the recorded items of RT_DATA_ALL_ITEMS, in their order
+    uint32_t channel_mask;
+    uint8_t value_count;
+
+    float frequency;
+    // record every Nth loop iteration
+    uint16_t decimation;
+    uint16_t decimation_counter;
+
+    // Trigger mode: with a non-zero mask of events, the recording continues
+    // after disengaging until the capture is triggered by one of the events,
+    // and then stops post_trigger_samples later
+    uint8_t trigger_events;
+    uint16_t post_trigger_samples;
+    uint16_t post_trigger_remaining;
+    bool triggered;
+
+    // the pending request, the main loop signals request_done once it's done
+    volatile DataRecordRequest request;
+    DataRecordEncoding requested_encoding;
+    uint32_t requested_channel_mask;
+    lib_semaphore request_done;
+
+    // Bulk download: frames are sent in windows, each acknowledgement of the
+    // received frames sends the next window
+    bool downloading;
+    uint8_t download_window;
+    uint16_t download_frame_count;
+    uint16_t download_frame_items;
+    float download_timer;
+
+    uint8_t *memory;
+    size_t memory_size;
     CircularBuffer buffer;
+
+    // Compressed encoding: samples are encoded into the block, which is pushed
+    // into the buffer when full
+    SampleEncoder encoder;
+    uint8_t block[DATA_RECORD_BLOCK_SIZE];
 } DataRecord;
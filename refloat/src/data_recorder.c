@@ -18,10 +18,38 @@
 #include "data_recorder.h"
 #include "conf/buffer.h"
 #include "utils.h"
+#include "utils/utils.h"
 #include "vesc_c_if.h"
 
+#include <math.h>
+#include <string.h>
+
+#define CHANNEL_COUNT DATA_RECORD_CHANNEL_COUNT
+#define ALL_CHANNELS (CHANNEL_COUNT == 32 ? UINT32_MAX : (1u << CHANNEL_COUNT) - 1)
+
+// time and flags precede the values of a packed raw sample
+#define RAW_SAMPLE_HEADER_SIZE 5
+
+#define DOWNLOAD_MAX_WINDOW 32
+// the download stops blocking autostart when the client stops acknowledging
+#define DOWNLOAD_TIMEOUT 10.0f
+#define REQUEST_TIMEOUT_MS 100
+
+// package ID, command ID, seq, frame count and offset before the data, CRC after
+#define FRAME_HEADER_SIZE 10
+#define FRAME_CRC_SIZE 4
+#define FRAME_DATA_SIZE (SEND_BUF_MAX_SIZE - FRAME_HEADER_SIZE - FRAME_CRC_SIZE)
+
+_Static_assert(
+    CHANNEL_COUNT <= SAMPLE_ENCODER_MAX_VALUES, "Too many recorded values for the sample encoder."
+);
+
 static void start_recording(DataRecord *dr) {
     circular_buffer_clear(&dr->buffer);
+    sample_encoder_init(&dr->encoder, dr->block, DATA_RECORD_BLOCK_SIZE, dr->value_count);
+    dr->decimation_counter = 0;
+    dr->triggered = false;
+    dr->downloading = false;
     dr->recording = true;
 }
 
@@ -35,14 +63,64 @@ typedef struct {
     size_t length;
 } DataBufferInfo;
 
+// The information about the data buffer is stored at the end of the VESC
+// interface memory area
+#ifndef DATA_BUFFER_INFO_ADDR
+#define DATA_BUFFER_INFO_ADDR ((uint8_t *) VESC_IF + 2036)
+#endif
+
+static size_t raw_sample_size(const DataRecord *dr) {
+    return RAW_SAMPLE_HEADER_SIZE + 2 * dr->value_count;
+}
+
+static void push_raw_sample(DataRecord *dr, const Sample *sample) {
+    uint8_t item[RAW_SAMPLE_HEADER_SIZE + 2 * CHANNEL_COUNT];
+    memcpy(item, &sample->time, sizeof(time_t));
+    item[4] = sample->flags;
+    memcpy(&item[RAW_SAMPLE_HEADER_SIZE], sample->values, 2 * dr->value_count);
+    circular_buffer_push(&dr->buffer, item);
+}
+
+static void unpack_raw_sample(const DataRecord *dr, const uint8_t *item, Sample *sample) {
+    memcpy(&sample->time, item, sizeof(time_t));
+    sample->flags = item[4];
+    memcpy(sample->values, &item[RAW_SAMPLE_HEADER_SIZE], 2 * dr->value_count);
+}
+
+static bool get_raw_sample(const DataRecord *dr, size_t i, Sample *sample) {
+    uint8_t item[RAW_SAMPLE_HEADER_SIZE + 2 * CHANNEL_COUNT];
+    if (!circular_buffer_get(&dr->buffer, i, item)) {
+        return false;
+    }
+    unpack_raw_sample(dr, item, sample);
+    return true;
+}
+
+static void setup_buffer(DataRecord *dr) {
+    size_t item_size = dr->encoding == DATA_RECORD_ENCODING_COMPRESSED ? DATA_RECORD_BLOCK_SIZE
+                                                                         : raw_sample_size(dr);
+    circular_buffer_init(&dr->buffer, item_size, dr->memory_size / item_size, dr->memory);
+    sample_encoder_init(&dr->encoder, dr->block, DATA_RECORD_BLOCK_SIZE, dr->value_count);
+}
+
 void data_recorder_init(DataRecord *dr) {
     dr->recording = false;
     dr->autostart = true;
     dr->autostop = true;
-
-    // fetch information about the data buffer, it's stored at the end of the
-    // VESC interface memory area
-    DataBufferInfo *buffer_info = (DataBufferInfo *) ((uint8_t *) VESC_IF + 2036);
+    dr->encoding = DATA_RECORD_ENCODING_RAW;
+    dr->channel_mask = ALL_CHANNELS;
+    dr->value_count = CHANNEL_COUNT;
+    dr->frequency = 0;
+    dr->decimation = 1;
+    dr->decimation_counter = 0;
+    dr->trigger_events = 0;
+    dr->post_trigger_samples = 0;
+    dr->post_trigger_remaining = 0;
+    dr->triggered = false;
+    dr->request = DATA_RECORD_REQUEST_NONE;
+    dr->downloading = false;
+
+    DataBufferInfo *buffer_info = (DataBufferInfo *) DATA_BUFFER_INFO_ADDR;
 
     // Magic format: 0xcafe1XVM where X=ignored (reserved for future use),
     // V=major version (4 bits), M=minor version (4 bits)
@@ -60,23 +138,72 @@ void data_recorder_init(DataRecord *dr) {
         return;
     }
 
+    // older firmware without semaphores
+    if (!VESC_IF->sem_create) {
+        log_error("Data Record requires a newer firmware.");
+        dr->enabled = false;
+        return;
+    }
+
+    dr->request_done = VESC_IF->sem_create();
+    if (!dr->request_done) {
+        log_error("Failed to init Data Record: Out of memory.");
+        dr->enabled = false;
+        return;
+    }
+
     dr->enabled = true;
-    size_t size = buffer_info->length;
-    size_t sample_nr = size / sizeof(Sample);
-    uint8_t *buffer = buffer_info->buffer;
-    circular_buffer_init(&dr->buffer, sizeof(Sample), sample_nr, buffer);
-    log_msg("Data Record buffer size: %uB (%u samples)", size, sample_nr);
+    dr->memory = buffer_info->buffer;
+    dr->memory_size = buffer_info->length;
+    setup_buffer(dr);
+    log_msg(
+        "Data Record buffer size: %uB (%u samples)",
+        dr->memory_size,
+        dr->memory_size / raw_sample_size(dr)
+    );
+}
+
+void data_recorder_destroy(DataRecord *dr) {
+    if (dr->enabled) {
+        VESC_IF->free(dr->request_done);
+    }
 }
 
 bool data_recorder_has_capability(const DataRecord *dr) {
     return dr->enabled;
 }
 
+void data_recorder_configure(DataRecord *dr, float frequency) {
+    dr->frequency = frequency;
+}
+
 void data_recorder_trigger(DataRecord *dr, bool engage) {
     if (!dr->enabled) {
         return;
     }
 
+    // don't overwrite the data while they're being downloaded
+    if (dr->downloading) {
+        if (VESC_IF->system_time() - dr->download_timer < DOWNLOAD_TIMEOUT) {
+            return;
+        }
+        dr->downloading = false;
+    }
+
+    if (dr->trigger_events) {
+        // keep a triggered capture until it's downloaded and recording is
+        // started again, and let a running post-trigger recording finish
+        if (dr->triggered) {
+            return;
+        }
+
+        // don't restart a running recording, it holds the pre-trigger window
+        if (dr->autostart && engage && !dr->recording) {
+            start_recording(dr);
+        }
+        return;
+    }
+
     if (dr->autostart && engage) {
         start_recording(dr);
     } else if (dr->autostop && !engage) {
@@ -84,32 +211,175 @@ void data_recorder_trigger(DataRecord *dr, bool engage) {
     }
 }
 
+void data_recorder_event(DataRecord *dr, DataRecordEvent event) {
+    if (!dr->recording || dr->triggered || !(dr->trigger_events & event)) {
+        return;
+    }
+
+    dr->triggered = true;
+    dr->post_trigger_remaining = dr->post_trigger_samples;
+}
+
+static void flush_block(DataRecord *dr) {
+    circular_buffer_push(&dr->buffer, dr->block);
+    sample_encoder_init(&dr->encoder, dr->block, DATA_RECORD_BLOCK_SIZE, dr->value_count);
+}
+
+static void encode_sample(DataRecord *dr, const Sample *sample) {
+    if (!sample_encoder_add(&dr->encoder, sample->time, sample->flags, sample->values)) {
+        // the block is full, a new one always fits at least one sample
+        flush_block(dr);
+        sample_encoder_add(&dr->encoder, sample->time, sample->flags, sample->values);
+    }
+}
+
+static void handle_request(DataRecord *dr) {
+    DataRecordRequest request = dr->request;
+    if (request == DATA_RECORD_REQUEST_NONE) {
+        return;
+    }
+
+    if (request == DATA_RECORD_REQUEST_START) {
+        start_recording(dr);
+    } else if (request == DATA_RECORD_REQUEST_STOP) {
+        stop_recording(dr);
+    } else if (request == DATA_RECORD_REQUEST_SETUP) {
+        // autostart may have started the recording since the request was made
+        if (dr->recording) {
+            log_error("Data Record can't be set up while recording.");
+        } else {
+            dr->encoding = dr->requested_encoding;
+            dr->channel_mask = dr->requested_channel_mask;
+            dr->value_count = __builtin_popcount(dr->channel_mask);
+            setup_buffer(dr);
+        }
+    }
+
+    // push the partially filled block once the recording stops, so that it's
+    // in the buffer for sending by the time the request is done
+    if (!dr->recording && !sample_encoder_empty(&dr->encoder)) {
+        flush_block(dr);
+    }
+
+    dr->request = DATA_RECORD_REQUEST_NONE;
+    VESC_IF->sem_signal(dr->request_done);
+}
+
 void data_recorder_sample(DataRecord *dr, const Data *d, time_t time) {
-    if (!dr->enabled || !dr->recording) {
+    if (!dr->enabled) {
+        return;
+    }
+
+    handle_request(dr);
+
+    if (!dr->recording) {
+        // push the partially filled block once the recording stops
+        if (!sample_encoder_empty(&dr->encoder)) {
+            flush_block(dr);
+        }
+        return;
+    }
+
+    if (++dr->decimation_counter < dr->decimation) {
         return;
     }
+    dr->decimation_counter = 0;
 
     uint8_t flags = d->state.sat << 4 | d->footpad.state << 2;
     flags |= d->state.wheelslip << 1 | (d->state.state == STATE_RUNNING);
 
-    Sample sample =
-        {.time = time,
-         .flags = flags,
-         .values = {
-#define ARRAY_VALUE(id) to_float16(d->id),
-             VISIT_REC(RT_DATA_ALL_ITEMS, ARRAY_VALUE)
-#undef ARRAY_VALUE
-         }};
-    circular_buffer_push(&dr->buffer, &sample);
+    Sample sample = {.time = time, .flags = flags};
+    uint8_t channel = 0;
+    uint8_t value = 0;
+#define ADD_VALUE(id)                                                                              \
+    if (dr->channel_mask & (1u << channel++)) {                                                    \
+        sample.values[value++] = to_float16(d->id);                                                \
+    }
+    VISIT_REC(RT_DATA_ALL_ITEMS, ADD_VALUE);
+#undef ADD_VALUE
+
+    if (dr->encoding == DATA_RECORD_ENCODING_COMPRESSED) {
+        encode_sample(dr, &sample);
+    } else {
+        push_raw_sample(dr, &sample);
+    }
+
+    if (dr->triggered) {
+        if (dr->post_trigger_remaining == 0) {
+            stop_recording(dr);
+        } else {
+            --dr->post_trigger_remaining;
+        }
+    }
+}
+
+/**
+ * Hands @p request over to the main loop and waits until it's carried out.
+ * Requests are only made from the command thread, so there's at most one
+ * pending. On timeout the request is withdrawn, so that the main loop doesn't
+ * carry it out later, after the command has already failed.
+ */
+static void make_request(DataRecord *dr, DataRecordRequest request) {
+    VESC_IF->sem_reset(dr->request_done);
+    dr->request = request;
+    if (!VESC_IF->sem_wait_to(dr->request_done, REQUEST_TIMEOUT_MS * SYSTEM_TICK_RATE_HZ / 1000)) {
+        // if the main loop has just picked it up, it still finishes it and
+        // the stale signal is reset by the next request
+        dr->request = DATA_RECORD_REQUEST_NONE;
+        log_error("Data Record request timed out.");
+    }
+}
+
+static void set_encoding(DataRecord *dr, DataRecordEncoding encoding) {
+    if (encoding != DATA_RECORD_ENCODING_RAW && encoding != DATA_RECORD_ENCODING_COMPRESSED) {
+        log_error("Data Record unknown encoding: %u", encoding);
+        return;
+    }
+
+    if (dr->recording) {
+        log_error("Data Record encoding can't be changed while recording.");
+        return;
+    }
+
+    dr->requested_encoding = encoding;
+    dr->requested_channel_mask = dr->channel_mask;
+    make_request(dr, DATA_RECORD_REQUEST_SETUP);
+}
+
+static void set_rate(DataRecord *dr, uint16_t rate) {
+    if (rate == 0 || dr->frequency <= 0) {
+        dr->decimation = 1;
+        return;
+    }
+
+    dr->decimation = clampf(roundf(dr->frequency / rate), 1, UINT16_MAX);
+}
+
+static void set_channel_mask(DataRecord *dr, uint32_t mask) {
+    mask &= ALL_CHANNELS;
+    if (mask == 0) {
+        log_error("Data Record channel mask selects no channels.");
+        return;
+    }
+
+    if (dr->recording) {
+        log_error("Data Record channels can't be changed while recording.");
+        return;
+    }
+
+    dr->requested_encoding = dr->encoding;
+    dr->requested_channel_mask = mask;
+    make_request(dr, DATA_RECORD_REQUEST_SETUP);
 }
 
 static void send_point_vt_experiment(const void *item, void *data) {
-    unused(data);
+    const DataRecord *dr = data;
 
-    Sample *sample = (Sample *) item;
-    for (uint8_t i = 0; i < ITEMS_COUNT_REC(RT_DATA_ALL_ITEMS); ++i) {
+    Sample sample;
+    unpack_raw_sample(dr, item, &sample);
+    for (uint8_t i = 0; i < dr->value_count; ++i) {
         VESC_IF->plot_set_graph(i);
-        VESC_IF->plot_send_points(sample->time, sample->values[i]);
+        VESC_IF->plot_send_points(sample.time, sample.values[i]);
     }
 }
 
@@ -118,18 +388,41 @@ void data_recorder_send_experiment_plot(DataRecord *dr) {
         return;
     }
 
+    if (dr->encoding != DATA_RECORD_ENCODING_RAW) {
+        log_msg("Data Record experiment plot is only supported with raw encoding.");
+        return;
+    }
+
     VESC_IF->plot_init("t", "v");
 
-#define ADD_GRAPH(id) VESC_IF->plot_add_graph(#id);
+    uint8_t channel = 0;
+#define ADD_GRAPH(id)                                                                              \
+    if (dr->channel_mask & (1u << channel++)) {                                                    \
+        VESC_IF->plot_add_graph(#id);                                                              \
+    }
     VISIT_REC(RT_DATA_ALL_ITEMS, ADD_GRAPH);
 #undef ADD_GRAPH
 
-    circular_buffer_iterate(&dr->buffer, &send_point_vt_experiment, 0);
+    circular_buffer_iterate(&dr->buffer, &send_point_vt_experiment, dr);
+}
+
+/**
+ * Stops the recording and waits for the main loop to finish writing the last
+ * sample and to flush the partially filled block, so that the data don't
+ * change while they're being sent.
+ */
+static void pause_recording(DataRecord *dr) {
+    if (!dr->recording && sample_encoder_empty(&dr->encoder)) {
+        return;
+    }
+
+    make_request(dr, DATA_RECORD_REQUEST_STOP);
 }
 
 typedef enum {
     COMMAND_DATA_RECORD_HEADER = 42,
     COMMAND_DATA_RECORD_DATA = 43,
+    COMMAND_DATA_RECORD_FRAME = 46,
 } DataRecordCommands;
 
 static void send_header(DataRecord *dr) {
@@ -142,11 +435,60 @@ static void send_header(DataRecord *dr) {
 
     buffer_append_uint32(buf, circular_buffer_size(&dr->buffer), &ind);
 
-    buf[ind++] = ITEMS_COUNT_REC(RT_DATA_ALL_ITEMS);
-#define ADD_ID(id) buffer_append_string(buf, #id, &ind);
+    buf[ind++] = dr->value_count;
+    uint8_t channel = 0;
+#define ADD_ID(id)                                                                                 \
+    if (dr->channel_mask & (1u << channel++)) {                                                    \
+        buffer_append_string(buf, #id, &ind);                                                      \
+    }
     VISIT_REC(RT_DATA_ALL_ITEMS, ADD_ID);
 #undef ADD_ID
 
+    buf[ind++] = dr->encoding;
+    buffer_append_uint16(buf, dr->decimation, &ind);
+    buf[ind++] = dr->trigger_events;
+    buf[ind++] = dr->triggered;
+
+    SEND_APP_DATA(buf, bufsize, ind);
+}
+
+static void append_block(const uint8_t *block, uint8_t *buf, int32_t *ind) {
+    // only the used part of the block is sent, it starts with its length
+    uint16_t length = block[0] << 8 | block[1];
+    memcpy(&buf[*ind], block, length);
+    *ind += length;
+}
+
+static void append_raw_sample(
+    const DataRecord *dr, const Sample *sample, uint8_t *buf, int32_t *ind
+) {
+    buffer_append_uint32(buf, sample->time, ind);
+    buf[(*ind)++] = sample->flags;
+
+    for (size_t i = 0; i < dr->value_count; ++i) {
+        buffer_append_uint16(buf, sample->values[i], ind);
+    }
+}
+
+static void send_blocks(const DataRecord *dr, size_t offset) {
+    static const int bufsize = SEND_BUF_MAX_SIZE;
+    uint8_t buf[bufsize];
+    int32_t ind = 0;
+
+    buf[ind++] = 101;  // Package ID
+    buf[ind++] = COMMAND_DATA_RECORD_DATA;
+
+    buffer_append_uint32(buf, offset, &ind);
+
+    uint8_t block[DATA_RECORD_BLOCK_SIZE];
+    while (circular_buffer_get(&dr->buffer, offset++, block)) {
+        append_block(block, buf, &ind);
+
+        if (ind + DATA_RECORD_BLOCK_SIZE > bufsize) {
+            break;
+        }
+    }
+
     SEND_APP_DATA(buf, bufsize, ind);
 }
 
@@ -155,6 +497,11 @@ static void send_data(const DataRecord *dr, size_t offset) {
         return;
     }
 
+    if (dr->encoding == DATA_RECORD_ENCODING_COMPRESSED) {
+        send_blocks(dr, offset);
+        return;
+    }
+
     static const int bufsize = SEND_BUF_MAX_SIZE;
     uint8_t buf[bufsize];
     int32_t ind = 0;
@@ -165,23 +512,88 @@ static void send_data(const DataRecord *dr, size_t offset) {
     buffer_append_uint32(buf, offset, &ind);
 
     Sample sample;
-    while (circular_buffer_get(&dr->buffer, offset++, &sample)) {
-        buffer_append_uint32(buf, sample.time, &ind);
-        buf[ind++] = sample.flags;
+    while (get_raw_sample(dr, offset++, &sample)) {
+        append_raw_sample(dr, &sample, buf, &ind);
 
-        for (size_t i = 0; i < ITEMS_COUNT_REC(RT_DATA_ALL_ITEMS); ++i) {
-            buffer_append_uint16(buf, sample.values[i], &ind);
+        // 4 bytes for time, 1 byte for flags, 2 bytes for each active value
+        if (ind + raw_sample_size(dr) > bufsize) {
+            break;
         }
+    }
 
-        // 4 bytes for time, 1 byte for flags, 2 bytes for rest of the values
-        if (ind + 4 + 1 + 2 * ITEMS_COUNT_REC(RT_DATA_ALL_ITEMS) > bufsize) {
-            break;
+    SEND_APP_DATA(buf, bufsize, ind);
+}
+
+static void send_frame(const DataRecord *dr, uint16_t seq) {
+    static const int bufsize = SEND_BUF_MAX_SIZE;
+    uint8_t buf[bufsize];
+    int32_t ind = 0;
+
+    buf[ind++] = 101;  // Package ID
+    buf[ind++] = COMMAND_DATA_RECORD_FRAME;
+
+    size_t offset = seq * dr->download_frame_items;
+    buffer_append_uint16(buf, seq, &ind);
+    buffer_append_uint16(buf, dr->download_frame_count, &ind);
+    buffer_append_uint32(buf, offset, &ind);
+
+    for (size_t i = offset; i < offset + dr->download_frame_items; ++i) {
+        if (dr->encoding == DATA_RECORD_ENCODING_COMPRESSED) {
+            uint8_t block[DATA_RECORD_BLOCK_SIZE];
+            if (!circular_buffer_get(&dr->buffer, i, block)) {
+                break;
+            }
+            append_block(block, buf, &ind);
+        } else {
+            Sample sample;
+            if (!get_raw_sample(dr, i, &sample)) {
+                break;
+            }
+            append_raw_sample(dr, &sample, buf, &ind);
         }
     }
 
+    // the CRC covers the frame without the package and command IDs
+    buffer_append_uint32(buf, utils_crc32c(&buf[2], ind - 2), &ind);
+
     SEND_APP_DATA(buf, bufsize, ind);
 }
 
+static void send_frames(DataRecord *dr, uint16_t seq, uint8_t count) {
+    dr->download_timer = VESC_IF->system_time();
+
+    uint32_t end = min((uint32_t) seq + count, (uint32_t) dr->download_frame_count);
+    for (uint32_t i = seq; i < end; ++i) {
+        send_frame(dr, i);
+    }
+}
+
+static void start_download(DataRecord *dr, uint8_t window) {
+    pause_recording(dr);
+
+    size_t item_size = dr->encoding == DATA_RECORD_ENCODING_COMPRESSED ? DATA_RECORD_BLOCK_SIZE
+                                                                         : raw_sample_size(dr);
+    dr->download_frame_items = FRAME_DATA_SIZE / item_size;
+    dr->download_frame_count =
+        (circular_buffer_size(&dr->buffer) + dr->download_frame_items - 1) /
+        dr->download_frame_items;
+    dr->download_window = max(min(window, DOWNLOAD_MAX_WINDOW), 1);
+    dr->downloading = true;
+
+    send_header(dr);
+    send_frames(dr, 0, dr->download_window);
+}
+
+static void acknowledge_frames(DataRecord *dr, uint16_t seq) {
+    if (seq >= dr->download_frame_count) {
+        // all frames received
+        dr->downloading = false;
+        return;
+    }
+
+    send_frames(dr, seq, dr->download_window);
+}
+
 void data_recorder_request(DataRecord *dr, uint8_t *buffer, size_t len) {
     if (!dr->enabled) {
         log_error("Data Record not supported.");
@@ -197,27 +609,50 @@ void data_recorder_request(DataRecord *dr, uint8_t *buffer, size_t len) {
     uint8_t mode = buffer[ind++];
     uint8_t sub_mode = buffer[ind++];
     if (mode == 1) {  // control
-        if (len < 3) {
+        // decimation rate and post-trigger samples have a 16-bit value, channel mask 32-bit
+        size_t value_size = 1;
+        if (sub_mode == 6 || sub_mode == 8) {
+            value_size = 2;
+        } else if (sub_mode == 9) {
+            value_size = 4;
+        }
+        if (len < 2 + value_size) {
             log_error("Data Record request missing value, length: %u", len);
             return;
         }
-        uint8_t value = buffer[ind++];
+
+        uint32_t value;
+        if (value_size == 4) {
+            value = buffer_get_uint32(buffer, &ind);
+        } else if (value_size == 2) {
+            value = buffer_get_uint16(buffer, &ind);
+        } else {
+            value = buffer[ind++];
+        }
+
         if (sub_mode == 1) {  // start/stop recording
-            if (value > 0) {
-                start_recording(dr);
-            } else {
-                stop_recording(dr);
-            }
+            make_request(dr, value > 0 ? DATA_RECORD_REQUEST_START : DATA_RECORD_REQUEST_STOP);
         } else if (sub_mode == 2) {  // set autostart on engage
             dr->autostart = value;
         } else if (sub_mode == 3) {  // set autostop on disengage
             dr->autostop = value;
+        } else if (sub_mode == 4) {  // set encoding
+            set_encoding(dr, value);
+        } else if (sub_mode == 5) {  // set decimation
+            dr->decimation = max(value, 1u);
+        } else if (sub_mode == 6) {  // set decimation by target rate
+            set_rate(dr, value);
+        } else if (sub_mode == 7) {  // set trigger events
+            dr->trigger_events = value;
+            dr->triggered = false;
+        } else if (sub_mode == 8) {  // set post-trigger samples
+            dr->post_trigger_samples = value;
+        } else if (sub_mode == 9) {  // set recorded channels
+            set_channel_mask(dr, value);
         }
     } else if (mode == 2) {  // send
         if (sub_mode == 1) {  // header
-            // pause recording; in theory a race, but the delay between sending the header
-            // and getting a data request should be enough for any writing to end
-            stop_recording(dr);
+            pause_recording(dr);
             send_header(dr);
         } else if (sub_mode == 2) {  // data
             if (len < 6) {
@@ -227,6 +662,38 @@ void data_recorder_request(DataRecord *dr, uint8_t *buffer, size_t len) {
 
             size_t offset = buffer_get_uint32(buffer, &ind);
             send_data(dr, offset);
+        } else if (sub_mode == 3) {  // bulk download
+            if (len < 3) {
+                log_error("Data Record request missing window, length: %u", len);
+                return;
+            }
+
+            start_download(dr, buffer[ind++]);
+        } else if (sub_mode >= 4 && sub_mode <= 6) {
+            if (!dr->downloading) {
+                log_error("Data Record bulk download not started.");
+                return;
+            }
+
+            if (sub_mode == 4) {  // acknowledge
+                if (len < 4) {
+                    log_error("Data Record request missing seq, length: %u", len);
+                    return;
+                }
+
+                acknowledge_frames(dr, buffer_get_uint16(buffer, &ind));
+            } else if (sub_mode == 5) {  // retransmit
+                if (len < 5) {
+                    log_error("Data Record request missing frame range, length: %u", len);
+                    return;
+                }
+
+                uint16_t seq = buffer_get_uint16(buffer, &ind);
+                uint8_t count = buffer[ind++];
+                send_frames(dr, seq, min(count, (uint8_t) DOWNLOAD_MAX_WINDOW));
+            } else {  // end bulk download
+                dr->downloading = false;
+            }
         }
     }
 }
@@ -31,10 +31,20 @@
 
 void data_recorder_init(DataRecord *dr);
 
+void data_recorder_destroy(DataRecord *dr);
+
 bool data_recorder_has_capability(const DataRecord *dr);
 
+void data_recorder_configure(DataRecord *dr, float frequency);
+
 void data_recorder_trigger(DataRecord *dr, bool engage);
 
+/**
+ * Reports an event which triggers the capture in trigger mode, if @p event is
+ * among the events selected for triggering.
+ */
+void data_recorder_event(DataRecord *dr, DataRecordEvent event);
+
 void data_recorder_sample(DataRecord *dr, const Data *data, time_t time);
 
 void data_recorder_request(DataRecord *dr, uint8_t *buffer, size_t len);
@@ -0,0 +1,98 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "led_color.h"
+
+// (1 - cos(x)) / 2 over [0, PI] in 64 steps, scaled to 0xFFFF
+static const uint16_t cosine_table[65] = {
+    0, 39, 158, 355, 630, 982, 1411, 1915,
+    2494, 3146, 3869, 4662, 5522, 6448, 7438, 8488,
+    9597, 10762, 11980, 13248, 14563, 15922, 17321, 18758,
+    20228, 21728, 23256, 24806, 26375, 27960, 29556, 31160,
+    32768, 34375, 35979, 37575, 39160, 40729, 42279, 43807,
+    45307, 46777, 48214, 49613, 50972, 52287, 53555, 54773,
+    55938, 57047, 58097, 59087, 60013, 60873, 61666, 62389,
+    63041, 63620, 64124, 64553, 64905, 65180, 65377, 65496,
+    65535,
+};
+
+uint16_t color_wave(uint32_t phase) {
+    // mirror the falling half to the rising one
+    uint32_t x = phase % COLOR_WAVE_PERIOD;
+    if (x >= COLOR_WAVE_PERIOD / 2) {
+        x = COLOR_WAVE_PERIOD - x;
+    }
+
+    uint32_t i = x >> 6;
+    uint32_t value = cosine_table[i];
+    if (i < 64) {
+        value += ((cosine_table[i + 1] - value) * (x & 0x3F)) >> 6;
+    }
+    return (value + 0x80) >> 8;
+}
+
+// Colors for hue in range [0..255], the hue of each channel is a cosine wave
+// tweaked to make the hue more uniform.
+static const uint32_t hue_colors[256] = {
+    0x00F700E2, 0x00F800DF, 0x00F900DC, 0x00FA00D8, 0x00FB00D5, 0x00FB00D1,
+    0x00FC00CD, 0x00FC00C8, 0x00FD00C4, 0x00FD00BF, 0x00FD00BA, 0x00FD00B5,
+    0x00FE00AF, 0x00FE00AA, 0x00FE00A4, 0x00FE009E, 0x00FE0097, 0x00FE0091,
+    0x00FE008A, 0x00FE0083, 0x00FE007C, 0x00FE0074, 0x00FE006D, 0x00FE0065,
+    0x00FE005E, 0x00FE0057, 0x00FE004F, 0x00FE0048, 0x00FE0041, 0x00FE003A,
+    0x00FE0033, 0x00FE002C, 0x00FE0026, 0x00FE001F, 0x00FE001A, 0x00FE0014,
+    0x00FE0010, 0x00FE000B, 0x00FF0008, 0x00FF0004, 0x00FF0002, 0x00FF0000,
+    0x00FF0000, 0x00FF0000, 0x00FF0100, 0x00FF0300, 0x00FF0500, 0x00FF0900,
+    0x00FE0D00, 0x00FE1200, 0x00FE1800, 0x00FE1E00, 0x00FE2400, 0x00FE2B00,
+    0x00FE3200, 0x00FE3A00, 0x00FE4100, 0x00FE4900, 0x00FE5100, 0x00FE5900,
+    0x00FE6100, 0x00FE6900, 0x00FE7100, 0x00FE7900, 0x00FE8000, 0x00FE8800,
+    0x00FE8F00, 0x00FE9600, 0x00FE9D00, 0x00FEA400, 0x00FEAA00, 0x00FEB000,
+    0x00FEB600, 0x00FEBB00, 0x00FDC000, 0x00FDC500, 0x00FDCA00, 0x00FDCE00,
+    0x00FCD200, 0x00FCD600, 0x00FBDA00, 0x00FBDD00, 0x00FAE000, 0x00F9E300,
+    0x00F8E600, 0x00F7E800, 0x00F6EB00, 0x00F5ED00, 0x00F3EF00, 0x00F1F100,
+    0x00EFF200, 0x00EDF400, 0x00EBF500, 0x00E9F600, 0x00E6F700, 0x00E3F800,
+    0x00DFF900, 0x00DBFA00, 0x00D7FB00, 0x00D3FB00, 0x00CEFC00, 0x00C9FC00,
+    0x00C3FD00, 0x00BEFD00, 0x00B7FD00, 0x00B0FD00, 0x00A9FE00, 0x00A1FE00,
+    0x0099FE00, 0x0091FE00, 0x0088FE00, 0x007EFE00, 0x0075FE00, 0x006BFE00,
+    0x0061FE00, 0x0057FE00, 0x004DFE00, 0x0043FE00, 0x0039FE00, 0x0030FE00,
+    0x0027FE00, 0x001EFE00, 0x0016FE00, 0x000FFE00, 0x0009FE00, 0x0005FE00,
+    0x0001FF00, 0x0000FF00, 0x0000FF00, 0x0000FF00, 0x0000FE02, 0x0000FE04,
+    0x0000FE08, 0x0000FE0B, 0x0000FE10, 0x0000FE14, 0x0000FE1A, 0x0000FE1F,
+    0x0000FE26, 0x0000FE2C, 0x0000FE33, 0x0000FE3A, 0x0000FE41, 0x0000FE48,
+    0x0000FE4F, 0x0000FE57, 0x0000FE5E, 0x0000FE65, 0x0000FE6D, 0x0000FE74,
+    0x0000FD7C, 0x0000FD83, 0x0000FD8A, 0x0000FD91, 0x0000FC97, 0x0000FC9E,
+    0x0000FBA4, 0x0000FBAA, 0x0000FAAF, 0x0000F9B5, 0x0000F8BA, 0x0000F7BF,
+    0x0000F6C4, 0x0000F5C8, 0x0000F4CD, 0x0000F2D1, 0x0000F1D5, 0x0000EFD8,
+    0x0000EDDC, 0x0000EBDF, 0x0000E8E2, 0x0000E6E4, 0x0000E3E7, 0x0000E0E9,
+    0x0000DDEC, 0x0000DAEE, 0x0000D6EF, 0x0000D2F1, 0x0000CEF3, 0x0000CAF4,
+    0x0000C5F5, 0x0000C0F7, 0x0000BBF8, 0x0000B6F9, 0x0000B0F9, 0x0000AAFA,
+    0x0000A4FB, 0x00009DFB, 0x000096FC, 0x00008FFC, 0x000088FD, 0x000080FD,
+    0x000079FD, 0x000071FE, 0x000069FE, 0x000061FE, 0x000059FE, 0x000051FE,
+    0x000049FE, 0x000041FE, 0x00003AFE, 0x000032FE, 0x00002BFE, 0x000024FE,
+    0x00001EFE, 0x000018FE, 0x000012FE, 0x00000DFE, 0x000009FE, 0x000005FE,
+    0x000003FE, 0x000001FE, 0x000000FF, 0x000000FF, 0x000100FE, 0x000500FE,
+    0x000900FE, 0x000F00FE, 0x001600FE, 0x001E00FE, 0x002700FE, 0x003000FE,
+    0x003900FE, 0x004300FE, 0x004D00FE, 0x005700FE, 0x006100FE, 0x006B00FE,
+    0x007500FE, 0x007E00FE, 0x008800FE, 0x009100FE, 0x009900FE, 0x00A100FD,
+    0x00A900FD, 0x00B000FD, 0x00B700FC, 0x00BE00FC, 0x00C300FB, 0x00C900FB,
+    0x00CE00FA, 0x00D300F9, 0x00D700F9, 0x00DB00F8, 0x00DF00F7, 0x00E300F5,
+    0x00E600F4, 0x00E900F3, 0x00EB00F1, 0x00ED00EF, 0x00EF00EE, 0x00F100EC,
+    0x00F300E9, 0x00F500E7, 0x00F600E4, 0x00F700E2,
+};
+
+uint32_t color_hue(uint8_t hue) {
+    return hue_colors[hue];
+}
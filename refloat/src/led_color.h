@@ -0,0 +1,73 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stdint.h>
+
+// Colors are processed in fixed point. Blend and brightness factors are Q8
+// (0..256 representing 0..1) and the channels are processed two at a time in
+// a uint32_t (R and B, W and G), each having a 16-bit lane to multiply in.
+#define Q8_ONE 256
+
+// Converts a float in the range [0, 1] to Q8, clamping it to the range.
+static inline uint16_t q8(float x) {
+    if (x <= 0.0f) {
+        return 0;
+    } else if (x >= 1.0f) {
+        return Q8_ONE;
+    }
+    return x * Q8_ONE + 0.5f;
+}
+
+// Scales all channels of a color by a Q8 factor, rounding to nearest.
+static inline uint32_t color_scale(uint32_t color, uint16_t k) {
+    uint32_t rb = (((color & 0x00FF00FF) * k + 0x00800080) >> 8) & 0x00FF00FF;
+    uint32_t wg = (((color >> 8) & 0x00FF00FF) * k + 0x00800080) & 0xFF00FF00;
+    return rb | wg;
+}
+
+// Blends color1 into color2 by a Q8 factor, truncating.
+static inline uint32_t color_blend(uint32_t color1, uint32_t color2, uint16_t blend) {
+    if (blend == 0) {
+        return color1;
+    } else if (blend >= Q8_ONE) {
+        return color2;
+    }
+
+    uint16_t blend1 = Q8_ONE - blend;
+    uint32_t rb = (((color1 & 0x00FF00FF) * blend1 + (color2 & 0x00FF00FF) * blend) >> 8) &
+        0x00FF00FF;
+    uint32_t wg =
+        (((color1 >> 8) & 0x00FF00FF) * blend1 + ((color2 >> 8) & 0x00FF00FF) * blend) &
+        0xFF00FF00;
+    return rb | wg;
+}
+
+// Period of color_wave() in its phase units, which are 1/4096 s for a 2 s period.
+#define COLOR_WAVE_PERIOD 8192
+
+/**
+ * Returns a cosine wave in Q8 oscillating from 0 to 1: (1 - cos(x)) / 2,
+ * starting at 0 for @p phase = 0, with a period of COLOR_WAVE_PERIOD.
+ */
+uint16_t color_wave(uint32_t phase);
+
+/**
+ * Returns the color for @p hue in range [0..255], going around the color wheel.
+ */
+uint32_t color_hue(uint8_t hue);
@@ -29,12 +29,65 @@
 #define WS2812_ZERO (((uint32_t) TIM_PERIOD) * 0.3)
 #define WS2812_ONE (((uint32_t) TIM_PERIOD) * 0.7)
 
+// Resend the (unchanged) bitbuffer every this many paints, so that a LED that
+// latched a glitch recovers
+#define REFRESH_PAINTS 30
+
+#define NIBBLE_BIT(n, bit) (((n) >> (bit)) & 0x1 ? WS2812_ONE : WS2812_ZERO)
+#define NIBBLE_SLOTS(n) {NIBBLE_BIT(n, 3), NIBBLE_BIT(n, 2), NIBBLE_BIT(n, 1), NIBBLE_BIT(n, 0)}
+
+// PWM slots of a nibble, MSB first
+static const uint16_t nibble_slots[16][4] = {
+    NIBBLE_SLOTS(0),
+    NIBBLE_SLOTS(1),
+    NIBBLE_SLOTS(2),
+    NIBBLE_SLOTS(3),
+    NIBBLE_SLOTS(4),
+    NIBBLE_SLOTS(5),
+    NIBBLE_SLOTS(6),
+    NIBBLE_SLOTS(7),
+    NIBBLE_SLOTS(8),
+    NIBBLE_SLOTS(9),
+    NIBBLE_SLOTS(10),
+    NIBBLE_SLOTS(11),
+    NIBBLE_SLOTS(12),
+    NIBBLE_SLOTS(13),
+    NIBBLE_SLOTS(14),
+    NIBBLE_SLOTS(15),
+};
+
+// (c * c + c) / 256
+static const uint8_t gamma_table[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 3, 3, 3, 3,
+    4, 4, 4, 4, 5, 5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8,
+    9, 9, 9, 10, 10, 11, 11, 12, 12, 12, 13, 13, 14, 14, 15, 15,
+    16, 16, 17, 17, 18, 18, 19, 19, 20, 21, 21, 22, 22, 23, 24, 24,
+    25, 25, 26, 27, 27, 28, 29, 29, 30, 31, 31, 32, 33, 34, 34, 35,
+    36, 37, 37, 38, 39, 40, 41, 41, 42, 43, 44, 45, 45, 46, 47, 48,
+    49, 50, 51, 52, 53, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63,
+    64, 65, 66, 67, 68, 69, 70, 71, 72, 73, 74, 76, 77, 78, 79, 80,
+    81, 82, 83, 84, 86, 87, 88, 89, 90, 92, 93, 94, 95, 96, 98, 99,
+    100, 101, 103, 104, 105, 106, 108, 109, 110, 112, 113, 114, 116, 117, 118, 120,
+    121, 123, 124, 125, 127, 128, 130, 131, 132, 134, 135, 137, 138, 140, 141, 143,
+    144, 146, 147, 149, 150, 152, 153, 155, 157, 158, 160, 161, 163, 164, 166, 168,
+    169, 171, 173, 174, 176, 178, 179, 181, 183, 184, 186, 188, 189, 191, 193, 195,
+    196, 198, 200, 202, 203, 205, 207, 209, 211, 212, 214, 216, 218, 220, 222, 224,
+    225, 227, 229, 231, 233, 235, 237, 239, 241, 243, 245, 247, 249, 251, 253, 255,
+};
+
+// Shifts of the channels in the RGBW color value in the order they are sent out
+static const uint8_t channel_shifts_grb[] = {8, 16, 0};
+static const uint8_t channel_shifts_grbw[] = {8, 16, 0, 24};
+static const uint8_t channel_shifts_rgb[] = {16, 8, 0};
+static const uint8_t channel_shifts_wrgb[] = {24, 16, 8, 0};
+
 static const PinHwConfig pin_hw_configs[] = {
     {
         .pin_port = GPIOB,
         .pin_nr = 6,
         .timer = TIM4,
-        .ccr_address = (uint32_t) &TIM4->CCR1,
+        .ccr_address = (uint32_t) (uintptr_t) &TIM4->CCR1,
         .rcc_apb1_periph = RCC_APB1Periph_TIM4,
         .timer_ccmr = &TIM4->CCMR1,
         .timer_ccmr_shift = 0,
@@ -48,7 +101,7 @@ static const PinHwConfig pin_hw_configs[] = {
         .pin_port = GPIOB,
         .pin_nr = 7,
         .timer = TIM4,
-        .ccr_address = (uint32_t) &TIM4->CCR2,
+        .ccr_address = (uint32_t) (uintptr_t) &TIM4->CCR2,
         .rcc_apb1_periph = RCC_APB1Periph_TIM4,
         .timer_ccmr = &TIM4->CCMR1,
         .timer_ccmr_shift = 8,
@@ -62,7 +115,7 @@ static const PinHwConfig pin_hw_configs[] = {
         .pin_port = GPIOC,
         .pin_nr = 9,
         .timer = TIM3,
-        .ccr_address = (uint32_t) &TIM3->CCR4,
+        .ccr_address = (uint32_t) (uintptr_t) &TIM3->CCR4,
         .rcc_apb1_periph = RCC_APB1Periph_TIM3,
         .timer_ccmr = &TIM3->CCMR2,
         .timer_ccmr_shift = 8,
@@ -128,13 +181,18 @@ static void init_dma_stream(const PinHwConfig *pin_hw_cfg, uint16_t *buf, uint32
 
     pin_hw_cfg->dma_stream->FCR = 0x00000020 | DMA_FIFOThreshold_Full;
 
-    pin_hw_cfg->dma_stream->M0AR = (uint32_t) buf;
+    pin_hw_cfg->dma_stream->M0AR = (uint32_t) (uintptr_t) buf;
     pin_hw_cfg->dma_stream->NDTR = buf_len;
     pin_hw_cfg->dma_stream->PAR = pin_hw_cfg->ccr_address;
 
     enable_dma_stream(pin_hw_cfg);
 }
 
+static bool dma_stream_busy(const PinHwConfig *pin_hw_cfg) {
+    // in normal mode the EN bit is cleared by hardware at the end of the transfer
+    return pin_hw_cfg->dma_stream->CR & DMA_SxCR_EN;
+}
+
 static void reset_dma_stream_transfer_complete(const PinHwConfig *pin_hw_cfg) {
     DMA1->LIFCR |= DMA_LIFCR_CTCIF0 << pin_hw_cfg->dma_if_shift;
 }
@@ -147,6 +205,16 @@ static void enable_timer_dma(const PinHwConfig *pin_hw_cfg) {
     pin_hw_cfg->timer->DIER |= pin_hw_cfg->dma_source;
 }
 
+static void start_transfer(const PinHwConfig *cfg, uint16_t *buf, uint32_t buf_len) {
+    disable_timer_dma(cfg);
+    disable_dma_stream(cfg);
+    reset_dma_stream_transfer_complete(cfg);
+    cfg->dma_stream->M0AR = (uint32_t) (uintptr_t) buf;
+    cfg->dma_stream->NDTR = buf_len;
+    enable_dma_stream(cfg);
+    enable_timer_dma(cfg);
+}
+
 static void init_hw(
     const PinHwConfig *cfg, LedPinConfig pin_config, uint16_t *buffer, uint32_t length
 ) {
@@ -180,9 +248,29 @@ inline static uint8_t color_order_bits(LedColorOrder order) {
     return 24;
 }
 
+inline static const uint8_t *color_order_shifts(LedColorOrder order) {
+    switch (order) {
+    case LED_COLOR_GRBW:
+        return channel_shifts_grbw;
+    case LED_COLOR_WRGB:
+        return channel_shifts_wrgb;
+    case LED_COLOR_GRB:
+        return channel_shifts_grb;
+    case LED_COLOR_RGB:
+        return channel_shifts_rgb;
+    }
+
+    return channel_shifts_grb;
+}
+
+static uint16_t *get_bitbuffer(const LedDriver *driver, uint8_t index) {
+    return driver->bitbuffer + index * driver->bitbuffer_length;
+}
+
 void led_driver_init(LedDriver *driver) {
     driver->bitbuffer_length = 0;
     driver->bitbuffer = NULL;
+    driver->painted_data = NULL;
 }
 
 bool led_driver_setup(
@@ -195,66 +283,80 @@ bool led_driver_setup(
     driver->pin_hw_config = &pin_hw_configs[pin];
 
     driver->bitbuffer_length = 0;
+    driver->front = 0;
+    driver->swap_pending = false;
+    driver->refresh_countdown = REFRESH_PAINTS;
 
-    size_t offsets[3] = {0};
+    size_t led_count = 0;
     for (size_t i = 0; i < STRIP_COUNT; ++i) {
         const LedStrip *strip = led_strips[i];
+        driver->strips[i] = strip;
+        driver->strip_painted[i] = NULL;
+        driver->strip_stale[i] = 0;
         if (!strip) {
-            driver->strips[i] = NULL;
-            driver->strip_bitbuffs[i] = NULL;
             continue;
         }
 
-        driver->strips[i] = strip;
-        offsets[i] = driver->bitbuffer_length;
+        driver->strip_offsets[i] = driver->bitbuffer_length;
         driver->bitbuffer_length += color_order_bits(strip->color_order) * strip->length;
+        led_count += strip->length;
     }
 
     // An extra array item to set the output to 0 PWM
     ++driver->bitbuffer_length;
-    driver->bitbuffer = VESC_IF->malloc(sizeof(uint16_t) * driver->bitbuffer_length);
+    driver->bitbuffer = VESC_IF->malloc(sizeof(uint16_t) * driver->bitbuffer_length * 2);
+    // An extra item so that the allocation isn't empty
+    driver->painted_data = VESC_IF->malloc(sizeof(uint32_t) * (led_count + 1));
     driver->pin = pin;
 
-    if (!driver->bitbuffer) {
+    if (!driver->bitbuffer || !driver->painted_data) {
         log_error("Failed to init LED driver, out of memory.");
+        if (driver->bitbuffer) {
+            VESC_IF->free(driver->bitbuffer);
+            driver->bitbuffer = NULL;
+        }
+        if (driver->painted_data) {
+            VESC_IF->free(driver->painted_data);
+            driver->painted_data = NULL;
+        }
         return false;
     }
 
+    // Both bitbuffers and the painted colors start out black
+    uint32_t *painted = driver->painted_data;
     for (size_t i = 0; i < STRIP_COUNT; ++i) {
         if (driver->strips[i]) {
-            driver->strip_bitbuffs[i] = driver->bitbuffer + offsets[i];
+            driver->strip_painted[i] = painted;
+            memset(painted, 0, sizeof(uint32_t) * driver->strips[i]->length);
+            painted += driver->strips[i]->length;
         }
     }
 
-    for (uint32_t i = 0; i < driver->bitbuffer_length - 1; ++i) {
-        driver->bitbuffer[i] = WS2812_ZERO;
+    for (uint8_t b = 0; b < 2; ++b) {
+        uint16_t *bitbuffer = get_bitbuffer(driver, b);
+        for (uint32_t i = 0; i < driver->bitbuffer_length - 1; ++i) {
+            bitbuffer[i] = WS2812_ZERO;
+        }
+        bitbuffer[driver->bitbuffer_length - 1] = 0;
     }
-    driver->bitbuffer[driver->bitbuffer_length - 1] = 0;
 
     init_hw(driver->pin_hw_config, pin_config, driver->bitbuffer, driver->bitbuffer_length);
     return true;
 }
 
-inline static uint8_t cgamma(uint8_t c) {
-    return (c * c + c) / 256;
-}
-
-static uint32_t color_grb(uint8_t w, uint8_t r, uint8_t g, uint8_t b) {
-    unused(w);
-    return (g << 16) | (r << 8) | b;
-}
-
-static uint32_t color_grbw(uint8_t w, uint8_t r, uint8_t g, uint8_t b) {
-    return (g << 24) | (r << 16) | (b << 8) | w;
-}
-
-static uint32_t color_rgb(uint8_t w, uint8_t r, uint8_t g, uint8_t b) {
-    unused(w);
-    return (r << 16) | (g << 8) | b;
-}
-
-static uint32_t color_wrgb(uint8_t w, uint8_t r, uint8_t g, uint8_t b) {
-    return (w << 24) | (r << 16) | (g << 8) | b;
+static void paint_strip(uint16_t *buf, const LedStrip *strip) {
+    const uint8_t *shifts = color_order_shifts(strip->color_order);
+    const uint8_t channels = color_order_bits(strip->color_order) / 8;
+
+    for (uint32_t j = 0; j < strip->length; ++j) {
+        uint32_t color = strip->data[j];
+        for (uint8_t c = 0; c < channels; ++c) {
+            uint8_t value = gamma_table[(color >> shifts[c]) & 0xFF];
+            memcpy(buf, nibble_slots[value >> 4], sizeof(nibble_slots[0]));
+            memcpy(buf + 4, nibble_slots[value & 0xF], sizeof(nibble_slots[0]));
+            buf += 8;
+        }
+    }
 }
 
 void led_driver_paint(LedDriver *driver) {
@@ -265,50 +367,46 @@ void led_driver_paint(LedDriver *driver) {
     for (size_t i = 0; i < STRIP_COUNT; ++i) {
         const LedStrip *strip = driver->strips[i];
         if (!strip) {
-            break;
+            continue;
         }
 
-        uint32_t (*color_conv)(uint8_t, uint8_t, uint8_t, uint8_t);
-        switch (strip->color_order) {
-        case LED_COLOR_GRB:
-            color_conv = color_grb;
-            break;
-        case LED_COLOR_GRBW:
-            color_conv = color_grbw;
-            break;
-        case LED_COLOR_RGB:
-            color_conv = color_rgb;
-            break;
-        case LED_COLOR_WRGB:
-            color_conv = color_wrgb;
-            break;
+        size_t size = sizeof(uint32_t) * strip->length;
+        if (memcmp(driver->strip_painted[i], strip->data, size) != 0) {
+            memcpy(driver->strip_painted[i], strip->data, size);
+            driver->strip_stale[i] = 0x3;
+            driver->swap_pending = true;
         }
+    }
 
-        uint8_t bits = color_order_bits(strip->color_order);
-        uint16_t *strip_bitbuffer = driver->strip_bitbuffs[i];
-
-        for (uint32_t j = 0; j < strip->length; ++j) {
-            uint32_t color = strip->data[j];
-            uint8_t w = cgamma((color >> 24) & 0xFF);
-            uint8_t r = cgamma((color >> 16) & 0xFF);
-            uint8_t g = cgamma((color >> 8) & 0xFF);
-            uint8_t b = cgamma(color & 0xFF);
-
-            color = color_conv(w, r, g, b);
-
-            for (int8_t bit = bits - 1; bit >= 0; --bit) {
-                strip_bitbuffer[bit + j * bits] = color & 0x1 ? WS2812_ONE : WS2812_ZERO;
-                color >>= 1;
+    if (driver->swap_pending) {
+        // Only the back bitbuffer is painted into, the front one may still be
+        // being sent out. A changed strip is painted into each of the
+        // bitbuffers once, the other strips are left as they are.
+        uint8_t back = driver->front ^ 1;
+        for (size_t i = 0; i < STRIP_COUNT; ++i) {
+            if (driver->strips[i] && driver->strip_stale[i] & (1 << back)) {
+                uint16_t *buf = get_bitbuffer(driver, back) + driver->strip_offsets[i];
+                paint_strip(buf, driver->strips[i]);
+                driver->strip_stale[i] &= ~(1 << back);
             }
         }
     }
 
     const PinHwConfig *cfg = driver->pin_hw_config;
-    disable_timer_dma(cfg);
-    disable_dma_stream(cfg);
-    reset_dma_stream_transfer_complete(cfg);
-    enable_dma_stream(cfg);
-    enable_timer_dma(cfg);
+    if (dma_stream_busy(cfg)) {
+        // try again on the next paint, the back bitbuffer stays as it is
+        return;
+    }
+
+    if (driver->swap_pending) {
+        driver->front ^= 1;
+        driver->swap_pending = false;
+    } else if (--driver->refresh_countdown > 0) {
+        return;
+    }
+
+    driver->refresh_countdown = REFRESH_PAINTS;
+    start_transfer(cfg, get_bitbuffer(driver, driver->front), driver->bitbuffer_length);
 }
 
 void led_driver_destroy(LedDriver *driver) {
@@ -318,6 +416,8 @@ void led_driver_destroy(LedDriver *driver) {
 
         VESC_IF->free(driver->bitbuffer);
         driver->bitbuffer = NULL;
+        VESC_IF->free(driver->painted_data);
+        driver->painted_data = NULL;
     }
     driver->bitbuffer_length = 0;
 }
@@ -42,12 +42,22 @@ typedef struct {
 } PinHwConfig;
 
 typedef struct {
+    // Two bitbuffers of bitbuffer_length items each, one is being sent out by
+    // the DMA (front) while the other one is being painted into (back)
     uint16_t *bitbuffer;
     uint32_t bitbuffer_length;
+    uint8_t front;
+    bool swap_pending;
+    uint8_t refresh_countdown;
     LedPin pin;
     const PinHwConfig *pin_hw_config;
     const LedStrip *strips[STRIP_COUNT];
-    uint16_t *strip_bitbuffs[STRIP_COUNT];
+    uint32_t strip_offsets[STRIP_COUNT];
+    // Colors of the strips at the time they were last painted
+    uint32_t *painted_data;
+    uint32_t *strip_painted[STRIP_COUNT];
+    // Bitmask of bitbuffers which don't contain the current strip colors yet
+    uint8_t strip_stale[STRIP_COUNT];
 } LedDriver;
 
 void led_driver_init(LedDriver *driver);
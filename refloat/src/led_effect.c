@@ -0,0 +1,247 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "led_effect.h"
+
+#include "led_color.h"
+#include "utils.h"
+
+#include <string.h>
+
+// Operands of the instructions: which of d, a, b are registers and whether d
+// is a forward jump offset. The rest are immediates or unused.
+#define REG_D 0x1
+#define REG_A 0x2
+#define REG_B 0x4
+#define JUMP 0x8
+
+static const uint8_t operands[LED_EFFECT_OP_COUNT] = {
+    [LED_EFFECT_OP_END] = 0,
+    [LED_EFFECT_OP_LDI] = REG_D,
+    [LED_EFFECT_OP_LDHI] = REG_D,
+    [LED_EFFECT_OP_MOV] = REG_D | REG_A,
+    [LED_EFFECT_OP_ADDI] = REG_D | REG_A,
+    [LED_EFFECT_OP_ADD] = REG_D | REG_A | REG_B,
+    [LED_EFFECT_OP_SUB] = REG_D | REG_A | REG_B,
+    [LED_EFFECT_OP_MUL] = REG_D | REG_A | REG_B,
+    [LED_EFFECT_OP_DIV] = REG_D | REG_A | REG_B,
+    [LED_EFFECT_OP_MOD] = REG_D | REG_A | REG_B,
+    [LED_EFFECT_OP_MULQ] = REG_D | REG_A | REG_B,
+    [LED_EFFECT_OP_MIN] = REG_D | REG_A | REG_B,
+    [LED_EFFECT_OP_MAX] = REG_D | REG_A | REG_B,
+    [LED_EFFECT_OP_AND] = REG_D | REG_A | REG_B,
+    [LED_EFFECT_OP_OR] = REG_D | REG_A | REG_B,
+    [LED_EFFECT_OP_XOR] = REG_D | REG_A | REG_B,
+    [LED_EFFECT_OP_SHL] = REG_D | REG_A | REG_B,
+    [LED_EFFECT_OP_SHR] = REG_D | REG_A | REG_B,
+    [LED_EFFECT_OP_SAR] = REG_D | REG_A | REG_B,
+    [LED_EFFECT_OP_ABS] = REG_D | REG_A,
+    [LED_EFFECT_OP_WAVE] = REG_D | REG_A,
+    [LED_EFFECT_OP_HUE] = REG_D | REG_A,
+    [LED_EFFECT_OP_BLEND] = REG_D | REG_A | REG_B,
+    [LED_EFFECT_OP_SCALE] = REG_D | REG_A | REG_B,
+    [LED_EFFECT_OP_RAND] = REG_D | REG_A,
+    [LED_EFFECT_OP_JMP] = JUMP,
+    [LED_EFFECT_OP_JEQ] = JUMP | REG_A | REG_B,
+    [LED_EFFECT_OP_JNE] = JUMP | REG_A | REG_B,
+    [LED_EFFECT_OP_JLT] = JUMP | REG_A | REG_B,
+    [LED_EFFECT_OP_JGE] = JUMP | REG_A | REG_B,
+};
+
+void led_effect_init(LedEffect *effect) {
+    effect->length = 0;
+}
+
+static LedEffectResult validate(const LedEffectInstruction *ins, uint8_t index, uint8_t count) {
+    if (ins->op >= LED_EFFECT_OP_COUNT) {
+        return LED_EFFECT_ERR_OPCODE;
+    }
+
+    uint8_t ops = operands[ins->op];
+    if (((ops & REG_D) && ins->d >= LED_EFFECT_REGISTERS) ||
+        ((ops & REG_A) && ins->a >= LED_EFFECT_REGISTERS) ||
+        ((ops & REG_B) && ins->b >= LED_EFFECT_REGISTERS)) {
+        return LED_EFFECT_ERR_REGISTER;
+    }
+
+    // jumping right past the last instruction ends the program
+    if ((ops & JUMP) && index + 1 + ins->d > count) {
+        return LED_EFFECT_ERR_JUMP;
+    }
+
+    return LED_EFFECT_OK;
+}
+
+LedEffectResult led_effect_load(
+    LedEffect *effect, const uint8_t *code, uint8_t count, uint8_t *error_index
+) {
+    *error_index = 0;
+    if (count > LED_EFFECT_MAX_INSTRUCTIONS) {
+        return LED_EFFECT_ERR_LENGTH;
+    }
+
+    for (uint8_t i = 0; i < count; ++i) {
+        const uint8_t *c = &code[i * 4];
+        LedEffectInstruction ins = {.op = c[0], .d = c[1], .a = c[2], .b = c[3]};
+        LedEffectResult res = validate(&ins, i, count);
+        if (res != LED_EFFECT_OK) {
+            *error_index = i;
+            return res;
+        }
+    }
+
+    for (uint8_t i = 0; i < count; ++i) {
+        const uint8_t *c = &code[i * 4];
+        effect->code[i] = (LedEffectInstruction){.op = c[0], .d = c[1], .a = c[2], .b = c[3]};
+    }
+    effect->length = count;
+    return LED_EFFECT_OK;
+}
+
+uint8_t led_effect_store(const LedEffect *effect, uint8_t *buffer) {
+    for (uint8_t i = 0; i < effect->length; ++i) {
+        const LedEffectInstruction *ins = &effect->code[i];
+        buffer[i * 4] = ins->op;
+        buffer[i * 4 + 1] = ins->d;
+        buffer[i * 4 + 2] = ins->a;
+        buffer[i * 4 + 3] = ins->b;
+    }
+    return effect->length;
+}
+
+static inline uint16_t q8_factor(int32_t x) {
+    return min(max(x, 0), Q8_ONE);
+}
+
+uint32_t led_effect_run(const LedEffect *effect, const LedEffectFrame *frame, uint8_t index) {
+    int32_t r[LED_EFFECT_REGISTERS] = {0};
+    r[LED_EFFECT_REG_INDEX] = index;
+    r[LED_EFFECT_REG_LENGTH] = frame->length;
+    r[LED_EFFECT_REG_TIME] = frame->time;
+    r[LED_EFFECT_REG_COLOR1] = frame->color1;
+    r[LED_EFFECT_REG_COLOR2] = frame->color2;
+
+    // The arithmetic is done on unsigned values where signed overflow would
+    // be undefined, the results wrap around.
+    uint8_t pc = 0;
+    while (pc < effect->length) {
+        const LedEffectInstruction *ins = &effect->code[pc++];
+        int32_t *d = &r[ins->d & 0xF];
+        int32_t a = r[ins->a & 0xF];
+        int32_t b = r[ins->b & 0xF];
+
+        switch ((LedEffectOpcode) ins->op) {
+        case LED_EFFECT_OP_END:
+            return r[LED_EFFECT_REG_OUT];
+        case LED_EFFECT_OP_LDI:
+            *d = (int16_t) (ins->a << 8 | ins->b);
+            break;
+        case LED_EFFECT_OP_LDHI:
+            *d = (uint32_t) (ins->a << 8 | ins->b) << 16 | (*d & 0xFFFF);
+            break;
+        case LED_EFFECT_OP_MOV:
+            *d = a;
+            break;
+        case LED_EFFECT_OP_ADDI:
+            *d = (uint32_t) a + (int8_t) ins->b;
+            break;
+        case LED_EFFECT_OP_ADD:
+            *d = (uint32_t) a + b;
+            break;
+        case LED_EFFECT_OP_SUB:
+            *d = (uint32_t) a - b;
+            break;
+        case LED_EFFECT_OP_MUL:
+            *d = (uint32_t) a * b;
+            break;
+        case LED_EFFECT_OP_DIV:
+            if (b == 0) {
+                *d = 0;
+            } else if (b == -1) {
+                *d = -(uint32_t) a;
+            } else {
+                *d = a / b;
+            }
+            break;
+        case LED_EFFECT_OP_MOD:
+            *d = b == 0 || b == -1 ? 0 : a % b;
+            break;
+        case LED_EFFECT_OP_MULQ:
+            *d = (uint32_t) (((int64_t) a * b) >> 8);
+            break;
+        case LED_EFFECT_OP_MIN:
+            *d = min(a, b);
+            break;
+        case LED_EFFECT_OP_MAX:
+            *d = max(a, b);
+            break;
+        case LED_EFFECT_OP_AND:
+            *d = a & b;
+            break;
+        case LED_EFFECT_OP_OR:
+            *d = a | b;
+            break;
+        case LED_EFFECT_OP_XOR:
+            *d = a ^ b;
+            break;
+        case LED_EFFECT_OP_SHL:
+            *d = (uint32_t) a << (b & 0x1F);
+            break;
+        case LED_EFFECT_OP_SHR:
+            *d = (uint32_t) a >> (b & 0x1F);
+            break;
+        case LED_EFFECT_OP_SAR:
+            *d = a >> (b & 0x1F);
+            break;
+        case LED_EFFECT_OP_ABS:
+            *d = a < 0 ? -(uint32_t) a : (uint32_t) a;
+            break;
+        case LED_EFFECT_OP_WAVE:
+            *d = color_wave(a);
+            break;
+        case LED_EFFECT_OP_HUE:
+            *d = color_hue(a);
+            break;
+        case LED_EFFECT_OP_BLEND:
+            *d = color_blend(a, b, q8_factor(*d));
+            break;
+        case LED_EFFECT_OP_SCALE:
+            *d = color_scale(a, q8_factor(b));
+            break;
+        case LED_EFFECT_OP_RAND:
+            *d = rnd(a);
+            break;
+        case LED_EFFECT_OP_JMP:
+            pc += ins->d;
+            break;
+        case LED_EFFECT_OP_JEQ:
+            pc += a == b ? ins->d : 0;
+            break;
+        case LED_EFFECT_OP_JNE:
+            pc += a != b ? ins->d : 0;
+            break;
+        case LED_EFFECT_OP_JLT:
+            pc += a < b ? ins->d : 0;
+            break;
+        case LED_EFFECT_OP_JGE:
+            pc += a >= b ? ins->d : 0;
+            break;
+        }
+    }
+
+    return r[LED_EFFECT_REG_OUT];
+}
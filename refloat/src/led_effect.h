@@ -0,0 +1,136 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// A small register machine running user-defined LED effects. An effect is a
+// program of up to LED_EFFECT_MAX_INSTRUCTIONS instructions, run once for
+// every LED of a strip on every frame. The resulting color of the LED is the
+// value of the `out` register when the program ends.
+//
+// Programs are sandboxed: they can only read and write their own registers,
+// all arithmetic is defined for every input (division by zero yields 0) and
+// jumps can only go forward, so a program can't run more instructions than
+// it has. Programs are validated when loaded, the interpreter relies on it.
+//
+// See /doc/commands/LED_EFFECT.md for the instruction set.
+
+#define LED_EFFECT_MAX_INSTRUCTIONS 40
+#define LED_EFFECT_REGISTERS 16
+
+typedef enum {
+    LED_EFFECT_REG_INDEX = 0,
+    LED_EFFECT_REG_LENGTH = 1,
+    LED_EFFECT_REG_TIME = 2,
+    LED_EFFECT_REG_COLOR1 = 3,
+    LED_EFFECT_REG_COLOR2 = 4,
+    LED_EFFECT_REG_OUT = 5,
+} LedEffectRegister;
+
+typedef enum {
+    LED_EFFECT_OP_END = 0x00,
+    LED_EFFECT_OP_LDI = 0x01,
+    LED_EFFECT_OP_LDHI = 0x02,
+    LED_EFFECT_OP_MOV = 0x03,
+    LED_EFFECT_OP_ADDI = 0x04,
+    LED_EFFECT_OP_ADD = 0x05,
+    LED_EFFECT_OP_SUB = 0x06,
+    LED_EFFECT_OP_MUL = 0x07,
+    LED_EFFECT_OP_DIV = 0x08,
+    LED_EFFECT_OP_MOD = 0x09,
+    LED_EFFECT_OP_MULQ = 0x0A,
+    LED_EFFECT_OP_MIN = 0x0B,
+    LED_EFFECT_OP_MAX = 0x0C,
+    LED_EFFECT_OP_AND = 0x0D,
+    LED_EFFECT_OP_OR = 0x0E,
+    LED_EFFECT_OP_XOR = 0x0F,
+    LED_EFFECT_OP_SHL = 0x10,
+    LED_EFFECT_OP_SHR = 0x11,
+    LED_EFFECT_OP_SAR = 0x12,
+    LED_EFFECT_OP_ABS = 0x13,
+    LED_EFFECT_OP_WAVE = 0x14,
+    LED_EFFECT_OP_HUE = 0x15,
+    LED_EFFECT_OP_BLEND = 0x16,
+    LED_EFFECT_OP_SCALE = 0x17,
+    LED_EFFECT_OP_RAND = 0x18,
+    LED_EFFECT_OP_JMP = 0x19,
+    LED_EFFECT_OP_JEQ = 0x1A,
+    LED_EFFECT_OP_JNE = 0x1B,
+    LED_EFFECT_OP_JLT = 0x1C,
+    LED_EFFECT_OP_JGE = 0x1D,
+} LedEffectOpcode;
+
+#define LED_EFFECT_OP_COUNT 0x1E
+
+typedef enum {
+    LED_EFFECT_OK = 0,
+    LED_EFFECT_ERR_LENGTH = 1,
+    LED_EFFECT_ERR_OPCODE = 2,
+    LED_EFFECT_ERR_REGISTER = 3,
+    LED_EFFECT_ERR_JUMP = 4,
+    LED_EFFECT_ERR_STORAGE = 5,
+} LedEffectResult;
+
+typedef struct {
+    uint8_t op;
+    uint8_t d;
+    uint8_t a;
+    uint8_t b;
+} LedEffectInstruction;
+
+typedef struct {
+    uint8_t length;
+    LedEffectInstruction code[LED_EFFECT_MAX_INSTRUCTIONS];
+} LedEffect;
+
+// Per-frame inputs of an effect, the per-LED ones are passed to led_effect_run().
+typedef struct {
+    uint8_t length;
+    // in 1/4096 s, so that COLOR_WAVE_PERIOD is 2 s
+    int32_t time;
+    uint32_t color1;
+    uint32_t color2;
+} LedEffectFrame;
+
+void led_effect_init(LedEffect *effect);
+
+/**
+ * Validates and loads a program of @p count instructions, 4 bytes each
+ * (opcode, d, a, b). On failure, the effect is left unchanged and the index
+ * of the offending instruction is stored in @p error_index.
+ */
+LedEffectResult led_effect_load(
+    LedEffect *effect, const uint8_t *code, uint8_t count, uint8_t *error_index
+);
+
+/**
+ * Serializes the program of the effect into @p buffer, which needs to fit
+ * LED_EFFECT_MAX_INSTRUCTIONS * 4 bytes. Returns the number of instructions.
+ */
+uint8_t led_effect_store(const LedEffect *effect, uint8_t *buffer);
+
+static inline bool led_effect_empty(const LedEffect *effect) {
+    return effect->length == 0;
+}
+
+/**
+ * Runs the effect for the LED at @p index and returns its color.
+ */
+uint32_t led_effect_run(const LedEffect *effect, const LedEffectFrame *frame, uint8_t index);
@@ -18,6 +18,7 @@
 #include "leds.h"
 
 #include "conf/datatypes.h"
+#include "led_color.h"
 #include "led_driver.h"
 #include "utils.h"
 
@@ -85,59 +86,10 @@ static const uint32_t colors[] = {
 
 #define CONFIRM_ANIMATION_DURATION 0.8f
 
-static uint32_t color_blend(uint32_t color1, uint32_t color2, float blend) {
-    if (blend <= 0.0f) {
-        return color1;
-    } else if (blend >= 1.0f) {
-        return color2;
-    }
-
-    float blend1 = 1.0f - blend;
-
-    uint8_t r = R(color1) * blend1 + R(color2) * blend;
-    uint8_t g = G(color1) * blend1 + G(color2) * blend;
-    uint8_t b = B(color1) * blend1 + B(color2) * blend;
-    uint8_t w = W(color1) * blend1 + W(color2) * blend;
-
-    return RGBW(r, g, b, w);
-}
-
-// Bhaskara cosine approximation.
-// Returns a cosine wave oscillating from 0 to 1, starting at 0, with a period of 2s:
+// Returns a cosine wave in Q8 oscillating from 0 to 1, starting at 0, with a period of 2s:
 // (1 - cos(x)) / 2
-static float cosine_progress(float time) {
-    uint32_t rounded = lroundf(time);
-    float x = (time - rounded) * M_PI;
-    x *= x;
-    float cos = 2.5f * x / (x + M_PI * M_PI);
-    if (rounded % 2 == 1) {
-        return 1 - cos;
-    } else {
-        return cos;
-    }
-}
-
-// Tweaks the color channel value to make the hue more uniform.
-static float tweak_color(float x, float a) {
-    if (x < 1.0f) {
-        return 1.0f - powf(1.0f - x, a);
-    } else if (x < 2.0f) {
-        return 1.0f + powf(x - 1.0f, a);
-    }
-    return 0.0f;
-}
-
-// Returns color for hue in range [0..255].
-static uint32_t hue_to_color(uint8_t hue) {
-    float norm = (float) hue / 255.0f * 3.0f;
-    float r_norm = fmodf(norm + 0.5f, 3.0f);
-    float g_norm = fmodf(norm + 2.5f, 3.0f);
-    float b_norm = fmodf(norm + 1.5f, 3.0f);
-    float r = cosine_progress(tweak_color(r_norm, 3.2f));
-    float g = cosine_progress(tweak_color(g_norm, 2.4f));
-    float b = cosine_progress(tweak_color(b_norm, 2.2f));
-
-    return ((uint8_t) (r * 255) << 16) | ((uint8_t) (g * 255) << 8) | (uint8_t) (b * 255);
+static inline uint16_t cosine_progress(float time) {
+    return color_wave(fmodf(fabsf(time), 2.0f) * 4096.0f);
 }
 
 static void sattolo_shuffle(uint32_t seed, uint8_t *array, uint8_t length) {
@@ -159,10 +111,15 @@ static void full_animation_reset(Leds *leds, float current_time) {
     leds->status_on_front_idle_time = current_time;
 }
 
+// Brightness in Q8 of a strip at @p brightness, including the on/off fade.
+static inline uint16_t led_brightness(const Leds *leds, float brightness) {
+    return q8(brightness * leds->on_off_fade);
+}
+
 static void led_set_color(
-    Leds *leds, const LedStrip *strip, uint8_t i, uint32_t color, float brightness, float blend
+    const LedStrip *strip, uint8_t i, uint32_t color, uint16_t brightness, uint16_t blend
 ) {
-    if (blend <= 0.0f) {
+    if (blend == 0) {
         return;
     }
 
@@ -175,49 +132,38 @@ static void led_set_color(
         return;
     }
 
-    float br = brightness * leds->on_off_fade;
-
-    uint8_t r = R(color) * br + 0.5f;
-    uint8_t g = G(color) * br + 0.5f;
-    uint8_t b = B(color) * br + 0.5f;
-    uint8_t w = W(color) * br + 0.5f;
-
-    if (blend < 1.0f) {
-        uint32_t orig_color = strip->data[led];
-        float orig_blend = 1.0f - blend;
-
-        r = r * blend + R(orig_color) * orig_blend;
-        g = g * blend + G(orig_color) * orig_blend;
-        b = b * blend + B(orig_color) * orig_blend;
-        w = w * blend + W(orig_color) * orig_blend;
+    color = color_scale(color, brightness);
+    if (blend < Q8_ONE) {
+        color = color_blend(strip->data[led], color, blend);
     }
 
-    strip->data[led] = RGBW(r, g, b, w);
+    strip->data[led] = color;
 }
 
 static void strip_set_color_range(
-    Leds *leds,
     const LedStrip *strip,
     uint32_t color,
-    float brightness,
-    float blend,
+    uint16_t brightness,
+    uint16_t blend,
     uint8_t idx_start,
     uint8_t idx_end
 ) {
     uint8_t end = idx_end < strip->length ? idx_end : strip->length;
     for (uint8_t i = idx_start; i < end; ++i) {
-        led_set_color(leds, strip, i, color, brightness, blend);
+        led_set_color(strip, i, color, brightness, blend);
     }
 }
 
 static void strip_set_color(
     Leds *leds, const LedStrip *strip, uint32_t color, float brightness, float blend
 ) {
-    strip_set_color_range(leds, strip, color, brightness, blend, 0, strip->length);
+    strip_set_color_range(
+        strip, color, led_brightness(leds, brightness), q8(blend), 0, strip->length
+    );
 }
 
 static void anim_fade(Leds *leds, const LedStrip *strip, const LedBar *bar, float time) {
-    float p = cosine_progress(time);
+    uint16_t p = cosine_progress(time);
     uint32_t color = color_blend(colors[bar->color2], colors[bar->color1], p);
     strip_set_color(leds, strip, color, strip->brightness, 1.0f);
 }
@@ -230,61 +176,72 @@ static void anim_strobe(Leds *leds, const LedStrip *strip, const LedBar *bar, fl
 static void anim_pulse(
     Leds *leds, const LedStrip *strip, const LedBar *bar, float time, float center
 ) {
-    float p = cosine_progress(time);
+    uint16_t p = cosine_progress(time);
 
+    // positions along the strip in Q8
     float length = strip->length / 2.0f - center;
-    float offset = length * (1.0f - p);
-    float feather = strip->length / 4.0f;
+    int32_t offset = length * (Q8_ONE - p);
+    int32_t feather = strip->length * (Q8_ONE / 4);
 
-    float fade = 1.0f;
+    uint16_t fade = Q8_ONE;
     float ratio = center / length;
     if (time < ratio) {
-        fade = time / ratio;
+        fade = q8(time / ratio);
     }
 
+    uint16_t brightness = led_brightness(leds, strip->brightness);
     for (uint8_t i = 0; i < strip->length; ++i) {
-        float dist1 = i - offset + 1.0f;
-        float dist2 = strip->length - offset - i;
-        float k1 = clampf(dist1 / feather, 0.0f, 1.0f);
-        float k2 = clampf(dist2 / feather, 0.0f, 1.0f);
+        int32_t dist1 = i * Q8_ONE - offset + Q8_ONE;
+        int32_t dist2 = strip->length * Q8_ONE - offset - i * Q8_ONE;
+        int32_t k = min(max(min(dist1, dist2) * Q8_ONE / feather, 0), Q8_ONE);
 
         uint32_t color =
-            color_blend(colors[bar->color2], colors[bar->color1], fminf(k1, k2) * fade);
-        led_set_color(leds, strip, i, color, strip->brightness, 1.0f);
+            color_blend(colors[bar->color2], colors[bar->color1], (k * fade) >> 8);
+        led_set_color(strip, i, color, brightness, Q8_ONE);
     }
 }
 
 static void anim_knight_rider(Leds *leds, const LedStrip *strip, const LedBar *bar, float time) {
     const uint8_t tail = strip->length / 3 + 1;
+    const int32_t tail_length = tail * Q8_ONE;
 
+    // positions of the two lights along the strip in Q8
     time *= 0.7f;
-    float backlight = time > 0.3f ? 0.08f : 0.0f;
-    float x1 = strip->length * fmodf(time, 2.0f) - 0.5f * strip->length - 1.0f;
-    float x2 = 1.5f * strip->length - strip->length * fmodf(time - 1.0f, 2.0f);
+    uint16_t backlight = time > 0.3f ? q8(0.08f) : 0;
+    int32_t x1 = lroundf(
+        (strip->length * fmodf(time, 2.0f) - 0.5f * strip->length - 1.0f) * Q8_ONE
+    );
+    int32_t x2 = lroundf(
+        (1.5f * strip->length - strip->length * fmodf(time - 1.0f, 2.0f)) * Q8_ONE
+    );
 
+    uint16_t brightness = led_brightness(leds, strip->brightness);
     for (uint8_t i = 0; i < strip->length; ++i) {
-        float k1 = backlight;
-        float dist1 = fabsf(x1 - i);
-        if (i <= x1) {
-            if (dist1 <= tail) {
-                k1 = (tail - dist1) / tail;
+        const int32_t pos = i * Q8_ONE;
+
+        uint16_t k1 = backlight;
+        int32_t dist1 = abs(x1 - pos);
+        if (pos <= x1) {
+            if (dist1 <= tail_length) {
+                k1 = (tail_length - dist1) / tail;
             }
-        } else if (i < x1 + 1) {
-            k1 = x1 - floorf(x1);
+        } else if (pos < x1 + Q8_ONE) {
+            // the fractional part of x1, even for negative x1
+            k1 = x1 & 0xFF;
         }
 
-        float k2 = backlight;
-        float dist2 = fabsf(x2 - i);
-        if (i >= x2) {
-            if (dist2 <= tail) {
-                k2 = (tail - dist2) / tail;
+        uint16_t k2 = backlight;
+        int32_t dist2 = abs(x2 - pos);
+        if (pos >= x2) {
+            if (dist2 <= tail_length) {
+                k2 = (tail_length - dist2) / tail;
             }
-        } else if (i > x2 - 1) {
-            k2 = 1 - x2 + floorf(x2);
+        } else if (pos > x2 - Q8_ONE) {
+            k2 = Q8_ONE - (x2 & 0xFF);
         }
 
-        uint32_t color = color_blend(colors[bar->color2], colors[bar->color1], fmaxf(k1, k2));
-        led_set_color(leds, strip, i, color, strip->brightness, 1.0f);
+        uint32_t color = color_blend(colors[bar->color2], colors[bar->color1], max(k1, k2));
+        led_set_color(strip, i, color, brightness, Q8_ONE);
     }
 }
 
@@ -297,28 +254,19 @@ static void anim_felony(Leds *leds, const LedStrip *strip, const LedBar *bar, fl
     // also account for led strips with odd numbers of leds (leaving the middle one black)
     uint8_t stop_idx = strip->length / 2;
     uint8_t start_idx = strip->length / 2 + strip->length % 2;
+    uint16_t br = led_brightness(leds, strip->brightness);
     if (state_mod < state_duration) {
-        strip_set_color_range(
-            leds, strip, colors[bar->color1], strip->brightness, 1.0f, 0, stop_idx
-        );
-        strip_set_color_range(leds, strip, color_off, strip->brightness, 1.0f, stop_idx, start_idx);
-        strip_set_color_range(
-            leds, strip, color_off, strip->brightness, 1.0f, start_idx, strip->length
-        );
+        strip_set_color_range(strip, colors[bar->color1], br, Q8_ONE, 0, stop_idx);
+        strip_set_color_range(strip, color_off, br, Q8_ONE, stop_idx, start_idx);
+        strip_set_color_range(strip, color_off, br, Q8_ONE, start_idx, strip->length);
     } else if (state_mod < 2.0f * state_duration) {
-        strip_set_color_range(leds, strip, color_off, strip->brightness, 1.0f, 0, stop_idx);
-        strip_set_color_range(leds, strip, color_off, strip->brightness, 1.0f, stop_idx, start_idx);
-        strip_set_color_range(
-            leds, strip, colors[bar->color2], strip->brightness, 1.0f, start_idx, strip->length
-        );
+        strip_set_color_range(strip, color_off, br, Q8_ONE, 0, stop_idx);
+        strip_set_color_range(strip, color_off, br, Q8_ONE, stop_idx, start_idx);
+        strip_set_color_range(strip, colors[bar->color2], br, Q8_ONE, start_idx, strip->length);
     } else {
-        strip_set_color_range(
-            leds, strip, colors[bar->color2], strip->brightness, 1.0f, 0, stop_idx
-        );
-        strip_set_color_range(leds, strip, color_off, strip->brightness, 1.0f, stop_idx, start_idx);
-        strip_set_color_range(
-            leds, strip, colors[bar->color1], strip->brightness, 1.0f, start_idx, strip->length
-        );
+        strip_set_color_range(strip, colors[bar->color2], br, Q8_ONE, 0, stop_idx);
+        strip_set_color_range(strip, color_off, br, Q8_ONE, stop_idx, start_idx);
+        strip_set_color_range(strip, colors[bar->color1], br, Q8_ONE, start_idx, strip->length);
     }
 }
 
@@ -326,25 +274,43 @@ static void anim_rainbow_cycle(Leds *leds, const LedStrip *strip, float time) {
     const uint8_t count = 10;
     const float segment = 255.0f / count;
     uint8_t color_idx = ((uint8_t) (time * count) % count) * segment;
-    strip_set_color(leds, strip, hue_to_color(color_idx), strip->brightness, 1.0f);
+    strip_set_color(leds, strip, color_hue(color_idx), strip->brightness, 1.0f);
 }
 
 static void anim_rainbow_fade(Leds *leds, const LedStrip *strip, float time) {
     uint8_t offset = fmodf(time, 1.0f) * 255.0f;
-    strip_set_color(leds, strip, hue_to_color(offset), strip->brightness, 1.0f);
+    strip_set_color(leds, strip, color_hue(offset), strip->brightness, 1.0f);
 }
 
 static void anim_rainbow_roll(Leds *leds, const LedStrip *strip, float time) {
-    uint8_t offset = fmodf(time, 1.0f) * 255.0f;
-    for (int i = 0; i < strip->length; ++i) {
-        led_set_color(
-            leds,
-            strip,
-            i,
-            hue_to_color(255.0f / strip->length * i + offset),
-            strip->brightness,
-            1.0f
-        );
+    // hue in Q8, wrapping around
+    uint32_t offset = (uint8_t) (fmodf(time, 1.0f) * 255.0f) << 8;
+    uint32_t step = (255 << 8) / strip->length;
+    uint16_t brightness = led_brightness(leds, strip->brightness);
+    for (uint8_t i = 0; i < strip->length; ++i) {
+        uint8_t hue = (offset + step * i) >> 8;
+        led_set_color(strip, i, color_hue(hue), brightness, Q8_ONE);
+    }
+}
+
+static void anim_custom(Leds *leds, const LedStrip *strip, const LedBar *bar, float time) {
+    if (led_effect_empty(&leds->effect)) {
+        strip_set_color(leds, strip, colors[bar->color1], strip->brightness, 1.0f);
+        return;
+    }
+
+    LedEffectFrame frame = {
+        .length = strip->length,
+        // wrapped to keep it in range, at a multiple of all the periods
+        .time = fmodf(time, 65536.0f) * 4096.0f,
+        .color1 = colors[bar->color1],
+        .color2 = colors[bar->color2],
+    };
+
+    uint16_t brightness = led_brightness(leds, strip->brightness);
+    for (uint8_t i = 0; i < strip->length; ++i) {
+        uint32_t color = led_effect_run(&leds->effect, &frame, i);
+        led_set_color(strip, i, color, brightness, Q8_ONE);
     }
 }
 
@@ -379,6 +345,9 @@ static void led_strip_animate(Leds *leds, const LedStrip *strip, const LedBar *b
     case LED_ANIM_RAINBOW_ROLL:
         anim_rainbow_roll(leds, strip, time);
         break;
+    case LED_ANIM_CUSTOM:
+        anim_custom(leds, strip, bar, time);
+        break;
     }
 }
 
@@ -413,7 +382,9 @@ static void anim_fs_state(Leds *leds, const LedStrip *strip, bool reverse, float
         }
 
         blend = fminf(blend, fmaxf(left_sensor, right_sensor));
-        led_set_color(leds, strip, i, color, strip->brightness * dim, blend);
+        led_set_color(
+            strip, i, color, led_brightness(leds, strip->brightness * dim), q8(blend)
+        );
     }
 }
 
@@ -456,7 +427,7 @@ static void anim_progress_bar(
         }
 
         uint8_t led = reverse ? strip->length - i - 1 : i;
-        led_set_color(leds, strip, led, col, strip->brightness * dim, blend);
+        led_set_color(strip, led, col, led_brightness(leds, strip->brightness * dim), q8(blend));
     }
 }
 
@@ -506,6 +477,8 @@ static void anim_confirm(Leds *leds, const LedStrip *strip, float time) {
     float offset = sides + length * (1.0f - p);
     float feather = strip->length * 0.25f;
 
+    uint16_t brightness = led_brightness(leds, strip->brightness);
+    uint16_t blend_q8 = q8(blend);
     for (uint8_t i = 0; i < strip->length; ++i) {
         float d;
         if (i < strip->length * 0.5f) {
@@ -515,8 +488,8 @@ static void anim_confirm(Leds *leds, const LedStrip *strip, float time) {
         }
 
         float k = clampf(d / feather, 0.0f, 1.0f);
-        uint32_t color = color_blend(COLOR_BLACK, CONFIRM_COLOR, k);
-        led_set_color(leds, strip, i, color, strip->brightness, blend);
+        uint32_t color = color_blend(COLOR_BLACK, CONFIRM_COLOR, q8(k));
+        led_set_color(strip, i, color, brightness, blend_q8);
     }
 }
 
@@ -617,7 +590,8 @@ static void trans_fade_out_in(
         float brightness = strip->brightness + (to_bar->brightness - strip->brightness) * prog;
         strip_set_color(leds, strip, 0x00000000, brightness, prog);
     } else {
-        uint32_t to_color = color_blend(0x00000000, colors[led_bar_to_color(to_bar)], progress);
+        uint32_t to_color =
+            color_blend(0x00000000, colors[led_bar_to_color(to_bar)], q8(progress));
         float brightness = strip->brightness + (to_bar->brightness - strip->brightness) * progress;
         strip_set_color(leds, strip, to_color, brightness, 1.0f);
     }
@@ -635,7 +609,8 @@ static void trans_cipher(
     int8_t prog = progress * strip->length;
 
     uint32_t to_color = colors[led_bar_to_color(to_bar)];
-    float mid_brightness = (strip->brightness + to_bar->brightness) / 2.0f;
+    uint16_t mid_brightness = led_brightness(leds, (strip->brightness + to_bar->brightness) / 2.0f);
+    uint16_t to_brightness = led_brightness(leds, to_bar->brightness);
 
     for (int8_t i = 1 - strip->length; i <= prog; ++i) {
         if (i <= 0) {
@@ -649,18 +624,18 @@ static void trans_cipher(
                 color = 0x00000000;
             } else {
                 if (mono) {
-                    color = color_blend(colors[from_bar->color1], to_color, r / 256.0f);
+                    color = color_blend(colors[from_bar->color1], to_color, r);
                 } else {
                     // random fade to white
                     uint8_t wf = rnd(j + target_j + 23) % 128 + 80;
-                    color = hue_to_color(r) | RGB(wf, wf, wf);
+                    color = color_hue(r) | RGB(wf, wf, wf);
                 }
             }
 
-            led_set_color(leds, strip, target_j, color, mid_brightness, 1.0f);
+            led_set_color(strip, target_j, color, mid_brightness, Q8_ONE);
         } else {
             led_set_color(
-                leds, strip, data->map[i - 1 + strip->length], to_color, to_bar->brightness, 1.0f
+                strip, data->map[i - 1 + strip->length], to_color, to_brightness, Q8_ONE
             );
         }
     }
@@ -794,6 +769,11 @@ void leds_init(Leds *leds) {
     leds->rear_dir_target = NULL;
     leds->rear_time_target = NULL;
 
+    led_effect_init(&leds->effect);
+    led_effect_init(&leds->pending_effect);
+    leds->effect_pending = false;
+    leds->effect_lock = VESC_IF->mutex_create();
+
     led_driver_init(&leds->led_driver);
 }
 
@@ -903,11 +883,34 @@ void leds_set_headlights_enabled(Leds *leds, bool value) {
     leds->runtime_status_overriden.headlights_enabled = true;
 }
 
+void leds_set_effect(Leds *leds, const LedEffect *effect) {
+    if (!leds->effect_lock) {
+        log_error("LED effect lock not allocated.");
+        return;
+    }
+
+    VESC_IF->mutex_lock(leds->effect_lock);
+    leds->pending_effect = *effect;
+    leds->effect_pending = true;
+    VESC_IF->mutex_unlock(leds->effect_lock);
+}
+
+const LedEffect *leds_get_effect(const Leds *leds) {
+    return &leds->pending_effect;
+}
+
 void leds_update(Leds *leds, const State *state, FootpadSensorState fs_state) {
     if (!leds->led_data) {
         return;
     }
 
+    if (leds->effect_pending) {
+        VESC_IF->mutex_lock(leds->effect_lock);
+        leds->effect = leds->pending_effect;
+        leds->effect_pending = false;
+        VESC_IF->mutex_unlock(leds->effect_lock);
+    }
+
     float current_time = VESC_IF->system_time();
     leds->last_updated = current_time;
     RunState old_state = leds->state.state;
@@ -1223,6 +1226,11 @@ void leds_status_confirm(Leds *leds) {
 void leds_destroy(Leds *leds) {
     led_driver_destroy(&leds->led_driver);
 
+    if (leds->effect_lock) {
+        VESC_IF->free(leds->effect_lock);
+        leds->effect_lock = NULL;
+    }
+
     if (leds->led_data) {
         VESC_IF->free(leds->led_data);
         leds->led_data = NULL;
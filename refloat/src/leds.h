@@ -20,8 +20,10 @@
 #include "conf/datatypes.h"
 #include "footpad_sensor.h"
 #include "led_driver.h"
+#include "led_effect.h"
 #include "led_strip.h"
 #include "state.h"
+#include "vesc_c_if.h"
 
 #define LEDS_REFRESH_RATE 30
 
@@ -85,6 +87,14 @@ typedef struct {
     const LedBar *rear_dir_target;
     const LedBar *rear_time_target;
 
+    // the effect run by the aux thread for LED_ANIM_CUSTOM and the last one
+    // set, which is copied over at the start of the next update; the lock
+    // keeps the update from copying an effect that is still being set
+    LedEffect effect;
+    LedEffect pending_effect;
+    volatile bool effect_pending;
+    lib_mutex effect_lock;
+
     uint32_t *led_data;
     LedDriver led_driver;
 } Leds;
@@ -101,6 +111,17 @@ void leds_set_enabled(Leds *leds, bool value);
 
 void leds_set_headlights_enabled(Leds *leds, bool value);
 
+/**
+ * Sets the effect for LED_ANIM_CUSTOM. Can be called from any thread, the
+ * effect is applied on the next update.
+ */
+void leds_set_effect(Leds *leds, const LedEffect *effect);
+
+/**
+ * Returns the last effect set by leds_set_effect().
+ */
+const LedEffect *leds_get_effect(const Leds *leds);
+
 void leds_update(Leds *leds, const State *state, FootpadSensorState fs_state);
 
 void leds_status_confirm(Leds *leds);
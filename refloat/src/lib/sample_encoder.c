@@ -0,0 +1,210 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "sample_encoder.h"
+
+#include <string.h>
+
+// block header: length and sample count, both uint16
+#define HEADER_SIZE 4
+
+// the residual sums decay by 1/2^shift each sample
+#define RESIDUAL_SUM_SHIFT 2
+#define PREDICTOR_ERROR_SHIFT 2
+
+// Rice codes with a quotient of at least this are escaped
+#define RICE_ESCAPE 16
+
+typedef struct {
+    uint8_t *buf;
+    uint16_t pos;
+} BitWriter;
+
+static inline void put_u16(uint8_t *buf, uint16_t value) {
+    buf[0] = value >> 8;
+    buf[1] = value;
+}
+
+static inline void put_bit(BitWriter *w, bool bit) {
+    if (bit) {
+        w->buf[w->pos >> 3] |= 0x80 >> (w->pos & 7);
+    }
+    ++w->pos;
+}
+
+static inline void put_bits(BitWriter *w, uint32_t value, uint8_t count) {
+    while (count > 0) {
+        put_bit(w, (value >> --count) & 1);
+    }
+}
+
+// Exponential Golomb code of order 0
+static void put_exp_golomb(BitWriter *w, uint32_t value) {
+    uint64_t x = (uint64_t) value + 1;
+    uint8_t bits = 0;
+    while (x >> bits) {
+        ++bits;
+    }
+
+    w->pos += bits - 1;
+    put_bit(w, 1);
+    put_bits(w, x, bits - 1);
+}
+
+static void put_rice(BitWriter *w, uint16_t value, uint8_t k) {
+    uint16_t quotient = value >> k;
+    if (quotient >= RICE_ESCAPE) {
+        put_bits(w, 0xffffffff, RICE_ESCAPE);
+        put_bits(w, value, 16);
+        return;
+    }
+
+    put_bits(w, 0xffffffff, quotient);
+    put_bit(w, 0);
+    put_bits(w, value, k);
+}
+
+static inline uint8_t rice_parameter(uint32_t residual_sum) {
+    // about log2 of the mean residual
+    uint32_t x = residual_sum >> (RESIDUAL_SUM_SHIFT + 1);
+    uint8_t k = 0;
+    while (x >> k) {
+        ++k;
+    }
+    return k;
+}
+
+static inline uint16_t zigzag_delta(uint16_t value, uint16_t last) {
+    int16_t delta = (int16_t) (value - last);
+    return (uint16_t) (delta * 2) ^ (uint16_t) (delta >> 15);
+}
+
+static inline uint16_t hold_prediction(const SampleEncoder *e, uint8_t i) {
+    return e->last_values[i];
+}
+
+static inline uint16_t linear_prediction(const SampleEncoder *e, uint8_t i) {
+    return 2 * e->last_values[i] - e->prev_values[i];
+}
+
+static inline bool use_linear(const SampleEncoder *e, uint8_t i) {
+    return e->linear_error[i] < e->hold_error[i];
+}
+
+static void update_header(SampleEncoder *e) {
+    put_u16(e->block, e->length);
+    put_u16(e->block + 2, e->sample_count);
+}
+
+void sample_encoder_init(SampleEncoder *e, uint8_t *block, uint16_t size, uint8_t value_count) {
+    e->block = block;
+    e->size = size;
+    e->length = HEADER_SIZE;
+    e->bit_offset = 0;
+    e->sample_count = 0;
+    e->value_count = value_count;
+    update_header(e);
+}
+
+static bool add_key_sample(SampleEncoder *e, uint32_t time, uint8_t flags, const uint16_t *values) {
+    if (e->length + 5 + 2 * e->value_count > e->size) {
+        return false;
+    }
+
+    uint8_t *p = e->block + e->length;
+    put_u16(p, time >> 16);
+    put_u16(p + 2, time);
+    p[4] = flags;
+    p += 5;
+    for (uint8_t i = 0; i < e->value_count; ++i) {
+        put_u16(p, values[i]);
+        p += 2;
+    }
+
+    e->length = p - e->block;
+    e->last_time_delta = 0;
+    memcpy(e->prev_values, values, e->value_count * sizeof(uint16_t));
+    memset(e->residual_sum, 0, sizeof(e->residual_sum));
+    memset(e->hold_error, 0, sizeof(e->hold_error));
+    memset(e->linear_error, 0, sizeof(e->linear_error));
+    return true;
+}
+
+static bool add_delta_sample(
+    SampleEncoder *e, uint32_t time, uint8_t flags, const uint16_t *values
+) {
+    // encode into a temporary buffer first, the worst case may not fit even
+    // though the actual sample does; it starts with the partially filled last
+    // byte of the block
+    uint8_t buf[SAMPLE_ENCODER_MAX_DELTA_SIZE(SAMPLE_ENCODER_MAX_VALUES)] = {0};
+    uint16_t start = e->length;
+    if (e->bit_offset > 0) {
+        buf[0] = e->block[--start];
+    }
+    BitWriter w = {buf, e->bit_offset};
+
+    uint32_t time_delta = time - e->last_time;
+    int32_t time_delta_change = (int32_t) (time_delta - e->last_time_delta);
+    put_exp_golomb(&w, (uint32_t) time_delta_change * 2 ^ (uint32_t) (time_delta_change >> 31));
+
+    bool flags_changed = flags != e->last_flags;
+    put_bit(&w, flags_changed);
+    if (flags_changed) {
+        put_bits(&w, flags, 8);
+    }
+
+    for (uint8_t i = 0; i < e->value_count; ++i) {
+        uint16_t prediction = use_linear(e, i) ? linear_prediction(e, i) : hold_prediction(e, i);
+        put_rice(&w, zigzag_delta(values[i], prediction), rice_parameter(e->residual_sum[i]));
+    }
+
+    uint16_t len = (w.pos + 7) >> 3;
+    if (start + len > e->size) {
+        return false;
+    }
+
+    memcpy(e->block + start, buf, len);
+    e->length = start + len;
+    e->bit_offset = w.pos & 7;
+    e->last_time_delta = time_delta;
+
+    for (uint8_t i = 0; i < e->value_count; ++i) {
+        uint16_t hold = zigzag_delta(values[i], hold_prediction(e, i));
+        uint16_t linear = zigzag_delta(values[i], linear_prediction(e, i));
+        e->residual_sum[i] += (use_linear(e, i) ? linear : hold) -
+            (e->residual_sum[i] >> RESIDUAL_SUM_SHIFT);
+        e->hold_error[i] += hold - (e->hold_error[i] >> PREDICTOR_ERROR_SHIFT);
+        e->linear_error[i] += linear - (e->linear_error[i] >> PREDICTOR_ERROR_SHIFT);
+    }
+    memcpy(e->prev_values, e->last_values, e->value_count * sizeof(uint16_t));
+    return true;
+}
+
+bool sample_encoder_add(SampleEncoder *e, uint32_t time, uint8_t flags, const uint16_t *values) {
+    bool added = e->sample_count == 0 ? add_key_sample(e, time, flags, values)
+                                      : add_delta_sample(e, time, flags, values);
+    if (!added) {
+        return false;
+    }
+
+    ++e->sample_count;
+    e->last_time = time;
+    e->last_flags = flags;
+    memcpy(e->last_values, values, e->value_count * sizeof(uint16_t));
+    update_header(e);
+    return true;
+}
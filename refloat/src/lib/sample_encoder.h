@@ -0,0 +1,75 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Delta encoder of recorded samples into self-contained fixed-size blocks.
+//
+// Each block starts with a full key sample, the following samples are stored
+// as a bit stream of the change of the time delta and the residuals of the
+// 16-bit values against a per-value predictor, Rice coded with a parameter
+// adapted to the recent residuals. A block can be decoded without any other
+// block, so the oldest blocks can be dropped from a circular buffer.
+//
+// See the compressed encoding in /doc/commands/DATA_RECORD.md for the format.
+
+#define SAMPLE_ENCODER_MAX_VALUES 32
+
+// Worst case size of a delta sample: 65b time delta code, 9b flags, 32b per
+// value, plus a byte for the partially filled last byte of the block
+#define SAMPLE_ENCODER_MAX_DELTA_SIZE(value_count) ((65 + 9 + 32 * (value_count) + 7) / 8 + 1)
+
+typedef struct {
+    uint8_t *block;
+    uint16_t size;
+    uint16_t length;
+    // number of bits used in the last byte of the block, 0 if it's full
+    uint8_t bit_offset;
+    uint16_t sample_count;
+    uint8_t value_count;
+
+    uint32_t last_time;
+    uint32_t last_time_delta;
+    uint8_t last_flags;
+    uint16_t last_values[SAMPLE_ENCODER_MAX_VALUES];
+    uint16_t prev_values[SAMPLE_ENCODER_MAX_VALUES];
+
+    // decaying sums of the recent zig-zag residuals, of the chosen predictor
+    // for the Rice parameter and of both predictors to choose between them
+    uint32_t residual_sum[SAMPLE_ENCODER_MAX_VALUES];
+    uint32_t hold_error[SAMPLE_ENCODER_MAX_VALUES];
+    uint32_t linear_error[SAMPLE_ENCODER_MAX_VALUES];
+} SampleEncoder;
+
+/**
+ * Starts a new empty block in @p block of @p size bytes.
+ */
+void sample_encoder_init(SampleEncoder *e, uint8_t *block, uint16_t size, uint8_t value_count);
+
+/**
+ * Appends a sample to the block. Returns false if it doesn't fit, in which
+ * case the block is left unchanged.
+ */
+bool sample_encoder_add(SampleEncoder *e, uint32_t time, uint8_t flags, const uint16_t *values);
+
+static inline bool sample_encoder_empty(const SampleEncoder *e) {
+    return e->sample_count == 0;
+}
@@ -0,0 +1,144 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "loop_timer.h"
+#include "conf/buffer.h"
+#include "utils.h"
+#include "vesc_c_if.h"
+
+#include <math.h>
+#include <string.h>
+
+// Always sleep at least one system tick, even after an overrun, so that lower
+// priority threads get to run
+#define MIN_SLEEP_US (1000000u / SYSTEM_TICK_RATE_HZ)
+
+// Limits of the dt ratio, a long stall (e.g. a config write) shouldn't turn
+// into a huge step of the rate limiters
+#define DT_RATIO_MIN 0.25f
+#define DT_RATIO_MAX 4.0f
+
+static void reset_stats(LoopTimerStats *stats) {
+    memset(stats, 0, sizeof(LoopTimerStats));
+}
+
+void loop_timer_init(LoopTimer *lt) {
+    lt->period = 0.001f;
+    lt->start = 0;
+    lt->deadline = lt->period;
+    lt->started = false;
+    lt->dt = lt->period;
+    lt->dt_ratio = 1.0f;
+    lt->reset_requested = false;
+    reset_stats(&lt->stats);
+}
+
+void loop_timer_configure(LoopTimer *lt, float frequency) {
+    lt->period = 1.0f / frequency;
+}
+
+void loop_timer_start(LoopTimer *lt) {
+    if (lt->reset_requested) {
+        reset_stats(&lt->stats);
+        lt->reset_requested = false;
+    }
+
+    uint32_t now = VESC_IF->timer_time_now();
+    if (!lt->started) {
+        lt->started = true;
+        lt->dt = lt->period;
+        lt->deadline = lt->period;
+    } else {
+        float elapsed = VESC_IF->timer_seconds_elapsed_since(lt->start);
+        float lateness = fmaxf(elapsed - lt->deadline, 0.0f);
+        lt->dt = elapsed;
+
+        if (lateness > lt->stats.lateness_max) {
+            lt->stats.lateness_max = lateness;
+        }
+        lt->stats.lateness_sum_us += (uint32_t) (lateness * 1e6f + 0.5f);
+
+        if (lateness < lt->period) {
+            // catch up on the lateness in this iteration
+            lt->deadline = lt->period - lateness;
+        } else {
+            // deadlines were missed, realign the schedule to now
+            lt->stats.missed_deadlines += (uint32_t) (lateness / lt->period);
+            lt->deadline = lt->period;
+        }
+    }
+
+    lt->start = now;
+    lt->dt_ratio = clampf(lt->dt / lt->period, DT_RATIO_MIN, DT_RATIO_MAX);
+}
+
+void loop_timer_wait(LoopTimer *lt) {
+    float elapsed = VESC_IF->timer_seconds_elapsed_since(lt->start);
+    float remaining = lt->deadline - elapsed;
+
+    ++lt->stats.iterations;
+    if (elapsed > lt->stats.busy_max) {
+        lt->stats.busy_max = elapsed;
+    }
+
+    if (remaining <= 0.0f) {
+        ++lt->stats.overruns;
+        VESC_IF->sleep_us(MIN_SLEEP_US);
+        return;
+    }
+
+    uint32_t sleep_us = remaining * 1e6f;
+    VESC_IF->sleep_us(max(sleep_us, MIN_SLEEP_US));
+}
+
+typedef enum {
+    COMMAND_LOOP_TIMER = 45,
+} LoopTimerCommands;
+
+static void send_stats(const LoopTimer *lt) {
+    static const int bufsize = 32;
+    uint8_t buf[bufsize];
+    int32_t ind = 0;
+
+    const LoopTimerStats *s = &lt->stats;
+    buf[ind++] = 101;  // Package ID
+    buf[ind++] = COMMAND_LOOP_TIMER;
+    buffer_append_uint32(buf, lt->period * 1e6f, &ind);
+    buffer_append_uint32(buf, s->iterations, &ind);
+    buffer_append_uint32(buf, s->overruns, &ind);
+    buffer_append_uint32(buf, s->missed_deadlines, &ind);
+    buffer_append_uint32(buf, s->iterations > 0 ? s->lateness_sum_us / s->iterations : 0, &ind);
+    buffer_append_uint32(buf, s->lateness_max * 1e6f, &ind);
+    buffer_append_uint32(buf, s->busy_max * 1e6f, &ind);
+
+    SEND_APP_DATA(buf, bufsize, ind);
+}
+
+void loop_timer_request(LoopTimer *lt, uint8_t *buffer, size_t len) {
+    if (len < 1) {
+        log_error("Loop timer request missing data.");
+        return;
+    }
+
+    uint8_t mode = buffer[0];
+    if (mode == 1) {  // reset
+        // the reset is done in the main loop to not race with recording
+        lt->reset_requested = true;
+    } else if (mode == 2) {  // send stats
+        send_stats(lt);
+    }
+}
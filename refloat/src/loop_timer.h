@@ -0,0 +1,83 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Deadline scheduler of the main loop. Instead of sleeping for the loop period
+// after each iteration (which makes the real period the loop period plus the
+// execution time plus the sleep granularity), the loop sleeps until a deadline
+// that advances by exactly one period each iteration. Lateness of a wakeup is
+// subtracted from the following sleep, so the average loop rate matches the
+// configured frequency.
+//
+// When an iteration overruns by more than a whole period, the missed deadlines
+// are counted and skipped (the schedule is realigned to the current time)
+// instead of running a burst of back-to-back iterations to catch up.
+//
+// See: /doc/commands/LOOP_TIMER.md
+
+typedef struct {
+    uint32_t iterations;
+    // iterations that ended after their deadline
+    uint32_t overruns;
+    // whole periods skipped due to overruns or late wakeups
+    uint32_t missed_deadlines;
+    float lateness_max;
+    // in microseconds, a float sum stops growing once the small samples
+    // fall below its precision, after a few hours of running
+    uint64_t lateness_sum_us;
+    float busy_max;
+} LoopTimerStats;
+
+typedef struct {
+    float period;
+
+    // start of the current iteration in VESC_IF->timer_time_now() units
+    uint32_t start;
+    // deadline of the current iteration in seconds relative to start
+    float deadline;
+    bool started;
+
+    // real duration of the last period in seconds
+    float dt;
+    // dt divided by the nominal period, used to scale the per-iteration steps
+    float dt_ratio;
+
+    volatile bool reset_requested;
+    LoopTimerStats stats;
+} LoopTimer;
+
+void loop_timer_init(LoopTimer *lt);
+
+void loop_timer_configure(LoopTimer *lt, float frequency);
+
+/**
+ * Marks the start of a loop iteration and measures the real time since the
+ * start of the previous one.
+ */
+void loop_timer_start(LoopTimer *lt);
+
+/**
+ * Sleeps until the deadline of the current iteration.
+ */
+void loop_timer_wait(LoopTimer *lt);
+
+void loop_timer_request(LoopTimer *lt, uint8_t *buffer, size_t len);
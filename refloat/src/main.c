@@ -33,9 +33,11 @@
 #include "imu.h"
 #include "lcm.h"
 #include "leds.h"
+#include "loop_timer.h"
 #include "motor_control.h"
 #include "motor_data.h"
 #include "pid.h"
+#include "profiler.h"
 #include "remote.h"
 #include "rt_data.h"
 #include "state.h"
@@ -43,6 +45,7 @@
 #include "torque_tilt.h"
 #include "turn_tilt.h"
 #include "utils.h"
+#include "utils/utils.h"
 
 #include "conf/buffer.h"
 #include "conf/conf_general.h"
@@ -181,8 +184,8 @@ static void reconfigure(Data *d) {
 static void configure(Data *d) {
     state_set_disabled(&d->state, d->float_conf.disabled);
 
-    // Loop time in microseconds
-    d->loop_time_us = 1e6 / d->float_conf.hertz;
+    loop_timer_configure(&d->loop_timer, d->float_conf.hertz);
+    data_recorder_configure(&d->data_record, d->float_conf.hertz);
 
     d->tiltback_duty_step_size = d->float_conf.tiltback_duty_speed / d->float_conf.hertz;
     d->tiltback_hv_step_size = d->float_conf.tiltback_hv_speed / d->float_conf.hertz;
@@ -552,6 +555,7 @@ static void calculate_setpoint_target(Data *d) {
                d->motor.abs_erpm > 2000) {
         d->state.wheelslip = true;
         d->state.sat = SAT_NONE;
+        data_recorder_event(&d->data_record, DATA_RECORD_EVENT_WHEELSLIP);
         timer_refresh(&d->time, &d->wheelslip_timer);
         if (d->state.darkride) {
             d->traction_control = true;
@@ -750,7 +754,11 @@ static void apply_noseangling(Data *d) {
         noseangling_target += d->float_conf.tiltback_constant * d->motor.erpm_sign;
     }
 
-    rate_limitf(&d->noseangling_interpolated, noseangling_target, d->noseangling_step_size);
+    rate_limitf(
+        &d->noseangling_interpolated,
+        noseangling_target,
+        d->noseangling_step_size * d->loop_timer.dt_ratio
+    );
 }
 
 static void imu_ref_callback(float *acc, float *gyro, float *mag, float dt) {
@@ -766,9 +774,13 @@ static void refloat_thd(void *arg) {
     configure(d);
 
     while (!VESC_IF->should_terminate()) {
+        loop_timer_start(&d->loop_timer);
+        profiler_loop_start(&d->profiler);
+
         time_update(&d->time, d->state.state);
 
         imu_update(&d->imu, &d->balance_filter, &d->state);
+        profiler_stage_end(&d->profiler, PROFILER_STAGE_IMU);
 
         beeper_update(d);
 
@@ -789,13 +801,17 @@ static void refloat_thd(void *arg) {
             }
         }
 
+        profiler_stage_start(&d->profiler);
         motor_data_update(&d->motor);
+        profiler_stage_end(&d->profiler, PROFILER_STAGE_MOTOR_DATA);
 
         remote_input(&d->remote, &d->float_conf);
 
         turn_tilt_aggregate(&d->turn_tilt, &d->imu);
 
+        profiler_stage_start(&d->profiler);
         footpad_sensor_update(&d->footpad, &d->float_conf);
+        profiler_stage_end(&d->profiler, PROFILER_STAGE_FOOTPAD);
 
         if (d->footpad.state == FS_NONE && d->state.state == STATE_RUNNING &&
             d->state.mode != MODE_FLYWHEEL && d->motor.abs_erpm > d->switch_warn_beep_erpm) {
@@ -808,6 +824,7 @@ static void refloat_thd(void *arg) {
             beep_off(d, false);
         }
 
+        profiler_stage_start(&d->profiler);
         haptic_feedback_update(
             &d->haptic_feedback,
             &d->motor_control,
@@ -816,14 +833,18 @@ static void refloat_thd(void *arg) {
             &d->alert_tracker,
             &d->time
         );
+        profiler_stage_end(&d->profiler, PROFILER_STAGE_HAPTICS);
 
         bms_update(&d->bms, &d->float_conf.bms, &d->time);
+        profiler_stage_end(&d->profiler, PROFILER_STAGE_BMS);
 
         motor_data_evaluate_alerts(&d->motor, &d->alert_tracker, &d->time);
         alert_tracker_finalize(&d->alert_tracker, &d->time);
         if (alert_tracker_is_alert_active(&d->alert_tracker, ALERT_FW_FAULT)) {
             d->beep_reason = BEEP_FW_FAULT;
+            data_recorder_event(&d->data_record, DATA_RECORD_EVENT_FW_FAULT);
         }
+        profiler_stage_end(&d->profiler, PROFILER_STAGE_ALERTS);
 
         // Control Loop State Logic
         switch (d->state.state) {
@@ -856,6 +877,9 @@ static void refloat_thd(void *arg) {
                     timer_refresh(&d->time, &d->fault_angle_pitch_timer);
                 }
                 motor_control_play_click(&d->motor_control);
+                if (d->state.stop_condition == STOP_PITCH || d->state.stop_condition == STOP_ROLL) {
+                    data_recorder_event(&d->data_record, DATA_RECORD_EVENT_FAULT);
+                }
                 data_recorder_trigger(&d->data_record, false);
                 break;
             }
@@ -867,7 +891,7 @@ static void refloat_thd(void *arg) {
             rate_limitf(
                 &d->setpoint_target_interpolated,
                 d->setpoint_target,
-                get_setpoint_adjustment_step_size(d)
+                get_setpoint_adjustment_step_size(d) * d->loop_timer.dt_ratio
             );
             d->setpoint = d->setpoint_target_interpolated;
 
@@ -922,7 +946,7 @@ static void refloat_thd(void *arg) {
             float pitch_based = d->pid.rate_p + d->booster.current;
             if (d->softstart_pid_limit < d->motor.current_max) {
                 pitch_based = fminf(fabs(pitch_based), d->softstart_pid_limit) * sign(pitch_based);
-                d->softstart_pid_limit += d->softstart_ramp_step_size;
+                d->softstart_pid_limit += d->softstart_ramp_step_size * d->loop_timer.dt_ratio;
             }
 
             float new_current = d->pid.p + d->pid.i + pitch_based;
@@ -1069,12 +1093,17 @@ static void refloat_thd(void *arg) {
         case (STATE_DISABLED):
             break;
         }
+        profiler_stage_end(&d->profiler, PROFILER_STAGE_CONTROL);
 
         motor_control_apply(&d->motor_control, d->motor.abs_erpm_smooth, d->state.state, &d->time);
+        profiler_stage_end(&d->profiler, PROFILER_STAGE_MOTOR_APPLY);
 
         data_recorder_sample(&d->data_record, d, d->time.now);
+        profiler_stage_end(&d->profiler, PROFILER_STAGE_DATA_RECORD);
+
+        profiler_loop_end(&d->profiler);
 
-        VESC_IF->sleep_us(d->loop_time_us);
+        loop_timer_wait(&d->loop_timer);
     }
 }
 
@@ -1087,8 +1116,10 @@ static void refloat_thd(void *arg) {
 #define SERIALIZED_CONFIG_LENGTH 320
 #endif
 
+#define CFG_EEPROM_WORDS ((SERIALIZED_CONFIG_LENGTH - 1) / 4 + 1)
+
 static void write_cfg_to_eeprom(Data *d) {
-    const size_t words = (SERIALIZED_CONFIG_LENGTH - 1) / 4 + 1;
+    const size_t words = CFG_EEPROM_WORDS;
     const size_t bufsize = words * 4;
     uint32_t *buffer = VESC_IF->malloc(bufsize);
     if (!buffer) {
@@ -1154,7 +1185,7 @@ static void aux_thd(void *arg) {
 }
 
 static void read_cfg_from_eeprom(Data *d) {
-    uint32_t words = (SERIALIZED_CONFIG_LENGTH - 1) / 4 + 1;
+    uint32_t words = CFG_EEPROM_WORDS;
     uint32_t *buffer = VESC_IF->malloc(words * sizeof(uint32_t));
     if (!buffer) {
         log_error("Failed to read config: Out of memory.");
@@ -1184,6 +1215,72 @@ static void read_cfg_from_eeprom(Data *d) {
     VESC_IF->free(buffer);
 }
 
+// The LED effect is stored in the EEPROM right after the config: a header
+// word ('L', 'E', version, instruction count), the instructions and a crc32c
+// of the header and the instructions.
+#define LED_EFFECT_EEPROM_VERSION 1
+#define LED_EFFECT_EEPROM_WORDS (LED_EFFECT_MAX_INSTRUCTIONS + 2)
+
+static bool write_led_effect_to_eeprom(const LedEffect *effect) {
+    uint32_t words[LED_EFFECT_EEPROM_WORDS];
+    uint8_t *bytes = (uint8_t *) words;
+    bytes[0] = 'L';
+    bytes[1] = 'E';
+    bytes[2] = LED_EFFECT_EEPROM_VERSION;
+    bytes[3] = led_effect_store(effect, &bytes[4]);
+
+    uint8_t crc_word = bytes[3] + 1;
+    words[crc_word] = utils_crc32c(bytes, crc_word * 4);
+    for (uint8_t i = 0; i <= crc_word; ++i) {
+        eeprom_var v;
+        v.as_u32 = words[i];
+        if (!VESC_IF->store_eeprom_var(&v, CFG_EEPROM_WORDS + i)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void read_led_effect_from_eeprom(Leds *leds) {
+    uint32_t words[LED_EFFECT_EEPROM_WORDS];
+    uint8_t *bytes = (uint8_t *) words;
+
+    eeprom_var v;
+    if (!VESC_IF->read_eeprom_var(&v, CFG_EEPROM_WORDS)) {
+        return;
+    }
+    words[0] = v.as_u32;
+
+    // nothing stored (or an older version) is not an error
+    if (bytes[0] != 'L' || bytes[1] != 'E' || bytes[2] != LED_EFFECT_EEPROM_VERSION ||
+        bytes[3] > LED_EFFECT_MAX_INSTRUCTIONS) {
+        return;
+    }
+
+    uint8_t crc_word = bytes[3] + 1;
+    for (uint8_t i = 1; i <= crc_word; ++i) {
+        if (!VESC_IF->read_eeprom_var(&v, CFG_EEPROM_WORDS + i)) {
+            log_error("Failed to read LED effect.");
+            return;
+        }
+        words[i] = v.as_u32;
+    }
+
+    if (utils_crc32c(bytes, crc_word * 4) != words[crc_word]) {
+        log_error("LED effect checksum mismatch.");
+        return;
+    }
+
+    LedEffect effect;
+    uint8_t error_index;
+    if (led_effect_load(&effect, &bytes[4], bytes[3], &error_index) != LED_EFFECT_OK) {
+        log_error("Invalid LED effect at instruction %u.", error_index);
+        return;
+    }
+    leds_set_effect(leds, &effect);
+}
+
 static void data_init(Data *d) {
     memset(d, 0, sizeof(Data));
 
@@ -1211,11 +1308,14 @@ static void data_init(Data *d) {
 
     leds_init(&d->leds);
     leds_setup(&d->leds, &d->float_conf.hardware.leds, &d->float_conf.leds);
+    read_led_effect_from_eeprom(&d->leds);
     lcm_init(&d->lcm, &d->float_conf.hardware.leds);
     charging_init(&d->charging);
     bms_init(&d->bms);
 
     data_recorder_init(&d->data_record);
+    profiler_init(&d->profiler);
+    loop_timer_init(&d->loop_timer);
 
     konami_init(&d->flywheel_konami, flywheel_konami_sequence, sizeof(flywheel_konami_sequence));
     konami_init(
@@ -1262,6 +1362,9 @@ enum {
     COMMAND_ALERTS_LIST = 35,
     COMMAND_ALERTS_CONTROL = 36,
     COMMAND_DATA_RECORD_REQUEST = 41,
+    COMMAND_PROFILER = 44,
+    COMMAND_LOOP_TIMER = 45,
+    COMMAND_LED_EFFECT = 47,
 
     // commands above 200 are unstable and can change protocol at any time
 } Commands;
@@ -2075,6 +2178,62 @@ static void cmd_alerts_control(AlertTracker *at, uint8_t *buf, size_t len) {
     }
 }
 
+static void cmd_led_effect(Leds *leds, uint8_t *buf, size_t len) {
+    if (len < 1) {
+        log_error("LED effect request missing data.");
+        return;
+    }
+
+    static const int bufsize = 5 + LED_EFFECT_MAX_INSTRUCTIONS * 4;
+    uint8_t buffer[bufsize];
+    int32_t ind = 0;
+    buffer[ind++] = 101;  // Package ID
+    buffer[ind++] = COMMAND_LED_EFFECT;
+
+    uint8_t mode = buf[0];
+    buffer[ind++] = mode;
+    LedEffectResult result = LED_EFFECT_OK;
+    uint8_t value = 0;
+
+    if (mode == 1) {  // upload
+        uint8_t count = len >= 2 ? buf[1] : 0;
+        LedEffect effect;
+        if (len < 2 || len - 2 < count * 4u) {
+            result = LED_EFFECT_ERR_LENGTH;
+        } else {
+            result = led_effect_load(&effect, &buf[2], count, &value);
+        }
+
+        if (result == LED_EFFECT_OK) {
+            leds_set_effect(leds, &effect);
+            value = count;
+        }
+    } else if (mode == 2) {  // download
+        value = led_effect_store(leds_get_effect(leds), &buffer[ind + 2]);
+    } else if (mode == 3) {  // save
+        const LedEffect *effect = leds_get_effect(leds);
+        value = effect->length;
+        if (!write_led_effect_to_eeprom(effect)) {
+            log_error("Failed to write LED effect.");
+            result = LED_EFFECT_ERR_STORAGE;
+        }
+    } else if (mode == 4) {  // clear
+        LedEffect effect;
+        led_effect_init(&effect);
+        leds_set_effect(leds, &effect);
+    } else {
+        return;
+    }
+
+    buffer[ind++] = result;
+    buffer[ind++] = value;
+    if (mode == 2) {
+        ind += value * 4;
+    }
+
+    SEND_APP_DATA(buffer, bufsize, ind);
+}
+
 static void lights_control_request(Leds *leds, uint8_t *buffer, size_t len, LcmData *lcm) {
     if (len < 5) {
         return;
@@ -2330,6 +2489,18 @@ static void on_command_received(unsigned char *buffer, unsigned int len) {
         data_recorder_request(&d->data_record, &buffer[2], len - 2);
         return;
     }
+    case COMMAND_PROFILER: {
+        profiler_request(&d->profiler, &buffer[2], len - 2);
+        return;
+    }
+    case COMMAND_LOOP_TIMER: {
+        loop_timer_request(&d->loop_timer, &buffer[2], len - 2);
+        return;
+    }
+    case COMMAND_LED_EFFECT: {
+        cmd_led_effect(&d->leds, &buffer[2], len - 2);
+        return;
+    }
     case COMMAND_ALERTS_LIST: {
         cmd_alerts_list(&d->alert_tracker, &buffer[2], len - 2);
         return;
@@ -2453,6 +2624,8 @@ static void stop(void *arg) {
     }
     log_msg("Terminating.");
     leds_destroy(&d->leds);
+    profiler_destroy(&d->profiler);
+    data_recorder_destroy(&d->data_record);
     VESC_IF->free(d);
 }
 
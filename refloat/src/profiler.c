@@ -0,0 +1,233 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include "profiler.h"
+#include "conf/buffer.h"
+#include "utils.h"
+#include "vesc_c_if.h"
+
+#include <string.h>
+
+#ifdef REFLOAT_SIM
+#include <time.h>
+
+uint32_t profiler_ticks(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void enable_counter(void) {
+}
+#else
+#define DEMCR (*(volatile uint32_t *) 0xE000EDFC)
+#define DEMCR_TRCENA (1 << 24)
+#define DWT_CTRL (*(volatile uint32_t *) 0xE0001000)
+#define DWT_CTRL_CYCCNTENA (1 << 0)
+
+static void enable_counter(void) {
+    // the firmware may have it enabled already, enabling it again is harmless
+    DEMCR |= DEMCR_TRCENA;
+    DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+}
+#endif
+
+static const char *const stage_names[PROFILER_STAGE_COUNT] = {
+    [PROFILER_STAGE_IMU] = "imu",
+    [PROFILER_STAGE_MOTOR_DATA] = "motor_data",
+    [PROFILER_STAGE_FOOTPAD] = "footpad",
+    [PROFILER_STAGE_HAPTICS] = "haptics",
+    [PROFILER_STAGE_BMS] = "bms",
+    [PROFILER_STAGE_ALERTS] = "alerts",
+    [PROFILER_STAGE_CONTROL] = "control",
+    [PROFILER_STAGE_MOTOR_APPLY] = "motor_apply",
+    [PROFILER_STAGE_DATA_RECORD] = "data_record",
+    [PROFILER_STAGE_LOOP] = "loop",
+};
+
+static void reset_stats(ProfilerStageStats *stats) {
+    for (size_t i = 0; i < PROFILER_STAGE_COUNT; ++i) {
+        memset(&stats[i], 0, sizeof(ProfilerStageStats));
+        stats[i].min = UINT32_MAX;
+    }
+}
+
+void profiler_init(Profiler *p) {
+    p->enabled = false;
+    p->reset_requested = false;
+    p->stats = NULL;
+    p->loop_start = 0;
+    p->stage_start = 0;
+}
+
+void profiler_destroy(Profiler *p) {
+    p->enabled = false;
+    if (p->stats) {
+        VESC_IF->free(p->stats);
+        p->stats = NULL;
+    }
+}
+
+static bool enable(Profiler *p, bool enable) {
+    if (!enable) {
+        // keep the stats, they can still be read and the main loop may be
+        // just recording a value
+        p->enabled = false;
+        return true;
+    }
+
+    if (!p->stats) {
+        ProfilerStageStats *stats =
+            VESC_IF->malloc(PROFILER_STAGE_COUNT * sizeof(ProfilerStageStats));
+        if (!stats) {
+            log_error("Failed to enable profiler: Out of memory.");
+            return false;
+        }
+        reset_stats(stats);
+        p->stats = stats;
+    }
+
+    enable_counter();
+    p->enabled = true;
+    return true;
+}
+
+static inline uint8_t histogram_bucket(uint32_t ticks) {
+    if (ticks < 2) {
+        return ticks;
+    }
+
+    uint8_t msb = 31 - __builtin_clz(ticks);
+    if (msb >= PROFILER_HISTOGRAM_BITS) {
+        return PROFILER_HISTOGRAM_SIZE - 1;
+    }
+    return msb * 2 + ((ticks >> (msb - 1)) & 1);
+}
+
+// Highest value that falls into the bucket
+static uint32_t bucket_upper_bound(uint8_t bucket) {
+    if (bucket < 2) {
+        return bucket;
+    }
+
+    uint8_t msb = bucket / 2;
+    uint32_t lower = (1u << msb) | ((uint32_t) (bucket & 1) << (msb - 1));
+    return lower + (1u << (msb - 1)) - 1;
+}
+
+void profiler_record(Profiler *p, ProfilerStage stage, uint32_t ticks) {
+    ProfilerStageStats *s = &p->stats[stage];
+
+    ++s->count;
+    s->sum += ticks;
+    if (ticks < s->min) {
+        s->min = ticks;
+    }
+    if (ticks > s->max) {
+        s->max = ticks;
+    }
+
+    uint16_t *bucket = &s->histogram[histogram_bucket(ticks)];
+    if (*bucket == UINT16_MAX) {
+        // halve the whole histogram, which keeps the distribution and gives
+        // more weight to recent values
+        for (size_t i = 0; i < PROFILER_HISTOGRAM_SIZE; ++i) {
+            s->histogram[i] /= 2;
+        }
+    }
+    ++*bucket;
+}
+
+void profiler_apply_reset(Profiler *p) {
+    reset_stats(p->stats);
+    p->reset_requested = false;
+}
+
+static uint32_t percentile(const ProfilerStageStats *s, uint32_t percent) {
+    uint32_t total = 0;
+    for (size_t i = 0; i < PROFILER_HISTOGRAM_SIZE; ++i) {
+        total += s->histogram[i];
+    }
+
+    // the number of values that are allowed to be above the percentile
+    uint32_t above = total * (100 - percent) / 100;
+    uint32_t sum = 0;
+    for (int i = PROFILER_HISTOGRAM_SIZE - 1; i >= 0; --i) {
+        sum += s->histogram[i];
+        if (sum > above) {
+            return min(bucket_upper_bound(i), s->max);
+        }
+    }
+    return 0;
+}
+
+typedef enum {
+    COMMAND_PROFILER = 44,
+} ProfilerCommands;
+
+static void send_stats(const Profiler *p) {
+    static const int bufsize = 400;
+    uint8_t buf[bufsize];
+    int32_t ind = 0;
+
+    buf[ind++] = 101;  // Package ID
+    buf[ind++] = COMMAND_PROFILER;
+    buf[ind++] = p->enabled;
+    buffer_append_uint32(buf, PROFILER_TICK_RATE_HZ, &ind);
+
+    if (!p->stats) {
+        buf[ind++] = 0;
+        SEND_APP_DATA(buf, bufsize, ind);
+        return;
+    }
+
+    buf[ind++] = PROFILER_STAGE_COUNT;
+    for (size_t i = 0; i < PROFILER_STAGE_COUNT; ++i) {
+        const ProfilerStageStats *s = &p->stats[i];
+        buffer_append_string(buf, stage_names[i], &ind);
+        buffer_append_uint32(buf, s->count, &ind);
+        buffer_append_uint32(buf, s->count > 0 ? s->min : 0, &ind);
+        buffer_append_uint32(buf, s->count > 0 ? s->sum / s->count : 0, &ind);
+        buffer_append_uint32(buf, percentile(s, 99), &ind);
+        buffer_append_uint32(buf, s->max, &ind);
+    }
+
+    SEND_APP_DATA(buf, bufsize, ind);
+}
+
+void profiler_request(Profiler *p, uint8_t *buffer, size_t len) {
+    if (len < 1) {
+        log_error("Profiler request missing data.");
+        return;
+    }
+
+    uint8_t mode = buffer[0];
+    if (mode == 1) {  // enable / disable
+        if (len < 2) {
+            log_error("Profiler request missing value, length: %u", len);
+            return;
+        }
+        enable(p, buffer[1] > 0);
+    } else if (mode == 2) {  // reset
+        if (p->stats) {
+            // the reset is done in the main loop to not race with recording
+            p->reset_requested = true;
+        }
+    } else if (mode == 3) {  // send stats
+        send_stats(p);
+    }
+}
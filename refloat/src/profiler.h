@@ -0,0 +1,133 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-stage execution time profiler of the main loop. Times are measured in
+// CPU cycles using the DWT cycle counter on the hardware and in nanoseconds
+// using a monotonic clock in the host simulation.
+//
+// The profiler is disabled by default, in which case each measurement point
+// is a single branch. Stats memory is allocated when it's first enabled.
+//
+// See: /doc/commands/PROFILER.md
+
+#ifdef REFLOAT_SIM
+#define PROFILER_TICK_RATE_HZ 1000000000
+#else
+// The CPU clock, which the package can't query from the firmware. Override it
+// with `make PROFILER_TICK_RATE_HZ=...` for hardware that is clocked
+// differently than the usual 168MHz of the STM32F4.
+#ifndef PROFILER_TICK_RATE_HZ
+#define PROFILER_TICK_RATE_HZ 168000000
+#endif
+#define PROFILER_DWT_CYCCNT (*(volatile uint32_t *) 0xE0001004)
+#endif
+
+// Histogram with two buckets per power of two, up to 2^24 ticks (100ms at
+// 168MHz), longer durations end up in the last bucket
+#define PROFILER_HISTOGRAM_BITS 24
+#define PROFILER_HISTOGRAM_SIZE (PROFILER_HISTOGRAM_BITS * 2)
+
+typedef enum {
+    PROFILER_STAGE_IMU = 0,
+    PROFILER_STAGE_MOTOR_DATA,
+    PROFILER_STAGE_FOOTPAD,
+    PROFILER_STAGE_HAPTICS,
+    PROFILER_STAGE_BMS,
+    PROFILER_STAGE_ALERTS,
+    PROFILER_STAGE_CONTROL,
+    PROFILER_STAGE_MOTOR_APPLY,
+    PROFILER_STAGE_DATA_RECORD,
+    PROFILER_STAGE_LOOP,
+    PROFILER_STAGE_COUNT
+} ProfilerStage;
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint16_t histogram[PROFILER_HISTOGRAM_SIZE];
+} ProfilerStageStats;
+
+typedef struct {
+    volatile bool enabled;
+    volatile bool reset_requested;
+    ProfilerStageStats *stats;
+
+    uint32_t loop_start;
+    uint32_t stage_start;
+} Profiler;
+
+#ifdef REFLOAT_SIM
+uint32_t profiler_ticks(void);
+#else
+static inline uint32_t profiler_ticks(void) {
+    return PROFILER_DWT_CYCCNT;
+}
+#endif
+
+void profiler_init(Profiler *p);
+
+void profiler_destroy(Profiler *p);
+
+/**
+ * Records a duration of a stage. Use the inline functions below instead.
+ */
+void profiler_record(Profiler *p, ProfilerStage stage, uint32_t ticks);
+
+void profiler_apply_reset(Profiler *p);
+
+static inline void profiler_loop_start(Profiler *p) {
+    if (p->enabled) {
+        if (p->reset_requested) {
+            profiler_apply_reset(p);
+        }
+        p->loop_start = profiler_ticks();
+        p->stage_start = p->loop_start;
+    }
+}
+
+static inline void profiler_stage_start(Profiler *p) {
+    if (p->enabled) {
+        p->stage_start = profiler_ticks();
+    }
+}
+
+/**
+ * Records the time since the last stage start or end as @p stage.
+ */
+static inline void profiler_stage_end(Profiler *p, ProfilerStage stage) {
+    if (p->enabled) {
+        uint32_t now = profiler_ticks();
+        profiler_record(p, stage, now - p->stage_start);
+        p->stage_start = now;
+    }
+}
+
+static inline void profiler_loop_end(Profiler *p) {
+    if (p->enabled) {
+        profiler_record(p, PROFILER_STAGE_LOOP, profiler_ticks() - p->loop_start);
+    }
+}
+
+void profiler_request(Profiler *p, uint8_t *buffer, size_t len);
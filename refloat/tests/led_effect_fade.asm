@@ -0,0 +1,6 @@
+; The Fade animation as an LED effect: a cosine wave from color2 to color1
+; and back over 2 seconds.
+
+    wave r6, time
+    blend r6, color2, color1
+    mov out, r6
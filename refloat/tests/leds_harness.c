@@ -0,0 +1,334 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+// Runs the LED animations through a fixed scenario and writes the LED colors
+// of selected frames, one frame per line, to be compared against the frames
+// rendered by a previous implementation (tests/leds_golden.txt).
+//
+// With an EFFECT_FILE (a program assembled by tools/led_effect_asm.py), the
+// effect is loaded and the Fade animation is replaced by the Custom one, for
+// the effect to be compared against the built-in animation.
+//
+// The LED driver is replaced by stubs, the few VESC_IF functions the LEDs use
+// are provided through the simulator's vesc_c_if.h shim.
+//
+// Usage: leds_harness FRAMES_FILE [EFFECT_FILE]
+
+#include "leds.h"
+
+#include "vesc_c_if.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FRAME_RATE 30.0f
+
+static float sim_time = 100.0f;
+static float sim_pitch = 0.0f;
+static float sim_duty = 0.0f;
+static float sim_rpm = 0.0f;
+static float sim_distance = 0.0f;
+// distance travelled per frame
+static float sim_speed = 0.0f;
+
+static float system_time(void) {
+    return sim_time;
+}
+
+static float imu_get_pitch(void) {
+    return sim_pitch;
+}
+
+static float mc_get_duty_cycle_now(void) {
+    return sim_duty;
+}
+
+static float mc_get_rpm(void) {
+    return sim_rpm;
+}
+
+static float mc_get_battery_level(float *wh_left) {
+    (void) wh_left;
+    return 0.63f;
+}
+
+static float mc_get_distance(void) {
+    return sim_distance;
+}
+
+static int harness_printf(const char *str, ...) {
+    (void) str;
+    return 0;
+}
+
+static void *harness_malloc(size_t bytes) {
+    return malloc(bytes);
+}
+
+static void harness_free(void *ptr) {
+    free(ptr);
+}
+
+static lib_mutex mutex_create(void) {
+    return malloc(1);
+}
+
+// single threaded, there's nothing to lock against
+static void mutex_lock(lib_mutex m) {
+    (void) m;
+}
+
+static void mutex_unlock(lib_mutex m) {
+    (void) m;
+}
+
+static bool app_is_output_disabled(void) {
+    return false;
+}
+
+static vesc_c_if harness_vesc_if = {
+    .system_time = system_time,
+    .printf = harness_printf,
+    .malloc = harness_malloc,
+    .free = harness_free,
+    .mutex_create = mutex_create,
+    .mutex_lock = mutex_lock,
+    .mutex_unlock = mutex_unlock,
+    .imu_get_pitch = imu_get_pitch,
+    .mc_get_duty_cycle_now = mc_get_duty_cycle_now,
+    .mc_get_rpm = mc_get_rpm,
+    .mc_get_battery_level = mc_get_battery_level,
+    .mc_get_distance = mc_get_distance,
+    .app_is_output_disabled = app_is_output_disabled,
+};
+
+vesc_c_if *sim_vesc_if = &harness_vesc_if;
+uint8_t sim_data_buffer_info[16];
+
+void led_driver_init(LedDriver *driver) {
+    driver->bitbuffer = NULL;
+}
+
+bool led_driver_setup(
+    LedDriver *driver, LedPin pin, LedPinConfig pin_config, const LedStrip **led_strips
+) {
+    (void) driver;
+    (void) pin;
+    (void) pin_config;
+    (void) led_strips;
+    return true;
+}
+
+void led_driver_paint(LedDriver *driver) {
+    (void) driver;
+}
+
+void led_driver_destroy(LedDriver *driver) {
+    (void) driver;
+}
+
+static Leds leds;
+static State state;
+static FILE *out;
+static uint32_t frame_count = 0;
+static uint8_t led_count;
+
+static void run(uint32_t frames, uint32_t record_every, FootpadSensorState fs_state) {
+    for (uint32_t i = 0; i < frames; ++i) {
+        sim_time += 1.0f / FRAME_RATE;
+        sim_distance += sim_speed;
+        leds_update(&leds, &state, fs_state);
+
+        if (i % record_every == record_every - 1) {
+            fprintf(out, "%u", frame_count);
+            for (uint8_t j = 0; j < led_count; ++j) {
+                fprintf(out, " %08x", leds.led_data[j]);
+            }
+            fprintf(out, "\n");
+        }
+        ++frame_count;
+    }
+}
+
+static bool load_effect(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return false;
+    }
+
+    uint8_t code[LED_EFFECT_MAX_INSTRUCTIONS * 4 + 1];
+    size_t size = fread(code, 1, sizeof(code), f);
+    fclose(f);
+
+    LedEffect effect;
+    uint8_t error_index;
+    LedEffectResult res = led_effect_load(&effect, code, size / 4, &error_index);
+    if (size % 4 != 0 || res != LED_EFFECT_OK) {
+        fprintf(stderr, "Invalid effect: error %u at instruction %u\n", res, error_index);
+        return false;
+    }
+
+    leds_set_effect(&leds, &effect);
+    return true;
+}
+
+static LedBar bar(
+    float brightness, LedColor color1, LedColor color2, LedAnimMode mode, float speed
+) {
+    LedBar bar = {
+        .brightness = brightness,
+        .color1 = color1,
+        .color2 = color2,
+        .mode = mode,
+        .speed = speed,
+    };
+    return bar;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr, "Usage: %s FRAMES_FILE [EFFECT_FILE]\n", argv[0]);
+        return 1;
+    }
+
+    out = fopen(argv[1], "w");
+    if (!out) {
+        fprintf(stderr, "Failed to open %s\n", argv[1]);
+        return 1;
+    }
+
+    CfgHwLeds hw_cfg = {
+        .mode = LED_MODE_INTERNAL,
+        .pin = LED_PIN_B7,
+        .pin_config = LED_PIN_CFG_NO_PULLUP,
+        .status = {.order = LED_STRIP_ORDER_1ST, .count = 8, .color_order = LED_COLOR_GRB},
+        .front = {.order = LED_STRIP_ORDER_2ND, .count = 16, .color_order = LED_COLOR_GRBW},
+        .rear =
+            {
+                .order = LED_STRIP_ORDER_3RD,
+                .count = 13,
+                .color_order = LED_COLOR_RGB,
+                .reverse = true,
+            },
+    };
+    led_count = hw_cfg.status.count + hw_cfg.front.count + hw_cfg.rear.count;
+
+    CfgLeds cfg = {
+        .on = true,
+        .headlights_on = false,
+        .headlights_transition = LED_TRANS_FADE,
+        .direction_transition = LED_TRANS_FADE,
+        .headlights = bar(0.9f, COLOR_WHITE_FULL, COLOR_BLACK, LED_ANIM_SOLID, 1.0f),
+        .taillights = bar(0.7f, COLOR_RED, COLOR_BLACK, LED_ANIM_SOLID, 1.0f),
+        .front = bar(0.8f, COLOR_CYAN, COLOR_FERRARI, LED_ANIM_SOLID, 1.0f),
+        .rear = bar(0.55f, COLOR_LAVENDER, COLOR_SAGE, LED_ANIM_SOLID, 0.7f),
+        .status =
+            {
+                .idle_timeout = 0,
+                .duty_threshold = 0.6f,
+                .red_bar_percentage = 0.2f,
+                .show_sensors_while_running = true,
+                .brightness_headlights_on = 0.6f,
+                .brightness_headlights_off = 0.35f,
+            },
+        .status_idle = bar(0.5f, COLOR_GOLD, COLOR_BLUE, LED_ANIM_RAINBOW_ROLL, 0.5f),
+    };
+
+    leds_init(&leds);
+    state_init(&state);
+    leds_setup(&leds, &hw_cfg, &cfg);
+    if (!leds.led_data) {
+        fprintf(stderr, "LED setup failed\n");
+        return 1;
+    }
+
+    LedAnimMode fade_mode = LED_ANIM_FADE;
+    if (argc == 3) {
+        if (!load_effect(argv[2])) {
+            return 1;
+        }
+        fade_mode = LED_ANIM_CUSTOM;
+    }
+
+    // startup, the footpad sensors and the status bar
+    state.state = STATE_READY;
+    run(15, 5, FS_NONE);
+    run(12, 4, FS_LEFT);
+    run(12, 4, FS_BOTH);
+    run(12, 6, FS_NONE);
+
+    // every animation mode on the front and rear bars
+    for (LedAnimMode mode = LED_ANIM_SOLID; mode <= LED_ANIM_RAINBOW_ROLL; ++mode) {
+        cfg.front.mode = mode == LED_ANIM_FADE ? fade_mode : mode;
+        cfg.rear.mode = cfg.front.mode;
+        run(45, 9, FS_NONE);
+    }
+
+    // status idle animation
+    cfg.front.mode = LED_ANIM_KNIGHT_RIDER;
+    cfg.rear.mode = LED_ANIM_PULSE;
+    cfg.status.idle_timeout = 1;
+    leds_configure(&leds, &cfg);
+    run(60, 10, FS_NONE);
+    cfg.status.idle_timeout = 0;
+
+    // running with the duty bar, headlights transitions
+    state.state = STATE_RUNNING;
+    state.mode = MODE_NORMAL;
+    sim_duty = 0.75f;
+    sim_rpm = 2000.0f;
+    LedTransition transitions[] = {
+        LED_TRANS_FADE, LED_TRANS_FADE_OUT_IN, LED_TRANS_CIPHER, LED_TRANS_MONO_CIPHER
+    };
+    for (size_t i = 0; i < sizeof(transitions) / sizeof(transitions[0]); ++i) {
+        cfg.headlights_transition = transitions[i];
+        leds_configure(&leds, &cfg);
+        leds_set_headlights_enabled(&leds, i % 2 == 0);
+        run(36, 6, FS_BOTH);
+    }
+
+    // direction change while running with the headlights on
+    leds_set_headlights_enabled(&leds, true);
+    run(36, 12, FS_BOTH);
+    for (size_t i = 0; i < sizeof(transitions) / sizeof(transitions[0]); ++i) {
+        cfg.direction_transition = transitions[i];
+        leds_configure(&leds, &cfg);
+        sim_speed = i % 2 == 0 ? -0.04f : 0.04f;
+        run(28, 4, FS_BOTH);
+    }
+    sim_speed = 0.0f;
+
+    // lifted up, status on front, confirm animation
+    state.state = STATE_READY;
+    sim_duty = 0.0f;
+    sim_rpm = 0.0f;
+    cfg.status_on_front_when_lifted = true;
+    sim_pitch = 1.3f;
+    run(30, 6, FS_NONE);
+    leds_status_confirm(&leds);
+    run(24, 3, FS_NONE);
+
+    // disabled
+    state.state = STATE_DISABLED;
+    run(40, 8, FS_NONE);
+
+    leds_destroy(&leds);
+    fclose(out);
+    return 0;
+}
@@ -0,0 +1,423 @@
+#!/usr/bin/env python3
+"""
+Refloat host tests
+Builds the host test harnesses of pure package code and checks their results.
+"""
+
+import os
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+
+TESTS_DIR = Path(__file__).resolve().parent
+REFLOAT_DIR = TESTS_DIR.parent
+SRC_DIR = REFLOAT_DIR / "src"
+VESC_C_LIB_DIR = Path(os.environ.get("VESC_C_LIB_PATH", REFLOAT_DIR / "vesc_pkg_lib"))
+
+sys.dont_write_bytecode = True
+sys.path.insert(0, str(REFLOAT_DIR / "tools"))
+import data_record  # noqa: E402
+import led_effect_asm  # noqa: E402
+
+CC = os.environ.get("CC", "cc")
+CFLAGS = ["-O2", "-std=gnu99", "-Wall", "-Wextra", "-Werror", "-iquote", str(SRC_DIR)]
+
+# for package code using VESC_IF, built the same way as in the simulator
+STLIB_DIR = VESC_C_LIB_DIR / "stdperiph_stm32f4"
+PACKAGE_CFLAGS = [
+    "-DIS_VESC_LIB",
+    "-DUSE_STLIB",
+    "-fsingle-precision-constant",
+    "-Wdouble-promotion",
+    "-I" + str(REFLOAT_DIR / "sim" / "include"),
+    "-I" + str(VESC_C_LIB_DIR),
+    "-I" + str(STLIB_DIR / "CMSIS" / "include"),
+    "-I" + str(STLIB_DIR / "CMSIS" / "ST"),
+    "-I" + str(STLIB_DIR / "inc"),
+]
+
+# Test counters
+test_passes = 0
+test_failures = 0
+
+
+def check(condition, test_name, details=""):
+    global test_passes, test_failures
+    if condition:
+        test_passes += 1
+        print(f"✓ {test_name}")
+    else:
+        test_failures += 1
+        print(f"✗ {test_name}")
+        if details:
+            print(f"  {details}")
+
+
+def build(workdir, name, sources, cflags=(), libs=()):
+    binary = Path(workdir) / name
+    cmd = [CC] + CFLAGS + list(cflags) + ["-o", str(binary)]
+    cmd += [str(s) for s in sources] + list(libs)
+    subprocess.run(cmd, check=True)
+    return binary
+
+
+# =============================================================================
+# Data Record Sample Encoder
+# =============================================================================
+
+def test_sample_encoder(workdir):
+    print("\nData Record sample encoder round trip:")
+    harness = build(
+        workdir,
+        "sample_encoder_harness",
+        [TESTS_DIR / "sample_encoder_harness.c", SRC_DIR / "lib" / "sample_encoder.c"],
+    )
+
+    dump_path = Path(workdir) / "dump.bin"
+    expected_path = Path(workdir) / "expected.txt"
+    subprocess.run([str(harness), str(dump_path), str(expected_path)], check=True)
+
+    expected = []
+    for line in expected_path.read_text().splitlines():
+        numbers = [int(n) for n in line.split()]
+        expected.append(data_record.Sample(numbers[0], numbers[1], numbers[2:]))
+
+    with open(dump_path, "rb") as f:
+        header, samples = data_record.decode_dump(f)
+
+    check(header.encoding == data_record.ENCODING_COMPRESSED, "header encoding")
+    check(len(header.ids) == 9, "header ids")
+    check(
+        len(samples) == len(expected),
+        "sample count",
+        f"Expected: {len(expected)}, Actual: {len(samples)}",
+    )
+    mismatch = next((i for i, (a, b) in enumerate(zip(samples, expected)) if a != b), None)
+    check(
+        mismatch is None,
+        "decoded samples match the encoded ones",
+        f"First mismatch at {mismatch}: {samples[mismatch] if mismatch is not None else ''}",
+    )
+
+    raw_size = len(expected) * (4 + 1 + 2 * len(header.ids))
+    encoded_size = header.size * data_record.BLOCK_SIZE
+    print(f"  compression ratio of the generated samples: {raw_size / encoded_size:.2f}")
+
+
+# =============================================================================
+# LED Animations
+# =============================================================================
+
+# maximum difference of a color channel from the golden frames
+LEDS_TOLERANCE = 1
+
+
+def read_frames(path):
+    frames = {}
+    for line in Path(path).read_text().splitlines():
+        numbers = line.split()
+        frames[int(numbers[0])] = [int(c, 16) for c in numbers[1:]]
+    return frames
+
+
+def build_leds_harness(workdir):
+    return build(
+        workdir,
+        "leds_harness",
+        [
+            TESTS_DIR / "leds_harness.c",
+            SRC_DIR / "leds.c",
+            SRC_DIR / "led_color.c",
+            SRC_DIR / "led_effect.c",
+            SRC_DIR / "led_strip.c",
+            SRC_DIR / "state.c",
+            SRC_DIR / "utils.c",
+        ],
+        PACKAGE_CFLAGS,
+        ["-lm"],
+    )
+
+
+def test_leds(workdir):
+    print("\nLED animations against the golden frames:")
+    harness = build_leds_harness(workdir)
+
+    frames_path = Path(workdir) / "leds_frames.txt"
+    subprocess.run([str(harness), str(frames_path)], check=True)
+
+    golden = read_frames(TESTS_DIR / "leds_golden.txt")
+    frames = read_frames(frames_path)
+    check(
+        frames.keys() == golden.keys(),
+        "frame count",
+        f"Expected: {len(golden)}, Actual: {len(frames)}",
+    )
+
+    max_diff = 0
+    diff_count = 0
+    channel_count = 0
+    worst = None
+    for index in sorted(golden.keys() & frames.keys()):
+        for led, (a, b) in enumerate(zip(frames[index], golden[index])):
+            for shift in (0, 8, 16, 24):
+                diff = abs((a >> shift & 0xff) - (b >> shift & 0xff))
+                channel_count += 1
+                if diff > 0:
+                    diff_count += 1
+                if diff > max_diff:
+                    max_diff = diff
+                    worst = (index, led, a, b)
+
+    check(
+        max_diff <= LEDS_TOLERANCE,
+        f"colors within {LEDS_TOLERANCE} of the golden frames",
+        f"Frame {worst[0]} LED {worst[1]}: {worst[2]:08x} != {worst[3]:08x}" if worst else "",
+    )
+    print(f"  differing channels: {diff_count} of {channel_count}, max difference {max_diff}")
+
+
+# =============================================================================
+# LED Effects
+# =============================================================================
+
+def test_led_effect(workdir):
+    print("\nLED effect conformance with the built-in Fade animation:")
+    harness = build_leds_harness(workdir)
+
+    code = led_effect_asm.assemble((TESTS_DIR / "led_effect_fade.asm").read_text())
+    effect_path = Path(workdir) / "fade.bin"
+    effect_path.write_bytes(code)
+
+    builtin_path = Path(workdir) / "leds_builtin.txt"
+    effect_frames_path = Path(workdir) / "leds_effect.txt"
+    subprocess.run([str(harness), str(builtin_path)], check=True)
+    subprocess.run([str(harness), str(effect_frames_path), str(effect_path)], check=True)
+
+    builtin = read_frames(builtin_path)
+    frames = read_frames(effect_frames_path)
+    mismatch = next((i for i in sorted(builtin) if builtin[i] != frames.get(i)), None)
+    check(
+        mismatch is None,
+        "effect frames identical to the built-in animation",
+        f"First mismatch in frame {mismatch}",
+    )
+
+    # a register out of range and a jump past the end of the program
+    for name, code in (("register", b"\x03\x10\x00\x00"), ("jump", b"\x19\x01\x00\x00")):
+        effect_path.write_bytes(code)
+        res = subprocess.run(
+            [str(harness), str(effect_frames_path), str(effect_path)], stderr=subprocess.DEVNULL
+        )
+        check(res.returncode != 0, f"invalid {name} rejected")
+
+    try:
+        led_effect_asm.assemble("start:\n    jmp start\n")
+        check(False, "backward jump rejected by the assembler")
+    except led_effect_asm.AsmError:
+        check(True, "backward jump rejected by the assembler")
+
+
+# =============================================================================
+# Simulation
+# =============================================================================
+
+SIM = REFLOAT_DIR / "sim" / "refloat_sim"
+
+
+def run_sim(*args):
+    return subprocess.run([str(SIM), "-q"] + list(args), capture_output=True, text=True)
+
+
+def test_sim(workdir):
+    print("\nSimulation of the synthetic ride:")
+    if not SIM.exists():
+        check(False, "simulator built", f"{SIM} is missing, build it with make -C sim")
+        return
+
+    res = run_sim("-d", "5")
+    check(res.returncode == 0, "ride runs", res.stderr.strip())
+    check("Refloat Main" in res.stderr, "thread stats printed")
+
+    stages = ["imu", "motor_data", "footpad", "haptics", "bms", "alerts", "control",
+              "motor_apply", "data_record", "loop"]
+    res = run_sim("-d", "5", "-P")
+    rows = {row[0]: row for row in (line.split() for line in res.stderr.splitlines()) if len(row) == 6}
+    check(
+        all(stage in rows and int(rows[stage][1]) > 0 for stage in stages),
+        "profiler stats of all stages",
+        res.stderr,
+    )
+    check("loop timer: period 1201us" in res.stderr, "loop timer stats printed")
+
+    # the CPU time charged at 10000 times is several loop periods
+    res = run_sim("-d", "5", "-P", "-x", "10000")
+    timer = next((line for line in res.stderr.splitlines() if line.startswith("loop timer")), "")
+    overruns = int(timer.split(" overruns")[0].split()[-1]) if "overruns" in timer else 0
+    check(overruns > 0 and "busy max 0us" not in timer, "loop timer sees charged CPU time", timer)
+
+    # the compressed record holds the same samples as the raw one, in the
+    # buffer space of a fraction of them
+    raw_path = Path(workdir) / "record_raw.bin"
+    compressed_path = Path(workdir) / "record_compressed.bin"
+    run_sim("-d", "5", "-r", str(raw_path))
+    res = run_sim("-d", "5", "-z", "-r", str(compressed_path))
+    with open(raw_path, "rb") as f:
+        raw_header, raw_samples = data_record.decode_dump(f)
+    with open(compressed_path, "rb") as f:
+        _, samples = data_record.decode_dump(f)
+    check(len(raw_samples) > 0 and samples == raw_samples, "compressed record matches the raw one")
+
+    # the bulk download retransmits the dropped frames
+    for args in (("-b", "8", "-L", "3"), ("-z", "-b", "4", "-L", "2")):
+        bulk_path = Path(workdir) / "record_bulk.bin"
+        bulk_res = run_sim("-d", "5", "-r", str(bulk_path), *args)
+        with open(bulk_path, "rb") as f:
+            _, bulk_samples = data_record.decode_dump(f)
+        check(
+            bulk_samples == raw_samples,
+            f"bulk download {' '.join(args)} matches the raw record",
+            bulk_res.stderr.strip(),
+        )
+
+    blocks = int(res.stderr.split(" blocks downloaded")[0].split()[-1])
+    ratio = len(samples) * (5 + 2 * len(raw_header.ids)) / (blocks * data_record.BLOCK_SIZE)
+    check(ratio >= 4.5, "compression ratio of the ride", f"ratio {ratio:.2f}")
+    print(f"  compression ratio of the ride: {ratio:.2f}")
+
+
+# in the simulator
+DATA_BUFFER_SIZE = 256 * 1024
+# the sample times are in 0.1ms
+SAMPLE_TIME_RATE = 10000
+
+
+def read_record(path):
+    with open(path, "rb") as f:
+        return data_record.decode_dump(f)
+
+
+def test_sim_record_trigger(workdir):
+    print("\nData Record triggered capture in the simulation:")
+    if not SIM.exists():
+        return
+
+    # a 20s ride wraps the buffer, the fault at 17s freezes it with the
+    # samples before the fault and the post-trigger ones after it
+    post_trigger = 50
+    fault_path = Path(workdir) / "record_fault.bin"
+    res = run_sim("-d", "20", "-R", "7=1", "-R", f"8={post_trigger}", "-F", "17", "-r", str(fault_path))
+    header, samples = read_record(fault_path)
+    capacity = DATA_BUFFER_SIZE // (5 + 2 * len(header.ids))
+    check(header.triggered and header.trigger_events == 1, "fault triggers the capture", res.stderr.strip())
+    check(
+        header.size == capacity and len(samples) == capacity,
+        "buffer full of pre-trigger samples",
+        f"Expected: {capacity}, Actual: {header.size}",
+    )
+    stopped = [i for i, s in enumerate(samples) if not s.flags & 1]
+    check(
+        stopped == list(range(capacity - post_trigger - 1, capacity)),
+        "fault sample followed by the post-trigger samples",
+        f"Stopped samples: {stopped[:3]}...{stopped[-3:]}",
+    )
+    steps = {b.time - a.time for a, b in zip(samples, samples[1:])}
+    check(max(steps) <= 13, "pre-trigger samples contiguous", f"Steps: {sorted(steps)}")
+    check(
+        samples[-1].time < 18 * SAMPLE_TIME_RATE,
+        "buffer frozen after the post-trigger samples",
+        f"Last sample at {samples[-1].time / SAMPLE_TIME_RATE}s",
+    )
+
+    # the wheelslip event triggers only when it's selected
+    post_trigger = 20
+    slip_path = Path(workdir) / "record_wheelslip.bin"
+    res = run_sim("-d", "10", "-R", "7=2", "-R", f"8={post_trigger}", "-W", "5", "-r", str(slip_path))
+    header, samples = read_record(slip_path)
+    slipping = [i for i, s in enumerate(samples) if s.flags & 2]
+    check(header.triggered, "wheelslip triggers the capture", res.stderr.strip())
+    check(
+        len(slipping) > 0 and slipping[0] == len(samples) - post_trigger - 1,
+        "wheelslip sample followed by the post-trigger samples",
+        f"Wheelslip at {slipping[:1]} of {len(samples)}",
+    )
+
+    run_sim("-d", "10", "-R", "7=1", "-R", f"8={post_trigger}", "-W", "5", "-r", str(slip_path))
+    header, samples = read_record(slip_path)
+    check(
+        not header.triggered and any(s.flags & 2 for s in samples),
+        "wheelslip ignored when only faults trigger",
+    )
+
+
+def test_sim_record_channels(workdir):
+    print("\nData Record decimation and channels in the simulation:")
+    if not SIM.exists():
+        return
+
+    full_path = Path(workdir) / "record_full.bin"
+    run_sim("-d", "5", "-r", str(full_path))
+    full_header, full = read_record(full_path)
+
+    for decimation in (2, 4):
+        path = Path(workdir) / "record_decimated.bin"
+        run_sim("-d", "5", "-R", f"5={decimation}", "-r", str(path))
+        header, samples = read_record(path)
+        check(
+            header.decimation == decimation and len(samples) > 0
+            and samples == full[decimation - 1::decimation],
+            f"decimation {decimation} keeps one in {decimation} samples",
+            f"{len(samples)} samples of {len(full)}",
+        )
+
+    # channels 0, 2 and 4
+    channels = [0, 2, 4]
+    for args in ((), ("-z",)):
+        path = Path(workdir) / "record_channels.bin"
+        run_sim("-d", "5", "-R", "9=0x15", "-r", str(path), *args)
+        header, samples = read_record(path)
+        name = " ".join(("channel mask",) + args)
+        check(
+            header.ids == [full_header.ids[c] for c in channels],
+            f"{name} selects the header ids",
+            f"Ids: {header.ids}",
+        )
+        check(
+            len(samples) == len(full) and all(
+                s.time == f.time and s.flags == f.flags and s.values == [f.values[c] for c in channels]
+                for s, f in zip(samples, full)
+            ),
+            f"{name} records the selected values",
+        )
+
+    # the buffer of a 20s ride wraps with all channels, but holds the whole
+    # ride with fewer of them
+    for mask, count in ((None, len(full_header.ids)), ("0x15", len(channels))):
+        path = Path(workdir) / "record_size.bin"
+        run_sim("-d", "20", "-r", str(path), *(("-R", f"9={mask}") if mask else ()))
+        header, samples = read_record(path)
+        capacity = DATA_BUFFER_SIZE // (5 + 2 * count)
+        wrapped = samples[0].time != full[0].time
+        check(
+            len(samples) == header.size and (header.size == capacity) == wrapped
+            and header.size <= capacity and wrapped == (mask is None),
+            f"size reported with {count} channels",
+            f"Capacity: {capacity}, size: {header.size}, first sample at {samples[0].time}",
+        )
+
+
+def main():
+    with tempfile.TemporaryDirectory() as workdir:
+        test_sample_encoder(workdir)
+        test_leds(workdir)
+        test_led_effect(workdir)
+        test_sim(workdir)
+        test_sim_record_trigger(workdir)
+        test_sim_record_channels(workdir)
+
+    print(f"\n{test_passes} passed, {test_failures} failed")
+    return 1 if test_failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
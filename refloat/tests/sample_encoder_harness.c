@@ -0,0 +1,152 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the Refloat VESC package.
+//
+// Refloat VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Refloat VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+// Encodes generated samples with the sample encoder and writes a dump of the
+// DATA_RECORD responses the package would send for them, along with the
+// expected samples, for the decoder in tools/data_record.py to be checked
+// against.
+//
+// Usage: sample_encoder_harness DUMP_FILE EXPECTED_FILE
+
+#include "lib/sample_encoder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define VALUE_COUNT 9
+#define SAMPLE_COUNT 20000
+#define BLOCK_SIZE 248
+#define MAX_BLOCKS 4096
+
+static uint8_t blocks[MAX_BLOCKS][BLOCK_SIZE];
+static size_t block_count = 0;
+
+static void write_message(FILE *f, const uint8_t *data, size_t len) {
+    uint8_t prefix[2] = {len >> 8, len};
+    fwrite(prefix, 1, 2, f);
+    fwrite(data, 1, len, f);
+}
+
+static size_t put_u32(uint8_t *buf, uint32_t value) {
+    buf[0] = value >> 24;
+    buf[1] = value >> 16;
+    buf[2] = value >> 8;
+    buf[3] = value;
+    return 4;
+}
+
+static void write_dump(FILE *f) {
+    uint8_t buf[512];
+    size_t ind = 0;
+    buf[ind++] = 101;
+    buf[ind++] = 42;
+    ind += put_u32(&buf[ind], block_count);
+    buf[ind++] = VALUE_COUNT;
+    for (int i = 0; i < VALUE_COUNT; ++i) {
+        int len = sprintf((char *) &buf[ind + 1], "v%d", i);
+        buf[ind] = len;
+        ind += 1 + len;
+    }
+    buf[ind++] = 1;  // compressed encoding
+    write_message(f, buf, ind);
+
+    // two blocks per data message, the same as the package sends them
+    for (size_t b = 0; b < block_count; b += 2) {
+        ind = 0;
+        buf[ind++] = 101;
+        buf[ind++] = 43;
+        ind += put_u32(&buf[ind], b);
+        for (size_t i = b; i < b + 2 && i < block_count; ++i) {
+            uint16_t length = blocks[i][0] << 8 | blocks[i][1];
+            for (uint16_t j = 0; j < length; ++j) {
+                buf[ind++] = blocks[i][j];
+            }
+        }
+        write_message(f, buf, ind);
+    }
+}
+
+static uint16_t random_walk(uint16_t value, int step) {
+    return value + (rand() % (2 * step + 1)) - step;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s DUMP_FILE EXPECTED_FILE\n", argv[0]);
+        return 1;
+    }
+
+    FILE *dump = fopen(argv[1], "wb");
+    FILE *expected = fopen(argv[2], "w");
+    if (!dump || !expected) {
+        fprintf(stderr, "Failed to open output files\n");
+        return 1;
+    }
+
+    srand(1);
+
+    SampleEncoder e;
+    sample_encoder_init(&e, blocks[0], BLOCK_SIZE, VALUE_COUNT);
+
+    uint32_t time = 0xfffff000;  // wraps around during the run
+    uint8_t flags = 0;
+    uint16_t values[VALUE_COUNT] = {0x3c00, 0xbc00, 0, 0x7bff, 0xfbff, 0x1234, 0x8001, 0x4000, 0};
+    for (int s = 0; s < SAMPLE_COUNT; ++s) {
+        time += 12;
+        if (s % 5000 == 4999) {
+            time += 0x90000000;  // a time delta change beyond int32
+        } else if (s % 1000 == 999) {
+            time += 100000;
+        }
+
+        if (rand() % 100 == 0) {
+            flags = rand();
+        }
+
+        values[0] = random_walk(values[0], 3);  // slow and noisy
+        values[1] = random_walk(values[1], 60);
+        values[2] = rand();  // incompressible
+        values[3] = s % 100 < 50 ? 0x7bff : 0xfbff;  // sign flips
+        values[5] = random_walk(values[5], 1);
+        values[7] = s;
+        // values 4, 6 and 8 are constant
+
+        if (!sample_encoder_add(&e, time, flags, values)) {
+            if (++block_count == MAX_BLOCKS) {
+                fprintf(stderr, "Out of blocks\n");
+                return 1;
+            }
+            sample_encoder_init(&e, blocks[block_count], BLOCK_SIZE, VALUE_COUNT);
+            if (!sample_encoder_add(&e, time, flags, values)) {
+                fprintf(stderr, "Sample doesn't fit into an empty block\n");
+                return 1;
+            }
+        }
+
+        fprintf(expected, "%u %u", time, flags);
+        for (int i = 0; i < VALUE_COUNT; ++i) {
+            fprintf(expected, " %u", values[i]);
+        }
+        fprintf(expected, "\n");
+    }
+    ++block_count;
+
+    write_dump(dump);
+    fclose(dump);
+    fclose(expected);
+    return 0;
+}
@@ -0,0 +1,276 @@
+#!/usr/bin/env python3
+
+# Decoder of the data recorded by the package data recorder, see
+# doc/commands/DATA_RECORD.md.
+#
+# The input is a dump of the DATA_RECORD_HEADER and DATA_RECORD_DATA response
+# payloads (starting with the package ID), each prefixed by its length as a
+# big-endian uint16. DATA_RECORD_FRAME responses of the bulk download are
+# accepted as well, frames with a CRC mismatch are skipped. The output is a
+# CSV file with one row per sample.
+
+from argparse import ArgumentParser
+import struct
+import sys
+
+
+PACKAGE_ID = 101
+COMMAND_DATA_RECORD_HEADER = 42
+COMMAND_DATA_RECORD_DATA = 43
+COMMAND_DATA_RECORD_FRAME = 46
+
+ENCODING_RAW = 0
+ENCODING_COMPRESSED = 1
+
+# parameters of the compressed encoding, see src/lib/sample_encoder.c
+RESIDUAL_SUM_SHIFT = 2
+PREDICTOR_ERROR_SHIFT = 2
+RICE_ESCAPE = 16
+
+# size of the buffer space of a block in the package
+BLOCK_SIZE = 248
+
+
+class Sample:
+    def __init__(self, time, flags, values):
+        self.time = time
+        self.flags = flags
+        self.values = values
+
+    def __eq__(self, other):
+        return (self.time, self.flags, self.values) == (other.time, other.flags, other.values)
+
+    def __repr__(self):
+        return "Sample({}, {}, {})".format(self.time, self.flags, self.values)
+
+
+class Header:
+    def __init__(self, size, ids, encoding, decimation=1, trigger_events=0, triggered=False):
+        self.size = size
+        self.ids = ids
+        self.encoding = encoding
+        self.decimation = decimation
+        self.trigger_events = trigger_events
+        self.triggered = triggered
+
+
+def float16(value):
+    return struct.unpack(">e", struct.pack(">H", value))[0]
+
+
+def crc32c(data):
+    crc = 0xffffffff
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ (0x82f63b78 & -(crc & 1))
+    return crc ^ 0xffffffff
+
+
+class BitReader:
+    def __init__(self, data, ind):
+        self.data = data
+        self.pos = ind * 8
+
+    def bit(self):
+        byte = self.data[self.pos >> 3]
+        bit = (byte >> (7 - (self.pos & 7))) & 1
+        self.pos += 1
+        return bit
+
+    def bits(self, count):
+        value = 0
+        for _ in range(count):
+            value = value << 1 | self.bit()
+        return value
+
+    def exp_golomb(self):
+        zeros = 0
+        while not self.bit():
+            zeros += 1
+        return (1 << zeros | self.bits(zeros)) - 1
+
+    def rice(self, k):
+        quotient = 0
+        while quotient < RICE_ESCAPE and self.bit():
+            quotient += 1
+        if quotient == RICE_ESCAPE:
+            return self.bits(16)
+        return quotient << k | self.bits(k)
+
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def decode_header(data):
+    size, count = struct.unpack_from(">IB", data)
+    ind = 5
+    ids = []
+    for _ in range(count):
+        length = data[ind]
+        ids.append(data[ind + 1:ind + 1 + length].decode())
+        ind += 1 + length
+
+    # the rest is not sent by older package versions
+    if ind >= len(data):
+        return Header(size, ids, ENCODING_RAW)
+    encoding = data[ind]
+    if ind + 5 > len(data):
+        return Header(size, ids, encoding)
+    decimation, trigger_events, triggered = struct.unpack_from(">HBB", data, ind + 1)
+    return Header(size, ids, encoding, decimation, trigger_events, bool(triggered))
+
+
+def decode_raw_samples(data, value_count):
+    """Decodes a sequence of raw samples, returns a list of Samples."""
+    sample_size = 5 + 2 * value_count
+    samples = []
+    for ind in range(0, len(data) - sample_size + 1, sample_size):
+        time, flags = struct.unpack_from(">IB", data, ind)
+        values = list(struct.unpack_from(">{}H".format(value_count), data, ind + 5))
+        samples.append(Sample(time, flags, values))
+    return samples
+
+
+def zigzag16(delta):
+    delta = (delta + 0x8000 & 0xffff) - 0x8000
+    return (delta << 1 ^ delta >> 15) & 0xffff
+
+
+def rice_parameter(residual_sum):
+    return (residual_sum >> (RESIDUAL_SUM_SHIFT + 1)).bit_length()
+
+
+def decode_block(data, value_count):
+    """
+    Decodes a single compressed block, returns a list of Samples and the
+    length of the block.
+    """
+    length, count = struct.unpack_from(">HH", data)
+    if count == 0:
+        return [], length
+
+    time, flags = struct.unpack_from(">IB", data, 4)
+    values = list(struct.unpack_from(">{}H".format(value_count), data, 9))
+    samples = [Sample(time, flags, values)]
+
+    prev_values = values
+    time_delta = 0
+    residual_sums = [0] * value_count
+    hold_errors = [0] * value_count
+    linear_errors = [0] * value_count
+
+    reader = BitReader(data, 9 + 2 * value_count)
+    for _ in range(count - 1):
+        time_delta = (time_delta + unzigzag(reader.exp_golomb())) & 0xffffffff
+        time = (time + time_delta) & 0xffffffff
+        if reader.bit():
+            flags = reader.bits(8)
+
+        new_values = []
+        for i in range(value_count):
+            hold = values[i]
+            linear = (2 * values[i] - prev_values[i]) & 0xffff
+            use_linear = linear_errors[i] < hold_errors[i]
+            residual = reader.rice(rice_parameter(residual_sums[i]))
+            value = ((linear if use_linear else hold) + unzigzag(residual)) & 0xffff
+            new_values.append(value)
+
+            residual_sums[i] += residual - (residual_sums[i] >> RESIDUAL_SUM_SHIFT)
+            hold_errors[i] += zigzag16(value - hold) - (hold_errors[i] >> PREDICTOR_ERROR_SHIFT)
+            linear_errors[i] += zigzag16(value - linear) - (linear_errors[i] >> PREDICTOR_ERROR_SHIFT)
+
+        prev_values = values
+        values = new_values
+        samples.append(Sample(time, flags, values))
+
+    if (reader.pos + 7) >> 3 != length:
+        raise ValueError("Block length mismatch: {} != {}".format((reader.pos + 7) >> 3, length))
+
+    return samples, length
+
+
+def decode_blocks(data, value_count):
+    """Decodes a sequence of compressed blocks, returns a list of Samples."""
+    samples = []
+    ind = 0
+    while ind < len(data):
+        block_samples, length = decode_block(data[ind:], value_count)
+        samples += block_samples
+        ind += length
+    return samples
+
+
+def read_messages(f):
+    while True:
+        prefix = f.read(2)
+        if len(prefix) < 2:
+            return
+        (length,) = struct.unpack(">H", prefix)
+        yield f.read(length)
+
+
+def decode_dump(f):
+    """
+    Decodes a dump of the header and data responses, returns the Header and a
+    list of Samples ordered by their offset.
+    """
+    header = None
+    chunks = {}
+    for msg in read_messages(f):
+        if len(msg) < 2 or msg[0] != PACKAGE_ID:
+            continue
+
+        if msg[1] == COMMAND_DATA_RECORD_HEADER:
+            header = decode_header(msg[2:])
+        elif msg[1] == COMMAND_DATA_RECORD_DATA:
+            (offset,) = struct.unpack_from(">I", msg, 2)
+            chunks[offset] = msg[6:]
+        elif msg[1] == COMMAND_DATA_RECORD_FRAME:
+            (crc,) = struct.unpack_from(">I", msg, len(msg) - 4)
+            if len(msg) < 14 or crc32c(msg[2:-4]) != crc:
+                continue
+            (offset,) = struct.unpack_from(">I", msg, 6)
+            chunks[offset] = msg[10:-4]
+
+    if header is None:
+        raise ValueError("No DATA_RECORD_HEADER in the dump")
+
+    value_count = len(header.ids)
+    samples = []
+    for offset in sorted(chunks):
+        if header.encoding == ENCODING_COMPRESSED:
+            samples += decode_blocks(chunks[offset], value_count)
+        else:
+            samples += decode_raw_samples(chunks[offset], value_count)
+    return header, samples
+
+
+def write_csv(out, header, samples):
+    columns = ["time", "running", "wheelslip", "footpad_state", "sat"] + header.ids
+    out.write(",".join(columns) + "\n")
+    for s in samples:
+        row = [s.time, s.flags & 1, (s.flags >> 1) & 1, (s.flags >> 2) & 3, s.flags >> 4]
+        row += [float16(v) for v in s.values]
+        out.write(",".join(str(v) for v in row) + "\n")
+
+
+def main():
+    parser = ArgumentParser(prog='data_record', description="Decode a data record dump into CSV.")
+    parser.add_argument('dump', help="dump of the DATA_RECORD responses")
+    parser.add_argument('-o', '--output', help="output CSV file (default: stdout)")
+    args = parser.parse_args()
+
+    with open(args.dump, 'rb') as f:
+        header, samples = decode_dump(f)
+
+    if args.output:
+        with open(args.output, 'w') as out:
+            write_csv(out, header, samples)
+    else:
+        write_csv(sys.stdout, header, samples)
+
+
+if __name__ == '__main__':
+    main()
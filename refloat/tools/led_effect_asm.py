@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+
+# Assembler of the LED effect programs, see doc/commands/LED_EFFECT.md.
+#
+# One instruction per line, operands separated by commas. Comments start with
+# `;` or `#`, labels end with `:` and can be used as targets of the (forward
+# only) jumps. Registers are `r0` to `r15`, the inputs also have their names:
+# `index`, `length`, `time`, `color1`, `color2` and `out`. Immediates can be
+# decimal or hexadecimal (`0x...`).
+#
+# Besides the instructions, there is a `ld d, imm32` pseudo-instruction which
+# loads a 32-bit value (e.g. a color) using `ldi` and `ldhi`.
+#
+# The output is the program as hex (the payload of the upload request after
+# the instruction count) or as a binary file.
+
+from argparse import ArgumentParser
+import sys
+
+
+MAX_INSTRUCTIONS = 40
+REGISTERS = 16
+
+REGISTER_NAMES = {
+    "index": 0,
+    "length": 1,
+    "time": 2,
+    "color1": 3,
+    "color2": 4,
+    "out": 5,
+}
+
+# operand formats: R register, I16 immediate, I8 signed immediate, L label
+OPCODES = {
+    "end": (0x00, ""),
+    "ldi": (0x01, "R,I16"),
+    "ldhi": (0x02, "R,I16"),
+    "mov": (0x03, "R,R"),
+    "addi": (0x04, "R,R,I8"),
+    "add": (0x05, "R,R,R"),
+    "sub": (0x06, "R,R,R"),
+    "mul": (0x07, "R,R,R"),
+    "div": (0x08, "R,R,R"),
+    "mod": (0x09, "R,R,R"),
+    "mulq": (0x0A, "R,R,R"),
+    "min": (0x0B, "R,R,R"),
+    "max": (0x0C, "R,R,R"),
+    "and": (0x0D, "R,R,R"),
+    "or": (0x0E, "R,R,R"),
+    "xor": (0x0F, "R,R,R"),
+    "shl": (0x10, "R,R,R"),
+    "shr": (0x11, "R,R,R"),
+    "sar": (0x12, "R,R,R"),
+    "abs": (0x13, "R,R"),
+    "wave": (0x14, "R,R"),
+    "hue": (0x15, "R,R"),
+    "blend": (0x16, "R,R,R"),
+    "scale": (0x17, "R,R,R"),
+    "rand": (0x18, "R,R"),
+    "jmp": (0x19, "L"),
+    "jeq": (0x1A, "R,R,L"),
+    "jne": (0x1B, "R,R,L"),
+    "jlt": (0x1C, "R,R,L"),
+    "jge": (0x1D, "R,R,L"),
+}
+
+
+class AsmError(Exception):
+    def __init__(self, line, message):
+        super().__init__("line {}: {}".format(line, message))
+
+
+def parse_register(line, text):
+    if text in REGISTER_NAMES:
+        return REGISTER_NAMES[text]
+    if text.startswith("r") and text[1:].isdigit() and int(text[1:]) < REGISTERS:
+        return int(text[1:])
+    raise AsmError(line, "invalid register '{}'".format(text))
+
+
+def parse_immediate(line, text, low, high):
+    try:
+        value = int(text, 0)
+    except ValueError:
+        raise AsmError(line, "invalid immediate '{}'".format(text))
+    if value < low or value > high:
+        raise AsmError(line, "immediate {} out of range [{}, {}]".format(text, low, high))
+    return value
+
+
+def tokenize(source):
+    """Returns a list of (line, mnemonic, operands), with labels as (line, 'label:', [name])."""
+    items = []
+    for number, text in enumerate(source.splitlines(), 1):
+        text = text.split(";")[0].split("#")[0].strip()
+        while ":" in text:
+            label, text = text.split(":", 1)
+            items.append((number, "label:", [label.strip()]))
+            text = text.strip()
+        if not text:
+            continue
+        parts = text.split(None, 1)
+        operands = [o.strip() for o in parts[1].split(",")] if len(parts) > 1 else []
+        items.append((number, parts[0].lower(), operands))
+    return items
+
+
+def expand(items):
+    """Expands pseudo-instructions."""
+    result = []
+    for line, mnemonic, operands in items:
+        if mnemonic == "ld":
+            if len(operands) != 2:
+                raise AsmError(line, "ld expects 2 operands")
+            value = parse_immediate(line, operands[1], -0x80000000, 0xFFFFFFFF) & 0xFFFFFFFF
+            result.append((line, "ldi", [operands[0], str(value & 0xFFFF)]))
+            result.append((line, "ldhi", [operands[0], str(value >> 16)]))
+        else:
+            result.append((line, mnemonic, operands))
+    return result
+
+
+def assemble(source):
+    """Assembles the source, returns the program as bytes."""
+    items = expand(tokenize(source))
+
+    labels = {}
+    instructions = []
+    for line, mnemonic, operands in items:
+        if mnemonic == "label:":
+            if operands[0] in labels:
+                raise AsmError(line, "duplicate label '{}'".format(operands[0]))
+            labels[operands[0]] = len(instructions)
+        else:
+            instructions.append((line, mnemonic, operands))
+
+    if len(instructions) > MAX_INSTRUCTIONS:
+        raise AsmError(
+            instructions[-1][0], "program too long, {} instructions max".format(MAX_INSTRUCTIONS)
+        )
+
+    code = bytearray()
+    for index, (line, mnemonic, operands) in enumerate(instructions):
+        if mnemonic not in OPCODES:
+            raise AsmError(line, "unknown instruction '{}'".format(mnemonic))
+        opcode, fmt = OPCODES[mnemonic]
+        kinds = fmt.split(",") if fmt else []
+        if len(operands) != len(kinds):
+            raise AsmError(line, "{} expects {} operands".format(mnemonic, len(kinds)))
+
+        fields = []  # d, a, b in order, the jump offset goes to d
+        offset = 0
+        for kind, operand in zip(kinds, operands):
+            if kind == "R":
+                fields.append(parse_register(line, operand))
+            elif kind == "I16":
+                value = parse_immediate(line, operand, -0x8000, 0xFFFF) & 0xFFFF
+                fields += [value >> 8, value & 0xFF]
+            elif kind == "I8":
+                fields.append(parse_immediate(line, operand, -0x80, 0x7F) & 0xFF)
+            elif kind == "L":
+                if operand not in labels:
+                    raise AsmError(line, "unknown label '{}'".format(operand))
+                offset = labels[operand] - index - 1
+                if offset < 0:
+                    raise AsmError(line, "jumps can only go forward")
+
+        if fmt.endswith("L"):
+            fields = [offset] + fields
+        fields += [0] * (3 - len(fields))
+        code += bytes([opcode] + fields)
+
+    return bytes(code)
+
+
+def main():
+    parser = ArgumentParser(prog='led_effect_asm', description="Assemble an LED effect program.")
+    parser.add_argument('source', help="assembly source file")
+    parser.add_argument('-o', '--output', help="output file (default: stdout)")
+    parser.add_argument(
+        '-f', '--format', choices=['hex', 'bin'], default='hex', help="output format"
+    )
+    args = parser.parse_args()
+
+    with open(args.source) as f:
+        try:
+            code = assemble(f.read())
+        except AsmError as e:
+            sys.exit("{}: {}".format(args.source, e))
+
+    if args.format == 'bin':
+        if args.output:
+            with open(args.output, 'wb') as out:
+                out.write(code)
+        else:
+            sys.stdout.buffer.write(code)
+    else:
+        text = code.hex() + "\n"
+        if args.output:
+            with open(args.output, 'w') as out:
+                out.write(text)
+        else:
+            sys.stdout.write(text)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,129 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the VESC package.
+//
+// This VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// This VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+// Mahony attitude filter of the firmware, for the secondary filter the
+// package runs on the IMU samples (true pitch and yaw).
+
+#include "sim.h"
+
+#include <math.h>
+#include <string.h>
+
+void sim_ahrs_init_attitude_info(ATTITUDE_INFO *att) {
+	memset(att, 0, sizeof(ATTITUDE_INFO));
+	att->q0 = 1;
+	att->accMagP = 1;
+	att->acc_confidence_decay = 1;
+	att->kp = 0.3f;
+}
+
+// Like the firmware, the first sample sets the orientation from gravity
+static void initial_orientation(const float *acc, ATTITUDE_INFO *att) {
+	float pitch = asinf(fmaxf(fminf(-acc[0], 1), -1));
+	float roll = atan2f(acc[1], acc[2]);
+	float cr = cosf(roll / 2), sr = sinf(roll / 2);
+	float cp = cosf(pitch / 2), sp = sinf(pitch / 2);
+	att->q0 = cr * cp;
+	att->q1 = sr * cp;
+	att->q2 = cr * sp;
+	att->q3 = -sr * sp;
+	att->initialUpdateDone = 1;
+}
+
+static float acc_confidence(float acc_mag, ATTITUDE_INFO *att) {
+	acc_mag = att->accMagP * 0.9f + acc_mag * 0.1f;
+	att->accMagP = acc_mag;
+	float confidence = 1 - att->acc_confidence_decay * sqrtf(fabsf(acc_mag - 1));
+	return confidence > 0 ? confidence : 0;
+}
+
+void sim_ahrs_update_mahony_imu(float *gyro, float *acc, float dt, ATTITUDE_INFO *att) {
+	float ax = acc[0], ay = acc[1], az = acc[2];
+	float gx = gyro[0], gy = gyro[1], gz = gyro[2];
+	float q0 = att->q0, q1 = att->q1, q2 = att->q2, q3 = att->q3;
+
+	float acc_norm = sqrtf(ax * ax + ay * ay + az * az);
+	if (!att->initialUpdateDone) {
+		if (acc_norm > 0) {
+			float norm_acc[3] = {ax / acc_norm, ay / acc_norm, az / acc_norm};
+			initial_orientation(norm_acc, att);
+		}
+		return;
+	}
+
+	float two_kp = 2 * acc_confidence(acc_norm, att) * att->kp;
+	float two_ki = 2 * att->ki;
+
+	if (acc_norm > 0) {
+		ax /= acc_norm;
+		ay /= acc_norm;
+		az /= acc_norm;
+
+		// Estimated direction of gravity and the error to the measured one
+		float halfvx = q1 * q3 - q0 * q2;
+		float halfvy = q0 * q1 + q2 * q3;
+		float halfvz = q0 * q0 - 0.5f + q3 * q3;
+		float halfex = ay * halfvz - az * halfvy;
+		float halfey = az * halfvx - ax * halfvz;
+		float halfez = ax * halfvy - ay * halfvx;
+
+		if (two_ki > 0) {
+			att->integralFBx += two_ki * halfex * dt;
+			att->integralFBy += two_ki * halfey * dt;
+			att->integralFBz += two_ki * halfez * dt;
+			gx += att->integralFBx;
+			gy += att->integralFBy;
+			gz += att->integralFBz;
+		} else {
+			att->integralFBx = 0;
+			att->integralFBy = 0;
+			att->integralFBz = 0;
+		}
+
+		gx += two_kp * halfex;
+		gy += two_kp * halfey;
+		gz += two_kp * halfez;
+	}
+
+	gx *= 0.5f * dt;
+	gy *= 0.5f * dt;
+	gz *= 0.5f * dt;
+	float qa = q0, qb = q1, qc = q2;
+	q0 += -qb * gx - qc * gy - q3 * gz;
+	q1 += qa * gx + qc * gz - q3 * gy;
+	q2 += qa * gy - qb * gz + q3 * gx;
+	q3 += qa * gz + qb * gy - qc * gx;
+
+	float norm = sqrtf(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+	att->q0 = q0 / norm;
+	att->q1 = q1 / norm;
+	att->q2 = q2 / norm;
+	att->q3 = q3 / norm;
+}
+
+float sim_ahrs_get_roll(ATTITUDE_INFO *att) {
+	return -atan2f(att->q0 * att->q1 + att->q2 * att->q3, 0.5f - (att->q1 * att->q1 + att->q2 * att->q2));
+}
+
+float sim_ahrs_get_pitch(ATTITUDE_INFO *att) {
+	float sin_pitch = -2 * (att->q1 * att->q3 - att->q0 * att->q2);
+	return asinf(fmaxf(fminf(sin_pitch, 1), -1));
+}
+
+float sim_ahrs_get_yaw(ATTITUDE_INFO *att) {
+	return -atan2f(att->q0 * att->q3 + att->q1 * att->q2, 0.5f - (att->q2 * att->q2 + att->q3 * att->q3));
+}
@@ -0,0 +1,145 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the VESC package.
+//
+// This VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// This VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+// Config overrides from the command line, so that tune changes can be
+// evaluated without a config file round trip.
+
+#include "sim.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+	CFG_FLOAT,
+	CFG_U16,
+	CFG_U8,
+	CFG_I8,
+	CFG_BOOL,
+	CFG_ENUM,
+} CfgType;
+
+typedef struct {
+	const char *name;
+	size_t offset;
+	CfgType type;
+} CfgItem;
+
+#define CFG_TYPE(field) _Generic((field), \
+	float: CFG_FLOAT, \
+	uint16_t: CFG_U16, \
+	uint8_t: CFG_U8, \
+	int8_t: CFG_I8, \
+	bool: CFG_BOOL, \
+	INPUTTILT_REMOTE_TYPE: CFG_ENUM)
+
+#define CFG(name) {#name, offsetof(tnt_config, name), CFG_TYPE(((tnt_config *)0)->name)},
+
+#define CFG_ITEMS \
+	CFG(disable_pkg) CFG(kp0) CFG(current1) CFG(current2) CFG(current3) CFG(current4) \
+	CFG(current5) CFG(current6) CFG(pitch1) CFG(pitch2) CFG(pitch3) CFG(pitch4) CFG(pitch5) \
+	CFG(pitch6) CFG(pitch_kp_input) CFG(mahony_kp) CFG(kp_rate) CFG(pitch_filter) \
+	CFG(kalman_factor1) CFG(kalman_factor2) CFG(kalman_factor3) CFG(brake_curve) CFG(brake_kp0) \
+	CFG(brakekp_rate) CFG(brakecurrent1) CFG(brakecurrent2) CFG(brakecurrent3) CFG(brakecurrent4) \
+	CFG(brakecurrent5) CFG(brakecurrent6) CFG(brakepitch1) CFG(brakepitch2) CFG(brakepitch3) \
+	CFG(brakepitch4) CFG(brakepitch5) CFG(brakepitch6) CFG(pitch_kp_input_brake) CFG(roll_kp1) \
+	CFG(roll_kp2) CFG(roll_kp3) CFG(roll1) CFG(roll2) CFG(roll3) CFG(brkroll_kp1) CFG(brkroll_kp2) \
+	CFG(brkroll_kp3) CFG(brkroll1) CFG(brkroll2) CFG(brkroll3) CFG(rollkp_higherpm) \
+	CFG(roll_hs_higherpm) CFG(rollkp_lowerpm) CFG(roll_hs_lowerpm) CFG(rollkp_maxscale) \
+	CFG(roll_hs_maxscale) CFG(yaw_rate_kp) CFG(yaw_kp1) CFG(yaw_kp2) CFG(yaw_kp3) CFG(yaw1) \
+	CFG(yaw2) CFG(yaw3) CFG(yaw_rate_brake_kp) CFG(brkyaw_kp1) CFG(brkyaw_kp2) CFG(brkyaw_kp3) \
+	CFG(brkyaw1) CFG(brkyaw2) CFG(brkyaw3) CFG(yaw_minerpm) CFG(is_surge_enabled) \
+	CFG(surge_startcurrent) CFG(surge_start_hd_current) CFG(surge_scaleduty) \
+	CFG(surge_pitchmargin) CFG(surge_maxangle) CFG(surge_minerpm) CFG(surge_duty) \
+	CFG(current_filter) CFG(tiltback_surge_speed) CFG(is_traction_enabled) \
+	CFG(wheelslip_accelstart) CFG(wheelslip_accelslowed) CFG(wheelslip_accelend) \
+	CFG(wheelslip_scaleaccel) CFG(wheelslip_scaleerpm) CFG(wheelslip_filter_freq) \
+	CFG(wheelslip_max_angle) CFG(wheelslip_accelhold) CFG(wheelslip_resettime) \
+	CFG(wheelslip_erpm_rate_limit) CFG(wheelslip_erpm_exclusion_rate) CFG(wheelslip_erpm_margin) \
+	CFG(is_tc_braking_enabled) CFG(tc_braking_angle) CFG(tc_braking_min_erpm) \
+	CFG(tc_braking_off_time) CFG(enable_speed_stability) CFG(enable_throttle_stability) \
+	CFG(stabl_pitch_max_scale) CFG(stabl_rate_max_scale) CFG(stabl_min_erpm) CFG(stabl_max_erpm) \
+	CFG(stabl_ramp) CFG(stabl_ramp_down) CFG(hertz) CFG(ema_factor) CFG(fault_pitch) \
+	CFG(fault_roll) CFG(fault_adc1) CFG(fault_adc2) CFG(fault_delay_pitch) \
+	CFG(fault_delay_switch_half) CFG(fault_delay_switch_full) CFG(fault_adc_half_erpm) \
+	CFG(fault_is_dual_switch) CFG(fault_moving_fault_disabled) CFG(is_quickstop_enabled) \
+	CFG(quickstop_erpm) CFG(quickstop_angle) CFG(tiltback_duty_angle) CFG(tiltback_duty_speed) \
+	CFG(tiltback_duty) CFG(tiltback_hv_angle) CFG(tiltback_hv_speed) CFG(tiltback_hv) \
+	CFG(tiltback_lv_angle) CFG(tiltback_lv_speed) CFG(tiltback_lv) CFG(midvolt_warning) \
+	CFG(lowvolt_warning) CFG(tiltback_ht_angle) CFG(tiltback_ht_speed) CFG(tiltback_return_speed) \
+	CFG(tiltback_constant) CFG(tiltback_constant_erpm) CFG(haptic_buzz_current) \
+	CFG(tone_freq_high_current) CFG(tone_volt_high_current) CFG(haptic_buzz_duty) \
+	CFG(tone_freq_high_duty) CFG(tone_volt_high_duty) CFG(beep_voltage) CFG(inputtilt_remote_type) \
+	CFG(inputtilt_speed) CFG(inputtilt_angle_limit) CFG(inputtilt_smoothing_factor) \
+	CFG(inputtilt_invert_throttle) CFG(inputtilt_deadband) CFG(stickytiltval1) CFG(stickytiltval2) \
+	CFG(is_stickytilt_enabled) CFG(stickytilt_holdcurrent) CFG(noseangling_speed) \
+	CFG(startup_pitch_tolerance) CFG(startup_speed) CFG(startup_simplestart_enabled) \
+	CFG(startup_pushstart_enabled) CFG(startup_dirtylandings_enabled) CFG(simple_start_delay) \
+	CFG(brake_current) CFG(overcurrent_margin) CFG(overcurrent_period) CFG(is_beeper_enabled) \
+	CFG(is_dutybeep_enabled) CFG(is_footbeep_enabled) CFG(is_resettripdata_enabled) \
+	CFG(is_pitchdebug_enabled) CFG(is_rolldebug_enabled) CFG(is_yawdebug_enabled) \
+	CFG(is_stabilitydebug_enabled) CFG(is_currentdebug_enabled) CFG(is_surgedebug_enabled) \
+	CFG(is_tcdebug_enabled) CFG(is_brakingdebug_enabled)
+
+static const CfgItem cfg_items[] = {CFG_ITEMS};
+
+#define CFG_ITEM_COUNT (sizeof(cfg_items) / sizeof(CfgItem))
+
+bool config_override(tnt_config *cfg, const char *assignment) {
+	const char *eq = strchr(assignment, '=');
+	if (!eq) {
+		fprintf(stderr, "Invalid config override '%s', expected name=value\n", assignment);
+		return false;
+	}
+
+	size_t name_len = eq - assignment;
+	for (size_t i = 0; i < CFG_ITEM_COUNT; i++) {
+		const CfgItem *item = &cfg_items[i];
+		if (strlen(item->name) != name_len || strncmp(item->name, assignment, name_len) != 0) {
+			continue;
+		}
+
+		double value = strtod(eq + 1, NULL);
+		void *field = (uint8_t *)cfg + item->offset;
+		switch (item->type) {
+		case CFG_FLOAT:
+			*(float *)field = value;
+			break;
+		case CFG_U16:
+			*(uint16_t *)field = value;
+			break;
+		case CFG_U8:
+			*(uint8_t *)field = value;
+			break;
+		case CFG_I8:
+			*(int8_t *)field = value;
+			break;
+		case CFG_BOOL:
+			*(bool *)field = value != 0;
+			break;
+		case CFG_ENUM:
+			*(INPUTTILT_REMOTE_TYPE *)field = (INPUTTILT_REMOTE_TYPE)value;
+			break;
+		}
+		return true;
+	}
+
+	fprintf(stderr, "Unknown config item '%.*s'\n", (int)name_len, assignment);
+	return false;
+}
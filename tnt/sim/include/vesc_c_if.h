@@ -0,0 +1,43 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the VESC package.
+//
+// This VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// This VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+// Host build shim for vesc_c_if.h. It is found before the real header on the
+// include path, includes it and replaces the macros which bind the package to
+// the fixed firmware memory layout with ones pointing to the simulated
+// interface table.
+
+#pragma once
+
+#include_next "vesc_c_if.h"
+
+#include <stdint.h>
+
+#undef VESC_IF
+#undef HEADER
+#undef INIT_FUN
+#undef INIT_START
+#undef PROG_ADDR
+
+extern vesc_c_if *sim_vesc_if;
+
+#define VESC_IF sim_vesc_if
+#define HEADER static volatile int prog_ptr;
+#define INIT_FUN bool package_init
+#define INIT_START (void)prog_ptr;
+#define PROG_ADDR ((uint32_t)0)
+
+bool package_init(lib_info *info);
@@ -0,0 +1,280 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the VESC package.
+//
+// This VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// This VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+// Host replay of recorded ride data through the TNT package. Runs the
+// unmodified package sources against a simulated VESC_IF, driven by a ride
+// trace at the configured loop rate, writes the per-loop control decisions
+// into a CSV file and reports the host cost of the loop and its stages.
+
+#include "sim.h"
+
+#include "tnt.h"
+#include "conf/confparser.h"
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_OVERRIDES 64
+#define SYNTHETIC_TRACE_RATE 1000.0f
+
+typedef struct {
+	FILE *out;
+	uint32_t last_command_count;
+
+	// loops with each of the decisions, for the summary
+	uint64_t loops, running, wheelslip, surge, braking;
+} Output;
+
+static void usage(const char *name) {
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  -t FILE        input trace, CSV or binary log of lib_log_sampler\n"
+		"                 (default: synthetic ride)\n"
+		"  -d SECONDS     duration of the synthetic ride (default: 20)\n"
+		"  -o FILE        write the per-loop outputs to a CSV file\n"
+		"  -i HZ          IMU sample rate (default: 10000)\n"
+		"  -x FACTOR      charge host CPU time times FACTOR to simulated time\n"
+		"                 (default: 0, the package runs in zero time)\n"
+		"  -p NAME=VALUE  override a tnt_config item, can be repeated\n"
+		"  -q             don't print package log messages\n",
+		name);
+}
+
+static void on_yield(SimThread *thread, uint64_t cost_ns, void *arg) {
+	Output *output = arg;
+	data *d = sim.arg;
+	if (!d || thread != (SimThread *)d->main_thread) {
+		return;
+	}
+
+	output->loops++;
+	if (d->state.state == STATE_RUNNING) {
+		output->running++;
+		output->wheelslip += d->state.wheelslip;
+		output->surge += d->state.surge_active;
+		output->braking += d->state.braking_active;
+	}
+
+	if (!output->out) {
+		return;
+	}
+
+	// only commands issued in this loop are written
+	const char *command = "none";
+	if (sim.motor_command.count != output->last_command_count) {
+		static const char *const names[] = {"none", "current", "brake", "duty", "release"};
+		command = names[sim.motor_command.type];
+		output->last_command_count = sim.motor_command.count;
+	}
+
+	fprintf(output->out, "%.6f,%d,%.4f,%.4f,%.4f,%.4f,%.4f,%d,%d,%d,%s,%.4f,%.3f\n",
+		sim.now_us / 1e6,
+		d->state.state,
+		(double)d->rt.pitch_angle,
+		(double)d->spd.setpoint,
+		(double)d->pid.proportional,
+		(double)d->pid.new_pid_value,
+		(double)d->pid.pid_value,
+		d->state.wheelslip,
+		d->state.surge_active,
+		d->state.braking_active,
+		command,
+		(double)sim.motor_command.value,
+		cost_ns / 1e3);
+}
+
+static int compare_u64(const void *a, const void *b) {
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+static void print_cost(SimCost *cost, float duration) {
+	if (cost->count == 0) {
+		return;
+	}
+
+	qsort(cost->cost_ns, cost->count, sizeof(uint64_t), compare_u64);
+	uint64_t sum = 0;
+	for (size_t i = 0; i < cost->count; i++) {
+		sum += cost->cost_ns[i];
+	}
+
+	fprintf(stderr, "%-16s %10lu %9.3f %9.3f %9.3f %9.3f %9.1f\n",
+		cost->name,
+		(unsigned long)cost->count,
+		cost->cost_ns[0] / 1e3,
+		(double)sum / cost->count / 1e3,
+		cost->cost_ns[cost->count * 99 / 100] / 1e3,
+		cost->cost_ns[cost->count - 1] / 1e3,
+		(double)(cost->count / duration));
+}
+
+static void print_stats(const Output *output, float duration, double host_s) {
+	fprintf(stderr, "%-16s %10s %9s %9s %9s %9s %9s\n",
+		"thread/stage", "count", "min[us]", "mean[us]", "p99[us]", "max[us]", "rate[Hz]");
+
+	for (SimThread *t = sim.threads; t; t = sim_thread_next(t)) {
+		print_cost(sim_thread_cost(t), duration);
+	}
+	for (int i = 0; i < STAGE_COUNT; i++) {
+		print_cost(sim_stage_cost(i), duration);
+	}
+
+	fprintf(stderr, "%lu loops, %lu running: %lu wheelslip, %lu surge, %lu braking\n",
+		(unsigned long)output->loops,
+		(unsigned long)output->running,
+		(unsigned long)output->wheelslip,
+		(unsigned long)output->surge,
+		(unsigned long)output->braking);
+	fprintf(stderr, "%.1fs of ride replayed in %.2fs\n", (double)duration, host_s);
+}
+
+// The package reads its config from EEPROM on init: the signature followed
+// by the raw config struct. Store the defaults with the overrides applied
+// there, the same way writing the config from VESC Tool would.
+static bool store_config(const char **overrides, int override_count) {
+	tnt_config cfg;
+	confparser_set_defaults_tnt_config(&cfg);
+	for (int i = 0; i < override_count; i++) {
+		if (!config_override(&cfg, overrides[i])) {
+			return false;
+		}
+	}
+
+	uint32_t buffer[sizeof(tnt_config) / 4 + 1] = {0};
+	_Static_assert(sizeof(buffer) / 4 + 1 <= SIM_EEPROM_VARS, "config doesn't fit the EEPROM");
+	memcpy(buffer, &cfg, sizeof(tnt_config));
+
+	eeprom_var v = {.as_u32 = TNT_CONFIG_SIGNATURE};
+	VESC_IF->store_eeprom_var(&v, 0);
+	for (size_t i = 0; i < sizeof(buffer) / 4; i++) {
+		v.as_u32 = buffer[i];
+		VESC_IF->store_eeprom_var(&v, i + 1);
+	}
+	return true;
+}
+
+static bool load_trace(Trace *trace, const char *path) {
+	char magic[4] = {0};
+	FILE *f = fopen(path, "rb");
+	if (f) {
+		size_t len = fread(magic, 1, sizeof(magic), f);
+		fclose(f);
+		if (len == sizeof(magic) && memcmp(magic, "VLOG", 4) == 0) {
+			return trace_load_vlog(trace, path);
+		}
+	}
+	return trace_load_csv(trace, path);
+}
+
+int main(int argc, char **argv) {
+	const char *trace_path = NULL;
+	const char *out_path = NULL;
+	const char *overrides[MAX_OVERRIDES];
+	int override_count = 0;
+	float duration = 20.0f;
+
+	sim.imu_rate = 10000;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "t:d:o:i:x:p:qh")) != -1) {
+		switch (opt) {
+		case 't':
+			trace_path = optarg;
+			break;
+		case 'd':
+			duration = strtof(optarg, NULL);
+			break;
+		case 'o':
+			out_path = optarg;
+			break;
+		case 'i':
+			sim.imu_rate = strtoul(optarg, NULL, 10);
+			break;
+		case 'x':
+			sim.cost_factor = strtof(optarg, NULL);
+			break;
+		case 'p':
+			if (override_count >= MAX_OVERRIDES) {
+				fprintf(stderr, "Too many config overrides\n");
+				return 1;
+			}
+			overrides[override_count++] = optarg;
+			break;
+		case 'q':
+			sim.quiet = true;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	bool trace_ok = trace_path ? load_trace(&sim.trace, trace_path) :
+		trace_generate(&sim.trace, duration, SYNTHETIC_TRACE_RATE);
+	if (!trace_ok) {
+		return 1;
+	}
+	trace_sample(&sim.trace, 0, &sim.input);
+	duration = trace_duration(&sim.trace);
+
+	sim_vesc_if_init();
+	if (!store_config(overrides, override_count)) {
+		return 1;
+	}
+
+	Output output = {0};
+	if (out_path) {
+		output.out = fopen(out_path, "w");
+		if (!output.out) {
+			fprintf(stderr, "Failed to open %s\n", out_path);
+			return 1;
+		}
+		fprintf(output.out, "t,state,pitch,setpoint,proportional,new_pid_value,pid_value,"
+			"wheelslip,surge,braking,motor_command,motor_value,cost_us\n");
+	}
+
+	lib_info info = {0};
+	if (!package_init(&info)) {
+		fprintf(stderr, "Package init failed\n");
+		return 1;
+	}
+	// the firmware stores the package argument for ARG after init
+	sim.arg = info.arg;
+
+	uint64_t host_start = sim_host_now_ns();
+	sim_run(duration * 1e6, on_yield, &output);
+	double host_s = (sim_host_now_ns() - host_start) / 1e9;
+
+	sim_terminate_threads();
+	if (info.stop_fun) {
+		info.stop_fun(info.arg);
+	}
+	sim.arg = NULL;
+
+	print_stats(&output, duration, host_s);
+
+	if (output.out) {
+		fclose(output.out);
+	}
+	sim_free_threads();
+	sim_free_stages();
+	trace_free(&sim.trace);
+	return 0;
+}
@@ -0,0 +1,59 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the VESC package.
+//
+// This VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// This VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+// Host side of the main loop stage marks in stage_timer.h. The time between
+// two marks is charged to the stage of the second one.
+
+#include "sim.h"
+
+#include <stdlib.h>
+
+static const char *const stage_names[STAGE_COUNT] = {
+	[STAGE_SENSORS] = "sensors",
+	[STAGE_SETPOINT] = "setpoint",
+	[STAGE_KP] = "kp",
+	[STAGE_TRACTION] = "traction",
+	[STAGE_OUTPUT] = "output",
+	[STAGE_IDLE] = "idle",
+};
+
+static SimCost stages[STAGE_COUNT];
+static uint64_t last_mark;
+
+void stage_timer_start(void) {
+	last_mark = sim_host_now_ns();
+}
+
+void stage_timer_end(LoopStage stage) {
+	uint64_t now = sim_host_now_ns();
+	sim_cost_record(&stages[stage], now - last_mark);
+	last_mark = now;
+}
+
+SimCost *sim_stage_cost(LoopStage stage) {
+	stages[stage].name = stage_names[stage];
+	return &stages[stage];
+}
+
+void sim_free_stages(void) {
+	for (int i = 0; i < STAGE_COUNT; i++) {
+		free(stages[i].cost_ns);
+		stages[i].cost_ns = NULL;
+		stages[i].count = 0;
+		stages[i].capacity = 0;
+	}
+}
@@ -0,0 +1,489 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the VESC package.
+//
+// This VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// This VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+// Input traces: recorded rides as CSV or binary logs of the log sampler, or
+// a synthetic ride.
+
+#include "sim.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEG2RAD (float)(M_PI / 180.0)
+#define INPUT_FLOATS (sizeof(SimInput) / sizeof(float))
+
+typedef struct {
+	const char *name;
+	size_t offset;
+} Column;
+
+#define COLUMN(name, field) {name, offsetof(SimInput, field)}
+
+static const Column columns[] = {
+	COLUMN("t", t),
+	COLUMN("pitch", pitch),
+	COLUMN("roll", roll),
+	COLUMN("yaw", yaw),
+	COLUMN("gyro_x", gyro[0]),
+	COLUMN("gyro_y", gyro[1]),
+	COLUMN("gyro_z", gyro[2]),
+	COLUMN("acc_x", acc[0]),
+	COLUMN("acc_y", acc[1]),
+	COLUMN("acc_z", acc[2]),
+	COLUMN("erpm", erpm),
+	COLUMN("current", current),
+	COLUMN("current_in", current_in),
+	COLUMN("duty", duty),
+	COLUMN("voltage", voltage),
+	COLUMN("adc1", adc1),
+	COLUMN("adc2", adc2),
+	COLUMN("remote", remote),
+	COLUMN("temp_fet", temp_fet),
+	COLUMN("temp_motor", temp_motor),
+};
+
+#define COLUMN_COUNT (sizeof(columns) / sizeof(Column))
+#define MAX_COLUMNS 256
+
+// Index of the column called name, -1 if there is none
+static int find_column(const char *name, size_t len) {
+	for (size_t i = 0; i < COLUMN_COUNT; i++) {
+		if (strlen(columns[i].name) == len && strncmp(columns[i].name, name, len) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static void set_column(SimInput *s, int column, float value) {
+	*(float *)((uint8_t *)s + columns[column].offset) = value;
+}
+
+static bool push_sample(Trace *trace, size_t *capacity, const SimInput *sample) {
+	if (trace->count >= *capacity) {
+		size_t new_capacity = *capacity ? *capacity * 2 : 1024;
+		SimInput *samples = realloc(trace->samples, new_capacity * sizeof(SimInput));
+		if (!samples) {
+			return false;
+		}
+		trace->samples = samples;
+		*capacity = new_capacity;
+	}
+	trace->samples[trace->count++] = *sample;
+	return true;
+}
+
+// Gravity vector in the IMU frame for the given orientation, matching the
+// convention of the attitude filter.
+static void acc_from_angles(SimInput *s) {
+	float pitch = s->pitch * DEG2RAD;
+	float roll = s->roll * DEG2RAD;
+	s->acc[0] = -sinf(pitch);
+	s->acc[1] = sinf(roll) * cosf(pitch);
+	s->acc[2] = cosf(roll) * cosf(pitch);
+}
+
+static float angle_diff(float a, float b) {
+	float diff = a - b;
+	if (diff > 180) {
+		diff -= 360;
+	} else if (diff < -180) {
+		diff += 360;
+	}
+	return diff;
+}
+
+static void gyro_from_angles(Trace *trace) {
+	for (size_t i = 1; i < trace->count; i++) {
+		SimInput *prev = &trace->samples[i - 1];
+		SimInput *s = &trace->samples[i];
+		float dt = s->t - prev->t;
+		if (dt > 0) {
+			s->gyro[0] = (s->roll - prev->roll) / dt;
+			s->gyro[1] = (s->pitch - prev->pitch) / dt;
+			s->gyro[2] = angle_diff(s->yaw, prev->yaw) / dt;
+		}
+	}
+}
+
+// Fills in the IMU inputs the trace doesn't have
+static bool finish_trace(Trace *trace, const char *path, bool has_gyro, bool has_acc) {
+	if (trace->count == 0) {
+		fprintf(stderr, "Trace %s has no samples\n", path);
+		trace_free(trace);
+		return false;
+	}
+
+	if (!has_acc) {
+		for (size_t i = 0; i < trace->count; i++) {
+			acc_from_angles(&trace->samples[i]);
+		}
+	}
+	if (!has_gyro) {
+		gyro_from_angles(trace);
+	}
+
+	// recordings rarely start at 0, the replay does
+	float t0 = trace->samples[0].t;
+	for (size_t i = 0; i < trace->count; i++) {
+		trace->samples[i].t -= t0;
+	}
+	return true;
+}
+
+bool trace_load_csv(Trace *trace, const char *path) {
+	memset(trace, 0, sizeof(Trace));
+
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		fprintf(stderr, "Failed to open trace %s\n", path);
+		return false;
+	}
+
+	char line[4096];
+	if (!fgets(line, sizeof(line), f)) {
+		fprintf(stderr, "Empty trace %s\n", path);
+		fclose(f);
+		return false;
+	}
+
+	// map CSV columns to SimInput fields, -1 for ignored columns
+	int map[MAX_COLUMNS];
+	size_t csv_columns = 0;
+	bool has_gyro = false;
+	bool has_acc = false;
+	for (char *tok = strtok(line, ",\r\n"); tok && csv_columns < MAX_COLUMNS; tok = strtok(NULL, ",\r\n")) {
+		while (*tok == ' ') {
+			tok++;
+		}
+		map[csv_columns] = find_column(tok, strlen(tok));
+		has_gyro |= map[csv_columns] >= 0 && strncmp(tok, "gyro_", 5) == 0;
+		has_acc |= map[csv_columns] >= 0 && strncmp(tok, "acc_", 4) == 0;
+		csv_columns++;
+	}
+
+	size_t capacity = 0;
+	while (fgets(line, sizeof(line), f)) {
+		SimInput sample = {0};
+		char *cursor = line;
+		for (size_t c = 0; c < csv_columns; c++) {
+			char *end;
+			float value = strtof(cursor, &end);
+			if (map[c] >= 0) {
+				set_column(&sample, map[c], value);
+			}
+			cursor = strchr(end, ',');
+			if (!cursor) {
+				break;
+			}
+			cursor++;
+		}
+
+		if (!push_sample(trace, &capacity, &sample)) {
+			fclose(f);
+			trace_free(trace);
+			return false;
+		}
+	}
+	fclose(f);
+
+	return finish_trace(trace, path, has_gyro, has_acc);
+}
+
+// Binary log format, see lib_log_sampler/README.md
+#define VLOG_VERSION		1
+#define VLOG_HEADER_SIZE	8
+#define VLOG_BLOCK_HEADER_SIZE	5
+
+typedef struct {
+	const uint8_t *data;
+	size_t len;
+	size_t pos;
+	bool error;
+} Reader;
+
+static uint8_t read_u8(Reader *r) {
+	if (r->pos >= r->len) {
+		r->error = true;
+		return 0;
+	}
+	return r->data[r->pos++];
+}
+
+static uint16_t read_u16(Reader *r) {
+	uint16_t hi = read_u8(r);
+	return hi << 8 | read_u8(r);
+}
+
+static uint32_t read_varint(Reader *r) {
+	uint32_t value = 0;
+	for (int shift = 0; shift < 35; shift += 7) {
+		uint8_t byte = read_u8(r);
+		value |= (uint32_t)(byte & 0x7F) << shift;
+		if (byte < 0x80 || r->error) {
+			break;
+		}
+	}
+	return value;
+}
+
+static int32_t read_signed(Reader *r) {
+	uint32_t zigzag = read_varint(r);
+	return (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+}
+
+static bool read_file(const char *path, uint8_t **data, size_t *len) {
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		fprintf(stderr, "Failed to open trace %s\n", path);
+		return false;
+	}
+
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	*data = size > 0 ? malloc(size) : NULL;
+	bool ok = *data && fread(*data, 1, size, f) == (size_t)size;
+	fclose(f);
+
+	if (!ok) {
+		fprintf(stderr, "Failed to read trace %s\n", path);
+		free(*data);
+		return false;
+	}
+	*len = size;
+	return true;
+}
+
+bool trace_load_vlog(Trace *trace, const char *path) {
+	memset(trace, 0, sizeof(Trace));
+
+	uint8_t *data;
+	size_t len;
+	if (!read_file(path, &data, &len)) {
+		return false;
+	}
+
+	Reader r = {data, len, 0, false};
+	if (len < VLOG_HEADER_SIZE || memcmp(data, "VLOG", 4) != 0) {
+		fprintf(stderr, "%s is not a binary log\n", path);
+		free(data);
+		return false;
+	}
+	r.pos = 4;
+	uint8_t version = read_u8(&r);
+	uint8_t field_count = read_u8(&r);
+	float time_unit = read_u16(&r) * 1e-6f;
+	if (version != VLOG_VERSION) {
+		fprintf(stderr, "%s: unsupported log version %d\n", path, version);
+		free(data);
+		return false;
+	}
+
+	int map[MAX_COLUMNS];
+	float divisor[MAX_COLUMNS];
+	bool has_gyro = false;
+	bool has_acc = false;
+	for (int i = 0; i < field_count; i++) {
+		divisor[i] = powf(10, read_u8(&r));
+		uint8_t name_len = read_u8(&r);
+		const char *name = (const char *)&data[r.pos];
+		r.pos += name_len;
+		r.pos += read_u8(&r); // unit
+		if (r.error || r.pos > len) {
+			fprintf(stderr, "%s: truncated header\n", path);
+			free(data);
+			return false;
+		}
+		map[i] = find_column(name, name_len);
+		has_gyro |= map[i] >= 0 && strncmp(name, "gyro_", 5) == 0;
+		has_acc |= map[i] >= 0 && strncmp(name, "acc_", 4) == 0;
+	}
+
+	size_t capacity = 0;
+	int bitmap_len = (field_count + 7) / 8;
+	int32_t values[MAX_COLUMNS];
+	while (r.pos + VLOG_BLOCK_HEADER_SIZE <= len) {
+		size_t start = r.pos;
+		if (read_u8(&r) != 'B') {
+			fprintf(stderr, "%s: invalid block at offset %zu, stopping\n", path, start);
+			break;
+		}
+		uint16_t block_len = read_u16(&r);
+		uint16_t frames = read_u16(&r);
+		if (start + block_len > len) {
+			fprintf(stderr, "%s: truncated block at offset %zu, stopping\n", path, start);
+			break;
+		}
+		r.len = start + block_len;
+
+		// each block starts with absolute values, the other frames store the changed fields
+		uint32_t time = 0;
+		for (int frame = 0; frame < frames && !r.error; frame++) {
+			if (frame == 0) {
+				time = read_varint(&r);
+				for (int i = 0; i < field_count; i++) {
+					values[i] = read_signed(&r);
+				}
+			} else {
+				time += read_varint(&r);
+				if (r.pos + bitmap_len > r.len) {
+					r.error = true;
+					break;
+				}
+				const uint8_t *bitmap = &data[r.pos];
+				r.pos += bitmap_len;
+				for (int i = 0; i < field_count; i++) {
+					if (bitmap[i / 8] & (1 << (i % 8))) {
+						// wraps like the 32-bit deltas of the encoder
+						values[i] = (int32_t)((uint32_t)values[i] + (uint32_t)read_signed(&r));
+					}
+				}
+			}
+
+			SimInput sample = {0};
+			for (int i = 0; i < field_count; i++) {
+				if (map[i] >= 0) {
+					set_column(&sample, map[i], values[i] / divisor[i]);
+				}
+			}
+			sample.t = time * time_unit;
+			if (!push_sample(trace, &capacity, &sample)) {
+				free(data);
+				trace_free(trace);
+				return false;
+			}
+		}
+
+		if (r.error || r.pos != start + block_len) {
+			fprintf(stderr, "%s: corrupt block at offset %zu, stopping\n", path, start);
+			break;
+		}
+		r.len = len;
+	}
+	free(data);
+
+	return finish_trace(trace, path, has_gyro, has_acc);
+}
+
+static float smoothstep(float edge0, float edge1, float x) {
+	float t = (x - edge0) / (edge1 - edge0);
+	t = t < 0 ? 0 : (t > 1 ? 1 : t);
+	return t * t * (3 - 2 * t);
+}
+
+bool trace_generate(Trace *trace, float duration, float rate) {
+	memset(trace, 0, sizeof(Trace));
+
+	const float mount = 0.5f;
+	const float dismount = duration - 1.0f;
+	const float slip = mount + 3.4f; // at the bottom of a pitch oscillation, accelerating
+	const float erpm_max = 8000.0f;
+
+	size_t capacity = 0;
+	size_t count = duration * rate;
+	for (size_t i = 0; i < count; i++) {
+		float t = i / rate;
+		bool riding = t >= mount && t < dismount;
+
+		SimInput s = {0};
+		s.t = t;
+
+		// accelerate to full speed in 2s, brake hard in the 2s before dismount
+		float speed = smoothstep(mount + 0.5f, mount + 2.5f, t) -
+			smoothstep(dismount - 2.5f, dismount - 0.5f, t);
+		bool braking = t > dismount - 2.5f && t < dismount - 0.5f;
+		s.erpm = erpm_max * speed;
+
+		// the wheel breaks loose under high current for a moment: the ERPM
+		// shoots up in 30ms and comes back in 150ms
+		float slipping = smoothstep(slip, slip + 0.03f, t) - smoothstep(slip + 0.05f, slip + 0.2f, t);
+		s.erpm += 3000.0f * slipping;
+		s.duty = s.erpm / 40000.0f;
+
+		if (riding) {
+			s.pitch = 1.5f * sinf(2 * M_PI * 0.7f * t) + 0.5f * sinf(2 * M_PI * 3.1f * t);
+			s.roll = 3.0f * sinf(2 * M_PI * 0.2f * t);
+			s.yaw = fmodf(40.0f * (t - mount) + 180, 360) - 180;
+			s.current = braking ? -30.0f : 15.0f * sinf(2 * M_PI * 0.7f * t) + 10.0f * speed + 40.0f * slipping;
+			if (braking) {
+				s.pitch += 4.0f; // tail down
+			}
+			s.adc1 = 3.0f;
+			s.adc2 = 3.0f;
+		}
+		s.current_in = s.current * s.duty;
+		s.voltage = 63.0f - 0.05f * s.current_in;
+		s.temp_fet = 35.0f;
+		s.temp_motor = 40.0f;
+
+		acc_from_angles(&s);
+		if (!push_sample(trace, &capacity, &s)) {
+			trace_free(trace);
+			return false;
+		}
+	}
+
+	gyro_from_angles(trace);
+	return trace->count > 0;
+}
+
+void trace_sample(Trace *trace, float t, SimInput *input) {
+	// samples are mostly requested in increasing time, search from the last position
+	size_t i = trace->position;
+	if (i >= trace->count || trace->samples[i].t > t) {
+		i = 0;
+	}
+	while (i + 1 < trace->count && trace->samples[i + 1].t <= t) {
+		i++;
+	}
+	trace->position = i;
+
+	const SimInput *a = &trace->samples[i];
+	if (i + 1 >= trace->count || t <= a->t) {
+		*input = *a;
+		return;
+	}
+
+	const SimInput *b = &trace->samples[i + 1];
+	float f = (t - a->t) / (b->t - a->t);
+	const float *fa = (const float *)a;
+	const float *fb = (const float *)b;
+	float *out = (float *)input;
+	for (size_t k = 0; k < INPUT_FLOATS; k++) {
+		out[k] = fa[k] + (fb[k] - fa[k]) * f;
+	}
+
+	// yaw wraps at +-180
+	input->yaw = a->yaw + angle_diff(b->yaw, a->yaw) * f;
+	if (input->yaw > 180) {
+		input->yaw -= 360;
+	} else if (input->yaw < -180) {
+		input->yaw += 360;
+	}
+}
+
+float trace_duration(const Trace *trace) {
+	return trace->count > 0 ? trace->samples[trace->count - 1].t : 0;
+}
+
+void trace_free(Trace *trace) {
+	free(trace->samples);
+	memset(trace, 0, sizeof(Trace));
+}
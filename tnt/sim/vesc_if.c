@@ -0,0 +1,448 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the VESC package.
+//
+// This VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// This VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+// Simulated VESC_IF table. Motor and IMU getters return the trace inputs at
+// the current simulation time, motor commands are recorded in sim.
+
+#include "sim.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEG2RAD (float)(M_PI / 180.0)
+
+Sim sim;
+
+vesc_c_if *sim_vesc_if;
+
+static vesc_c_if vesc_if;
+
+static struct {
+	eeprom_var value;
+	bool stored;
+} eeprom[SIM_EEPROM_VARS];
+
+void sim_ahrs_init_attitude_info(ATTITUDE_INFO *att);
+void sim_ahrs_update_mahony_imu(float *gyro, float *acc, float dt, ATTITUDE_INFO *att);
+float sim_ahrs_get_roll(ATTITUDE_INFO *att);
+float sim_ahrs_get_pitch(ATTITUDE_INFO *att);
+float sim_ahrs_get_yaw(ATTITUDE_INFO *att);
+
+// OS
+
+static void sleep_us(uint32_t us) {
+	sim_thread_sleep_us(us);
+}
+
+static void sleep_ms(uint32_t ms) {
+	sim_thread_sleep_us(ms * 1000);
+}
+
+static float system_time(void) {
+	return sim.now_us * 1e-6f;
+}
+
+static systime_t system_time_ticks(void) {
+	return sim.now_us / (1000000 / SYSTEM_TICK_RATE_HZ);
+}
+
+static uint32_t timer_time_now(void) {
+	return sim.now_us;
+}
+
+static float timer_seconds_elapsed_since(uint32_t time) {
+	return (uint32_t)(sim.now_us - time) * 1e-6f;
+}
+
+static int sim_printf(const char *str, ...) {
+	if (sim.quiet) {
+		return 0;
+	}
+
+	// log messages of the package have no newline, plain printfs do
+	char buffer[256];
+	va_list args;
+	va_start(args, str);
+	int res = vsnprintf(buffer, sizeof(buffer), str, args);
+	va_end(args);
+	size_t len = strlen(buffer);
+	fprintf(stderr, "%s%s", buffer, len > 0 && buffer[len - 1] == '\n' ? "" : "\n");
+	return res;
+}
+
+static void **get_arg(uint32_t prog_addr) {
+	(void)prog_addr;
+	return &sim.arg;
+}
+
+// IO
+
+static float io_read_analog(VESC_PIN pin) {
+	switch (pin) {
+	case VESC_PIN_ADC1:
+		return sim.input.adc1;
+	case VESC_PIN_ADC2:
+		return sim.input.adc2;
+	default:
+		return -1.0f;
+	}
+}
+
+static bool app_is_output_disabled(void) {
+	return false;
+}
+
+// Motor
+
+static void record_command(MotorCommandType type, float value) {
+	sim.motor_command.type = type;
+	sim.motor_command.value = value;
+	sim.motor_command.count++;
+}
+
+static void mc_set_current(float current) {
+	record_command(MOTOR_CMD_CURRENT, current);
+}
+
+static void mc_set_brake_current(float current) {
+	record_command(MOTOR_CMD_BRAKE, current);
+}
+
+static void mc_set_duty(float duty) {
+	record_command(MOTOR_CMD_DUTY, duty);
+}
+
+static void mc_release_motor(void) {
+	record_command(MOTOR_CMD_RELEASE, 0);
+}
+
+static void mc_set_current_off_delay(float delay_sec) {
+	(void)delay_sec;
+}
+
+static void timeout_reset(void) {
+}
+
+static float mc_get_rpm(void) {
+	return sim.input.erpm;
+}
+
+static float mc_get_duty_cycle_now(void) {
+	return sim.input.duty;
+}
+
+static float mc_get_tot_current_directional(void) {
+	return sim.input.erpm < 0 ? -sim.input.current : sim.input.current;
+}
+
+static float mc_get_tot_current_in(void) {
+	return sim.input.current_in;
+}
+
+static float mc_get_input_voltage_filtered(void) {
+	return sim.input.voltage;
+}
+
+static float mc_temp_fet_filtered(void) {
+	return sim.input.temp_fet;
+}
+
+static float mc_temp_motor_filtered(void) {
+	return sim.input.temp_motor;
+}
+
+static float foc_get_iq(void) {
+	return sim.input.current;
+}
+
+static float foc_get_vq(void) {
+	return sim.input.duty * sim.input.voltage;
+}
+
+static float mc_get_zero(void) {
+	return 0.0f;
+}
+
+static float mc_get_amp_hours(bool reset) {
+	(void)reset;
+	return 0.0f;
+}
+
+static uint64_t mc_get_odometer(void) {
+	return 0;
+}
+
+static void mc_stat_reset(void) {
+}
+
+static bool store_backup_data(void) {
+	return true;
+}
+
+static bool foc_play_tone(int channel, float freq, float voltage) {
+	(void)channel;
+	(void)freq;
+	(void)voltage;
+	sim.tone_count++;
+	return true;
+}
+
+static bool foc_beep(float freq, float time, float voltage) {
+	(void)time;
+	return foc_play_tone(0, freq, voltage);
+}
+
+static void foc_stop_audio(bool reset) {
+	(void)reset;
+}
+
+// IMU
+
+static bool imu_startup_done(void) {
+	return true;
+}
+
+static float imu_get_pitch(void) {
+	return sim.input.pitch * DEG2RAD;
+}
+
+static float imu_get_roll(void) {
+	return sim.input.roll * DEG2RAD;
+}
+
+static float imu_get_yaw(void) {
+	return sim.input.yaw * DEG2RAD;
+}
+
+static void imu_get_gyro(float *gyro) {
+	memcpy(gyro, sim.input.gyro, sizeof(sim.input.gyro));
+}
+
+static void imu_get_accel(float *accel) {
+	memcpy(accel, sim.input.acc, sizeof(sim.input.acc));
+}
+
+static void imu_set_read_callback(void (*func)(float *acc, float *gyro, float *mag, float dt)) {
+	sim.imu_callback = func;
+}
+
+// Input devices
+
+static float get_ppm(void) {
+	return sim.input.remote;
+}
+
+static float get_ppm_age(void) {
+	return 0.0f;
+}
+
+static remote_state get_remote_state(void) {
+	remote_state state = {0};
+	state.js_y = sim.input.remote;
+	return state;
+}
+
+// Comm
+
+static void send_app_data(unsigned char *data, unsigned int len) {
+	(void)data;
+	(void)len;
+}
+
+static bool set_app_data_handler(void (*func)(unsigned char *data, unsigned int len)) {
+	(void)func;
+	return true;
+}
+
+// Config
+
+static bool read_eeprom_var(eeprom_var *v, int address) {
+	if (address < 0 || address >= SIM_EEPROM_VARS || !eeprom[address].stored) {
+		return false;
+	}
+	*v = eeprom[address].value;
+	return true;
+}
+
+static bool store_eeprom_var(eeprom_var *v, int address) {
+	if (address < 0 || address >= SIM_EEPROM_VARS) {
+		return false;
+	}
+	eeprom[address].value = *v;
+	eeprom[address].stored = true;
+	return true;
+}
+
+static void conf_custom_add_config(
+		int (*get_cfg)(uint8_t *data, bool is_default),
+		bool (*set_cfg)(uint8_t *data),
+		int (*get_cfg_xml)(uint8_t **data)) {
+	(void)get_cfg;
+	(void)set_cfg;
+	(void)get_cfg_xml;
+}
+
+static void conf_custom_clear_configs(void) {
+}
+
+static float mahony_kp = 0.4f;
+
+static float get_cfg_float(CFG_PARAM p) {
+	switch (p) {
+	case CFG_PARAM_l_current_max:
+		return 60.0f;
+	case CFG_PARAM_l_current_min:
+		return -60.0f;
+	case CFG_PARAM_l_temp_fet_start:
+		return 85.0f;
+	case CFG_PARAM_l_temp_motor_start:
+		return 100.0f;
+	case CFG_PARAM_l_max_duty:
+		return 0.95f;
+	case CFG_PARAM_l_min_vin:
+		return 40.0f;
+	case CFG_PARAM_l_max_vin:
+		return 72.0f;
+	case CFG_PARAM_l_battery_cut_start:
+		return 50.0f;
+	case CFG_PARAM_l_battery_cut_end:
+		return 48.0f;
+	case CFG_PARAM_IMU_mahony_kp:
+		return mahony_kp;
+	case CFG_PARAM_si_wheel_diameter:
+		return 0.28f;
+	default:
+		return 0.0f;
+	}
+}
+
+static int get_cfg_int(CFG_PARAM p) {
+	switch (p) {
+	case CFG_PARAM_si_battery_cells:
+		return 15;
+	case CFG_PARAM_si_motor_poles:
+		return 30;
+	case CFG_PARAM_IMU_sample_rate:
+		return sim.imu_rate;
+	default:
+		return 0;
+	}
+}
+
+static bool set_cfg_float(CFG_PARAM p, float value) {
+	if (p == CFG_PARAM_IMU_mahony_kp) {
+		mahony_kp = value;
+	}
+	return true;
+}
+
+// LispBM
+
+static bool lbm_add_extension(char *name, extension_fptr fptr) {
+	(void)name;
+	(void)fptr;
+	return true;
+}
+
+void sim_vesc_if_init(void) {
+	vesc_if = (vesc_c_if) {
+		.lbm_add_extension = lbm_add_extension,
+		.lbm_enc_sym_nil = 0,
+		.lbm_enc_sym_true = 1,
+
+		.sleep_ms = sleep_ms,
+		.sleep_us = sleep_us,
+		.system_time = system_time,
+		.printf = sim_printf,
+		.malloc = malloc,
+		.free = free,
+		.spawn = sim_thread_spawn,
+		.request_terminate = sim_thread_request_terminate,
+		.should_terminate = sim_thread_should_terminate,
+		.get_arg = get_arg,
+
+		.io_read_analog = io_read_analog,
+		.app_is_output_disabled = app_is_output_disabled,
+
+		.mc_set_duty = mc_set_duty,
+		.mc_set_current = mc_set_current,
+		.mc_set_brake_current = mc_set_brake_current,
+		.mc_release_motor = mc_release_motor,
+		.mc_set_current_off_delay = mc_set_current_off_delay,
+		.mc_get_duty_cycle_now = mc_get_duty_cycle_now,
+		.mc_get_rpm = mc_get_rpm,
+		.mc_get_tot_current_directional_filtered = mc_get_tot_current_directional,
+		.mc_get_tot_current_in = mc_get_tot_current_in,
+		.mc_get_input_voltage_filtered = mc_get_input_voltage_filtered,
+		.mc_temp_fet_filtered = mc_temp_fet_filtered,
+		.mc_temp_motor_filtered = mc_temp_motor_filtered,
+		.mc_get_distance_abs = mc_get_zero,
+		.mc_get_odometer = mc_get_odometer,
+		.mc_get_amp_hours = mc_get_amp_hours,
+		.mc_get_amp_hours_charged = mc_get_amp_hours,
+		.mc_get_watt_hours = mc_get_amp_hours,
+		.mc_get_watt_hours_charged = mc_get_amp_hours,
+		.mc_stat_speed_avg = mc_get_zero,
+		.mc_stat_power_avg = mc_get_zero,
+		.mc_stat_current_avg = mc_get_zero,
+		.mc_stat_reset = mc_stat_reset,
+		.foc_get_iq = foc_get_iq,
+		.foc_get_vq = foc_get_vq,
+		.timeout_reset = timeout_reset,
+		.store_backup_data = store_backup_data,
+
+		.foc_beep = foc_beep,
+		.foc_play_tone = foc_play_tone,
+		.foc_stop_audio = foc_stop_audio,
+
+		.imu_startup_done = imu_startup_done,
+		.imu_get_roll = imu_get_roll,
+		.imu_get_pitch = imu_get_pitch,
+		.imu_get_yaw = imu_get_yaw,
+		.imu_get_accel = imu_get_accel,
+		.imu_get_gyro = imu_get_gyro,
+		.imu_set_read_callback = imu_set_read_callback,
+
+		.ahrs_init_attitude_info = sim_ahrs_init_attitude_info,
+		.ahrs_update_mahony_imu = sim_ahrs_update_mahony_imu,
+		.ahrs_get_roll = sim_ahrs_get_roll,
+		.ahrs_get_pitch = sim_ahrs_get_pitch,
+		.ahrs_get_yaw = sim_ahrs_get_yaw,
+
+		.get_remote_state = get_remote_state,
+		.get_ppm = get_ppm,
+		.get_ppm_age = get_ppm_age,
+
+		.send_app_data = send_app_data,
+		.set_app_data_handler = set_app_data_handler,
+
+		.read_eeprom_var = read_eeprom_var,
+		.store_eeprom_var = store_eeprom_var,
+		.conf_custom_add_config = conf_custom_add_config,
+		.conf_custom_clear_configs = conf_custom_clear_configs,
+		.get_cfg_float = get_cfg_float,
+		.get_cfg_int = get_cfg_int,
+		.set_cfg_float = set_cfg_float,
+
+		.timer_time_now = timer_time_now,
+		.timer_seconds_elapsed_since = timer_seconds_elapsed_since,
+		.system_time_ticks = system_time_ticks,
+	};
+	sim_vesc_if = &vesc_if;
+}
@@ -0,0 +1,371 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the VESC package.
+//
+// This VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// This VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+// Checks the multi-axis Kalman filter: the pitch axis against the single axis
+// filter it replaced, the bias estimate of the roll axis, the yaw change
+// across the wrap of the yaw angle at 180 degrees and the signs of the roll
+// and yaw rates against the angles of the AHRS of the simulator.
+
+#include "runtime.h"
+#include "kalman.h"
+#include "utils_tnt.h"
+#include "conf/confparser.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+vesc_c_if *sim_vesc_if;
+
+void sim_ahrs_init_attitude_info(ATTITUDE_INFO *att);
+void sim_ahrs_update_mahony_imu(float *gyro, float *acc, float dt, ATTITUDE_INFO *att);
+float sim_ahrs_get_roll(ATTITUDE_INFO *att);
+float sim_ahrs_get_pitch(ATTITUDE_INFO *att);
+float sim_ahrs_get_yaw(ATTITUDE_INFO *att);
+
+static int failures = 0;
+
+static void check(bool condition, const char *name) {
+	printf("%s %s\n", condition ? "✓" : "✗", name);
+	if (!condition) {
+		failures++;
+	}
+}
+
+static float noise(float amplitude) {
+	return amplitude * (2.0f * (float)rand() / (float)RAND_MAX - 1);
+}
+
+// The single axis filter of the pitch before all axes were filtered together
+typedef struct {
+	float P00, P01, P10, P11, bias;
+	float Q_angle, Q_bias, R_measure;
+} RefKalman;
+
+static void ref_kalman(float in, float in_rate, float *out, float dt, RefKalman *k) {
+	float rate = in_rate / 131 - k->bias;
+	*out += dt * rate;
+	k->P00 += dt * (dt * k->P11 - k->P01 - k->P10 + k->Q_angle);
+	k->P01 -= dt * k->P11;
+	k->P10 -= dt * k->P11;
+	k->P11 += k->Q_bias * dt;
+	float S = k->P00 + k->R_measure;
+	float K0 = k->P00 / S;
+	float K1 = k->P10 / S;
+	float y = in - *out;
+	*out += K0 * y;
+	k->bias += K1 * y;
+	float P00_temp = k->P00;
+	float P01_temp = k->P01;
+	k->P00 -= K0 * P00_temp;
+	k->P01 -= K0 * P01_temp;
+	k->P10 -= K1 * P00_temp;
+	k->P11 -= K1 * P01_temp;
+}
+
+static void test_pitch(void) {
+	tnt_config config;
+	confparser_set_defaults_tnt_config(&config);
+	config.kalman_factor1 = 20;
+	config.kalman_factor2 = 5;
+	config.kalman_factor3 = 50;
+
+	KalmanFilter k;
+	configure_kalman(&config, &k);
+	for (int i = 0; i < KALMAN_AXES; i++) {
+		reset_kalman(&k, i, 0);
+	}
+
+	RefKalman ref = {0};
+	ref.Q_angle = config.kalman_factor1 / 10000;
+	ref.Q_bias = config.kalman_factor2 / 10000;
+	ref.R_measure = config.kalman_factor3 / 100000;
+	float ref_out = 0;
+
+	float dt = 1.0f / 1000;
+	float max_diff = 0;
+	for (int n = 0; n < 20000; n++) {
+		float t = n * dt;
+		float pitch = 5 * sinf(3 * t) + noise(0.5f);
+		float in[KALMAN_AXES] = {pitch, noise(10), noise(10)};
+		float in_rate[KALMAN_AXES] = {15 * cosf(3 * t) + noise(20), noise(50), noise(50)};
+
+		apply_kalman(in, in_rate, dt, &k);
+		ref_kalman(pitch, in_rate[KALMAN_PITCH], &ref_out, dt, &ref);
+		max_diff = fmaxf(max_diff, fabsf(k.angle[KALMAN_PITCH] - ref_out));
+	}
+
+	check(max_diff < 1e-3f, "pitch axis matches the single axis filter");
+}
+
+// Roll with a gyro bias of 3 deg/s. The rate estimate loses the bias, while
+// the angle follows the measurement.
+static void test_roll_bias(int hertz) {
+	tnt_config config;
+	confparser_set_defaults_tnt_config(&config);
+	KalmanFilter k;
+	configure_kalman(&config, &k);
+	for (int i = 0; i < KALMAN_AXES; i++) {
+		reset_kalman(&k, i, 0);
+	}
+
+	float dt = 1.0f / hertz;
+	float max_angle_err = 0, max_rate_err = 0;
+	for (int n = 0; n < 30 * hertz; n++) {
+		float t = n * dt;
+		float roll = 10 * sinf(t);
+		float rate = 10 * cosf(t);
+		float in[KALMAN_AXES] = {0, roll + noise(0.2f), 0};
+		float in_rate[KALMAN_AXES] = {0, rate + 3 + noise(2), 0};
+		apply_kalman(in, in_rate, dt, &k);
+
+		if (t > 20) {
+			max_angle_err = fmaxf(max_angle_err, fabsf(k.angle[KALMAN_ROLL] - roll));
+			max_rate_err = fmaxf(max_rate_err, fabsf(k.rate[KALMAN_ROLL] - rate));
+		}
+	}
+
+	char name[64];
+	snprintf(name, sizeof(name), "roll bias estimated at %d Hz", hertz);
+	check(fabsf(k.bias[KALMAN_ROLL] - 3) < 0.3f, name);
+	snprintf(name, sizeof(name), "roll angle follows at %d Hz", hertz);
+	check(max_angle_err < 0.5f, name);
+	snprintf(name, sizeof(name), "roll rate without bias at %d Hz", hertz);
+	check(max_rate_err < 2.5f, name);
+}
+
+// A steady turn at 40 deg/s through the wrap of the yaw angle at 180
+static void test_yaw_wrap(void) {
+	tnt_config config;
+	confparser_set_defaults_tnt_config(&config);
+	config.kalman_factor1 = 0;
+
+	static RuntimeData rt;
+	YawData yaw = {0};
+	YawDebugData yaw_dbg = {0};
+	memset(&rt, 0, sizeof(rt));
+
+	int hertz = config.hertz;
+	rt.diff_time = 1.0f / hertz;
+	rt.imu_rate_factor = lerp(832, 10000, 1, 2, hertz);
+	configure_kalman(&config, &rt.kalman);
+	rt.yaw_angle = 100;
+	reset_kalman(&rt.kalman, KALMAN_YAW, rt.yaw_angle);
+
+	float expected = 40 * rt.diff_time / rt.imu_rate_factor;
+	float max_change_err = 0, max_yaw_err = 0, max_estimate = 0;
+	int wraps = 0;
+	for (int n = 0; n < 30 * hertz; n++) {
+		float t = n * rt.diff_time;
+		float angle = fmodf(100 + 40 * t + 180, 360) - 180;
+		wraps += angle < rt.yaw_angle;
+		rt.yaw_angle = angle;
+		rt.yaw_rate = 40 + 1;
+		apply_filters(&rt, &config);
+		calc_yaw_change(&yaw, &rt, &yaw_dbg, hertz);
+
+		max_estimate = fmaxf(max_estimate, fabsf(rt.kalman.angle[KALMAN_YAW]));
+		if (t > 20) {
+			float err = fabsf(rt.kalman.angle[KALMAN_YAW] - angle);
+			max_yaw_err = fmaxf(max_yaw_err, fminf(err, 360 - err));
+			max_change_err = fmaxf(max_change_err, fabsf(yaw.change - expected));
+		}
+	}
+
+	check(wraps >= 3, "yaw angle wraps");
+	check(max_estimate <= 180, "yaw estimate stays within 180");
+	check(max_yaw_err < 0.1f, "yaw estimate follows across the wrap");
+	check(max_change_err < 0.02f * expected, "yaw change steady across the wrap");
+}
+
+// The IMU of the firmware, the AHRS of the simulator fed with body rates and
+// the gravity of its own attitude
+static ATTITUDE_INFO imu_att;
+static float imu_gyro[3], imu_accel[3], imu_time;
+
+static float imu_get_roll(void) {
+	return sim_ahrs_get_roll(&imu_att);
+}
+
+static float imu_get_pitch(void) {
+	return sim_ahrs_get_pitch(&imu_att);
+}
+
+static void imu_get_gyro(float *gyro) {
+	for (int i = 0; i < 3; i++) {
+		gyro[i] = rad2deg(imu_gyro[i]);
+	}
+}
+
+static void imu_get_accel(float *accel) {
+	memcpy(accel, imu_accel, sizeof(imu_accel));
+}
+
+static float system_time(void) {
+	return imu_time;
+}
+
+static void imu_update(float dt, RuntimeData *rt) {
+	ATTITUDE_INFO *atts[2] = {&imu_att, &rt->m_att_ref};
+	for (int i = 0; i < 2; i++) {
+		ATTITUDE_INFO *a = atts[i];
+		imu_accel[0] = 2 * (a->q1 * a->q3 - a->q0 * a->q2);
+		imu_accel[1] = 2 * (a->q0 * a->q1 + a->q2 * a->q3);
+		imu_accel[2] = 2 * (a->q0 * a->q0 - 0.5f + a->q3 * a->q3);
+		sim_ahrs_update_mahony_imu(imu_gyro, imu_accel, dt, a);
+	}
+	imu_time += dt;
+}
+
+static float wrap_180(float angle) {
+	if (angle > 180) {
+		return angle - 360;
+	} else if (angle < -180) {
+		return angle + 360;
+	}
+	return angle;
+}
+
+// Carving while leaning and pitched. The roll and yaw rates from the body
+// rates match the change of the AHRS angles, and the yaw change from the
+// Kalman rate matches the one from the difference of the AHRS yaw, as it was
+// calculated before the yaw was filtered.
+static void test_rate_signs(void) {
+	tnt_config config;
+	confparser_set_defaults_tnt_config(&config);
+	config.pitch_filter = 0;
+
+	static vesc_c_if vesc_if;
+	vesc_if.imu_get_roll = imu_get_roll;
+	vesc_if.imu_get_pitch = imu_get_pitch;
+	vesc_if.imu_get_gyro = imu_get_gyro;
+	vesc_if.imu_get_accel = imu_get_accel;
+	vesc_if.ahrs_get_pitch = sim_ahrs_get_pitch;
+	vesc_if.ahrs_get_yaw = sim_ahrs_get_yaw;
+	vesc_if.system_time = system_time;
+	sim_vesc_if = &vesc_if;
+
+	static RuntimeData rt;
+	YawData yaw = {0};
+	YawDebugData yaw_dbg = {0};
+	memset(&rt, 0, sizeof(rt));
+
+	int hertz = config.hertz;
+	rt.diff_time = 1.0f / hertz;
+	rt.imu_rate_factor = lerp(832, 10000, 1, 2, hertz);
+	configure_kalman(&config, &rt.kalman);
+
+	// The first update sets the attitude from gravity: leaning right, nose up
+	sim_ahrs_init_attitude_info(&imu_att);
+	sim_ahrs_init_attitude_info(&rt.m_att_ref);
+	float roll = deg2rad(20), pitch = deg2rad(10);
+	imu_accel[0] = -sinf(pitch);
+	imu_accel[1] = cosf(pitch) * sinf(roll);
+	imu_accel[2] = cosf(pitch) * cosf(roll);
+	sim_ahrs_update_mahony_imu(imu_gyro, imu_accel, 0, &imu_att);
+	sim_ahrs_update_mahony_imu(imu_gyro, imu_accel, 0, &rt.m_att_ref);
+	runtime_data_update(&rt);
+	for (int i = 0; i < KALMAN_AXES; i++) {
+		reset_kalman(&rt.kalman, i, 0);
+	}
+	rt.kalman.angle[KALMAN_ROLL] = rt.roll_angle;
+	rt.kalman.angle[KALMAN_YAW] = rt.yaw_angle;
+
+	float old_change = 0;
+	float max_yaw_rate_err = 0, max_roll_rate_err = 0, max_change_err = 0, max_change = 0;
+	for (int n = 0; n < 10 * hertz; n++) {
+		float t = n * rt.diff_time;
+		imu_gyro[0] = 0.3f * sinf(0.5f * t);
+		imu_gyro[1] = 0.2f * sinf(0.3f * t);
+		imu_gyro[2] = 0.8f;
+
+		float last_roll = rt.roll_angle, last_yaw = rt.yaw_angle;
+		float yaw_rate = rt.yaw_rate, roll_rate = rt.roll_rate;
+		imu_update(rt.diff_time, &rt);
+		runtime_data_update(&rt);
+		apply_filters(&rt, &config);
+		calc_yaw_change(&yaw, &rt, &yaw_dbg, hertz);
+
+		float yaw_diff = wrap_180(rt.yaw_angle - last_yaw);
+		ema(&old_change, 0.2 * 832 / hertz, yaw_diff / rt.imu_rate_factor);
+		if (n > 0) {
+			max_yaw_rate_err = fmaxf(max_yaw_rate_err, fabsf(yaw_diff / rt.diff_time - yaw_rate));
+			max_roll_rate_err = fmaxf(max_roll_rate_err, fabsf((rt.roll_angle - last_roll) / rt.diff_time - roll_rate));
+		}
+		if (t > 5) {
+			max_change_err = fmaxf(max_change_err, fabsf(yaw.change - old_change));
+			max_change = fmaxf(max_change, fabsf(old_change));
+		}
+	}
+
+	check(max_yaw_rate_err < 1, "yaw rate matches the AHRS yaw");
+	check(max_roll_rate_err < 1, "roll rate matches the AHRS roll");
+	check(max_change > 0 && max_change_err < 0.05f * max_change, "yaw change matches the AHRS yaw difference");
+}
+
+static int get_cfg_int(CFG_PARAM param) {
+	(void)param;
+	return 10000;
+}
+
+// Configured on startup before the first IMU reading, as the package does,
+// roll and yaw follow the board right away instead of converging from 0
+static void test_seed(void) {
+	tnt_config config;
+	confparser_set_defaults_tnt_config(&config);
+
+	static vesc_c_if vesc_if;
+	vesc_if.get_cfg_int = get_cfg_int;
+	sim_vesc_if = &vesc_if;
+
+	static RuntimeData rt;
+	memset(&rt, 0, sizeof(rt));
+	configure_runtime(&rt, &config);
+	rt.diff_time = 1.0f / config.hertz;
+
+	float max_roll_err = 0, max_yaw_err = 0;
+	for (int n = 0; n < config.hertz / 10; n++) {
+		rt.roll_angle = 30;
+		rt.yaw_angle = -120;
+		apply_filters(&rt, &config);
+		max_roll_err = fmaxf(max_roll_err, fabsf(rt.roll_kalman - 30));
+		max_yaw_err = fmaxf(max_yaw_err, fabsf(rt.kalman.angle[KALMAN_YAW] + 120));
+	}
+	check(max_roll_err < 0.01f && max_yaw_err < 0.01f, "roll and yaw start at the first reading");
+
+	// Writing the config while riding starts them over at the current angles
+	configure_runtime(&rt, &config);
+	rt.roll_angle = -10;
+	rt.yaw_angle = 170;
+	apply_filters(&rt, &config);
+	check(fabsf(rt.roll_kalman + 10) < 0.01f && fabsf(rt.kalman.angle[KALMAN_YAW] - 170) < 0.01f,
+		"roll and yaw start over after configure");
+}
+
+int main(void) {
+	srand(1);
+
+	test_pitch();
+	test_roll_bias(1000);
+	test_roll_bias(10000);
+	test_yaw_wrap();
+	test_rate_signs();
+	test_seed();
+
+	return failures ? 1 : 0;
+}
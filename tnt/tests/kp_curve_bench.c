@@ -0,0 +1,90 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the VESC package.
+//
+// This VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// This VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+// Host benchmark of the Kp curves of the default config: angle_kp_select()
+// walking the points against the compiled angle_kp_lookup(), for angles
+// within the points and for a sweep to three times the last point.
+//
+// Usage: kp_curve_bench [CALLS]
+
+#include "pid.h"
+#include "conf/confparser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+vesc_c_if *sim_vesc_if;
+
+static double now_s(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / (double)1000000000;
+}
+
+int main(int argc, char **argv) {
+	unsigned int calls = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+
+	tnt_config config;
+	confparser_set_defaults_tnt_config(&config);
+	KpArray k[3];
+	for (int i = 0; i < 3; i++) {
+		angle_kp_reset(&k[i]);
+	}
+	pitch_kp_configure(&config, &k[0], 1);
+	roll_kp_configure(&config, &k[1], 1);
+	yaw_kp_configure(&config, &k[2], 1);
+
+	float *angles = malloc(calls * sizeof(float));
+	static const char *names[] = {"pitch", "roll", "yaw"};
+	static const float spans[] = {1, 3};
+
+	// accumulate the results so that the calls aren't optimized out
+	volatile float sink = 0;
+
+	printf("ns per call\n");
+	printf("%-6s %6s %10s %10s\n", "curve", "span", "select", "lookup");
+	for (int c = 0; c < 3; c++) {
+		for (int s = 0; s < 2; s++) {
+			float last = k[c].angle_kp[k[c].count][0];
+			srand(1);
+			for (unsigned int i = 0; i < calls; i++) {
+				angles[i] = spans[s] * last * (float)rand() / (float)RAND_MAX;
+			}
+
+			float sum = 0;
+			double start = now_s();
+			for (unsigned int i = 0; i < calls; i++) {
+				sum += angle_kp_select(angles[i], &k[c]);
+			}
+			double t_select = now_s() - start;
+
+			start = now_s();
+			for (unsigned int i = 0; i < calls; i++) {
+				sum += angle_kp_lookup(angles[i], &k[c]);
+			}
+			double t_lookup = now_s() - start;
+			sink += sum;
+
+			printf("%-6s %5.0fx %10.2f %10.2f\n", names[c], (double)spans[s],
+					t_select * (double)1000000000 / calls, t_lookup * (double)1000000000 / calls);
+		}
+	}
+
+	free(angles);
+	return 0;
+}
@@ -0,0 +1,259 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the VESC package.
+//
+// This VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// This VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+// Checks the compiled Kp curves of angle_kp_lookup() against angle_kp_select()
+// for the default config, random curves and curves with points sharing a cell.
+
+#include "pid.h"
+#include "conf/confparser.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+vesc_c_if *sim_vesc_if;
+
+static int failures = 0;
+
+static void check(bool condition, const char *name) {
+	printf("%s %s\n", condition ? "✓" : "✗", name);
+	if (!condition) {
+		failures++;
+	}
+}
+
+static float rand_range(float min, float max) {
+	return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+// Largest error of the lookups so far, relative to the range of the curve
+static float max_error = 0;
+
+static float segment_slope(const KpArray *k, int i) {
+	if (i >= k->count) {
+		return 0;
+	}
+	return (k->angle_kp[i+1][1] - k->angle_kp[i][1]) / (k->angle_kp[i+1][0] - k->angle_kp[i][0]);
+}
+
+// The line of a cell runs through the curve at both ends of the cell. A point
+// inside the cell where the slope changes by ds puts the line at most
+// ds * width / 4 off the curve. Elsewhere only rounding is allowed, of the
+// values and of the angles times the slope.
+static float tolerance(float angle, const KpArray *k, float ref) {
+	float last = k->angle_kp[k->count][0];
+	float max_slope = 0;
+	for (int i = 0; i < k->count; i++) {
+		max_slope = fmaxf(max_slope, fabsf(segment_slope(k, i)));
+	}
+	float rounding = 1e-5f * (1 + fabsf(ref) + fabsf(k->angle_kp[k->count][1])) +
+		1e-6f * last * max_slope;
+	if (last <= 0 || angle >= last) {
+		return rounding;
+	}
+
+	float width = last / KP_TABLE_SIZE;
+	float cell_start = floorf(angle / width) * width;
+	float ds = 0;
+	for (int i = 1; i < k->count; i++) {
+		float x = k->angle_kp[i][0];
+		if (x > cell_start - 1e-4f * width && x < cell_start + width * (1 + 1e-4f)) {
+			ds += fabsf(segment_slope(k, i) - segment_slope(k, i - 1));
+		}
+	}
+	return ds * width / 4 + rounding;
+}
+
+static bool close_kp(float angle, const KpArray *k) {
+	float kp = angle_kp_lookup(angle, k);
+	float ref = angle_kp_select(angle, k);
+	float range = fmaxf(fabsf(k->angle_kp[k->count][1]), 1);
+	max_error = fmaxf(max_error, fabsf(kp - ref) / range);
+	if (!(fabsf(kp - ref) <= tolerance(angle, k, ref))) {
+		printf("  %g: %g, reference %g\n", (double)angle, (double)kp, (double)ref);
+		return false;
+	}
+	return true;
+}
+
+// Sweeps from 0 to past the last point, and hits every point exactly and
+// just before it
+static bool matches(const KpArray *k) {
+	float last = fmaxf(k->angle_kp[k->count][0], 1);
+	for (int i = 0; i <= 2000; i++) {
+		if (!close_kp(1.5f * last * (float)i / 2000, k)) {
+			return false;
+		}
+	}
+
+	for (int i = 0; i <= k->count; i++) {
+		float angle = k->angle_kp[i][0];
+		if (!close_kp(angle, k) || !close_kp(nextafterf(angle, 0), k)) {
+			printf("  point %d at %g\n", i, (double)angle);
+			return false;
+		}
+	}
+
+	return close_kp(90, k) && close_kp(1000, k);
+}
+
+// Number of points inside the same cell as the previous point
+static int count_shared_cells(const KpArray *k) {
+	int shared = 0;
+	for (int i = 1; i < k->count; i++) {
+		int cell = (int)(k->angle_kp[i][0] * k->inv_step);
+		shared += cell == (int)(k->angle_kp[i+1][0] * k->inv_step);
+	}
+	return shared;
+}
+
+static void configure(const tnt_config *config, KpArray k[6]) {
+	for (int i = 0; i < 6; i++) {
+		angle_kp_reset(&k[i]);
+	}
+	pitch_kp_configure(config, &k[0], 1);
+	pitch_kp_configure(config, &k[1], 2);
+	roll_kp_configure(config, &k[2], 1);
+	roll_kp_configure(config, &k[3], 2);
+	yaw_kp_configure(config, &k[4], 1);
+	yaw_kp_configure(config, &k[5], 2);
+}
+
+static void test_default(void) {
+	tnt_config config;
+	KpArray k[6];
+	confparser_set_defaults_tnt_config(&config);
+	configure(&config, k);
+
+	check(matches(&k[0]), "default pitch curve");
+	check(matches(&k[1]), "default brake pitch curve");
+	check(matches(&k[2]), "default roll curve");
+	check(matches(&k[3]), "default brake roll curve");
+	check(matches(&k[4]), "default yaw curve");
+	check(matches(&k[5]), "default brake yaw curve");
+	printf("  largest error on the default curves: %.3g%% of the last kp\n", (double)(100 * max_error));
+
+	KpArray empty;
+	angle_kp_reset(&empty);
+	check(angle_kp_lookup(0, &empty) == 0 && angle_kp_lookup(10, &empty) == 0, "reset curve is zero");
+}
+
+// Points 0.5 to 3 apart (times scale), so that no two of them share a cell.
+// With close, about half of them are only 0.001 to 0.01 apart instead.
+static void random_points(float *angle, float *value, int n, float scale, bool increasing,
+		bool close) {
+	float a = 0;
+	float v = 0;
+	for (int i = 0; i < n; i++) {
+		a += (close && rand() % 2 ? rand_range(0.001f, 0.01f) : rand_range(0.5f, 3)) * scale;
+		v = increasing ? v + rand_range(0.1f, 10) : rand_range(0.1f, 40);
+		angle[i] = a;
+		value[i] = v;
+	}
+}
+
+static void test_random(bool close, const char *name) {
+	bool pitch_ok = true, roll_ok = true, yaw_ok = true;
+	int pitch_points = 0;
+	int shared_cells = 0;
+
+	for (int n = 0; n < 500; n++) {
+		tnt_config config;
+		confparser_set_defaults_tnt_config(&config);
+
+		float a[6], v[6];
+		// Pitch curves end at a random point
+		int count = rand() % 7;
+		random_points(a, v, 6, 1, false, close);
+		for (int i = count; i < 6; i++) {
+			v[i] = 0;
+		}
+		config.pitch1 = a[0]; config.current1 = v[0];
+		config.pitch2 = a[1]; config.current2 = v[1];
+		config.pitch3 = a[2]; config.current3 = v[2];
+		config.pitch4 = a[3]; config.current4 = v[3];
+		config.pitch5 = a[4]; config.current5 = v[4];
+		config.pitch6 = a[5]; config.current6 = v[5];
+		config.kp0 = rand_range(0, 30);
+		config.pitch_kp_input = rand() % 2;
+
+		random_points(a, v, 6, 1, false, close);
+		config.brakepitch1 = a[0]; config.brakecurrent1 = v[0];
+		config.brakepitch2 = a[1]; config.brakecurrent2 = v[1];
+		config.brakepitch3 = a[2]; config.brakecurrent3 = v[2];
+		config.brakepitch4 = a[3]; config.brakecurrent4 = v[3];
+		config.brakepitch5 = a[4]; config.brakecurrent5 = v[4];
+		config.brakepitch6 = a[5]; config.brakecurrent6 = v[5];
+		config.brake_kp0 = rand_range(0, 30);
+
+		random_points(a, v, 3, 5, rand() % 2, close);
+		config.roll1 = a[0]; config.roll_kp1 = v[0];
+		config.roll2 = a[1]; config.roll_kp2 = v[1];
+		config.roll3 = a[2]; config.roll_kp3 = v[2];
+
+		random_points(a, v, 3, 5, true, close);
+		config.brkroll1 = a[0]; config.brkroll_kp1 = v[0];
+		config.brkroll2 = a[1]; config.brkroll_kp2 = v[1];
+		config.brkroll3 = a[2]; config.brkroll_kp3 = v[2];
+
+		config.hertz = 800 + rand() % 4 * 200;
+		random_points(a, v, 3, 200, rand() % 2, close);
+		config.yaw1 = a[0]; config.yaw_kp1 = v[0];
+		config.yaw2 = a[1]; config.yaw_kp2 = v[1];
+		config.yaw3 = a[2]; config.yaw_kp3 = v[2];
+
+		random_points(a, v, 3, 200, true, close);
+		config.brkyaw1 = a[0]; config.brkyaw_kp1 = v[0];
+		config.brkyaw2 = a[1]; config.brkyaw_kp2 = v[1];
+		config.brkyaw3 = a[2]; config.brkyaw_kp3 = v[2];
+
+		KpArray k[6];
+		configure(&config, k);
+		pitch_points += k[0].count;
+		for (int i = 0; i < 6; i++) {
+			shared_cells += count_shared_cells(&k[i]);
+		}
+
+		pitch_ok = pitch_ok && matches(&k[0]) && matches(&k[1]);
+		roll_ok = roll_ok && matches(&k[2]) && matches(&k[3]);
+		yaw_ok = yaw_ok && matches(&k[4]) && matches(&k[5]);
+	}
+
+	char buf[64];
+	snprintf(buf, sizeof(buf), "%s pitch curves", name);
+	check(pitch_ok, buf);
+	snprintf(buf, sizeof(buf), "%s roll curves", name);
+	check(roll_ok, buf);
+	snprintf(buf, sizeof(buf), "%s yaw curves", name);
+	check(yaw_ok, buf);
+	snprintf(buf, sizeof(buf), "%s pitch curves have points", name);
+	check(pitch_points > 500, buf);
+	if (close) {
+		snprintf(buf, sizeof(buf), "%s curves have points sharing a cell", name);
+		check(shared_cells > 100, buf);
+	}
+}
+
+int main(void) {
+	srand(1);
+
+	test_default();
+	test_random(false, "random");
+	test_random(true, "close point");
+
+	return failures ? 1 : 0;
+}
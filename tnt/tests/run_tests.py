@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""
+TNT host tests
+Builds host tests of the platform independent parts of the package and runs
+them, and replays the synthetic ride in the simulator
+"""
+
+import os
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+
+TESTS_DIR = Path(__file__).resolve().parent
+SRC_DIR = TESTS_DIR.parent / "tnt"
+SIM_DIR = TESTS_DIR.parent / "sim"
+C_LIBS_DIR = TESTS_DIR.parent.parent / "c_libs"
+STLIB_DIR = C_LIBS_DIR / "stdperiph_stm32f4"
+
+CC = os.environ.get("CC", "cc")
+# The package headers need the firmware headers of c_libs, with VESC_IF
+# redirected by the shim of the host replay
+CFLAGS = ["-O2", "-std=gnu99", "-Wall", "-Wextra", "-Werror",
+          "-fsingle-precision-constant", "-Wdouble-promotion",
+          "-DIS_VESC_LIB", "-DUSE_STLIB",
+          "-iquote", str(SRC_DIR), "-I", str(SIM_DIR / "include"), "-I", str(C_LIBS_DIR),
+          "-I", str(STLIB_DIR / "CMSIS" / "include"), "-I", str(STLIB_DIR / "CMSIS" / "ST"),
+          "-I", str(STLIB_DIR / "inc")]
+
+# Test counters
+test_passes = 0
+test_failures = 0
+
+
+def check(condition, test_name, details=""):
+    global test_passes, test_failures
+    if condition:
+        test_passes += 1
+        print(f"✓ {test_name}")
+    else:
+        test_failures += 1
+        print(f"✗ {test_name}")
+        if details:
+            print(f"  {details}")
+
+
+def build(workdir, name, sources, defines=()):
+    binary = Path(workdir) / name
+    cmd = [CC] + CFLAGS + [f"-D{d}" for d in defines] + ["-o", str(binary)]
+    subprocess.run(cmd + [str(s) for s in sources] + ["-lm"], check=True)
+    return binary
+
+
+def run_test(workdir, name, sources, defines=(), args=()):
+    """Builds and runs a test program, which prints a ✓/✗ line per check"""
+    global test_passes, test_failures
+    print(f"\n{name}:")
+    binary = build(workdir, name, sources, defines)
+    result = subprocess.run([str(binary)] + list(args), capture_output=True, text=True)
+    print(result.stdout, end="")
+    test_passes += result.stdout.count("✓")
+    test_failures += result.stdout.count("✗")
+    if result.returncode != 0 and "✗" not in result.stdout:
+        test_failures += 1
+        print(f"✗ {name} exited with {result.returncode}")
+        print(result.stderr, end="")
+
+
+SIM = SIM_DIR / "tnt_sim"
+
+
+def run_sim(*args):
+    return subprocess.run([str(SIM), "-q"] + list(args), capture_output=True, text=True)
+
+
+def test_sim(workdir):
+    print("\nSimulation of the synthetic ride:")
+    if not SIM.exists():
+        check(False, "simulator built", f"{SIM} is missing, build it with make sim")
+        return
+
+    out_path = Path(workdir) / "out.csv"
+    res = run_sim("-d", "5", "-o", str(out_path))
+    check(res.returncode == 0, "ride runs", res.stderr.strip())
+
+    stages = ["TNT Main", "sensors", "setpoint", "kp", "traction", "output", "idle"]
+    check(all(f"\n{stage} " in res.stderr for stage in stages), "stats of all stages printed", res.stderr)
+
+    # one row per loop, the synthetic ride mounts and slips once
+    summary = next((line for line in res.stderr.splitlines() if " loops, " in line), "")
+    loops = int(summary.split()[0]) if summary else 0
+    rows = out_path.read_text().splitlines()[1:] if out_path.exists() else []
+    check(loops > 0 and len(rows) == loops, "output row per loop", summary)
+    check(any(row.split(",")[1] == "3" for row in rows), "board engages")
+    check(" 0 wheelslip" not in summary, "wheelslip detected", summary)
+
+    # with the CPU time charged at 10000 times the loop can't keep its rate
+    res = run_sim("-d", "5", "-x", "10000")
+    summary = next((line for line in res.stderr.splitlines() if " loops, " in line), "")
+    check(res.returncode == 0 and summary and int(summary.split()[0]) < loops / 2,
+          "charged CPU time slows the loop", summary)
+
+
+def main():
+    with tempfile.TemporaryDirectory() as workdir:
+        run_test(workdir, "kp_curve_test", [
+            TESTS_DIR / "kp_curve_test.c", SRC_DIR / "pid.c", SRC_DIR / "utils_tnt.c",
+            SRC_DIR / "state_tnt.c", SRC_DIR / "footpad_sensor.c",
+            SRC_DIR / "conf" / "confparser.c", SRC_DIR / "conf" / "buffer.c"])
+        print("\nkp_curve_bench:")
+        bench = build(workdir, "kp_curve_bench", [
+            TESTS_DIR / "kp_curve_bench.c", SRC_DIR / "pid.c", SRC_DIR / "utils_tnt.c",
+            SRC_DIR / "state_tnt.c", SRC_DIR / "footpad_sensor.c",
+            SRC_DIR / "conf" / "confparser.c", SRC_DIR / "conf" / "buffer.c"])
+        subprocess.run([str(bench)], check=True)
+        run_test(workdir, "kalman_test", [
+            TESTS_DIR / "kalman_test.c", SRC_DIR / "kalman.c", SRC_DIR / "runtime.c",
+            SRC_DIR / "biquad.c", SRC_DIR / "utils_tnt.c", SIM_DIR / "ahrs.c",
+            SRC_DIR / "conf" / "confparser.c", SRC_DIR / "conf" / "buffer.c"])
+        test_sim(workdir)
+
+    print(f"\n{test_passes} passed, {test_failures} failed")
+    return 1 if test_failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
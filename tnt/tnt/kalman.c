@@ -16,55 +16,78 @@
 // this program. If not, see <http://www.gnu.org/licenses/>.
 
 #include "kalman.h"
+#include <math.h>
 
-void apply_kalman(float in, float in_rate, float *out, float dt, KalmanFilter *k){
+// Noise values of the roll and yaw axes, those of the original filter for the gyro in deg/s
+#define ROLL_YAW_Q_ANGLE 0.001f
+#define ROLL_YAW_Q_BIAS 0.003f
+#define ROLL_YAW_R_MEASURE 0.03f
+
+void apply_kalman(const float in[KALMAN_AXES], const float in_rate[KALMAN_AXES], float dt, KalmanFilter *k){
     // KasBot V2  -  Kalman filter module - http://www.x-firm.com/?page_id=145
     // Modified by Kristian Lauszus
     // See my blog post for more information: http://blog.tkjelectronics.dk/2012/09/a-practical-approach-to-kalman-filter-and-how-to-implement-it
-    // Discrete Kalman filter time update equations - Time Update ("Predict")
-    // Update xhat - Project the state ahead
-	// Step 1
-	float rate = in_rate / 131 - k->bias; 
-	*out += dt * rate;
-	// Update estimation error covariance - Project the error covariance ahead
-	// Step 2 
-	k->P00 += dt * (dt * k->P11 - k->P01 - k->P10 + k->Q_angle);
-	k->P01 -= dt * k->P11;
-	k->P10 -= dt * k->P11;
-	k->P11 += k->Q_bias * dt;
-	// Discrete Kalman filter measurement update equations - Measurement Update ("Correct")
-	// Step 4
-	float S = k->P00 + k->R_measure; // Estimate error
-	// Calculate Kalman gain
-	// Step 5
-	float K0 = k->P00 / S; // Kalman gain - This is a 2x1 vector
-	float K1 = k->P10 / S;
-	// Calculate angle and bias - Update estimate with measurement zk (newAngle)
-	// Step 3
-	float y = in - *out; // Angle difference
-	// Step 6
-	*out += K0 * y;
-	k->bias += K1 * y;
-	// Calculate estimation error covariance - Update the error covariance
-	// Step 7
-	float P00_temp = k->P00;
-	float P01_temp = k->P01;
-	k->P00 -= K0 * P00_temp;
-	k->P01 -= K0 * P01_temp;
-	k->P10 -= K1 * P00_temp;
-	k->P11 -= K1 * P01_temp;
+	// The axes don't depend on each other, the same steps run for each of them
+	for (int i = 0; i < KALMAN_AXES; i++) {
+		// Discrete Kalman filter time update equations - Time Update ("Predict")
+		// Update xhat - Project the state ahead
+		// Step 1
+		k->rate[i] = in_rate[i] * k->rate_scale[i] - k->bias[i];
+		k->angle[i] += dt * k->rate[i];
+		// Update estimation error covariance - Project the error covariance ahead
+		// Step 2
+		k->P00[i] += dt * (dt * k->P11[i] - k->P01[i] - k->P10[i] + k->Q_angle[i]);
+		k->P01[i] -= dt * k->P11[i];
+		k->P10[i] -= dt * k->P11[i];
+		k->P11[i] += k->Q_bias[i] * dt;
+		// Discrete Kalman filter measurement update equations - Measurement Update ("Correct")
+		// Step 4
+		float S = k->P00[i] + k->R_measure[i]; // Estimate error
+		// Calculate Kalman gain
+		// Step 5
+		float K0 = k->P00[i] / S; // Kalman gain - This is a 2x1 vector
+		float K1 = k->P10[i] / S;
+		// Calculate angle and bias - Update estimate with measurement zk (newAngle)
+		// Step 3
+		float y = in[i] - k->angle[i]; // Angle difference
+		// Step 6
+		k->angle[i] += K0 * y;
+		k->bias[i] += K1 * y;
+		// Calculate estimation error covariance - Update the error covariance
+		// Step 7
+		float P00_temp = k->P00[i];
+		float P01_temp = k->P01[i];
+		k->P00[i] -= K0 * P00_temp;
+		k->P01[i] -= K0 * P01_temp;
+		k->P10[i] -= K1 * P00_temp;
+		k->P11[i] -= K1 * P01_temp;
+	}
 }
 
 void configure_kalman(const tnt_config *config, KalmanFilter *k) {
-	k->Q_angle = config->kalman_factor1/10000;
-	k->Q_bias = config->kalman_factor2/10000;
-	k->R_measure = config->kalman_factor3/100000;
+	// Pitch is tuned with the config. Its gyro rate keeps the 1/131 scale of
+	// the original filter (LSB per deg/s of the MPU6050), the factors of
+	// existing tunes are set for it.
+	k->Q_angle[KALMAN_PITCH] = config->kalman_factor1/10000;
+	k->Q_bias[KALMAN_PITCH] = config->kalman_factor2/10000;
+	k->R_measure[KALMAN_PITCH] = fmaxf(config->kalman_factor3/100000, 1e-9); // No division by 0 when disabled
+	k->rate_scale[KALMAN_PITCH] = 1.0f / 131;
+
+	// Roll and yaw use the gyro in deg/s
+	for (int i = KALMAN_ROLL; i <= KALMAN_YAW; i++) {
+		k->Q_angle[i] = ROLL_YAW_Q_ANGLE;
+		k->Q_bias[i] = ROLL_YAW_Q_BIAS;
+		k->R_measure[i] = ROLL_YAW_R_MEASURE;
+		k->rate_scale[i] = 1;
+	}
 }
 
-void reset_kalman(KalmanFilter *k) {
-	k->P00 = 0;
-	k->P01 = 0;
-	k->P10 = 0;
-	k->P11 = 0;
-	k->bias = 0;
+void reset_kalman(KalmanFilter *k, KalmanAxis axis, float angle) {
+	k->angle[axis] = angle;
+	k->rate[axis] = 0;
+	k->P00[axis] = 0;
+	k->P01[axis] = 0;
+	k->P10[axis] = 0;
+	k->P11[axis] = 0;
+	k->bias[axis] = 0;
 }
@@ -19,11 +19,26 @@
 
 #include "conf/datatypes.h"
 
+// Axes of the filter, all updated together from one IMU read
+#define KALMAN_AXES 3
+
+typedef enum {
+	KALMAN_PITCH = 0,
+	KALMAN_ROLL,
+	KALMAN_YAW
+} KalmanAxis;
+
+// Angle and gyro bias per axis, with one array per value so that the update
+// is one loop over the axes
 typedef struct {
-	float P00, P01, P10, P11, bias;
-	float Q_angle, Q_bias, R_measure;
+	float angle[KALMAN_AXES];
+	float bias[KALMAN_AXES];
+	float rate[KALMAN_AXES]; // Scaled gyro rate minus bias
+	float P00[KALMAN_AXES], P01[KALMAN_AXES], P10[KALMAN_AXES], P11[KALMAN_AXES];
+	float Q_angle[KALMAN_AXES], Q_bias[KALMAN_AXES], R_measure[KALMAN_AXES];
+	float rate_scale[KALMAN_AXES];
 } KalmanFilter;
 
-void apply_kalman(float in, float in_rate, float *out, float dt, KalmanFilter *k);
+void apply_kalman(const float in[KALMAN_AXES], const float in_rate[KALMAN_AXES], float dt, KalmanFilter *k);
 void configure_kalman(const tnt_config *config, KalmanFilter *k);
-void reset_kalman(KalmanFilter *k);
+void reset_kalman(KalmanFilter *k, KalmanAxis axis, float angle);
@@ -20,6 +20,8 @@
 #include <math.h>
 #include "vesc_c_if.h"
 
+// Walks the curve for every call, the loop uses the compiled curve of
+// angle_kp_lookup(). This is the reference for the host tests.
 float angle_kp_select(float angle, const KpArray *k) {
 	float kp_mod = 0;
 	float kp_min = 0;
@@ -49,6 +51,46 @@ float angle_kp_select(float angle, const KpArray *k) {
 	return kp_mod;
 }
 
+void angle_kp_compile(KpArray *k) {
+	//Cells from 0 to the last point, the line of a cell runs through the curve at
+	//both of its ends. It follows the curve exactly unless a point is inside the cell.
+	float last = k->angle_kp[k->count][0];
+	float step = last / KP_TABLE_SIZE;
+	k->last = last;
+	k->inv_step = last > 0 ? KP_TABLE_SIZE / last : 0;
+	for (int c = 0; c < KP_TABLE_SIZE; c++) {
+		float x0 = c * step;
+		float x1 = c == KP_TABLE_SIZE - 1 ? last : (c + 1) * step;
+		KpCell *cell = &k->cell[c];
+		cell->x0 = x0;
+		cell->y0 = angle_kp_select(x0, k);
+		cell->slope = x1 > x0 ? (angle_kp_select(x1, k) - cell->y0) / (x1 - x0) : 0;
+	}
+
+	//Flat after the last point
+	KpCell *flat = &k->cell[KP_TABLE_SIZE];
+	flat->x0 = last;
+	flat->y0 = k->angle_kp[k->count][1];
+	flat->slope = 0;
+	if (last <= 0) {
+		for (int c = 0; c < KP_TABLE_SIZE; c++) {
+			k->cell[c] = *flat;
+		}
+	}
+}
+
+// angle_kp_select() of |angle| with one index and one multiply-add. Off by at
+// most a quarter of the cell width times the change of slope in the cells with
+// a point inside.
+float angle_kp_lookup(float angle, const KpArray *k) {
+	//Clamped to the last point, where the line of the last cell and the flat cell
+	//both give its kp. fabsf() and the compare don't branch, fminf() is a call on the M4.
+	float x = fabsf(angle);
+	x = x < k->last ? x : k->last;
+	const KpCell *cell = &k->cell[(int)(x * k->inv_step)];
+	return cell->y0 + (x - cell->x0) * cell->slope;
+}
+
 void pitch_kp_configure(const tnt_config *config, KpArray *k, int mode){
 	float pitch_current[7][2] = { //Accel curve
 	{0, 0}, //reserved for kp0 assigned at the end
@@ -103,6 +145,7 @@ void pitch_kp_configure(const tnt_config *config, KpArray *k, int mode){
 	} else if (kp0 == 0) { //If no currents and no kp0
 		k->angle_kp[0][1] = 5; //default 5
 	} else { k->angle_kp[0][1] = kp0; }//passes all checks, it is ok 
+	angle_kp_compile(k);
 }
 
 void angle_kp_reset(KpArray *k) {
@@ -113,6 +156,7 @@ void angle_kp_reset(KpArray *k) {
 		}
 	}
 	k->count = 0;
+	angle_kp_compile(k);
 }
 
 void roll_kp_configure(const tnt_config *config, KpArray *k, int mode){
@@ -149,6 +193,7 @@ void roll_kp_configure(const tnt_config *config, KpArray *k, int mode){
 	} else if (k->angle_kp[1][1] >0 && k->angle_kp[1][0]>0) {
 		k->count = 1;
 	} else {k->count = 0;}
+	angle_kp_compile(k);
 }
 
 void yaw_kp_configure(const tnt_config *config, KpArray *k, int mode){
@@ -186,6 +231,7 @@ void yaw_kp_configure(const tnt_config *config, KpArray *k, int mode){
 	} else if (k->angle_kp[1][1] >0 && k->angle_kp[1][0]>0) {
 		k->count = 1;
 	} else {k->count = 0;}
+	angle_kp_compile(k);
 }
 
 float erpm_scale(float lowvalue, float highvalue, float lowscale, float highscale, float abs_erpm){ 
@@ -247,10 +293,10 @@ void reset_pid(PidData *p, PidDebug *pid_dbg) {
 	pid_dbg->debug16 = 0;
 }
 
-void apply_soft_start(PidData *p, float mc_current_max) {
+void apply_soft_start(PidData *p, float mc_current_max, float dt_ratio) {
 	if (p->softstart_pid_limit < mc_current_max) {
 		p->pid_mod = fminf(fabsf(p->pid_mod), p->softstart_pid_limit) * sign(p->pid_mod);
-		p->softstart_pid_limit += p->softstart_step_size;
+		p->softstart_pid_limit += p->softstart_step_size * dt_ratio;
 	}
 }
 
@@ -267,7 +313,7 @@ void configure_pid(PidData *p, tnt_config *config) {
 float apply_pitch_kp(KpArray *accel_kp, KpArray *brake_kp, PidData *p, PidDebug *pid_dbg) {
 	//Select and Apply Pitch kp  
 	float kp_mod, new_pid_value;
-	kp_mod = angle_kp_select(p->abs_prop_smooth, 
+	kp_mod = angle_kp_lookup(p->abs_prop_smooth, 
 		p->brake_pitch ? brake_kp : accel_kp);
 	pid_dbg->debug1 = p->brake_pitch ? -kp_mod : kp_mod;
 	pid_dbg->debug8 = (p->stability_kp - 1) * kp_mod;  //stability contribution to pitch kp
@@ -291,7 +337,7 @@ float apply_roll_kp(KpArray *roll_accel_kp, KpArray *roll_brake_kp, PidData *p,
 	// Select Roll Kp
 	float rollkp = 0;
 	float pid_mod = 0;
-	rollkp = angle_kp_select(abs_roll_angle, 
+	rollkp = angle_kp_lookup(abs_roll_angle, 
 		p->brake_roll ? roll_brake_kp : roll_accel_kp);
 	pid_dbg->debug16 = max(abs_roll_angle, pid_dbg->debug16);
 	
@@ -318,7 +364,7 @@ float apply_yaw_kp(KpArray *yaw_accel_kp, KpArray *yaw_brake_kp, PidData *p, flo
 	//Select Yaw Kp
 	float yawkp = 0;
 	float pid_mod = 0;
-	yawkp = angle_kp_select(abs_change, 
+	yawkp = angle_kp_lookup(abs_change, 
 		p->brake_yaw ? yaw_brake_kp : yaw_accel_kp);
 	
 	//Apply ERPM Scale
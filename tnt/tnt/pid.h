@@ -27,10 +27,25 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#define KP_TABLE_SIZE 64
+
+typedef struct {
+	float x0;
+	float y0;
+	float slope;
+} KpCell;
+
 typedef struct {
 	float angle_kp[7][2];
 	int count;
 	float kp_rate;
+
+	// Curve compiled by the configure functions for angle_kp_lookup(): the
+	// line through the curve at both ends of each of the uniform cells over 0
+	// to the last point, and the flat line after the last point
+	float last;
+	float inv_step;
+	KpCell cell[KP_TABLE_SIZE + 1];
 } KpArray;
 
 typedef struct {
@@ -76,13 +91,15 @@ void pitch_kp_configure(const tnt_config *config, KpArray *k, int mode);
 void roll_kp_configure(const tnt_config *config, KpArray *k, int mode);
 void yaw_kp_configure(const tnt_config *config, KpArray *k, int mode);
 float angle_kp_select(float angle, const KpArray *k);
+float angle_kp_lookup(float angle, const KpArray *k);
+void angle_kp_compile(KpArray *k);
 void angle_kp_reset(KpArray *k);
 float erpm_scale(float lowvalue, float highvalue, float lowscale, float highscale, float abs_erpm); 
 void apply_stability(PidData *p, float abs_erpm, float inputtilt_interpolated, tnt_config *config);
 void check_brake_kp(PidData *p, State *state, tnt_config *config, KpArray *roll_brake_kp, KpArray *yaw_brake_kp);
 float roll_erpm_scale(PidData *p, State *state, float abs_erpm, KpArray *roll_accel_kp, tnt_config *config);
 void reset_pid(PidData *p, PidDebug *pid_dbg);
-void apply_soft_start(PidData *p, float mc_current_max);
+void apply_soft_start(PidData *p, float mc_current_max, float dt_ratio);
 void configure_pid(PidData *p, tnt_config *config);
 float apply_pitch_kp(KpArray *accel_kp, KpArray *brake_kp, PidData *p, PidDebug *pid_dbg);
 float apply_kp_rate(KpArray *accel_kp, KpArray *brake_kp, bool braking, PidDebug *pid_dbg);
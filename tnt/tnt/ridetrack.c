@@ -111,7 +111,7 @@ void carve_tracking(RuntimeData *rt, YawData *yaw, RideTrackData *ridetrack, tnt
 	} else {
 		ridetrack->max_carve_chain = fmaxf(ridetrack->max_carve_chain, ridetrack->carve_chain);
 		ridetrack->max_yaw_temp = fmaxf( ridetrack->max_yaw_temp, yaw->abs_change > 1500.0 / config->hertz ? 0 : yaw->abs_change);
-		ridetrack->max_roll_temp = fmaxf( ridetrack->max_roll_temp, rt->abs_roll_angle);
+		ridetrack->max_roll_temp = fmaxf( ridetrack->max_roll_temp, fabsf(rt->roll_kalman));
 	}
 	ridetrack->last_yaw_sign = ridetrack->yaw_sign;
 	ridetrack->carves_mile = ridetrack->carves_total / ridetrack->distance;
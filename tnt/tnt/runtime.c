@@ -23,50 +23,72 @@
 #include "kalman.h"
 
 void runtime_data_update(RuntimeData *rt) {
-	// Update times
+	// Update times, diff_time is measured by the loop timer
 	rt->current_time = VESC_IF->system_time();
-	if (rt->last_time == 0) {
-		rt->last_time = rt->current_time;
-	}
-	rt->diff_time = rt->current_time - rt->last_time;
-	rt->last_time = rt->current_time;
 	
 	// Get the IMU Values
 	float roll_rad = VESC_IF->imu_get_roll();
+	float pitch_rad = VESC_IF->imu_get_pitch();
 	rt->roll_angle = rad2deg(roll_rad);
 	rt->abs_roll_angle = fabsf(rt->roll_angle);
 	rt->true_pitch_angle = rad2deg(VESC_IF->ahrs_get_pitch(&rt->m_att_ref)); // True pitch is derived from the secondary IMU filter running with kp=0.2
-	rt->pitch_angle = rad2deg(VESC_IF->imu_get_pitch());
+	rt->pitch_angle = rad2deg(pitch_rad);
 	VESC_IF->imu_get_gyro(rt->gyro);
 	rt->gyro_y = rt->gyro[1];
-	rt->gyro_z = sinf(roll_rad) * sinf(roll_rad) * rt->gyro[1] - cosf(roll_rad) * sinf(roll_rad) * rt->gyro[2];
+	float sin_roll = sinf(roll_rad);
+	float cos_roll = cosf(roll_rad);
+	rt->gyro_z = sin_roll * sin_roll * rt->gyro[1] - cos_roll * sin_roll * rt->gyro[2];
+	// Heading and roll rate from the body rates, for the Kalman filter. The AHRS roll and yaw are
+	// the negated Euler angles, so the rates are too.
+	rt->yaw_rate = (sin_roll * rt->gyro[1] - cos_roll * rt->gyro[2]) / fmaxf(cosf(pitch_rad), 0.1);
+	rt->roll_rate = -rt->gyro[0] + rt->yaw_rate * sinf(pitch_rad);
 	VESC_IF->imu_get_accel(rt->accel); //Used for drop detection
 	rt->yaw_angle = rad2deg(VESC_IF->ahrs_get_yaw(&rt->m_att_ref));
 }
 
 void apply_filters(RuntimeData *rt, tnt_config *config){
-	//Apply low pass and Kalman filters to pitch
+	//Apply low pass filter to pitch
 	if (config->pitch_filter > 0) 
 		rt->pitch_smooth = biquad_process(&rt->pitch_biquad, rt->pitch_angle);
 	else
 		rt->pitch_smooth = rt->pitch_angle;
 
+	//Roll and yaw start from the IMU, on startup there is no reading yet when configured
+	if (!rt->kalman_seeded) {
+		reset_kalman(&rt->kalman, KALMAN_ROLL, rt->roll_angle);
+		reset_kalman(&rt->kalman, KALMAN_YAW, rt->yaw_angle);
+		rt->kalman_seeded = true;
+	}
+
+	//Kalman filter of all axes. Yaw is unwrapped onto the turn of the estimate, so the sign flip at 180 is no step
+	float yaw = rt->yaw_angle;
+	float yaw_diff = yaw - rt->kalman.angle[KALMAN_YAW];
+	if (yaw_diff > 180) {
+		yaw -= 360;
+	} else if (yaw_diff < -180) {
+		yaw += 360;
+	}
+	float in[KALMAN_AXES] = {rt->pitch_smooth, rt->roll_angle, yaw};
+	float in_rate[KALMAN_AXES] = {rt->gyro[1], rt->roll_rate, rt->yaw_rate};
+	apply_kalman(in, in_rate, rt->diff_time, &rt->kalman);
+
+	//Keep the yaw estimate within 180 so it doesn't lose precision over many turns
+	if (rt->kalman.angle[KALMAN_YAW] > 180) {
+		rt->kalman.angle[KALMAN_YAW] -= 360;
+	} else if (rt->kalman.angle[KALMAN_YAW] < -180) {
+		rt->kalman.angle[KALMAN_YAW] += 360;
+	}
+
 	if (config->kalman_factor1 > 0) 
-		 apply_kalman(rt->pitch_smooth, rt->gyro[1], &rt->pitch_smooth_kalman, rt->diff_time, &rt->pitch_kalman);
+		rt->pitch_smooth_kalman = rt->kalman.angle[KALMAN_PITCH];
 	else 
 		rt->pitch_smooth_kalman = rt->pitch_smooth;
+	rt->roll_kalman = rt->kalman.angle[KALMAN_ROLL];
 }
 
 void calc_yaw_change(YawData *yaw, RuntimeData *rt, YawDebugData *yaw_dbg, int hertz){ 
-	float new_change = (rt->yaw_angle - yaw->last_angle) / rt->imu_rate_factor;
-	//if ((new_change == 0) || // Exact 0's only happen when the IMU is not updating between loops
-	//    (fabsf(new_change) > 100)) { // yaw flips signs at 180, ignore those changes
-	//	new_change = yaw->last_change;
-	//}
-	if (sign(rt->yaw_angle) != sign(yaw->last_angle)) // yaw flips signs at 180, ignore those changes
-		new_change = yaw->last_change;
-	yaw->last_change = new_change;
-	yaw->last_angle = rt->yaw_angle;
+	//Change per loop from the bias corrected yaw rate, scaled by the rate factor like the yaw curves
+	float new_change = rt->kalman.rate[KALMAN_YAW] * rt->diff_time / rt->imu_rate_factor;
 	ema(&yaw->change, 0.2 * 832 / hertz, new_change); //originally configured for 0.2 at 832 Hz
 	yaw->abs_change = fabsf(yaw->change);
 	yaw_dbg->debug1 = yaw->change;
@@ -78,13 +100,11 @@ void reset_runtime(RuntimeData *rt, YawData *yaw, YawDebugData *yaw_dbg) {
 	rt->pitch_smooth = rt->pitch_angle;
 	biquad_reset(&rt->pitch_biquad);
 	
-	//Kalman filter
-	reset_kalman(&rt->pitch_kalman);
+	//Kalman filter, roll and yaw keep running with their bias
+	reset_kalman(&rt->kalman, KALMAN_PITCH, rt->pitch_angle);
 	rt->pitch_smooth_kalman = rt->pitch_angle;
 
 	//Yaw
-	yaw->last_angle = rad2deg(VESC_IF->ahrs_get_yaw(&rt->m_att_ref));
-	yaw->last_change = 0;
 	yaw->abs_change = 0;
 	yaw_dbg->debug2 = 0;
 	yaw_dbg->debug3 = 0;
@@ -96,8 +116,8 @@ void configure_runtime(RuntimeData *rt, tnt_config *config) {
 	// This timer is used to determine how long the board has been disengaged / idle. subtract 1 second to prevent the haptic buzz disengage click on "write config"
 	rt->disengage_timer = rt->current_time - 1;
 
-	// Loop time in microseconds
-	rt->loop_time_us = 1e6 / config->hertz;
+	// Loop time in seconds
+	rt->loop_period = 1.0f / config->hertz;
 
 	// Loop time in seconds times 20 for a nice long grace period
 	rt->motor_timeout_s = 20.0f / config->hertz;
@@ -105,8 +125,9 @@ void configure_runtime(RuntimeData *rt, tnt_config *config) {
 	//Pitch Biquad Configure
 	biquad_configure(&rt->pitch_biquad, BQ_LOWPASS, 1.0 * config->pitch_filter / config->hertz); 
 
-	//Pitch Kalman Configure
-	configure_kalman(config, &rt->pitch_kalman);
+	//Kalman Configure, pitch is reset on engage and roll and yaw on the next IMU reading
+	configure_kalman(config, &rt->kalman);
+	rt->kalman_seeded = false;
 
 	//Yaw change correction factor
 	rt->imu_rate_factor = lerp(832, 10000, 1, 2, config->hertz);
@@ -135,3 +156,38 @@ void check_odometer(RuntimeData *rt) {
 		}
 	}
 }
+
+void loop_timer_start(RuntimeData *rt) {
+	// Deadline scheduling: each loop has a deadline one period after the previous one, lateness of
+	// the wakeup is taken from the next sleep so the average loop rate matches the configured hertz.
+	uint32_t now = VESC_IF->timer_time_now();
+	if (!rt->loop_started) {
+		rt->loop_started = true;
+		rt->diff_time = rt->loop_period;
+		rt->loop_deadline = rt->loop_period;
+	} else {
+		float elapsed = VESC_IF->timer_seconds_elapsed_since(rt->loop_start);
+		float lateness = fmaxf(elapsed - rt->loop_deadline, 0);
+		rt->diff_time = elapsed;
+		rt->loop_lateness_max = fmaxf(rt->loop_lateness_max, lateness);
+		if (lateness < rt->loop_period) {
+			rt->loop_deadline = rt->loop_period - lateness;
+		} else { // Missed deadlines, realign to now instead of running a burst of loops
+			rt->loop_missed += (uint32_t) (lateness / rt->loop_period);
+			rt->loop_deadline = rt->loop_period;
+		}
+	}
+	rt->loop_start = now;
+	rt->dt_ratio = clampf(rt->diff_time / rt->loop_period, 0.25, 4); // Limit the step after long stalls
+}
+
+void loop_timer_wait(RuntimeData *rt) {
+	float remaining = rt->loop_deadline - VESC_IF->timer_seconds_elapsed_since(rt->loop_start);
+	uint32_t min_sleep_us = 1000000 / SYSTEM_TICK_RATE_HZ; // Always yield to lower priority threads
+	if (remaining <= 0) {
+		rt->loop_overruns++;
+		VESC_IF->sleep_us(min_sleep_us);
+	} else {
+		VESC_IF->sleep_us(fmaxf(remaining * 1e6, min_sleep_us));
+	}
+}
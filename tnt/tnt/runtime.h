@@ -34,15 +34,24 @@ typedef struct { //Run time values used in various features
 	float gyro[3];
 	float gyro_y;
 	float gyro_z;
+	float roll_rate, yaw_rate; // Euler angle rates from the gyro, deg/s
 	float pitch_smooth; // Low Pass Filter
 	Biquad pitch_biquad; // Low Pass Filter
-	KalmanFilter pitch_kalman; // Kalman Filter
+	KalmanFilter kalman; // Kalman Filter of pitch, roll and yaw
+	bool kalman_seeded; // Roll and yaw Kalman start from the first IMU reading after configure
 	float pitch_smooth_kalman; // Kalman Filter
-	float diff_time, last_time;
+	float roll_kalman; // Kalman Filter
+	float diff_time; // Real loop period, measured by the loop timer
 	ATTITUDE_INFO m_att_ref; // Feature: True Pitch / Yaw
 	bool brake_pitch, brake_roll, brake_yaw;
 	float disengage_timer, nag_timer;
-	uint32_t loop_time_us;
+	float loop_period; // Nominal loop period in seconds
+	uint32_t loop_start; // Loop timer: start of the current loop in timer_time_now() units
+	float loop_deadline; // Loop timer: deadline of the current loop in seconds after loop_start
+	bool loop_started;
+	float dt_ratio; // Real loop period divided by the nominal one, scales per-loop step sizes
+	uint32_t loop_overruns, loop_missed; // Loops that ended after their deadline, whole periods skipped
+	float loop_lateness_max; // Seconds
 	float motor_timeout_s;
 	float odo_timer;
 	int odometer_dirty;
@@ -54,8 +63,6 @@ typedef struct { //Run time values used in various features
 } RuntimeData;
 
 typedef struct {
-	float last_angle;
-	float last_change;
 	float change;
 	float abs_change;
 	float aggregate;
@@ -76,3 +83,5 @@ void calc_yaw_change(YawData *yaw, RuntimeData *rt, YawDebugData *yaw_dbg, int h
 void reset_runtime(RuntimeData *rt, YawData *yaw, YawDebugData *yaw_dbg);
 void configure_runtime(RuntimeData *rt, tnt_config *config);
 void check_odometer(RuntimeData *rt);
+void loop_timer_start(RuntimeData *rt);
+void loop_timer_wait(RuntimeData *rt);
@@ -67,23 +67,23 @@ float get_setpoint_adjustment_step_size(SetpointData *s, State *state) {
 	}
 }
 
-void calculate_setpoint_interpolated(SetpointData *s, State *state) {
+void calculate_setpoint_interpolated(SetpointData *s, State *state, RuntimeData *rt) {
     if (s->setpoint_target_interpolated != s->setpoint_target) {
         rate_limitf(
             &s->setpoint_target_interpolated,
             s->setpoint_target,
-            get_setpoint_adjustment_step_size(s, state) 
+            get_setpoint_adjustment_step_size(s, state) * rt->dt_ratio
 	);
     }
 }
 
-void apply_noseangling(SetpointData *s, MotorData *motor, tnt_config *config) {
+void apply_noseangling(SetpointData *s, MotorData *motor, RuntimeData *rt, tnt_config *config) {
 	float noseangling_target = 0;
 	if (motor->abs_erpm > config->tiltback_constant_erpm) {
 		noseangling_target += config->tiltback_constant * motor->erpm_sign;
 	}
 
-	rate_limitf(&s->noseangling_interpolated, noseangling_target, s->noseangling_step_size);
+	rate_limitf(&s->noseangling_interpolated, noseangling_target, s->noseangling_step_size * rt->dt_ratio);
 
 	s->setpoint += s->noseangling_interpolated;
 }
@@ -39,7 +39,7 @@ typedef struct {
 void setpoint_configure(SetpointData *s, tnt_config *config);
 void setpoint_reset(SetpointData *s, tnt_config *config, RuntimeData *rt);
 float get_setpoint_adjustment_step_size(SetpointData *s, State *state);
-void calculate_setpoint_interpolated(SetpointData *s, State *state);
-void apply_noseangling(SetpointData *s, MotorData *motor, tnt_config *config);
+void calculate_setpoint_interpolated(SetpointData *s, State *state, RuntimeData *rt);
+void apply_noseangling(SetpointData *s, MotorData *motor, RuntimeData *rt, tnt_config *config);
 void calculate_setpoint_target(SetpointData *spd, State *state, MotorData *motor, RuntimeData *rt, 
     tnt_config *config, float proportional);
@@ -0,0 +1,40 @@
+// Copyright 2026 VESC project
+//
+// This file is part of the VESC package.
+//
+// This VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// This VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// Stages of the main loop, timed by the host simulation (see /sim). In the
+// package build the marks compile to nothing.
+typedef enum {
+	STAGE_SENSORS = 0,	// IMU, filters, motor data, remote, tones, footpad, ride tracking
+	STAGE_SETPOINT,		// Faults, setpoint, input tilt, noseangling, stability
+	STAGE_KP,		// Pitch, roll and yaw kp, soft start
+	STAGE_TRACTION,		// Current limit, surge, traction control and braking
+	STAGE_OUTPUT,		// PID value and motor command
+	STAGE_IDLE,		// Startup and ready states
+	STAGE_COUNT
+} LoopStage;
+
+#ifdef TNT_SIM
+// Starts timing the first stage of a loop
+void stage_timer_start(void);
+// Records the time since the last mark as stage
+void stage_timer_end(LoopStage stage);
+#else
+static inline void stage_timer_start(void) {}
+static inline void stage_timer_end(LoopStage stage) { (void)stage; }
+#endif
@@ -20,19 +20,8 @@
 
 #include "vesc_c_if.h"
 
-#include "runtime.h"
-#include "footpad_sensor.h"
-#include "motor_data_tnt.h"
-#include "state_tnt.h"
-#include "pid.h"
-#include "setpoint.h"
-#include "kalman.h"
-#include "traction.h"
-#include "surge.h"
-#include "utils_tnt.h"
-#include "remote_input.h"
-#include "foc_tone.h"
-#include "ridetrack.h"
+#include "tnt.h"
+#include "stage_timer.h"
 
 #include "conf/datatypes.h"
 #include "conf/confparser.h"
@@ -45,51 +34,6 @@
 
 HEADER
 
-// This is all persistent state of the application, which will be allocated in init. It
-// is put here because variables can only be read-only when this program is loaded
-// in flash without virtual memory in RAM (as all RAM already is dedicated to the
-// main firmware and managed from there). This is probably the main limitation of
-// loading applications in runtime, but it is not too bad to work around.
-typedef struct {
-	lib_thread main_thread;
-	tnt_config tnt_conf;
-
-	// Firmware version, passed in from Lisp
-	int fw_version_major, fw_version_minor, fw_version_beta;
-
-	//Essentials for an operating board with Trick and Trail control algorithm
-  	MotorData motor;			//Motor data
-	State state;				//Runtime state values
-	PidData pid;				//control variables
-	PidDebug pid_dbg;			//additional control variable information
-	SetpointData spd;			//Board angle changes
-	RuntimeData rt; 			//runtime data (IMU, times, etc)
-	FootpadSensor footpad_sensor;		//Footpad states and detection
-	YawData yaw;				//Yaw change data
-	YawDebugData yaw_dbg;			//Yaw debug
-
-	// Throttle/Brake Curves for Pitch Roll and Yaw
-	KpArray accel_kp;
-	KpArray brake_kp;
-	KpArray roll_accel_kp;
-	KpArray roll_brake_kp;
-	KpArray yaw_accel_kp;
-	KpArray yaw_brake_kp;
-
-	//Non-essential Features
-	ToneData tone;				//FOC play tones feature
-	ToneConfigs tone_config;		//Configurations for different beep profiles
-	RemoteData remote;			//Read and apply input remote
-	StickyTiltData st_tilt;			//Use input remote to lock in board angle
-	SurgeData surge;			//Temporary duty control mode
-	SurgeDebug surge_dbg;			//Surge debug info
-	TractionData traction;			//Traction control for accelerating
-	TractionDebug traction_dbg;		//traction control debug info
-	BrakingData braking;			//Traction control for braking
-	BrakingDebug braking_dbg;		//Braking debug info
-	RideTrackData ridetrack;		//Trip tracking data
-} data;
-
 static void configure(data *d) {
 	state_init(&d->state, d->tnt_conf.disable_pkg);				//Initialize
 	configure_runtime(&d->rt, &d->tnt_conf);				//runtime data (IMU, times, etc)
@@ -184,6 +128,8 @@ static void tnt_thd(void *arg) {
 	configure(d);
 
 	while (!VESC_IF->should_terminate()) {
+		loop_timer_start(&d->rt);
+		stage_timer_start();
 		runtime_data_update(&d->rt);
 		apply_filters(&d->rt, &d->tnt_conf);
 		motor_data_update(&d->motor, &d->tnt_conf);
@@ -193,6 +139,7 @@ static void tnt_thd(void *arg) {
 	        footpad_sensor_update(&d->footpad_sensor, &d->tnt_conf);
 		ride_tracking_update(&d->ridetrack, &d->rt, &d->yaw, &d->tnt_conf);
 	      	d->pid.new_pid_value = 0;		
+		stage_timer_end(STAGE_SENSORS);
 
 		// Control Loop State Logic
 		switch(d->state.state) {
@@ -201,6 +148,7 @@ static void tnt_thd(void *arg) {
 				reset_vars(d);
 				d->state.state = STATE_READY;
             		}
+			stage_timer_end(STAGE_IDLE);
            		break;
 		case (STATE_RUNNING):	
 			// Check for faults
@@ -211,6 +159,7 @@ static void tnt_thd(void *arg) {
 					d->spd.startup_pitch_tolerance = d->tnt_conf.startup_pitch_tolerance + d->spd.startup_pitch_trickmargin;
 					d->rt.fault_angle_pitch_timer = d->rt.current_time;
 				}
+				stage_timer_end(STAGE_SETPOINT);
 				break;
 			}
 
@@ -223,7 +172,7 @@ static void tnt_thd(void *arg) {
 			
 			// Calculate setpoint and interpolation
 			calculate_setpoint_target(&d->spd, &d->state, &d->motor, &d->rt, &d->tnt_conf, d->pid.proportional);
-			calculate_setpoint_interpolated(&d->spd, &d->state);
+			calculate_setpoint_interpolated(&d->spd, &d->state, &d->rt);
 			d->spd.setpoint = d->spd.setpoint_target_interpolated;
 
 			//Apply Remote Tilt and Sticky Tilt
@@ -234,7 +183,7 @@ static void tnt_thd(void *arg) {
 			d->spd.setpoint += d->tnt_conf.enable_throttle_stability ? 0 : d->remote.setpoint; //Don't apply if we are using the throttle for stability
 
 			//Adjust Setpoint as required
-			apply_noseangling(&d->spd, &d->motor, &d->tnt_conf);
+			apply_noseangling(&d->spd, &d->motor, &d->rt, &d->tnt_conf);
 
 			//Apply Stability
 			if (d->tnt_conf.enable_speed_stability || 
@@ -243,6 +192,7 @@ static void tnt_thd(void *arg) {
 			
 			// Calculate proportional difference for raw and filtered pitch
 			calculate_proportional(&d->rt, &d->pid, d->spd.setpoint);
+			stage_timer_end(STAGE_SETPOINT);
 
 			//Check for braking conditions and braking curves, and kp values for pitch roll and yaw
 			d->state.braking_pos = sign(d->pid.proportional) != d->motor.erpm_sign;
@@ -252,8 +202,9 @@ static void tnt_thd(void *arg) {
 			//Apply Pitch, Roll, Yaw Kp, and Soft Start
 			d->pid.new_pid_value = apply_pitch_kp(&d->accel_kp, &d->brake_kp, &d->pid, &d->pid_dbg);
 			apply_kp_modifiers(d);			//Roll Yaw
-			apply_soft_start(&d->pid, d->motor.mc_current_max);	//Soft start
+			apply_soft_start(&d->pid, d->motor.mc_current_max, d->rt.dt_ratio);	//Soft start
 			d->pid.new_pid_value += d->pid.pid_mod;
+			stage_timer_end(STAGE_KP);
 			
 			// Current Limiting
 			float current_limit = d->motor.braking ? d->motor.mc_current_min : d->motor.mc_current_max;
@@ -273,6 +224,7 @@ static void tnt_thd(void *arg) {
 			check_traction(&d->motor, &d->traction, &d->state, &d->tnt_conf,
 			    &d->pid, &d->traction_dbg);
 			check_tone(&d->tone, &d->tone_config, &d->motor);
+			stage_timer_end(STAGE_TRACTION);
 			
 			// PID value application
 			//d->pid.pid_value = (d->state.wheelslip && d->tnt_conf.is_traction_enabled) ? 0 : d->pid.new_pid_value; 
@@ -288,7 +240,7 @@ static void tnt_thd(void *arg) {
 				set_brake(d->pid.pid_value, &d->rt);			// Use braking function for traction control
 			else
 				set_current(d->pid.pid_value, &d->rt); 			// Set current as normal.
-
+			stage_timer_end(STAGE_OUTPUT);
 			break;
 
 		case (STATE_READY):
@@ -306,6 +258,7 @@ static void tnt_thd(void *arg) {
 				fabsf(d->rt.roll_angle) < 45 && 	//d->tnt_conf.startup_roll_tolerance && 
 				is_engaged(&d->footpad_sensor, &d->rt, &d->tnt_conf)) {
 				reset_vars(d);
+				stage_timer_end(STAGE_IDLE);
 				break;
 			}
 			
@@ -316,19 +269,21 @@ static void tnt_thd(void *arg) {
 					// 45 to prevent board engaging when upright or laying sideways
 					// 45 degree tolerance is more than plenty for tricks / extreme mounts
 					reset_vars(d);
+					stage_timer_end(STAGE_IDLE);
 					break;
 				}
 			}
 
 			brake(d->tnt_conf.brake_current, &d->rt, &d->motor);
+			stage_timer_end(STAGE_IDLE);
 			break;
 		case (STATE_DISABLED):;
 			// no set_current, no brake_current
 		default:;
 		}
 
-		// Delay between loops
-		VESC_IF->sleep_us(d->rt.loop_time_us);
+		// Delay until the next loop deadline
+		loop_timer_wait(&d->rt);
 	}
 }
 
@@ -432,6 +387,14 @@ static float app_get_debug(int index) {
         return d->motor.current;
     case (9):
         return d->motor.current;
+    case (10):
+        return d->rt.diff_time;
+    case (11):
+        return d->rt.loop_overruns;
+    case (12):
+        return d->rt.loop_missed;
+    case (13):
+        return d->rt.loop_lateness_max;
     default:
         return 0;
     }
@@ -0,0 +1,84 @@
+// Copyright 2019 - 2022 Mitch Lustig
+// Copyright 2022 Benjamin Vedder <benjamin@vedder.se>
+// Copyright 2023 Michael Silberstein
+// Copyright 2024 Lukas Hrazky
+//
+// This file is part of the Trick and Trail VESC package.
+//
+// This VESC package is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// This VESC package is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+#include "vesc_c_if.h"
+
+#include "runtime.h"
+#include "footpad_sensor.h"
+#include "motor_data_tnt.h"
+#include "state_tnt.h"
+#include "pid.h"
+#include "setpoint.h"
+#include "kalman.h"
+#include "traction.h"
+#include "surge.h"
+#include "utils_tnt.h"
+#include "remote_input.h"
+#include "foc_tone.h"
+#include "ridetrack.h"
+
+#include "conf/datatypes.h"
+
+// This is all persistent state of the application, which will be allocated in init. It
+// is put here because variables can only be read-only when this program is loaded
+// in flash without virtual memory in RAM (as all RAM already is dedicated to the
+// main firmware and managed from there). This is probably the main limitation of
+// loading applications in runtime, but it is not too bad to work around.
+// It is in a header so that the host replay in /sim can read the loop state.
+typedef struct {
+	lib_thread main_thread;
+	tnt_config tnt_conf;
+
+	// Firmware version, passed in from Lisp
+	int fw_version_major, fw_version_minor, fw_version_beta;
+
+	//Essentials for an operating board with Trick and Trail control algorithm
+  	MotorData motor;			//Motor data
+	State state;				//Runtime state values
+	PidData pid;				//control variables
+	PidDebug pid_dbg;			//additional control variable information
+	SetpointData spd;			//Board angle changes
+	RuntimeData rt; 			//runtime data (IMU, times, etc)
+	FootpadSensor footpad_sensor;		//Footpad states and detection
+	YawData yaw;				//Yaw change data
+	YawDebugData yaw_dbg;			//Yaw debug
+
+	// Throttle/Brake Curves for Pitch Roll and Yaw
+	KpArray accel_kp;
+	KpArray brake_kp;
+	KpArray roll_accel_kp;
+	KpArray roll_brake_kp;
+	KpArray yaw_accel_kp;
+	KpArray yaw_brake_kp;
+
+	//Non-essential Features
+	ToneData tone;				//FOC play tones feature
+	ToneConfigs tone_config;		//Configurations for different beep profiles
+	RemoteData remote;			//Read and apply input remote
+	StickyTiltData st_tilt;			//Use input remote to lock in board angle
+	SurgeData surge;			//Temporary duty control mode
+	SurgeDebug surge_dbg;			//Surge debug info
+	TractionData traction;			//Traction control for accelerating
+	TractionDebug traction_dbg;		//traction control debug info
+	BrakingData braking;			//Traction control for braking
+	BrakingDebug braking_dbg;		//Braking debug info
+	RideTrackData ridetrack;		//Trip tracking data
+} data;
@@ -4,9 +4,10 @@
 
 (defun esc-request (code) {
     (var success true)
+    ; All ESCs are asked at once, so this takes one round trip
+    (var rets (rcode-run-all config-can-id-esc 0.2 code))
     (looprange i 0 (length config-can-id-esc) {
-        (var ret (rcode-run (ix config-can-id-esc i) 0.2 code))
-        (match ret
+        (match (ix rets i)
             (timeout {
                 (print (str-merge "esc-request: timeout with esc id " (to-str (ix config-can-id-esc i))))
                 (setq success false)